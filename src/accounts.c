@@ -9,6 +9,25 @@
 #include <dirent.h>
 
 #define ACCT_INDEX_FILE (LIB_ACCTFILES "index.txt")
+#define ACCT_INDEX_MIN_SLOTS 64   /* smallest name table; a power of two */
+
+struct acct_index_entry {
+  long id;
+  char name[128];
+};
+
+static struct {
+  struct acct_index_entry *entries;  /* in file order */
+  int count, size;
+  int *slots;                        /* entries by name, -1 if empty */
+  int num_slots;
+  long max_id;
+  int loaded;
+  ino_t file_ino;                    /* the file the cache came from */
+  off_t file_size;
+  time_t file_mtime;
+  long hits, misses, reloads;
+} acct_index;
 
 static int ensure_account_dirs(void);
 static void account_debug_log(const char *format, ...);
@@ -100,105 +119,248 @@ static void get_account_filename(char *out, size_t len, long account_id)
   account_resolve_path(out, len, relative);
 }
 
-static int index_find(const char *acct_name, long *out_id)
+/* The account index lives in memory: entries in file order for
+ * account_foreach_index(), plus an open-addressing table over the lowercased
+ * names.  The file is reloaded only when something else has replaced it. */
+static unsigned long index_name_hash(const char *name)
 {
-  FILE *fp;
-  long id = 0;
-  char name[128];
-  char path[PATH_MAX];
-  static int warned = 0;
+  unsigned long h = 2166136261UL;
 
-  if (!out_id) return 0;
-  *out_id = 0;
+  for (; *name; name++) {
+    h ^= (unsigned char) LOWER(*name);
+    h *= 16777619UL;
+  }
+  return h;
+}
 
-  account_resolve_path(path, sizeof(path), ACCT_INDEX_FILE);
+static int index_slot_lookup(const char *acct_name)
+{
+  unsigned long i;
+  int pos;
 
-  fp = fopen(path, "r");
-  if (!fp) {
-    if (!warned) {
-      mudlog(CMP, LVL_IMPL, TRUE, "SYSERR: Unable to open account index %s: %s", path, strerror(errno));
-      warned = 1;
-    }
-    ensure_account_dirs();
-    return 0;
+  if (!acct_index.num_slots)
+    return -1;
+
+  for (i = index_name_hash(acct_name) & (acct_index.num_slots - 1);
+       (pos = acct_index.slots[i]) != -1;
+       i = (i + 1) & (acct_index.num_slots - 1))
+    if (!strcasecmp(acct_index.entries[pos].name, acct_name))
+      return pos;
+
+  return -1;
+}
+
+static void index_rehash(void)
+{
+  int want = ACCT_INDEX_MIN_SLOTS;
+
+  while (want < acct_index.count * 4)
+    want <<= 1;
+
+  if (want != acct_index.num_slots) {
+    free(acct_index.slots);
+    CREATE(acct_index.slots, int, want);
+    acct_index.num_slots = want;
   }
 
-  while (fscanf(fp, "%ld %127s", &id, name) == 2) {
-    if (!strcasecmp(name, acct_name)) {
-      fclose(fp);
-      *out_id = id;
-      return 1;
-    }
+  for (int i = 0; i < acct_index.num_slots; i++)
+    acct_index.slots[i] = -1;
+
+  for (int pos = 0; pos < acct_index.count; pos++) {
+    unsigned long i = index_name_hash(acct_index.entries[pos].name) & (acct_index.num_slots - 1);
+
+    /* The first entry for a name wins, as it did when the file was scanned. */
+    if (index_slot_lookup(acct_index.entries[pos].name) != -1)
+      continue;
+    while (acct_index.slots[i] != -1)
+      i = (i + 1) & (acct_index.num_slots - 1);
+    acct_index.slots[i] = pos;
   }
+}
 
-  fclose(fp);
-  return 0;
+static void index_append_entry(long id, const char *acct_name)
+{
+  struct acct_index_entry *entry;
+
+  if (acct_index.count == acct_index.size) {
+    acct_index.size = acct_index.size ? acct_index.size * 2 : 64;
+    RECREATE(acct_index.entries, struct acct_index_entry, acct_index.size);
+  }
+
+  entry = &acct_index.entries[acct_index.count++];
+  entry->id = id;
+  strlcpy(entry->name, acct_name, sizeof(entry->name));
+
+  if (id > acct_index.max_id)
+    acct_index.max_id = id;
+
+  if (acct_index.count * 2 > acct_index.num_slots)
+    index_rehash();
+  else if (index_slot_lookup(acct_name) == -1) {
+    unsigned long i = index_name_hash(acct_name) & (acct_index.num_slots - 1);
+
+    while (acct_index.slots[i] != -1)
+      i = (i + 1) & (acct_index.num_slots - 1);
+    acct_index.slots[i] = acct_index.count - 1;
+  }
 }
 
-static long index_next_id(void)
+/* Remembers which copy of the file the cache was built from. */
+static void index_note_file(const char *path)
+{
+  struct stat st;
+
+  if (stat(path, &st) == 0) {
+    acct_index.file_ino = st.st_ino;
+    acct_index.file_size = st.st_size;
+    acct_index.file_mtime = st.st_mtime;
+  } else {
+    acct_index.file_ino = 0;
+    acct_index.file_size = -1;
+    acct_index.file_mtime = 0;
+  }
+}
+
+static void index_load(const char *path)
 {
   FILE *fp;
-  long id = 0, max_id = 0;
+  long id = 0;
   char name[128];
+
+  acct_index.count = 0;
+  acct_index.max_id = 0;
+  for (int i = 0; i < acct_index.num_slots; i++)
+    acct_index.slots[i] = -1;
+
+  if ((fp = fopen(path, "r")) != NULL) {
+    while (fscanf(fp, "%ld %127s", &id, name) == 2)
+      index_append_entry(id, name);
+    fclose(fp);
+  }
+
+  index_rehash();
+  index_note_file(path);
+  acct_index.loaded = 1;
+  acct_index.reloads++;
+}
+
+/* Loads the index the first time, and again if the file was replaced. */
+static void index_refresh(void)
+{
   char path[PATH_MAX];
+  struct stat st;
+  int changed;
 
   account_resolve_path(path, sizeof(path), ACCT_INDEX_FILE);
 
-  fp = fopen(path, "r");
-  if (!fp) return 1;
-
-  while (fscanf(fp, "%ld %127s", &id, name) == 2)
-    if (id > max_id) max_id = id;
+  if (stat(path, &st) == 0)
+    changed = st.st_ino != acct_index.file_ino || st.st_size != acct_index.file_size ||
+              st.st_mtime != acct_index.file_mtime;
+  else
+    changed = acct_index.file_size != -1;
 
-  fclose(fp);
-  return max_id + 1;
+  if (!acct_index.loaded || changed)
+    index_load(path);
 }
 
-static int index_add(long id, const char *acct_name)
+/* Writes the whole index to a temporary file and renames it into place. */
+static int index_write(void)
 {
   FILE *fp;
-  char path[PATH_MAX];
+  char path[PATH_MAX], tmp[PATH_MAX + 4];
+  int ok;
 
-  if (!acct_name || !*acct_name) return 0;
+  account_resolve_path(path, sizeof(path), ACCT_INDEX_FILE);
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
 
-  if (!ensure_account_dirs())
+  if (!(fp = fopen(tmp, "w"))) {
+    mudlog(CMP, LVL_IMPL, TRUE, "SYSERR: Unable to write account index %s: %s", tmp, strerror(errno));
     return 0;
+  }
 
-  account_resolve_path(path, sizeof(path), ACCT_INDEX_FILE);
-  fp = fopen(path, "a");
-  if (!fp) {
-    mudlog(CMP, LVL_IMPL, TRUE, "SYSERR: Unable to append account index %s: %s", path, strerror(errno));
+  for (int i = 0; i < acct_index.count; i++)
+    fprintf(fp, "%ld %s\n", acct_index.entries[i].id, acct_index.entries[i].name);
+
+  ok = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+  if (fclose(fp) != 0)
+    ok = 0;
+
+  if (!ok || rename(tmp, path) != 0) {
+    mudlog(CMP, LVL_IMPL, TRUE, "SYSERR: Unable to replace account index %s: %s", path, strerror(errno));
+    unlink(tmp);
     return 0;
   }
 
-  fprintf(fp, "%ld %s\n", id, acct_name);
-  fclose(fp);
+  index_note_file(path);
   return 1;
 }
 
+/* Loads the account index at boot so the first login does not have to. */
+void account_index_boot(void)
+{
+  ensure_account_dirs();
+  index_refresh();
+  log("   %d accounts in the account index.", acct_index.count);
+}
+
+static int index_find(const char *acct_name, long *out_id)
+{
+  int pos;
+
+  if (!out_id) return 0;
+  *out_id = 0;
+
+  if (!acct_name)
+    return 0;
+
+  index_refresh();
+
+  if ((pos = index_slot_lookup(acct_name)) == -1) {
+    acct_index.misses++;
+    return 0;
+  }
+
+  acct_index.hits++;
+  *out_id = acct_index.entries[pos].id;
+  return 1;
+}
+
+static long index_next_id(void)
+{
+  index_refresh();
+  return acct_index.max_id + 1;
+}
+
+static int index_add(long id, const char *acct_name)
+{
+  if (!acct_name || !*acct_name) return 0;
+
+  if (!ensure_account_dirs())
+    return 0;
+
+  index_refresh();
+  index_append_entry(id, acct_name);
+  return index_write();
+}
+
 int account_foreach_index(int (*cb)(long id, const char *name, void *arg), void *arg)
 {
-  FILE *fp;
-  long id = 0;
-  char name[128];
-  char path[PATH_MAX];
+  struct acct_index_entry entry;
   int count = 0;
 
   if (!cb)
     return 0;
 
-  account_resolve_path(path, sizeof(path), ACCT_INDEX_FILE);
-  fp = fopen(path, "r");
-  if (!fp)
-    return 0;
+  index_refresh();
 
-  while (fscanf(fp, "%ld %127s", &id, name) == 2) {
+  /* Work from a copy in case the callback adds an account. */
+  for (int i = 0; i < acct_index.count; i++) {
+    entry = acct_index.entries[i];
     count++;
-    if (!cb(id, name, arg))
+    if (!cb(entry.id, entry.name, arg))
       break;
   }
 
-  fclose(fp);
   return count;
 }
 
@@ -626,17 +788,19 @@ void account_storage_report(void)
 {
   static int reported = 0;
 
-  if (reported)
+  if (!account_debugging_enabled())
     return;
 
-  reported = 1;
+  if (!reported) {
+    reported = 1;
 
-  if (!account_debugging_enabled())
-    return;
+    /* Attempt to bring directories online before reporting status. */
+    ensure_account_dirs();
+    report_storage_diagnostics();
+  }
 
-  /* Attempt to bring directories online before reporting status. */
-  ensure_account_dirs();
-  report_storage_diagnostics();
+  account_debug_log("Account index cache: %d entries, %ld hits, %ld misses, %ld reloads",
+                    acct_index.count, acct_index.hits, acct_index.misses, acct_index.reloads);
 }
 
 
@@ -2990,6 +2990,8 @@ ACMD(do_users)
   int low = 0, high = LVL_IMPL, num_can_see = 0;
   int showclass = 0, outlaws = 0, playing = 0, deadweight = 0;
   char buf[MAX_INPUT_LENGTH], arg[MAX_INPUT_LENGTH];
+  unsigned long zin, zout;
+  double zcpu;
 
   host_search[0] = name_search[0] = '\0';
 
@@ -3103,9 +3105,14 @@ ACMD(do_users)
     state, idletime, timestr);
 
     if (*d->host)
-      sprintf(line + strlen(line), "[%s]\r\n", d->host);
+      sprintf(line + strlen(line), "[%s]", d->host);
     else
-      strcat(line, "[Hostname unknown]\r\n");
+      strcat(line, "[Hostname unknown]");
+
+    /* MCCP: how much smaller the output got, and what it cost. */
+    if (compress_stats(d, &zin, &zout, &zcpu))
+      sprintf(line + strlen(line), " MCCP %.1f:1 %.1fms", zout ? (double) zin / zout : 0.0, zcpu);
+    strcat(line, "\r\n");
 
     if (STATE(d) != CON_PLAYING) {
       sprintf(line2, "%s%s%s", CCGRN(ch, C_SPR), line, CCNRM(ch, C_SPR));
@@ -19,6 +19,7 @@
 #include "screen.h"
 #include "spells.h"
 #include "act.h"
+#include "cmdtrie.h"
 
 /* local defined functions for local use */
 /* do_action and do_gmote utility function */
@@ -153,6 +154,9 @@ void create_command_list(void)
   }
 	complete_cmd_info[k] = cmd_info[i];
   log("Command info rebuilt, %d total commands.", k);
+
+  /* index the new list for command_interpreter() and find_command() */
+  cmd_trie_build(complete_cmd_info, cmd_info);
 }
 
 void free_command_list(void)
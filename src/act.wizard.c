@@ -22,6 +22,11 @@
 #include "constants.h"
 #include "oasis.h"
 #include "dg_scripts.h"
+#include "dg_event.h"
+#include "savequeue.h"
+#include "profiler.h"
+#include "logwriter.h"
+#include "ptable.h"
 #include "shop.h"
 #include "act.h"
 #include "genzon.h" /* for real_zone_by_thing */
@@ -1244,6 +1249,8 @@ ACMD(do_switch)
 
     victim->desc = ch->desc;
     ch->desc = NULL;
+    update_zone_player(ch);
+    update_zone_player(victim);
   }
 }
 
@@ -1279,7 +1286,9 @@ void return_to_char(struct char_data * ch)
 
   /* And our body's pointer to descriptor now points to our descriptor. */
   ch->desc->character->desc = ch->desc;
+  update_zone_player(ch->desc->character);
   ch->desc = NULL;  
+  update_zone_player(ch);
 }
 
 ACMD(do_return)
@@ -1468,6 +1477,7 @@ ACMD(do_purge)
 	  STATE(vict->desc) = CON_CLOSE;
 	  vict->desc->character = NULL;
 	  vict->desc = NULL;
+	  update_zone_player(vict);
 	}
       }
       extract_char(vict);
@@ -1564,6 +1574,7 @@ ACMD(do_advance)
     REMOVE_BIT_AR(PRF_FLAGS(victim), PRF_LOG2);
     REMOVE_BIT_AR(PRF_FLAGS(victim), PRF_NOHASSLE);
     REMOVE_BIT_AR(PRF_FLAGS(victim), PRF_HOLYLIGHT);
+    update_zone_player(victim);
     REMOVE_BIT_AR(PRF_FLAGS(victim), PRF_SHOWVNUMS);
     if (!PLR_FLAGGED(victim, PLR_NOWIZLIST))
       run_autowiz();
@@ -2488,9 +2499,10 @@ static size_t print_zone_to_buf(char *bufptr, size_t left, zone_rnum zone, int l
                         "         Mobiles:  %2d\r\n"
                         "         Shops:    %2d\r\n"
                         "         Triggers: %2d\r\n"
-                        "         Quests:   %2d\r\n",
+                        "         Quests:   %2d\r\n"
+                        "         Dormant:  %s\r\n",
 			buf, zone_table[zone].min_level, zone_table[zone].max_level,
-                        j, k, l, m, n, o);
+                        j, k, l, m, n, o, YESNO(zone_table[zone].dormant));
 
     return tmp;
   }
@@ -2534,6 +2546,9 @@ ACMD(do_show)
     { "thaco",      LVL_IMMORT },
     { "exp",        LVL_IMMORT },
     { "colour",     LVL_IMMORT },
+    { "events",     LVL_IMMORT },
+    { "saves",      LVL_IMMORT },			/* 15 */
+    { "profile",    LVL_IMMORT },
     { "\n", 0 }
   };
 
@@ -2677,8 +2692,9 @@ ACMD(do_show)
 	"  %5d objects          %5d prototypes\r\n"
 	"  %5d rooms            %5d zones\r\n"
   "  %5d triggers         %5d shops\r\n"
-  "  %5d large bufs       %5d autoquests\r\n"
+  "  %5d output chunks    %5d autoquests\r\n"
 	"  %5d buf switches     %5d overflows\r\n"
+	"  %5lu bytes copied/pulse\r\n"
 	"  %5d lists\r\n",
 	i, con,
 	top_of_p_table + 1,
@@ -2687,8 +2703,18 @@ ACMD(do_show)
 	top_of_world + 1, top_of_zone_table + 1,
 	top_of_trigt + 1, top_shop + 1,
 	buf_largecount, total_quests,
-	buf_switches, buf_overflows, global_lists->iSize
+	buf_switches, buf_overflows,
+	buf_copied / MAX(pulse, 1),
+	global_lists->iSize
 	);
+    {
+      struct log_writer_stats ls;
+
+      log_writer_stats(&ls);
+      send_to_char(ch,
+	"  %5lu log lines       %5lu dropped (%s, peak %d queued)\r\n",
+	ls.records, ls.dropped, ls.threaded ? "log thread" : "direct", ls.peak);
+    }
     break;
 
   /* show errors */
@@ -2819,6 +2845,91 @@ ACMD(do_show)
     page_string(ch->desc, buf, TRUE);
     break;
 
+  /* show event queue occupancy */
+  case 14:
+  {
+    struct dg_queue_stats qs;
+    static const char *depth_names[EVENT_DEPTH_BUCKETS] =
+      { "1", "2-3", "4-7", "8-15", "16-31", "32-63", "64+" };
+
+    event_queue_stats(&qs);
+    len = snprintf(buf, sizeof(buf),
+      "Event queue: %d queued, %d peak, %d due now\r\n"
+      "  Wheel levels:", qs.size, qs.peak, qs.due);
+    for (i = 0; i < EVENT_WHEEL_LEVELS; i++)
+      len += snprintf(buf + len, sizeof(buf) - len, " %d", qs.level[i]);
+    len += snprintf(buf + len, sizeof(buf) - len,
+      ", overflow %d\r\n"
+      "  Slab nodes: %d allocated, %d free\r\n"
+      "  Slots in use: %d\r\n", qs.overflow,
+      qs.nodes_allocated, qs.nodes_free, qs.slots_used);
+    for (i = 0; i < EVENT_DEPTH_BUCKETS; i++)
+      len += snprintf(buf + len, sizeof(buf) - len, "    %5s events: %5d slots\r\n",
+        depth_names[i], qs.depth[i]);
+    page_string(ch->desc, buf, TRUE);
+    break;
+  }
+
+  /* show save writer throughput and latency */
+  case 15:
+  {
+    struct save_queue_stats ss;
+
+    save_queue_stats(&ss);
+    send_to_char(ch,
+      "Save writer: %s\r\n"
+      "  Pending: %d (peak %d)\r\n"
+      "  Files written: %ld in %ld batches (largest %d), %ld bytes\r\n"
+      "  Coalesced: %ld, failed: %ld\r\n"
+      "  Latency: last %.1fms, average %.1fms, worst %.1fms\r\n",
+      ss.threaded ? "background thread" : "synchronous",
+      ss.pending, ss.peak_pending,
+      ss.writes, ss.batches, ss.largest_batch, ss.bytes,
+      ss.coalesced, ss.failures,
+      ss.last_latency / 1000.0,
+      (ss.writes + ss.failures) ? ss.total_latency / 1000.0 / (ss.writes + ss.failures) : 0.0,
+      ss.max_latency / 1000.0);
+    break;
+  }
+
+  /* show where the time of each pulse goes */
+  case 16:
+  {
+    struct profile_stats ps;
+    static const char *kinds[NUM_PROF_KINDS] =
+      { "phases", "commands", "triggers", "specials" };
+
+    if (*value && is_abbrev(value, "reset")) {
+      profile_reset();
+      send_to_char(ch, "Profile reset.\r\n");
+      break;
+    }
+    for (k = 0; k < NUM_PROF_KINDS; k++)
+      if (*value && is_abbrev(value, kinds[k]))
+        break;
+    if (*value && k == NUM_PROF_KINDS) {
+      send_to_char(ch, "Usage: show profile [phases | commands | triggers | specials | reset]\r\n");
+      break;
+    }
+
+    profile_stats(&ps);
+    len = snprintf(buf, sizeof(buf),
+      "Pulses: %lu, %lu over the %d ms budget, longest %.1f ms\r\n"
+      "Last slow pulse: %s\r\n"
+      "Times cover at most the last %d seconds of pulses.\r\n",
+      ps.pulses, ps.slow, OPT_USEC / 1000, ps.worst / 1000.0,
+      *ps.last_slow ? ps.last_slow : "none", 2 * PROFILE_WINDOW);
+    for (i = 0; i < NUM_PROF_KINDS && len < sizeof(buf); i++)
+      if (!*value || i == k) {
+        len += snprintf(buf + len, sizeof(buf) - len, "\r\n");
+        if (len < sizeof(buf))
+          len += profile_print(buf + len, sizeof(buf) - len, i,
+            i == PROF_PHASE ? NUM_PHASES : *value ? 50 : 10);
+      }
+    page_string(ch->desc, buf, TRUE);
+    break;
+  }
+
   /* show what? */
   default:
     send_to_char(ch, "Sorry, I don't understand that.\r\n");
@@ -3097,6 +3208,7 @@ static int perform_set(struct char_data *ch, struct char_data *vict, int mode, c
       }
       RANGE(1, LVL_IMPL);
       vict->player.level = value;
+      update_zone_player(vict);
       break;
     case 26: /* loadroom */
       if (!str_cmp(val_arg, "off")) {
@@ -3155,6 +3267,7 @@ static int perform_set(struct char_data *ch, struct char_data *vict, int mode, c
         return (0);
       }
       SET_OR_REMOVE(PRF_FLAGS(vict), PRF_NOHASSLE);
+      update_zone_player(vict);
       break;
     case 35: /* nosummon */
       SET_OR_REMOVE(PRF_FLAGS(vict), PRF_SUMMONABLE);
@@ -4327,10 +4440,14 @@ ACMD(do_copyover)
 
   /* drop those logging on */
    if (!d->character || d->connected > CON_PLAYING) {
+     compress_end(d);
+     compress_flush(d);
      write_to_descriptor (d->descriptor, "\n\rSorry, we are rebooting. Come back in a few minutes.\n\r");
      close_socket (d); /* throw'em out */
    } else {
       fprintf (fp, "%d %ld %s %s %s\n", d->descriptor, GET_PREF(och), GET_NAME(och), d->host, CopyoverGet(d));
+      /* CopyoverGet() ended MCCP; the plain text below must follow its tail. */
+      compress_flush(d);
       /* save och */
       GET_LOADROOM(och) = GET_ROOM_VNUM(IN_ROOM(och));
       Crash_rentsave(och,0);
@@ -4342,6 +4459,11 @@ ACMD(do_copyover)
   fprintf (fp, "-1\n");
   fclose (fp);
 
+  /* Queued saves use paths relative to lib/, so finish them before leaving.
+   * The log writer thread does not survive exec() either. */
+  save_queue_shutdown();
+  log_writer_shutdown();
+
   /* exec - descriptors are inherited */
   sprintf (buf, "%d", port);
   sprintf (buf2, "-C%d", mother_desc);
@@ -4357,6 +4479,7 @@ ACMD(do_copyover)
   execl (EXE_FILE, "circle", buf2, buf, (char *) NULL);
 
   /* Failed - successful exec will not return */
+  log_writer_init();
   perror ("do_copyover: execl");
   send_to_char (ch, "Copyover FAILED!\n\r");
 
@@ -4975,11 +5098,7 @@ bool change_player_name(struct char_data *ch, struct char_data *vict, char *new_
   }
 
   /* New playername is OK - find the entry in the index */
-  for (i = 0; i <= top_of_p_table; i++)
-    if (player_table[i].id == GET_IDNUM(vict))
-      break;
-
-  if (player_table[i].id != GET_IDNUM(vict))
+  if ((i = get_ptable_by_id(GET_IDNUM(vict))) == -1)
   {
     send_to_char(ch, "Your target was not found in the player index.\r\n");
     log("SYSERR: Player %s, with ID %ld, could not be found in the player index.", GET_NAME(vict), GET_IDNUM(vict));
@@ -5003,6 +5122,7 @@ bool change_player_name(struct char_data *ch, struct char_data *vict, char *new_
   free(player_table[i].name);              // Free the old name in the index
   player_table[i].name = strdup(new_name); // Insert the new name into the index
   for (k=0; (*(player_table[i].name+k) = LOWER(*(player_table[i].name+k))); k++);
+  ptable_hash_add(i);
 
   free(GET_PC_NAME(vict));
   GET_PC_NAME(vict) = strdup(CAP(new_name));    // Change the name in the victims char struct
@@ -5473,8 +5593,7 @@ ACMD(do_pull)
   if (!SCRIPT(vict))
     read_saved_vars(vict);
 
-  vict->next = character_list;
-  character_list = vict;
+  LINK_HEAD(vict, character_list, next, prev);
 
   char_to_room(vict, IN_ROOM(ch));
   GET_POS(vict) = POS_STANDING;
@@ -133,6 +133,7 @@ static void cedit_setup(struct descriptor_data *d)
   OLC_CONFIG(d)->operation.protocol_negotiation = CONFIG_PROTOCOL_NEGOTIATION;
   OLC_CONFIG(d)->operation.special_in_comm    = CONFIG_SPECIAL_IN_COMM;
   OLC_CONFIG(d)->operation.debug_mode    = CONFIG_DEBUG_MODE;
+  OLC_CONFIG(d)->operation.zone_dormancy = CONFIG_ZONE_DORMANCY;
   
   /* Autowiz */
   OLC_CONFIG(d)->autowiz.use_autowiz          = CONFIG_USE_AUTOWIZ;
@@ -237,6 +238,7 @@ static void cedit_save_internally(struct descriptor_data *d)
   CONFIG_PROTOCOL_NEGOTIATION = OLC_CONFIG(d)->operation.protocol_negotiation;
   CONFIG_SPECIAL_IN_COMM      = OLC_CONFIG(d)->operation.special_in_comm;
   CONFIG_DEBUG_MODE           = OLC_CONFIG(d)->operation.debug_mode;
+  CONFIG_ZONE_DORMANCY        = OLC_CONFIG(d)->operation.zone_dormancy;
     
   /* Autowiz */
   CONFIG_USE_AUTOWIZ          = OLC_CONFIG(d)->autowiz.use_autowiz;
@@ -569,6 +571,11 @@ int save_config( IDXTYPE nowhere )
               "debug_mode = %d\n\n",
               CONFIG_DEBUG_MODE);
 
+  fprintf(fl, "* Minutes a zone must be empty of players before its mobiles stop\n"
+              "* wandering and regenerating until someone comes back, or 0 for never.\n"
+              "zone_dormancy = %d\n\n",
+              CONFIG_ZONE_DORMANCY);
+
   fclose(fl);
 
   if (in_save_list(NOWHERE, SL_CFG))
@@ -758,6 +765,7 @@ static void cedit_disp_operation_options(struct descriptor_data *d)
   	"%sR%s) Enable Protocol Negotiation : %s%s\r\n"
   	"%sS%s) Enable Special Char in Comm : %s%s\r\n"
   	"%sT%s) Current Debug Mode : %s%s\r\n"
+  	"%sU%s) Zone Dormancy      : %s%d minute(s)\r\n"
     "%sQ%s) Exit To The Main Menu\r\n"
     "Enter your choice : ",
     grn, nrm, cyn, OLC_CONFIG(d)->operation.DFLT_PORT,
@@ -779,6 +787,7 @@ static void cedit_disp_operation_options(struct descriptor_data *d)
     grn, nrm, cyn, OLC_CONFIG(d)->operation.protocol_negotiation ? "Yes" : "No",
     grn, nrm, cyn, OLC_CONFIG(d)->operation.special_in_comm ? "Yes" : "No",
     grn, nrm, cyn, OLC_CONFIG(d)->operation.debug_mode == 0 ? "OFF" : (OLC_CONFIG(d)->operation.debug_mode == 1 ? "BRIEF" : (OLC_CONFIG(d)->operation.debug_mode == 2 ? "NORMAL" : "COMPLETE")),
+    grn, nrm, cyn, OLC_CONFIG(d)->operation.zone_dormancy,
     grn, nrm
     );
 
@@ -1273,6 +1282,12 @@ void cedit_parse(struct descriptor_data *d, char *arg)
            OLC_MODE(d) = CEDIT_DEBUG_MODE;
            return;
 
+         case 'u':
+         case 'U':
+           write_to_output(d, "Enter how many minutes an empty zone waits before going dormant (0 for never) : ");
+           OLC_MODE(d) = CEDIT_ZONE_DORMANCY;
+           return;
+
          case 'q':
          case 'Q':
            cedit_disp_menu(d);
@@ -1663,6 +1678,11 @@ void cedit_parse(struct descriptor_data *d, char *arg)
       cedit_disp_operation_options(d);
       break;
 
+    case CEDIT_ZONE_DORMANCY:
+      OLC_CONFIG(d)->operation.zone_dormancy = MAX(atoi(arg), 0);
+      cedit_disp_operation_options(d);
+      break;
+
     case CEDIT_MIN_WIZLIST_LEV:
       if (atoi(arg) > LVL_IMPL) {
         write_to_output(d,
@@ -0,0 +1,333 @@
+/**
+* @file cmdtrie.c
+* Prefix index over the command table for the command interpreter.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*
+* command_interpreter() accepts any abbreviation of a command and takes the
+* first entry of complete_cmd_info[] that the player's level allows, trying
+* real commands before socials.  The trie below answers that question by
+* walking one node per typed character.
+*
+* Each node keeps, for commands and for socials, the entries that are "first
+* for some level": the first entry under that prefix, then the next one with a
+* lower minimum level than any before it, and so on.  The first of those a
+* character's level allows is the entry the old linear sweep would have
+* stopped at.  These lists hold a handful of entries at most.
+*
+* Misspellings are matched against the base command table with a BK-tree, so
+* only the few commands near the typo have their edit distance computed.
+*/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "interpreter.h"
+#include "act.h"
+#include "cmdtrie.h"
+
+/** How far off a misspelling may be and still be suggested. */
+#define CMD_SUGGEST_DISTANCE 2
+
+/** One character of a command prefix. */
+struct trie_node {
+  char c;          /**< Character leading here from the parent */
+  int child;       /**< First child node, or -1 */
+  int sibling;     /**< Next node with the same parent, or -1 */
+  int exact;       /**< First command spelled exactly like this prefix, or -1 */
+  int cmds;        /**< First entry of the command pick list, or -1 */
+  int cmds_tail;   /**< Last entry of the command pick list, or -1 */
+  int socials;     /**< First entry of the social pick list, or -1 */
+  int socials_tail;/**< Last entry of the social pick list, or -1 */
+};
+
+/** An entry on a node's pick list. */
+struct trie_pick {
+  int cmd;         /**< Index into the command table */
+  int next;        /**< Next pick, or -1 */
+};
+
+/** A node of the BK-tree over the base command table. */
+struct bk_node {
+  int cmd;         /**< Index into the base table */
+  int dist;        /**< Edit distance to the parent's command */
+  int child;       /**< First child, or -1 */
+  int sibling;     /**< Next child of the same parent, or -1 */
+};
+
+static const struct command_info *trie_cmds = NULL;
+static struct trie_node *nodes = NULL;
+static int num_nodes = 0, max_nodes = 0;
+static struct trie_pick *picks = NULL;
+static int num_picks = 0, max_picks = 0;
+
+static const struct command_info *bk_cmds = NULL;
+static struct bk_node *bk_nodes = NULL;
+static int num_bk_nodes = 0;
+static int *bk_found = NULL;     /**< Scratch for cmd_trie_suggest() */
+
+/* local functions */
+static int trie_new_node(char c);
+static int trie_child(int node, char c, int create);
+static void trie_add_pick(int *head, int *tail, int cmd);
+static int pick_for_level(int pick, int level);
+static int cmd_distance(const char *a, const char *b);
+static void bk_insert(int cmd);
+static int bk_collect(int node, const char *word, int level, int count);
+static int compare_ints(const void *a, const void *b);
+
+static int trie_new_node(char c)
+{
+  struct trie_node *n;
+
+  if (num_nodes == max_nodes) {
+    max_nodes = MAX(256, max_nodes * 2);
+    RECREATE(nodes, struct trie_node, max_nodes);
+  }
+
+  n = &nodes[num_nodes];
+  n->c = c;
+  n->child = n->sibling = n->exact = -1;
+  n->cmds = n->cmds_tail = n->socials = n->socials_tail = -1;
+
+  return num_nodes++;
+}
+
+/* Find the child of 'node' reached by 'c', adding it if asked to. */
+static int trie_child(int node, char c, int create)
+{
+  int i, n;
+
+  for (i = nodes[node].child; i >= 0; i = nodes[i].sibling)
+    if (nodes[i].c == c)
+      return i;
+
+  if (!create)
+    return -1;
+
+  /* trie_new_node() may move nodes[], so take the index first. */
+  n = trie_new_node(c);
+  nodes[n].sibling = nodes[node].child;
+  nodes[node].child = n;
+  return n;
+}
+
+/* Commands arrive in table order, so a command is only worth keeping if it
+ * is open to a lower level than everything already on the list. */
+static void trie_add_pick(int *head, int *tail, int cmd)
+{
+  if (*tail >= 0 && trie_cmds[cmd].minimum_level >= trie_cmds[picks[*tail].cmd].minimum_level)
+    return;
+
+  if (num_picks == max_picks) {
+    max_picks = MAX(256, max_picks * 2);
+    RECREATE(picks, struct trie_pick, max_picks);
+  }
+  picks[num_picks].cmd = cmd;
+  picks[num_picks].next = -1;
+
+  if (*tail >= 0)
+    picks[*tail].next = num_picks;
+  else
+    *head = num_picks;
+  *tail = num_picks++;
+}
+
+static int pick_for_level(int pick, int level)
+{
+  for (; pick >= 0; pick = picks[pick].next)
+    if (level >= trie_cmds[picks[pick].cmd].minimum_level)
+      return picks[pick].cmd;
+
+  return -1;
+}
+
+/* Plain Levenshtein distance, without levenshtein_distance()'s allocations. */
+static int cmd_distance(const char *a, const char *b)
+{
+  int row[MAX_INPUT_LENGTH + 1], i, j, diag, up, blen;
+
+  blen = MIN(strlen(b), MAX_INPUT_LENGTH);
+  for (j = 0; j <= blen; j++)
+    row[j] = j;
+
+  for (i = 1; *a; a++, i++) {
+    diag = row[0];
+    row[0] = i;
+    for (j = 1; j <= blen; j++) {
+      up = row[j];
+      row[j] = MIN(MIN(row[j] + 1, row[j - 1] + 1), diag + (*a == b[j - 1] ? 0 : 1));
+      diag = up;
+    }
+  }
+
+  return row[blen];
+}
+
+static void bk_insert(int cmd)
+{
+  int node = 0, d, i;
+
+  if (num_bk_nodes > 0)
+    for (;;) {
+      d = cmd_distance(bk_cmds[cmd].command, bk_cmds[bk_nodes[node].cmd].command);
+      for (i = bk_nodes[node].child; i >= 0; i = bk_nodes[i].sibling)
+        if (bk_nodes[i].dist == d)
+          break;
+      if (i < 0)
+        break;
+      node = i;
+    }
+
+  bk_nodes[num_bk_nodes].cmd = cmd;
+  bk_nodes[num_bk_nodes].child = bk_nodes[num_bk_nodes].sibling = -1;
+  bk_nodes[num_bk_nodes].dist = 0;
+  if (num_bk_nodes > 0) {
+    bk_nodes[num_bk_nodes].dist = d;
+    bk_nodes[num_bk_nodes].sibling = bk_nodes[node].child;
+    bk_nodes[node].child = num_bk_nodes;
+  }
+  num_bk_nodes++;
+}
+
+/* The triangle inequality limits the search to children whose distance to
+ * their parent is within CMD_SUGGEST_DISTANCE of the word's. */
+static int bk_collect(int node, const char *word, int level, int count)
+{
+  const struct command_info *c = &bk_cmds[bk_nodes[node].cmd];
+  int d, i;
+
+  d = cmd_distance(word, c->command);
+  if (d <= CMD_SUGGEST_DISTANCE && *word == *c->command &&
+      c->minimum_level <= level && c->minimum_level >= 0)
+    bk_found[count++] = bk_nodes[node].cmd;
+
+  for (i = bk_nodes[node].child; i >= 0; i = bk_nodes[i].sibling)
+    if (bk_nodes[i].dist >= d - CMD_SUGGEST_DISTANCE && bk_nodes[i].dist <= d + CMD_SUGGEST_DISTANCE)
+      count = bk_collect(i, word, level, count);
+
+  return count;
+}
+
+static int compare_ints(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+/** Builds the prefix trie over the command table and the BK-tree over the
+ * base command list.  Call again whenever either table changes.
+ * @param cmds The full command table, socials included, ending in "\n".
+ * @param base The built-in commands used for suggestions, ending in "\n". */
+void cmd_trie_build(const struct command_info *cmds, const struct command_info *base)
+{
+  const char *p;
+  int cmd, node, count;
+
+  cmd_trie_free();
+  trie_cmds = cmds;
+  bk_cmds = base;
+
+  trie_new_node('\0');
+  for (cmd = 0; *cmds[cmd].command != '\n'; cmd++) {
+    node = 0;
+    for (p = cmds[cmd].command; ; p++) {
+      if (cmds[cmd].command_pointer == do_action)
+        trie_add_pick(&nodes[node].socials, &nodes[node].socials_tail, cmd);
+      else
+        trie_add_pick(&nodes[node].cmds, &nodes[node].cmds_tail, cmd);
+      if (!*p)
+        break;
+      node = trie_child(node, *p, TRUE);
+    }
+    if (nodes[node].exact < 0)
+      nodes[node].exact = cmd;
+  }
+
+  for (count = 0; *base[count].command != '\n'; count++)
+    ;
+  CREATE(bk_nodes, struct bk_node, MAX(1, count));
+  CREATE(bk_found, int, MAX(1, count));
+  for (cmd = 0; cmd < count; cmd++)
+    bk_insert(cmd);
+}
+
+void cmd_trie_free(void)
+{
+  if (nodes)
+    free(nodes);
+  if (picks)
+    free(picks);
+  if (bk_nodes)
+    free(bk_nodes);
+  if (bk_found)
+    free(bk_found);
+  nodes = NULL;
+  picks = NULL;
+  bk_nodes = NULL;
+  bk_found = NULL;
+  num_nodes = max_nodes = num_picks = max_picks = num_bk_nodes = 0;
+}
+
+/** Finds the command a typed word means.
+ * @param word The word as typed, already lowercased; may be an abbreviation.
+ * @param level The level of the character typing it.
+ * @retval int Index into the command table, or -1 if nothing matches. */
+int cmd_trie_lookup(const char *word, int level)
+{
+  int node = 0, cmd;
+
+  if (!nodes)
+    return -1;
+
+  for (; *word && node >= 0; word++)
+    node = trie_child(node, *word, FALSE);
+  if (node < 0)
+    return -1;
+
+  if ((cmd = pick_for_level(nodes[node].cmds, level)) < 0)
+    cmd = pick_for_level(nodes[node].socials, level);
+
+  return cmd;
+}
+
+/** Finds a command by its full name, as find_command() always has.
+ * @retval int Index into the command table, or -1. */
+int cmd_trie_exact(const char *word)
+{
+  int node = 0;
+
+  if (!nodes)
+    return -1;
+
+  for (; *word && node >= 0; word++)
+    node = trie_child(node, *word, FALSE);
+
+  return node < 0 ? -1 : nodes[node].exact;
+}
+
+/** Lists built-in commands a mistyped word might have meant: those sharing its
+ * first letter, open to the given level and within a small edit distance.
+ * @param word The word that matched nothing.
+ * @param level The level of the character typing it.
+ * @param found Receives indexes into the base table, in table order.
+ * @param max Room in found.
+ * @retval int Number of suggestions. */
+int cmd_trie_suggest(const char *word, int level, int *found, int max)
+{
+  int count, i;
+
+  if (!bk_nodes || num_bk_nodes == 0)
+    return 0;
+
+  count = bk_collect(0, word, level, 0);
+  qsort(bk_found, count, sizeof(int), compare_ints);
+
+  for (i = 0; i < count && i < max; i++)
+    found[i] = bk_found[i];
+
+  return i;
+}
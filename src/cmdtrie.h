@@ -0,0 +1,22 @@
+/**
+* @file cmdtrie.h
+* Prefix index over the command table for the command interpreter.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*/
+#ifndef _CMDTRIE_H_
+#define _CMDTRIE_H_
+
+/** Most "Did you mean" suggestions cmd_trie_suggest() will return. */
+#define CMD_MAX_SUGGEST  20
+
+void cmd_trie_build(const struct command_info *cmds, const struct command_info *base);
+void cmd_trie_free(void);
+int  cmd_trie_lookup(const char *word, int level);
+int  cmd_trie_exact(const char *word);
+int  cmd_trie_suggest(const char *word, int level, int *found, int max);
+
+#endif /* _CMDTRIE_H_ */
@@ -53,6 +53,10 @@
 #include "telnet.h"
 #endif
 
+#ifdef HAVE_ZLIB_H
+#include <zlib.h>
+#endif
+
 /* end conf.h dependent includes */
 
 /* Note, most includes for all platforms are in sysdep.h.  The list of
@@ -84,6 +88,15 @@
 #include "ibt.h" /* for free_ibt_lists */
 #include "mud_event.h"
 #include "prompt.h"
+#include "poller.h"
+#include "resolver.h"
+#include "cmdtrie.h"
+#include "savequeue.h"
+#include "logwriter.h"
+#include "mail.h" /* for free_mail */
+#include "snapshot.h"
+#include "profiler.h"
+#include "trace.h"
 
 struct descriptor_data;
 #ifndef INVALID_SOCKET
@@ -95,9 +108,10 @@ extern time_t newsmod;
 
 /* locally defined globals, used externally */
 struct descriptor_data *descriptor_list = NULL;   /* master desc list */
-int buf_largecount = 0;   /* # of large buffers which exist */
+int buf_largecount = 0;   /* # of output chunks which exist */
 int buf_overflows = 0;    /* # of overflows of output */
-int buf_switches = 0;     /* # of switches from small to large buf */
+int buf_switches = 0;     /* # of times output spilled into a new chunk */
+unsigned long buf_copied = 0; /* # of bytes copied into output queues */
 int circle_shutdown = 0;  /* clean shutdown */
 int circle_reboot = 0;    /* reboot the game after a shutdown */
 int no_specials = 0;      /* Suppress ass. of special routines */
@@ -109,8 +123,22 @@ socket_t mother_desc;
 int next_tick = SECS_PER_MUD_HOUR;  /* Tick countdown */
 
 
+#ifdef HAVE_ZLIB_H
+/* MCCP v2 state for one descriptor, see compress_start(). */
+struct compress_data {
+  z_stream stream;
+  int active;                 /* new output is being deflated */
+  size_t raw_left;            /* queued bytes that precede the start marker */
+  char *wire;                 /* encoded bytes waiting for the socket */
+  size_t wire_len, wire_sent, wire_size;
+  unsigned long bytes_in;     /* text fed to deflate() */
+  unsigned long bytes_out;    /* compressed bytes produced */
+  clock_t cpu;                /* processor time spent compressing */
+};
+#endif
+
 /* static local global variable declarations (current file scope only) */
-static struct txt_block *bufpool = 0;  /* pool of large output buffers */
+static struct output_chunk *bufpool = 0;  /* pool of free output chunks */
 static int max_players = 0;   /* max descriptors available */
 static int tics_passed = 0;     /* for extern checkpointing */
 static struct timeval null_time; /* zero-valued time structure */
@@ -119,6 +147,13 @@ static byte emergency_unban;  /* signal: SIGUSR2 */
 
 static int dg_act_check;         /* toggle for act_trigger */
 static bool fCopyOver;          /* Are we booting in copyover mode? */
+static bool fixed_seed;          /* --seed: use rng_seed, not the time */
+static unsigned long rng_seed;
+static const char *bench_report; /* --bench-report: file for the run's numbers */
+static const char *record_file;  /* --record: where to write an input trace */
+static const char *replay_file;  /* --replay, --replay-fast: trace to play back */
+static bool replay_fast;
+static const char *pulse_times;  /* --pulse-times: file for every pass's time */
 static char *last_act_message = NULL;
 
 /* static local function prototypes (current file scope only) */
@@ -131,12 +166,26 @@ static RETSIGTYPE checkpointing(int sig);
 static RETSIGTYPE hupsig(int sig);
 static ssize_t perform_socket_read(socket_t desc, char *read_point,size_t space_left);
 static ssize_t perform_socket_write(socket_t desc, const char *txt,size_t length);
+static ssize_t perform_socket_writev(socket_t desc, struct output_chunk *chunk, size_t *queued);
+static void output_append(struct descriptor_data *t, const char *txt, size_t length);
+static void output_consume(struct descriptor_data *t, size_t length);
+static void output_snoop(struct descriptor_data *t, size_t length);
+static int output_pending(struct descriptor_data *t);
+#ifdef HAVE_ZLIB_H
+static int process_compressed_output(struct descriptor_data *t);
+static void compress_free(struct descriptor_data *d);
+#endif
 static void circle_sleep(struct timeval *timeout);
 static int get_from_q(struct txt_q *queue, char *dest, int *aliased);
 static void init_game(ush_int port);
+static long max_rss_kb(void);
+static void write_bench_report(const char *fname, long boot_rss);
 static void signal_setup(void);
 static socket_t init_socket(ush_int port);
 static int new_descriptor(socket_t s);
+static void start_descriptor(struct descriptor_data *newd, socket_t desc);
+static void accept_new_descriptors(socket_t s);
+static void hostname_resolved(struct descriptor_data *d, const char *host);
 static int get_max_players(void);
 static int process_output(struct descriptor_data *t);
 static int process_input(struct descriptor_data *t);
@@ -195,7 +244,7 @@ void gettimeofday(struct timeval *t, struct timezone *dummy)
 
 int main(int argc, char **argv)
 {
-  int pos = 1;
+  int pos = 1, verify_snapshot = 0, status = 0;
   const char *dir;
 
 #ifdef MEMORY_DEBUG
@@ -292,10 +341,36 @@ int main(int argc, char **argv)
       no_specials = 1;
       puts("Suppressing assignment of special routines.");
       break;
+    case '-':
+      if (!strcmp(argv[pos], "--verify-snapshot")) {
+        scheck = 1;
+        verify_snapshot = 1;
+        puts("Snapshot verification mode enabled.");
+      } else if (!strncmp(argv[pos], "--seed=", 7) && isdigit(argv[pos][7])) {
+        fixed_seed = TRUE;
+        rng_seed = strtoul(argv[pos] + 7, NULL, 10);
+        printf("Random numbers seeded with %lu.\n", rng_seed);
+      } else if (!strncmp(argv[pos], "--bench-report=", 15) && argv[pos][15])
+        bench_report = argv[pos] + 15;
+      else if (!strncmp(argv[pos], "--record=", 9) && argv[pos][9])
+        record_file = argv[pos] + 9;
+      else if (!strncmp(argv[pos], "--replay=", 9) && argv[pos][9])
+        replay_file = argv[pos] + 9;
+      else if (!strncmp(argv[pos], "--replay-fast=", 14) && argv[pos][14]) {
+        replay_file = argv[pos] + 14;
+        replay_fast = TRUE;
+      } else if (!strncmp(argv[pos], "--pulse-times=", 14) && argv[pos][14])
+        pulse_times = argv[pos] + 14;
+      else
+        printf("SYSERR: Unknown option %s in argument string.\n", argv[pos]);
+      break;
     case 'h':
       /* From: Anil Mahajan. Do NOT use -C, this is the copyover mode and
        * without the proper copyover.dat file, the game will go nuts! */
-      printf("Usage: %s [-c] [-m] [-q] [-r] [-s] [-d pathname] [port #]\n"
+      printf("Usage: %s [-c] [-m] [-q] [-r] [-s] [-d pathname] [--verify-snapshot]\n"
+             "          [--seed=<n>] [--bench-report=<file>] [--record=<file>]\n"
+             "          [--replay=<file>] [--replay-fast=<file>] [--pulse-times=<file>]\n"
+             "          [port #]\n"
               "  -c             Enable syntax check mode.\n"
               "  -d <directory> Specify library directory (defaults to 'lib').\n"
               "  -h             Print this command line argument help.\n"
@@ -305,6 +380,14 @@ int main(int argc, char **argv)
               "  -q             Quick boot (doesn't scan rent for object limits)\n"
               "  -r             Restrict MUD -- no new players allowed.\n"
               "  -s             Suppress special procedure assignments.\n"
+              "  --verify-snapshot  Check the world snapshot against the world files.\n"
+              "  --seed=<n>     Seed the random numbers with <n>, not the time.\n"
+              "  --bench-report=<file>  Write pulse times and memory use to <file>\n"
+              "                 on shutdown.\n"
+              "  --record=<file>  Record all player input to <file>.\n"
+              "  --replay=<file>  Play back input recorded in <file>, with no sockets.\n"
+              "  --replay-fast=<file>  The same, without waiting between pulses.\n"
+              "  --pulse-times=<file>  Write the time every pulse took to <file>.\n"
               " Note:		These arguments are 'CaSe SeNsItIvE!!!'\n",
 		 argv[0]
       );
@@ -318,7 +401,10 @@ int main(int argc, char **argv)
 
   if (pos < argc) {
     if (!isdigit(*argv[pos])) {
-      printf("Usage: %s [-c] [-m] [-q] [-r] [-s] [-d pathname] [port #]\n", argv[0]);
+      printf("Usage: %s [-c] [-m] [-q] [-r] [-s] [-d pathname] [--verify-snapshot]\n"
+             "          [--seed=<n>] [--bench-report=<file>] [--record=<file>]\n"
+             "          [--replay=<file>] [--replay-fast=<file>] [--pulse-times=<file>]\n"
+             "          [port #]\n", argv[0]);
       exit(1);
     } else if ((port = atoi(argv[pos])) <= 1024) {
       printf("SYSERR: Illegal port number %d.\n", port);
@@ -328,6 +414,7 @@ int main(int argc, char **argv)
 
   /* All arguments have been parsed, try to open log file. */
   setup_log(CONFIG_LOGNAME, STDERR_FILENO);
+  log_writer_init();
 
   /* Moved here to distinguish command line options and to show up
    * in the log if stderr is redirected to a file. */
@@ -340,9 +427,11 @@ int main(int argc, char **argv)
   }
   log("Using %s as data directory.", dir);
 
-  if (scheck)
+  if (scheck) {
     boot_world();
-  else {
+    if (verify_snapshot)
+      status = snapshot_verify();
+  } else {
     log("Running game on port %d.", port);
     init_game(port);
   }
@@ -354,11 +443,13 @@ int main(int argc, char **argv)
     log("Clearing other memory.");
     free_bufpool();         /* comm.c */
     free_player_index();    /* players.c */
+    free_mail();            /* mail.c */
     free_messages();        /* fight.c */
     free_text_files();      /* db.c */
     board_clear_all();      /* boards.c */
     free(cmd_sort_info);    /* act.informative.c */
     free_command_list();    /* act.informative.c */
+    cmd_trie_free();        /* cmdtrie.c */
     free_social_messages(); /* act.social.c */
     free_help_table();      /* db.c */
     free_invalid_list();    /* ban.c */
@@ -377,12 +468,13 @@ int main(int argc, char **argv)
   free(CONFIG_CONFFILE);
   
   log("Done.");
+  log_writer_shutdown();
 
 #ifdef MEMORY_DEBUG
   zmalloc_check();
 #endif
 
-  return (0);
+  return (status);
 }
 
 /* Reload players after a copyover */
@@ -484,6 +576,7 @@ void copyover_recover()
         GET_LOADROOM(d->character) = NOWHERE;
 
       d->connected = CON_PLAYING;
+      update_zone_player(d->character);
       look_at_room(d->character, 0);
 
       /* Add to the list of 'recent' players (since last reboot) with copyover flag */
@@ -499,19 +592,43 @@ void copyover_recover()
 /* Init sockets, run game, and cleanup sockets */
 static void init_game(ush_int local_port)
 {
+  long boot_rss;
+
   /* We don't want to restart if we crash before we get up. */
   touch(KILLSCRIPT_FILE);
 
-  circle_srandom(time(0));
+  /* A replay has to roll the same numbers the recording did. */
+  if (replay_file) {
+    if (!trace_replay_start(replay_file, replay_fast, &rng_seed))
+      exit(1);
+    fixed_seed = TRUE;
+  } else if (!fixed_seed)
+    rng_seed = (unsigned long) time(0);
+  circle_srandom(rng_seed);
+
+  if (record_file && !replay_file && !trace_record_start(record_file, rng_seed))
+    exit(1);
+  if (pulse_times && !trace_times_start(pulse_times))
+    exit(1);
+
+  poller_init();
 
   log("Finding player limit.");
   max_players = get_max_players();
 
-  /* If copyover mother_desc is already set up */
-  if (!fCopyOver) {
-     log ("Opening mother connection.");
-     mother_desc = init_socket (local_port);
+  /* If copyover mother_desc is already set up.  A replay takes no
+   * connections. */
+  if (replay_file)
+    mother_desc = INVALID_SOCKET;
+  else {
+    if (!fCopyOver) {
+      log ("Opening mother connection.");
+      mother_desc = init_socket (local_port);
+    }
+    poller_set_mother(mother_desc);
   }
+  resolver_init(RESOLVER_WORKERS, hostname_resolved);
+  save_queue_init();
 
   event_init();
 
@@ -519,6 +636,7 @@ static void init_game(ush_int local_port)
   init_lookup_table();
 
   boot_db();
+  boot_rss = max_rss_kb();
 
 #if defined(CIRCLE_UNIX) || defined(CIRCLE_MACINTOSH)
   log("Signal trapping.");
@@ -534,6 +652,10 @@ static void init_game(ush_int local_port)
   log("Entering game loop.");
 
   game_loop(mother_desc);
+  trace_stop();
+
+  if (bench_report)
+    write_bench_report(bench_report, boot_rss);
 
   Crash_save_all();
 
@@ -542,10 +664,15 @@ static void init_game(ush_int local_port)
     close_socket(descriptor_list);
 
   CLOSE_SOCKET(mother_desc);
+  poller_shutdown();
+  resolver_shutdown();
 
   if (circle_reboot != 2)
     save_all();
 
+  log("Writing queued player files.");
+  save_queue_shutdown();
+
   log("Saving current MUD time.");
   save_mud_time(&time_info);
 
@@ -556,6 +683,48 @@ static void init_game(ush_int local_port)
   log("Normal termination of game.");
 }
 
+/* The most memory the game has held so far, in kilobytes, or 0 if that
+ * cannot be found out here. */
+static long max_rss_kb(void)
+{
+#if defined(HAVE_SYS_RESOURCE_H) && defined(RUSAGE_SELF)
+  struct rusage ru;
+
+  if (getrusage(RUSAGE_SELF, &ru) == 0)
+    return (ru.ru_maxrss);
+#endif
+  return (0);
+}
+
+/* Writes what a load test needs from this side of the sockets, as JSON.
+ * The pulse times cover every pass through game_loop() since boot. */
+static void write_bench_report(const char *fname, long boot_rss)
+{
+  struct profile_stats ps;
+  FILE *fl;
+
+  if (!(fl = fopen(fname, "w"))) {
+    log("SYSERR: Cannot write bench report %s: %s", fname, strerror(errno));
+    return;
+  }
+
+  profile_stats(&ps);
+  fprintf(fl, "{\n"
+    "  \"seed\": %lu,\n"
+    "  \"pulses\": %lu,\n"
+    "  \"slow_pulses\": %lu,\n"
+    "  \"pulse_ms\": { \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n"
+    "  \"boot_max_rss_kb\": %ld,\n"
+    "  \"max_rss_kb\": %ld\n"
+    "}\n",
+    rng_seed, ps.pulses, ps.slow,
+    profile_pulse_percentile(50) / 1000.0, profile_pulse_percentile(90) / 1000.0,
+    profile_pulse_percentile(99) / 1000.0, ps.worst / 1000.0,
+    boot_rss, max_rss_kb());
+  fclose(fl);
+  log("Wrote bench report to %s.", fname);
+}
+
 /* init_socket sets up the mother descriptor - creates the socket, sets
  * its options up, binds it, and listens. */
 static socket_t init_socket(ush_int local_port)
@@ -718,6 +887,12 @@ static int get_max_players(void)
   max_descs = CONFIG_MAX_PLAYING + NUM_RESERVED_DESCS;
 #endif
 
+  /* select() cannot watch sockets past FD_SETSIZE; epoll has no such limit. */
+  if (poller_max_descriptors() > 0 && max_descs > poller_max_descriptors()) {
+    max_descs = poller_max_descriptors();
+    method = "FD_SETSIZE";
+  }
+
   /* now calculate max _players_ based on max descs */
   max_descs = MIN(CONFIG_MAX_PLAYING, max_descs - NUM_RESERVED_DESCS);
 
@@ -738,19 +913,18 @@ static int get_max_players(void)
  * such as mobile_activity(). */
 void game_loop(socket_t local_mother_desc)
 {
-  fd_set input_set, output_set, exc_set, null_set;
   struct timeval last_time, opt_time, process_time, temp_time;
   struct timeval before_sleep, now, timeout;
   char comm[MAX_INPUT_LENGTH];
   struct descriptor_data *d, *next_d;
-  int missed_pulses, maxdesc, aliased;
+  int missed_pulses, aliased;
+  long pulse_start, t;
 
   /* initialize various time values */
   null_time.tv_sec = 0;
   null_time.tv_usec = 0;
   opt_time.tv_usec = OPT_USEC;
   opt_time.tv_sec = 0;
-  FD_ZERO(&null_set);
 
   gettimeofday(&last_time, (struct timezone *) 0);
 
@@ -758,11 +932,9 @@ void game_loop(socket_t local_mother_desc)
   while (!circle_shutdown) {
 
     /* Sleep if we don't have any connections */
-    if (descriptor_list == NULL) {
+    if (descriptor_list == NULL && trace_mode != TRACE_REPLAY) {
       log("No connections.  Going to sleep.");
-      FD_ZERO(&input_set);
-      FD_SET(local_mother_desc, &input_set);
-      if (select(local_mother_desc + 1, &input_set, (fd_set *) 0, (fd_set *) 0, NULL) < 0) {
+      if (poller_sleep() < 0) {
 	if (errno == EINTR)
 	  log("Waking up to process signal.");
 	else
@@ -771,23 +943,6 @@ void game_loop(socket_t local_mother_desc)
 	log("New connection.  Waking up.");
       gettimeofday(&last_time, (struct timezone *) 0);
     }
-    /* Set up the input, output, and exception sets for select(). */
-    FD_ZERO(&input_set);
-    FD_ZERO(&output_set);
-    FD_ZERO(&exc_set);
-    FD_SET(local_mother_desc, &input_set);
-
-    maxdesc = local_mother_desc;
-    for (d = descriptor_list; d; d = d->next) {
-#ifndef CIRCLE_WINDOWS
-      if (d->descriptor > maxdesc)
-	maxdesc = d->descriptor;
-#endif
-      FD_SET(d->descriptor, &input_set);
-      FD_SET(d->descriptor, &output_set);
-      FD_SET(d->descriptor, &exc_set);
-    }
-
     /* At this point, we have completed all input, output and heartbeat
      * activity from the previous iteration, so we have to put ourselves
      * to sleep until the next 0.1 second tick.  The first step is to
@@ -815,43 +970,62 @@ void game_loop(socket_t local_mother_desc)
     gettimeofday(&now, (struct timezone *) 0);
     timediff(&timeout, &last_time, &now);
 
-    /* Go to sleep */
-    do {
-      circle_sleep(&timeout);
-      gettimeofday(&now, (struct timezone *) 0);
-      timediff(&timeout, &last_time, &now);
-    } while (timeout.tv_usec || timeout.tv_sec);
-
-    /* Poll (without blocking) for new input, output, and exceptions */
-    if (select(maxdesc + 1, &input_set, &output_set, &exc_set, &null_time) < 0) {
-      perror("SYSERR: Select poll");
-      return;
+    /* Go to sleep, unless replaying as fast as we can. */
+    if (trace_replay_fast())
+      gettimeofday(&last_time, (struct timezone *) 0);
+    else {
+      do {
+        circle_sleep(&timeout);
+        gettimeofday(&now, (struct timezone *) 0);
+        timediff(&timeout, &last_time, &now);
+      } while (timeout.tv_usec || timeout.tv_sec);
     }
-    /* If there are new connections waiting, accept them. */
-    if (FD_ISSET(local_mother_desc, &input_set))
-      new_descriptor(local_mother_desc);
 
-    /* Kick out the freaky folks in the exception set and marked for close */
-    for (d = descriptor_list; d; d = next_d) {
-      next_d = d->next;
-      if (FD_ISSET(d->descriptor, &exc_set)) {
-        FD_CLR(d->descriptor, &input_set);
-	      FD_CLR(d->descriptor, &output_set);
-	      close_socket(d);
+    t = pulse_start = profile_pulse_start();
+
+    /* Pick up hostnames the resolver threads have finished with. */
+    resolver_process();
+
+    /* Report player files the save writer could not write. */
+    save_queue_process();
+
+    /* A replay takes its connections and input from the trace. */
+    if (trace_mode == TRACE_REPLAY)
+      trace_replay_input();
+    else {
+      /* Poll (without blocking) for new input, output, and exceptions.
+       * Only descriptors the poller reports as ready are visited below. */
+      if (poller_poll() < 0) {
+        perror("SYSERR: Select poll");
+        return;
+      }
+      /* If there are new connections waiting, accept them. */
+      if (poller_mother_ready())
+        accept_new_descriptors(local_mother_desc);
+
+      /* Kick out the freaky folks in the exception set and marked for close */
+      for (d = poller_ready_list(); d; d = next_d) {
+        next_d = d->poll_next;
+        if (IS_SET(d->poll_events, POLLER_ERROR)) {
+          trace_drop(d, TRACE_DROP_INPUT);
+          close_socket(d);
+        }
       }
-    }
 
-    /* Process descriptors with input pending */
-    for (d = descriptor_list; d; d = next_d) {
-      next_d = d->next;
-      if (FD_ISSET(d->descriptor, &input_set))
-       {
-        if ( d->pProtocol != NULL )      /* KaVir's plugin */
-          d->pProtocol->WriteOOB = 0;    /* KaVir's plugin */
-	      if (process_input(d) < 0)
-	        close_socket(d);
-       }
+      /* Process descriptors with input pending */
+      for (d = poller_ready_list(); d; d = next_d) {
+        next_d = d->poll_next;
+        if (IS_SET(d->poll_events, POLLER_READ)) {
+          if (d->pProtocol != NULL)       /* KaVir's plugin */
+            d->pProtocol->WriteOOB = 0;   /* KaVir's plugin */
+          if (process_input(d) < 0) {
+            trace_drop(d, TRACE_DROP_INPUT);
+            close_socket(d);
+          }
+        }
+      }
     }
+    t = profile_add(PROF_PHASE, PHASE_INPUT, t);
 
     /* Process commands we just read from process_input */
     for (d = descriptor_list; d; d = next_d) {
@@ -871,6 +1045,10 @@ void game_loop(socket_t local_mother_desc)
       if (!get_from_q(&d->input, comm, &aliased))
         continue;
 
+      /* What an alias expands to is not recorded; it expands again. */
+      if (!aliased)
+        trace_input(d, comm);
+
       if (d->character) {
 	/* Reset the idle timer & pull char back from void if necessary */
 	d->character->char_specials.timer = 0;
@@ -895,19 +1073,28 @@ void game_loop(socket_t local_mother_desc)
         command_interpreter(d->character, comm); /* Send it to interpreter */
       }
 
+      /* Entering OLC, the game or another body changes who counts. */
+      if (d->character)
+        update_zone_player(d->character);
+
       if (STATE(d) == CON_PLAYING && d->character)
         write_to_output(d, "%s", make_prompt(d));
     }
+    t = profile_add(PROF_PHASE, PHASE_COMMANDS, t);
 
     /* Send queued output out to the operating system (ultimately to user). */
     for (d = descriptor_list; d; d = next_d) {
       next_d = d->next;
-      if (*(d->output) && FD_ISSET(d->descriptor, &output_set)) {
+      if (output_pending(d) && IS_SET(d->poll_events, POLLER_WRITE)) {
         /* Output for this player is ready */
-        if (process_output(d) < 0)
+        if (process_output(d) < 0) {
+          trace_drop(d, TRACE_DROP_OUTPUT);
           close_socket(d);
+        }
       }
     }
+    if (trace_mode == TRACE_REPLAY)
+      trace_replay_output();
 
     /* Kick out folks in the CON_CLOSE or CON_DISCONNECT state */
     for (d = descriptor_list; d; d = next_d) {
@@ -915,6 +1102,7 @@ void game_loop(socket_t local_mother_desc)
       if (STATE(d) == CON_CLOSE || STATE(d) == CON_DISCONNECT)
 	close_socket(d);
     }
+    profile_add(PROF_PHASE, PHASE_OUTPUT, t);
 
     /* Now, we execute as many pulses as necessary--just one if we haven't
      * missed any pulses, or make up for lost time if we missed a few
@@ -932,6 +1120,12 @@ void game_loop(socket_t local_mother_desc)
       missed_pulses = 30 RL_SEC;
     }
 
+    /* A replay makes up for lost time only where the recording did. */
+    if (trace_mode == TRACE_REPLAY)
+      missed_pulses = trace_replay_heartbeats();
+    else
+      trace_heartbeats(missed_pulses);
+
     /* Now execute the heartbeat functions */
     while (missed_pulses--)
       heartbeat(++pulse);
@@ -951,6 +1145,12 @@ void game_loop(socket_t local_mother_desc)
       num_invalid = 0;
     }
 
+    trace_pass_end(profile_pulse_end(pulse_start));
+
+    if (trace_mode == TRACE_REPLAY && trace_replay_done()) {
+      log("Replay finished.");
+      circle_shutdown = 1;
+    }
 
 #ifdef CIRCLE_UNIX
     /* Update tics_passed for deadlock protection (UNIX only) */
@@ -985,37 +1185,60 @@ static void refresh_idle_prompts_on_tick(void)
 void heartbeat(int heart_pulse)
 {
   static int mins_since_crashsave = 0;
+  long t = profile_clock(), tick;
 
   event_process();
+  t = profile_add(PROF_PHASE, PHASE_EVENTS, t);
 
-  if (!(heart_pulse % PULSE_DG_SCRIPT))
+  if (!(heart_pulse % PULSE_DG_SCRIPT)) {
     script_trigger_check();
+    t = profile_add(PROF_PHASE, PHASE_SCRIPTS, t);
+  }
 
   if (!(heart_pulse % PASSES_PER_SEC)) {    /* EVERY second */
     msdp_update();
     next_tick--;
+    t = profile_add(PROF_PHASE, PHASE_OTHER, t);
   }
 
-  if (!(heart_pulse % PULSE_ZONE))
+  if (!(heart_pulse % PULSE_ZONE)) {
     zone_update();
+    t = profile_add(PROF_PHASE, PHASE_ZONES, t);
+    if (CONFIG_DEBUG_MODE >= NRM) {
+      check_zone_player_counts();
+      check_world_lists();
+      t = profile_add(PROF_PHASE, PHASE_OTHER, t);
+    }
+  }
 
-  if (!(heart_pulse % PULSE_IDLEPWD))		/* 15 seconds */
+  if (!(heart_pulse % PULSE_IDLEPWD)) {		/* 15 seconds */
     check_idle_passwords();
+    t = profile_add(PROF_PHASE, PHASE_OTHER, t);
+  }
 
-  if (!(heart_pulse % PULSE_MOBILE))
+  if (!(heart_pulse % PULSE_MOBILE)) {
     mobile_activity();
+    t = profile_add(PROF_PHASE, PHASE_MOBILES, t);
+  }
 
-  if (!(heart_pulse % PULSE_VIOLENCE))
+  if (!(heart_pulse % PULSE_VIOLENCE)) {
     perform_violence();
+    t = profile_add(PROF_PHASE, PHASE_VIOLENCE, t);
+  }
 
   if (!(heart_pulse % (SECS_PER_MUD_HOUR * PASSES_PER_SEC))) {  /* Tick ! */
+    tick = t;
     next_tick = SECS_PER_MUD_HOUR;  /* Reset tick coundown */
     weather_and_time(1);
     check_time_triggers();
+    t = profile_clock();
     affect_update();
+    t = profile_add(PROF_PHASE, PHASE_AFFECTS, t);
     point_update();
+    profile_add(PROF_PHASE, PHASE_POINTS, t);
     refresh_idle_prompts_on_tick();
     check_timed_quests();
+    t = profile_add(PROF_PHASE, PHASE_TICK, tick);
   }
 
   if (CONFIG_AUTO_SAVE && !(heart_pulse % PULSE_AUTOSAVE)) {	/* 1 minute */
@@ -1023,17 +1246,23 @@ void heartbeat(int heart_pulse)
       mins_since_crashsave = 0;
       Crash_save_all();
       House_save_all();
+      t = profile_add(PROF_PHASE, PHASE_AUTOSAVE, t);
     }
   }
 
-  if (!(heart_pulse % PULSE_USAGE))
+  if (!(heart_pulse % PULSE_USAGE)) {
     record_usage();
+    t = profile_add(PROF_PHASE, PHASE_OTHER, t);
+  }
 
-  if (!(heart_pulse % PULSE_TIMESAVE))
-  save_mud_time(&time_info);
+  if (!(heart_pulse % PULSE_TIMESAVE)) {
+    save_mud_time(&time_info);
+    t = profile_add(PROF_PHASE, PHASE_OTHER, t);
+  }
 
   /* Every pulse! Don't want them to stink the place up... */
   extract_pending_chars();
+  profile_add(PROF_PHASE, PHASE_EXTRACTIONS, t);
 }
 
 /* new code to calculate time differences, which works on systems for which
@@ -1170,10 +1399,7 @@ static int get_from_q(struct txt_q *queue, char *dest, int *aliased)
 /* Empty the queues before closing connection */
 static void flush_queues(struct descriptor_data *d)
 {
-  if (d->large_outbuf) {
-    d->large_outbuf->next = bufpool;
-    bufpool = d->large_outbuf;
-  }
+  output_consume(d, d->output_len);
   while (d->input.head) {
     struct txt_block *tmp = d->input.head;
     d->input.head = d->input.head->next;
@@ -1199,78 +1425,114 @@ size_t write_to_output(struct descriptor_data *t, const char *txt, ...)
 size_t vwrite_to_output(struct descriptor_data *t, const char *format, va_list args)
 {
   const char *text_overflow = "\r\nOVERFLOW\r\n";
+  const char *text_queue_full = "**OVERFLOW**\r\n";
   static char txt[MAX_STRING_LENGTH];
-  size_t wantsize;
+  const char *out;
   int size;
 
   /* if we're in the overflow state already, ignore this new output */
-  if (t->bufspace == 0)
+  if (t->output_overflow)
     return (0);
 
-  wantsize = size = vsnprintf(txt, sizeof(txt), format, args);
-
-  strcpy(txt, ProtocolOutput( t, txt, (int*)&wantsize )); /* <--- Add this line */
-  size = wantsize;                    /* <--- Add this line */
-  if ( t->pProtocol->WriteOOB > 0 )   /* <--- Add this line */
-    --t->pProtocol->WriteOOB;         /* <--- Add this line */
+  size = vsnprintf(txt, sizeof(txt), format, args);
 
   /* If exceeding the size of the buffer, truncate it for the overflow message */
-  if (size < 0 || wantsize >= sizeof(txt)) {
+  if (size < 0 || size >= (int) sizeof(txt)) {
     size = sizeof(txt) - 1;
     strcpy(txt + size - strlen(text_overflow), text_overflow);	/* strcpy: OK */
   }
 
-  /* If the text is too big to fit into even a large buffer, truncate
-   * the new text to make it fit.  (This will switch to the overflow
-   * state automatically because t->bufspace will end up 0.) */
-  if (size + t->bufptr + 1 > LARGE_BUFSIZE) {
-    size = LARGE_BUFSIZE - t->bufptr - 1;
-    txt[size] = '\0';
+  out = ProtocolOutput(t, txt, &size);
+  if (t->pProtocol->WriteOOB > 0)
+    --t->pProtocol->WriteOOB;
+
+  /* A client that is not reading its output stops getting any more until the
+   * queue has drained; tell it so. */
+  if (t->output_len + size > MAX_OUTPUT_QUEUE) {
     buf_overflows++;
+    t->output_overflow = TRUE;
+    output_append(t, text_queue_full, strlen(text_queue_full));
+    return (0);
   }
 
-  /* If we have enough space, just write to buffer and that's it! If the
-   * text just barely fits, then it's switched to a large buffer instead. */
-  if (t->bufspace > size) {
-    strcpy(t->output + t->bufptr, txt);	/* strcpy: OK (size checked above) */
-    t->bufspace -= size;
-    t->bufptr += size;
-    return (t->bufspace);
-  }
+  output_append(t, out, size);
+
+  return (MAX_OUTPUT_QUEUE - t->output_len);
+}
 
-  buf_switches++;
+/* Copy text onto the end of a descriptor's output queue, filling the tail
+ * chunk before taking a new one from the pool. */
+static void output_append(struct descriptor_data *t, const char *txt, size_t length)
+{
+  struct output_chunk *chunk;
+  size_t room;
+
+  buf_copied += length;
+  t->output_len += length;
+
+  while (length > 0) {
+    chunk = t->output_tail;
+    if (!chunk || chunk->len == OUTPUT_CHUNK_SIZE) {
+      /* if the pool has a chunk in it, grab it */
+      if (bufpool != NULL) {
+        chunk = bufpool;
+        bufpool = bufpool->next;
+      } else {			/* else create a new one */
+        CREATE(chunk, struct output_chunk, 1);
+        buf_largecount++;
+      }
+      chunk->len = chunk->sent = 0;
+      chunk->next = NULL;
+
+      if (t->output_tail) {
+        t->output_tail->next = chunk;
+        buf_switches++;
+      } else
+        t->output_head = chunk;
+      t->output_tail = chunk;
+    }
 
-  /* if the pool has a buffer in it, grab it */
-  if (bufpool != NULL) {
-    t->large_outbuf = bufpool;
-    bufpool = bufpool->next;
-  } else {			/* else create a new one */
-    CREATE(t->large_outbuf, struct txt_block, 1);
-    CREATE(t->large_outbuf->text, char, LARGE_BUFSIZE);
-    buf_largecount++;
+    room = MIN(OUTPUT_CHUNK_SIZE - chunk->len, length);
+    memcpy(chunk->data + chunk->len, txt, room);
+    chunk->len += room;
+    txt += room;
+    length -= room;
   }
+}
 
-  strcpy(t->large_outbuf->text, t->output);	/* strcpy: OK (size checked previously) */
-  t->output = t->large_outbuf->text;	/* make big buffer primary */
-  strcat(t->output, txt);	/* strcat: OK (size checked) */
+/* Drop 'length' bytes from the front of the output queue, returning emptied
+ * chunks to the pool. */
+static void output_consume(struct descriptor_data *t, size_t length)
+{
+  struct output_chunk *chunk;
+  size_t used;
 
-  /* set the pointer for the next write */
-  t->bufptr = strlen(t->output);
+  while (length > 0 && (chunk = t->output_head) != NULL) {
+    used = MIN(chunk->len - chunk->sent, length);
+    chunk->sent += used;
+    length -= used;
+    t->output_len -= used;
 
-  /* calculate how much space is left in the buffer */
-  t->bufspace = LARGE_BUFSIZE - 1 - t->bufptr;
+    if (chunk->sent < chunk->len)
+      break;
 
-  return (t->bufspace);
+    if (!(t->output_head = chunk->next))
+      t->output_tail = NULL;
+    chunk->next = bufpool;
+    bufpool = chunk;
+  }
+
+  /* Once everything has gone out, the client can have output again. */
+  if (t->output_len == 0)
+    t->output_overflow = FALSE;
 }
 
 static void free_bufpool(void)
 {
-  struct txt_block *tmp;
+  struct output_chunk *tmp;
 
   while (bufpool) {
     tmp = bufpool->next;
-    if (bufpool->text)
-      free(bufpool->text);
     free(bufpool);
     bufpool = tmp;
   }
@@ -1365,11 +1627,10 @@ static void init_descriptor (struct descriptor_data *newd, int desc)
 
   newd->descriptor = desc;
   newd->idle_tics = 0;
-  newd->output = newd->small_outbuf;
-  newd->bufspace = SMALL_BUFSIZE - 1;
+  newd->output_head = newd->output_tail = NULL;
+  newd->output_len = 0;
+  newd->output_overflow = FALSE;
   newd->login_time = time(0);
-  *newd->output = '\0';
-  newd->bufptr = 0;
   newd->has_prompt = 1;  /* prompt is part of greetings */
   STATE(newd) = CONFIG_PROTOCOL_NEGOTIATION ? CON_GET_PROTOCOL : CON_ACCT_NAME;
   CREATE(newd->history, char *, HISTORY_SIZE);
@@ -1378,24 +1639,36 @@ static void init_descriptor (struct descriptor_data *newd, int desc)
   newd->desc_num = last_desc;
   newd->pProtocol = ProtocolCreate(); /* KaVir's plugin*/
   newd->events = create_list();
-  
+
+  /* A replayed connection has no socket to watch, and can always be
+   * written to. */
+  if (desc == INVALID_SOCKET)
+    newd->poll_events = POLLER_WRITE;
+  else
+    poller_add(newd);
 }
 
+/* Returns -2 once accept() would block, -1 if it failed for any other
+ * reason, and 0 otherwise. */
 static int new_descriptor(socket_t s)
 {
   socket_t desc;
   int sockets_connected = 0;
-  int greetsize;
   socklen_t i;
   struct descriptor_data *newd;
   struct sockaddr_in peer;
-  struct hostent *from;
-  
+  int resolved;
+
   /* accept the new connection */
   i = sizeof(peer);
   if ((desc = accept(s, (struct sockaddr *) &peer, &i)) == INVALID_SOCKET) {
-    perror("SYSERR: accept");
-    return (-1);
+#if defined(EAGAIN) && !defined(CIRCLE_WINDOWS)
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      perror("SYSERR: accept");
+      return (-1);
+    }
+#endif
+    return (-2);
   }
   /* keep it from blocking */
   nonblock(desc);
@@ -1410,7 +1683,7 @@ static int new_descriptor(socket_t s)
   for (newd = descriptor_list; newd; newd = newd->next)
     sockets_connected++;
 
-  if (sockets_connected >= CONFIG_MAX_PLAYING) {
+  if (sockets_connected >= max_players || !poller_fd_ok(desc)) {
     write_to_descriptor(desc, "Sorry, the game is full right now... please try again later!\r\n");
     CLOSE_SOCKET(desc);
     return (0);
@@ -1418,21 +1691,15 @@ static int new_descriptor(socket_t s)
   /* create a new descriptor */
   CREATE(newd, struct descriptor_data, 1);
 
-  /* find the sitename */
-  if (CONFIG_NS_IS_SLOW ||
-      !(from = gethostbyaddr((char *) &peer.sin_addr,
-		             sizeof(peer.sin_addr), AF_INET))) {
-
-    /* resolution failed */
-    if (!CONFIG_NS_IS_SLOW)
-      perror("SYSERR: gethostbyaddr");
+  /* find the sitename: a cached name if we have one, otherwise the numeric
+   * address until the resolver threads come back with the name. */
+  resolved = !CONFIG_NS_IS_SLOW &&
+      resolver_cache_lookup(peer.sin_addr, newd->host, sizeof(newd->host));
 
+  if (!resolved) {
     /* find the numeric site address */
     strncpy(newd->host, (char *)inet_ntoa(peer.sin_addr), HOST_LENGTH);	/* strncpy: OK (n->host:HOST_LENGTH+1) */
     *(newd->host + HOST_LENGTH) = '\0';
-  } else {
-    strncpy(newd->host, from->h_name, HOST_LENGTH);	/* strncpy: OK (n->host:HOST_LENGTH+1) */
-    *(newd->host + HOST_LENGTH) = '\0';
   }
 
   /* determine if the site is banned */
@@ -1443,6 +1710,20 @@ static int new_descriptor(socket_t s)
     return (0);
   }
 
+  start_descriptor(newd, desc);
+  trace_connect(newd);
+
+  if (!CONFIG_NS_IS_SLOW && !resolved)
+    resolver_request(newd, peer.sin_addr);
+
+  return (0);
+}
+
+/* Puts a new connection on the list and greets it. */
+static void start_descriptor(struct descriptor_data *newd, socket_t desc)
+{
+  int greetsize;
+
   /* initialize descriptor data */
   init_descriptor(newd, desc);
 
@@ -1460,74 +1741,368 @@ static int new_descriptor(socket_t s)
     greetsize = strlen(GREETINGS);
     write_to_output(newd, "%s", ProtocolOutput(newd, GREETINGS, &greetsize));
   }
+}
+
+/** Opens a connection from an input trace.  It has no socket, and what is
+ * written to it goes nowhere.
+ * @param desc_num The number the connection had when it was recorded.
+ * @param host Where it came from. */
+struct descriptor_data *replay_descriptor(int desc_num, const char *host)
+{
+  struct descriptor_data *newd;
+
+  CREATE(newd, struct descriptor_data, 1);
+  strlcpy(newd->host, host, sizeof(newd->host));
+  start_descriptor(newd, INVALID_SOCKET);
+  newd->desc_num = desc_num;
+  return (newd);
+}
+
+/* The resolver found a name for a connection that started out numeric.  The
+ * name may be banned even though the address was not. */
+static void hostname_resolved(struct descriptor_data *d, const char *host)
+{
+  strncpy(d->host, host, HOST_LENGTH);	/* strncpy: OK (d->host:HOST_LENGTH+1) */
+  *(d->host + HOST_LENGTH) = '\0';
+
+  if (isbanned(d->host) == BAN_ALL) {
+    mudlog(CMP, LVL_GOD, TRUE, "Connection attempt denied from [%s]", d->host);
+    STATE(d) = IS_PLAYING(d) ? CON_DISCONNECT : CON_CLOSE;
+  }
+}
+
+/* Accept every connection waiting on the mother socket, up to a burst limit
+ * per pass so a connection flood cannot starve the pulse.  Anything left over
+ * is picked up on the next pass, as is anything behind an accept() error; the
+ * mother socket only counts as drained once accept() would block. */
+static void accept_new_descriptors(socket_t s)
+{
+  int accepted, result;
+
+  for (accepted = 0; accepted < MAX_ACCEPTS_PER_PASS; accepted++)
+    if ((result = new_descriptor(s)) < 0) {
+      if (result == -2)
+        poller_mother_drained();
+      return;
+    }
+}
+
+/* Pass the first 'length' queued bytes on to whoever is snooping 't'. */
+static void output_snoop(struct descriptor_data *t, size_t length)
+{
+  struct output_chunk *chunk;
+  size_t part;
+
+  write_to_output(t->snoop_by, "%% ");
+  for (chunk = t->output_head; chunk && length; chunk = chunk->next) {
+    part = MIN(chunk->len - chunk->sent, length);
+    write_to_output(t->snoop_by, "%.*s", (int) part, chunk->data + chunk->sent);
+    length -= part;
+  }
+  write_to_output(t->snoop_by, "%%%%");
+}
+
+/* Does this descriptor have anything waiting to go out? */
+static int output_pending(struct descriptor_data *t)
+{
+#ifdef HAVE_ZLIB_H
+  if (t->compress && t->compress->wire_len > t->compress->wire_sent)
+    return (TRUE);
+#endif
+  return (t->output_len > 0);
+}
+
+#ifdef HAVE_ZLIB_H
+/* MCCP v2.  Once a client answers our WILL with DO, compress_start() queues
+ * IAC SB MCCP2 IAC SE and everything queued after it is run through a zlib
+ * deflate stream of its own.  Each output pass compresses the whole plain
+ * queue into the descriptor's wire buffer and ends with Z_SYNC_FLUSH, so the
+ * client can display everything we have sent so far.  More text is only taken
+ * from the plain queue once the wire buffer is empty; a client that stops
+ * reading therefore still runs into MAX_OUTPUT_QUEUE.  compress_end() closes
+ * the stream with Z_FINISH, after which the client reads plain text again. */
+static void compress_wire_reserve(struct compress_data *c, size_t length)
+{
+  if (c->wire_len + length <= c->wire_size)
+    return;
+
+  c->wire_size = MAX(c->wire_size * 2, c->wire_len + length);
+  RECREATE(c->wire, char, c->wire_size);
+}
+
+/* Deflate 'length' bytes of 'txt' onto the end of the wire buffer. */
+static int compress_deflate(struct compress_data *c, const char *txt, size_t length, int flush)
+{
+  size_t before;
+  int ret;
+
+  c->stream.next_in = (Bytef *) txt;
+  c->stream.avail_in = length;
+  c->bytes_in += length;
+
+  do {
+    compress_wire_reserve(c, COMPRESS_BUF_SIZE);
+    before = c->wire_len;
+    c->stream.next_out = (Bytef *) c->wire + c->wire_len;
+    c->stream.avail_out = c->wire_size - c->wire_len;
+    ret = deflate(&c->stream, flush);
+    c->wire_len = c->wire_size - c->stream.avail_out;
+    c->bytes_out += c->wire_len - before;
+    if (ret == Z_STREAM_ERROR)
+      return (-1);
+  } while (c->stream.avail_out == 0);
+
   return (0);
 }
 
+/* Move everything in the plain queue into the wire buffer.  Text queued
+ * ahead of the start marker is copied as is, the rest is deflated. */
+static int compress_queue(struct descriptor_data *t, int flush)
+{
+  struct compress_data *c = t->compress;
+  struct output_chunk *chunk;
+  const char *txt;
+  size_t length, raw;
+  clock_t start = clock();
+  int ret = 0;
+
+  if (t->snoop_by)
+    output_snoop(t, t->output_len);
+
+  for (chunk = t->output_head; chunk && ret == 0; chunk = chunk->next) {
+    txt = chunk->data + chunk->sent;
+    length = chunk->len - chunk->sent;
+
+    if ((raw = MIN(length, c->raw_left)) > 0) {
+      compress_wire_reserve(c, raw);
+      memcpy(c->wire + c->wire_len, txt, raw);
+      c->wire_len += raw;
+      c->raw_left -= raw;
+      txt += raw;
+      length -= raw;
+    }
+    if (length > 0)
+      ret = compress_deflate(c, txt, length, Z_NO_FLUSH);
+  }
+  if (ret == 0)
+    ret = compress_deflate(c, NULL, 0, flush);
+
+  output_consume(t, t->output_len);
+  c->cpu += clock() - start;
+
+  return (ret);
+}
+
+/* Send the wire buffer, refilling it from the plain queue while the kernel
+ * keeps taking data. */
+static int process_compressed_output(struct descriptor_data *t)
+{
+  struct compress_data *c = t->compress;
+  ssize_t result, total = 0;
+
+  for (;;) {
+    if (c->wire_sent == c->wire_len) {
+      c->wire_len = c->wire_sent = 0;
+      if (!c->active || !t->output_len)
+        return (total);
+      if (compress_queue(t, Z_SYNC_FLUSH) < 0) {
+        log("SYSERR: deflate() failed for %s, closing connection.", t->host);
+        return (-1);
+      }
+    }
+
+    result = perform_socket_write(t->descriptor, c->wire + c->wire_sent, c->wire_len - c->wire_sent);
+    if (result < 0) {	/* Oops, fatal error. Bye! */
+      perror("SYSERR: Write to socket");
+      return (-1);
+    } else if (result == 0) {	/* Socket buffer full. Try later. */
+      poller_write_blocked(t);
+      return (total);
+    }
+
+    c->wire_sent += result;
+    total += result;
+    if (c->wire_sent < c->wire_len) {
+      poller_write_blocked(t);
+      return (total);
+    }
+  }
+}
+
+/* The client said DO MCCP2 (or we are restoring it after a copyover). */
+void compress_start(struct descriptor_data *d)
+{
+  static const char start[] = { (char) IAC, (char) SB, (char) TELOPT_MCCP, (char) IAC, (char) SE };
+  struct compress_data *c;
+
+  if (!d->compress)
+    CREATE(d->compress, struct compress_data, 1);
+  c = d->compress;
+
+  if (c->active)
+    return;
+
+  if (deflateInit(&c->stream, COMPRESS_LEVEL) != Z_OK) {
+    log("SYSERR: deflateInit() failed, not compressing output for %s.", d->host);
+    d->pProtocol->bMCCP = false;
+    return;
+  }
+
+  output_append(d, start, sizeof(start));
+  c->raw_left = d->output_len;
+  c->active = TRUE;
+}
+
+/* The client said DONT MCCP2, or a copyover is about to write to the socket
+ * directly.  Everything queued so far is compressed and the stream is closed;
+ * the tail of it is pushed out right away. */
+void compress_end(struct descriptor_data *d)
+{
+  struct compress_data *c = d->compress;
+
+  if (!c || !c->active)
+    return;
+
+  if (compress_queue(d, Z_FINISH) < 0)
+    log("SYSERR: deflate() failed while ending compression for %s.", d->host);
+  deflateEnd(&c->stream);
+  c->active = FALSE;
+  c->raw_left = 0;
+
+  /* A write error shows up again on the next output pass. */
+  process_compressed_output(d);
+}
+
+/* A copyover is about to write plain text to the socket and exec, so the tail
+ * of the stream has to reach the kernel first.  Waits for a full socket to
+ * drain, giving up after COMPRESS_FLUSH_SECS so one stuck client cannot hold
+ * up the copyover. */
+void compress_flush(struct descriptor_data *d)
+{
+  struct compress_data *c = d->compress;
+  struct timeval pause, start, now, waited;
+  ssize_t result;
+
+  if (!c)
+    return;
+
+  gettimeofday(&start, (struct timezone *) 0);
+  while (c->wire_sent < c->wire_len) {
+    result = perform_socket_write(d->descriptor, c->wire + c->wire_sent, c->wire_len - c->wire_sent);
+    if (result < 0) {
+      perror("SYSERR: Write to socket");
+      break;
+    } else if (result > 0) {
+      c->wire_sent += result;
+      continue;
+    }
+
+    /* Socket buffer full: give the client a moment to read. */
+    gettimeofday(&now, (struct timezone *) 0);
+    timediff(&waited, &now, &start);
+    if (waited.tv_sec >= COMPRESS_FLUSH_SECS) {
+      log("SYSERR: Gave up flushing compressed output to %s.", d->host);
+      break;
+    }
+    pause.tv_sec = 0;
+    pause.tv_usec = 10000;
+    circle_sleep(&pause);
+  }
+  c->wire_len = c->wire_sent = 0;
+}
+
+static void compress_free(struct descriptor_data *d)
+{
+  if (!d->compress)
+    return;
+
+  if (d->compress->active)
+    deflateEnd(&d->compress->stream);
+  if (d->compress->wire)
+    free(d->compress->wire);
+  free(d->compress);
+  d->compress = NULL;
+}
+
+/* Report how well a descriptor's output has compressed.  Returns FALSE if it
+ * never used MCCP. */
+int compress_stats(struct descriptor_data *d, unsigned long *in, unsigned long *out, double *cpu_ms)
+{
+  if (!d->compress || !d->compress->bytes_in)
+    return (FALSE);
+
+  *in = d->compress->bytes_in;
+  *out = d->compress->bytes_out;
+  *cpu_ms = (double) d->compress->cpu * 1000.0 / CLOCKS_PER_SEC;
+  return (TRUE);
+}
+#else
+void compress_start(struct descriptor_data *d)
+{
+  d->pProtocol->bMCCP = false;
+}
+
+void compress_end(struct descriptor_data *d)
+{
+}
+
+void compress_flush(struct descriptor_data *d)
+{
+}
+
+int compress_stats(struct descriptor_data *d, unsigned long *in, unsigned long *out, double *cpu_ms)
+{
+  return (FALSE);
+}
+#endif /* HAVE_ZLIB_H */
+
 /* Send all of the output that we've accumulated for a player out to the
- * player's descriptor. 32 byte GARBAGE_SPACE in MAX_SOCK_BUF used for:
- *	 2 bytes: prepended \r\n
- *	14 bytes: overflow message
- *	 2 bytes: extra \r\n for non-comapct
- *      14 bytes: unused */
+ * player's descriptor.  The queued chunks are handed to the kernel as they
+ * are (one writev() call), and whatever the kernel did not take stays queued
+ * for the next pass; nothing is copied or moved.  Compressed connections go
+ * through the wire buffer instead. */
 static int process_output(struct descriptor_data *t)
 {
-  char i[MAX_SOCK_BUF], *osb = i + 2;
-  int result;
-
-  /* we may need this \r\n for later -- see below */
-  strcpy(i, "\r\n");	/* strcpy: OK (for 'MAX_SOCK_BUF >= 3') */
+  ssize_t result;
+  size_t queued;
 
-  /* now, append the 'real' output */
-  strcpy(osb, t->output);	/* strcpy: OK (t->output:LARGE_BUFSIZE < osb:MAX_SOCK_BUF-2) */
+  /* A replayed connection has no socket; its output counts as sent. */
+  if (t->descriptor == INVALID_SOCKET) {
+    result = t->output_len;
+    if (t->snoop_by)
+      output_snoop(t, result);
+    output_consume(t, result);
+    return (result);
+  }
 
-  /* if we're in the overflow state, notify the user */
-  if (t->bufspace == 0)
-    strcat(osb, "**OVERFLOW**\r\n");	/* strcpy: OK (osb:MAX_SOCK_BUF-2 reserves space) */
+#ifdef HAVE_ZLIB_H
+  if (t->compress && (t->compress->active || t->compress->wire_len)) {
+    result = process_compressed_output(t);
+    /* Plain text queued behind the end of a stream goes out below. */
+    if (result < 0 || t->compress->active || t->compress->wire_len ||
+        !t->output_len || !IS_SET(t->poll_events, POLLER_WRITE))
+      return (result);
+  }
+#endif
 
   /* now, send the output. */
-  result = write_to_descriptor(t->descriptor, osb);
+  result = perform_socket_writev(t->descriptor, t->output_head, &queued);
   if (result < 0) {	/* Oops, fatal error. Bye! */
-//    close_socket(t); // close_socket is called after return of negative result
+    perror("SYSERR: Write to socket");
     return (-1);
-  } else if (result == 0)	/* Socket buffer full. Try later. */
+  } else if (result == 0) {	/* Socket buffer full. Try later. */
+    poller_write_blocked(t);
     return (0);
+  }
+
+  if ((size_t) result < queued)
+    poller_write_blocked(t);
 
   /* Handle snooping: prepend "% " and send to snooper. */
   if (t->snoop_by)
-    write_to_output(t->snoop_by, "%% %*s%%%%", result, t->output);
-
-  /* The common case: all saved output was handed off to the kernel buffer. */
-  if (result >= t->bufptr) {
-    /* If we were using a large buffer, put the large buffer on the buffer pool
-     * and switch back to the small one. */
-    if (t->large_outbuf) {
-      t->large_outbuf->next = bufpool;
-      bufpool = t->large_outbuf;
-      t->large_outbuf = NULL;
-      t->output = t->small_outbuf;
-    }
-    /* reset total bufspace back to that of a small buffer */
-    t->bufspace = SMALL_BUFSIZE - 1;
-    t->bufptr = 0;
-    *(t->output) = '\0';
-
-    /* If the overflow message or prompt were partially written, try to save
-     * them. There will be enough space for them if this is true.  'result'
-     * is effectively unsigned here anyway. */
-    if ((unsigned int)result < strlen(osb)) {
-      size_t savetextlen = strlen(osb + result);
-
-      strcat(t->output, osb + result);
-      t->bufptr   -= savetextlen;
-      t->bufspace += savetextlen;
-    }
+    output_snoop(t, result);
 
-  } else {
-    /* Not all data in buffer sent.  result < output buffersize. */
-    strcpy(t->output, t->output + result);	/* strcpy: OK (overlap) */
-    t->bufptr   -= result;
-    t->bufspace += result;
-  }
+  output_consume(t, result);
 
   return (result);
 }
@@ -1618,6 +2193,59 @@ static ssize_t perform_socket_write(socket_t desc, const char *txt, size_t lengt
 }
 #endif /* CIRCLE_WINDOWS */
 
+/* perform_socket_writev: hands a chain of output chunks to the OS in one
+ * call.  Sets *queued to the number of bytes offered and returns like
+ * perform_socket_write.  Platforms without writev() send the first chunk. */
+#if defined(HAVE_SYS_UIO_H) && !defined(CIRCLE_WINDOWS)
+#define OUTPUT_IOV_MAX  (MAX_OUTPUT_QUEUE / OUTPUT_CHUNK_SIZE + 1)
+
+static ssize_t perform_socket_writev(socket_t desc, struct output_chunk *chunk, size_t *queued)
+{
+  struct iovec iov[OUTPUT_IOV_MAX];
+  ssize_t result;
+  int n;
+
+  for (n = 0, *queued = 0; chunk && n < OUTPUT_IOV_MAX; chunk = chunk->next, n++) {
+    iov[n].iov_base = chunk->data + chunk->sent;
+    iov[n].iov_len = chunk->len - chunk->sent;
+    *queued += iov[n].iov_len;
+  }
+
+  /* A signal landing mid-call is not a full socket; under edge-triggered
+   * polling no writable event would come along to finish the job. */
+  do
+    result = writev(desc, iov, n);
+  while (result < 0 && errno == EINTR);
+
+  if (result > 0)
+    return (result);
+
+  if (result == 0) {
+    /* This should never happen! */
+    log("SYSERR: Huh??  writev() returned 0???  Please report this!");
+    return (-1);
+  }
+
+#ifdef EAGAIN		/* POSIX */
+  if (errno == EAGAIN)
+    return (0);
+#endif
+
+#ifdef EWOULDBLOCK	/* BSD */
+  if (errno == EWOULDBLOCK)
+    return (0);
+#endif
+
+  return (-1);
+}
+#else
+static ssize_t perform_socket_writev(socket_t desc, struct output_chunk *chunk, size_t *queued)
+{
+  *queued = chunk->len - chunk->sent;
+  return (perform_socket_write(desc, chunk->data + chunk->sent, *queued));
+}
+#endif
+
 /* write_to_descriptor takes a descriptor, and text to write to the descriptor.
  * It keeps calling the system-level write() until all the text has been
  * delivered to the OS, or until an error is encountered. Returns:
@@ -1745,6 +2373,8 @@ static int process_input(struct descriptor_data *t)
      * in the read_buf array as NULL */
     if ((bytes_read = perform_socket_read(t->descriptor, read_buf, space_left)) > 0)
       read_buf[bytes_read] = '\0';
+    else if (bytes_read == 0)
+      poller_read_drained(t);
 
     /* Since we have recieved atleast 1 byte of data from the socket, lets run it through
      * ProtocolInput() and rip out anything that is Out Of Band */ 
@@ -1814,13 +2444,8 @@ static int process_input(struct descriptor_data *t)
 
     *write_point = '\0';
 
-    if ((space_left <= 0) && (ptr < nl_pos)) {
-      char buffer[MAX_INPUT_LENGTH + 64];
-
-      snprintf(buffer, sizeof(buffer), "Line too long.  Truncated to:\r\n%s\r\n", tmp);
-      if (write_to_descriptor(t->descriptor, buffer) < 0)
-	return (-1);
-    }
+    if ((space_left <= 0) && (ptr < nl_pos))
+      write_to_output(t, "Line too long.  Truncated to:\r\n%s\r\n", tmp);
     if (t->snoop_by)
       write_to_output(t->snoop_by, "%% %s\r\n", tmp);
     failed_subst = 0;
@@ -1939,8 +2564,13 @@ void close_socket(struct descriptor_data *d)
   struct descriptor_data *temp;
 
   REMOVE_FROM_LIST(d, descriptor_list, next);
+  poller_remove(d);
+  resolver_cancel(d);
   CLOSE_SOCKET(d->descriptor);
   flush_queues(d);
+#ifdef HAVE_ZLIB_H
+  compress_free(d);
+#endif
 
   /* Forget snooping */
   if (d->snooping)
@@ -1954,6 +2584,7 @@ void close_socket(struct descriptor_data *d)
   if (d->character) {
     /* If we're switched, this resets the mobile taken. */
     d->character->desc = NULL;
+    update_zone_player(d->character);
 
     /* Plug memory leak, from Eric Green. */
     if (!IS_NPC(d->character) && PLR_FLAGGED(d->character, PLR_MAILING) && d->str) {
@@ -2154,6 +2785,13 @@ static RETSIGTYPE checkpointing(int sig)
 static RETSIGTYPE hupsig(int sig)
 {
   log("SYSERR: Received SIGHUP, SIGINT, or SIGTERM.  Shutting down...");
+
+  /* A load test or a recording ends this way, and wants its report or
+   * trace finished. */
+  if (bench_report || trace_mode == TRACE_RECORD) {
+    circle_shutdown = 1;
+    return;
+  }
   exit(1); /* perhaps something more elegant should substituted */
 }
 
@@ -14,6 +14,10 @@
 #define _COMM_H_
 
 #define NUM_RESERVED_DESCS	8
+#define MAX_ACCEPTS_PER_PASS	32  /* new connections accepted per game_loop pass */
+#define COMPRESS_LEVEL		6     /* zlib level for MCCP output, 1 (fast) - 9 (small) */
+#define COMPRESS_BUF_SIZE	4096  /* free space kept ahead of each deflate() call */
+#define COMPRESS_FLUSH_SECS	5     /* longest copyover waits on a client's compressed tail */
 #define COPYOVER_FILE "copyover.dat"
 
 /* comm.c */
@@ -52,8 +56,16 @@ int	write_to_descriptor(socket_t desc, const char *txt);
 size_t	write_to_output(struct descriptor_data *d, const char *txt, ...) __attribute__ ((format (printf, 2, 3)));
 size_t	vwrite_to_output(struct descriptor_data *d, const char *format, va_list args);
 
+/* MCCP v2 output compression */
+void	compress_start(struct descriptor_data *d);
+void	compress_end(struct descriptor_data *d);
+void	compress_flush(struct descriptor_data *d);
+int	compress_stats(struct descriptor_data *d, unsigned long *in, unsigned long *out, double *cpu_ms);
+
 typedef RETSIGTYPE sigfunc(int);
 
+struct descriptor_data *replay_descriptor(int desc_num, const char *host);
+
 void echo_off(struct descriptor_data *d);
 void echo_on(struct descriptor_data *d);
 void game_loop(socket_t mother_desc);
@@ -64,6 +76,7 @@ extern struct descriptor_data *descriptor_list;
 extern int buf_largecount;
 extern int buf_overflows;
 extern int buf_switches;
+extern unsigned long buf_copied;
 extern int circle_shutdown;
 extern int circle_reboot;
 extern int no_specials;
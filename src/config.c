@@ -317,3 +317,8 @@ int special_in_comm = YES;
 
 /* Current Debug Mode */
 int debug_mode = OFF;
+
+/* How many minutes a zone must be empty of players before its mobiles stop
+ * wandering, regenerating and counting down their affects.  They catch up
+ * when a player comes back.  0 keeps every zone awake. */
+int zone_dormancy = 10;
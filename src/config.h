@@ -71,6 +71,7 @@ extern int display_closed_doors;
 extern int protocol_negotiation;
 extern int special_in_comm;
 extern int debug_mode;
+extern int zone_dormancy;
 /* Automap and map options */
 extern int map_option;
 extern int default_map_size;
@@ -10,6 +10,11 @@
 
 #include "conf.h"
 #include "sysdep.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 #include "structs.h"
 #include "utils.h"
 #include "db.h"
@@ -39,8 +44,20 @@
 #include "mud_event.h"
 #include "msgedit.h"
 #include "screen.h"
+#include "pathfind.h"
+#include "ptable.h"
+#include "accounts.h"
+#include "snapshot.h"
+#include "logwriter.h"
 #include <sys/stat.h>
 
+/* The world files are read on worker threads where there are threads and
+ * thread-local log captures (see logwriter.c). */
+#if defined(HAVE_PTHREAD_H) && defined(__GNUC__)
+#define BOOT_THREADED
+#endif
+#define BOOT_MAX_THREADS 8    /* most world file workers, however many CPUs */
+
 /*  declarations of most of the 'global' variables */
 struct config_data config_info; /* Game configuration list.	 */
 
@@ -127,12 +144,53 @@ struct happyhour happy_data = {0,0,0,0};
 /* declaration of local (file scope) variables */
 static int converting = FALSE;
 
+/* One world file read by index_boot(), and the slots of the tables set aside
+ * for its records. */
+struct boot_file {
+  char name[PATH_MAX];      /* path of the file, for messages */
+  int mode;                 /* DB_BOOT_ZON, _TRG, _WLD, _MOB or _OBJ */
+  int first;                /* first slot of the file's records */
+  int slots;                /* records counted in the file */
+  int loaded;               /* records read into the slots */
+  zone_rnum zone;           /* where parse_room() is in the zone table */
+  int done;                 /* read by a worker */
+  int failed;               /* given up on by boot_abort() */
+  struct log_capture log;   /* what a worker logged while reading it */
+};
+
+static int boot_threads = 1;  /* threads the last world files were read on */
+
+#ifdef BOOT_THREADED
+static struct boot_file *boot_queue;  /* the files of the current phase */
+static int boot_queued = 0, boot_taken = 0;
+static pthread_t boot_workers[BOOT_MAX_THREADS];
+static pthread_mutex_t boot_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t boot_cond = PTHREAD_COND_INITIALIZER;
+static __thread struct boot_file *boot_parsing = NULL;  /* a worker's file */
+#endif
+
 /* Local (file scope) utility functions */
 static int check_bitvector_names(bitvector_t bits, size_t namecount, const char *whatami, const char *whatbits);
 static int check_object_spell_number(struct obj_data *obj, int val);
 static int check_object_level(struct obj_data *obj, int val);
 static int check_object(struct obj_data *);
-static void load_zones(FILE *fl, char *zonename);
+static void load_zones(FILE *fl, char *zonename, zone_rnum zone);
+static void discrete_load(FILE *fl, int mode, struct boot_file *file);
+static void boot_abort(void) __attribute__ ((noreturn));
+static void parse_boot_file(struct boot_file *file);
+static void load_world_files(int mode, struct boot_file *files, int count, int slots);
+static int merge_boot_file(int mode, struct boot_file *file, int to);
+static void finish_boot_tables(int mode, int count, int slots);
+static void save_converted(int vnum, int type);
+static int starts_with_article(const char *str);
+static void boot_phase(char *times, size_t size, const char *phase, struct timeval *since);
+#ifdef BOOT_THREADED
+static void end_boot_file(struct boot_file *file, int failed);
+static void *boot_worker(void *arg);
+static int start_boot_workers(struct boot_file *files, int count);
+static void wait_for_boot_file(struct boot_file *file);
+static void stop_boot_workers(int count);
+#endif
 static int file_to_string(const char *name, char *buf);
 static int file_to_string_alloc(const char *name, char **buf);
 static int count_alias_records(FILE *fl);
@@ -457,45 +515,92 @@ ACMD(do_reboot)
   send_to_char(ch, "%s", CONFIG_OK);
 }
 
-void boot_world(void)
+/* Adds how long a step of boot_world() took to the list logged at its end,
+ * and starts timing the next one. */
+static void boot_phase(char *times, size_t size, const char *phase, struct timeval *since)
 {
-  log("Loading zone table.");
-  index_boot(DB_BOOT_ZON);
-
-  log("Loading triggers and generating index.");
-  index_boot(DB_BOOT_TRG);
-
-  log("Loading rooms.");
-  index_boot(DB_BOOT_WLD);
-
-  log("Renumbering rooms.");
-  renum_world();
-
-  log("Checking start rooms.");
-  check_start_rooms();
-
-  log("Loading mobs and generating index.");
-  index_boot(DB_BOOT_MOB);
+  struct timeval now;
+  size_t len = strlen(times);
 
-  log("Loading objs and generating index.");
-  index_boot(DB_BOOT_OBJ);
-
-  log("Renumbering zone table.");
-  renum_zone_table();
+  gettimeofday(&now, NULL);
+  snprintf(times + len, size - len, "%s%s %ld ms", len ? ", " : "", phase,
+           (now.tv_sec - since->tv_sec) * 1000L + (now.tv_usec - since->tv_usec) / 1000);
+  *since = now;
+}
 
-  if(converting) {
-    log("Saving 128bit world files to disk.");
-    save_all();
+void boot_world(void)
+{
+  char times[MAX_STRING_LENGTH];
+  struct timeval since;
+  int from_files = FALSE;
+
+  *times = '\0';
+  gettimeofday(&since, NULL);
+
+  /* The syntax checker is there to read the files themselves. */
+  if (!scheck && snapshot_load()) {
+    boot_phase(times, sizeof(times), "snapshot", &since);
+    log("Checking start rooms.");
+    check_start_rooms();
+  } else {
+    from_files = TRUE;
+
+    log("Loading zone table.");
+    index_boot(DB_BOOT_ZON);
+    boot_phase(times, sizeof(times), "zones", &since);
+
+    log("Loading triggers and generating index.");
+    index_boot(DB_BOOT_TRG);
+    boot_phase(times, sizeof(times), "triggers", &since);
+
+    log("Loading rooms.");
+    index_boot(DB_BOOT_WLD);
+    boot_phase(times, sizeof(times), "rooms", &since);
+
+    log("Renumbering rooms.");
+    renum_world();
+
+    log("Checking start rooms.");
+    check_start_rooms();
+    boot_phase(times, sizeof(times), "room renumbering", &since);
+
+    log("Loading mobs and generating index.");
+    index_boot(DB_BOOT_MOB);
+    boot_phase(times, sizeof(times), "mobs", &since);
+
+    log("Loading objs and generating index.");
+    index_boot(DB_BOOT_OBJ);
+    boot_phase(times, sizeof(times), "objs", &since);
+
+    log("Renumbering zone table.");
+    renum_zone_table();
+    boot_phase(times, sizeof(times), "zone renumbering", &since);
+
+    if(converting) {
+      log("Saving 128bit world files to disk.");
+      save_all();
+      boot_phase(times, sizeof(times), "saving", &since);
+    } else if (!scheck) {
+      snapshot_save();
+      boot_phase(times, sizeof(times), "snapshot", &since);
+    }
   }
 
   if (!no_specials) {
     log("Loading shops.");
     index_boot(DB_BOOT_SHP);
+    boot_phase(times, sizeof(times), "shops", &since);
   }
 
   log("Loading quests.");
   index_boot(DB_BOOT_QST);
+  boot_phase(times, sizeof(times), "quests", &since);
 
+  if (from_files)
+    log("Boot times, world files read on %d thread%s: %s.", boot_threads,
+        boot_threads == 1 ? "" : "s", times);
+  else
+    log("Boot times: %s.", times);
 }
 
 static void free_extra_descriptions(struct extra_descr_data *edesc)
@@ -579,6 +684,7 @@ void destroy_db(void)
   }
   free(world);
   top_of_world = 0;
+  pathfind_free();
 
   /* Objects */
   for (cnt = 0; cnt <= top_of_objt; cnt++) {
@@ -733,6 +839,9 @@ void boot_db(void)
   log("Generating player index.");
   build_player_index();
 
+  log("Loading account index.");
+  account_index_boot();
+
   if (auto_pwipe) {
     log("Cleaning out inactive pfiles.");
     clean_pfiles();
@@ -957,8 +1066,11 @@ void index_boot(int mode)
 {
   const char *index_filename, *prefix = NULL;	/* NULL or egcs 1.1 complains */
   FILE *db_index, *db_file;
-  int line_number, rec_count = 0, size[2];
+  int line_number, rec_count = 0, size[2], count, num_files = 0, max_files = 0;
   char buf2[PATH_MAX], buf1[PATH_MAX - 100];   // - 100 to make room for prefix
+  struct boot_file *files = NULL, quests;
+  int world_files = (mode == DB_BOOT_ZON || mode == DB_BOOT_TRG ||
+      mode == DB_BOOT_WLD || mode == DB_BOOT_MOB || mode == DB_BOOT_OBJ);
 
   switch (mode) {
   case DB_BOOT_WLD:
@@ -1029,15 +1141,31 @@ void index_boot(int mode)
     if (!(db_file = fopen(buf2, "r"))) {
       log("SYSERR: File '%s' listed in '%s/%s': %s", buf2, prefix,
           index_filename, strerror(errno));
+      count = 0;
     } else {
       if (mode == DB_BOOT_ZON)
-        rec_count++;
+        count = 1;
       else if (mode == DB_BOOT_HLP)
-        rec_count += count_alias_records(db_file);
+        count = count_alias_records(db_file);
       else
-        rec_count += count_hash_records(db_file);
+        count = count_hash_records(db_file);
       fclose(db_file);
     }
+
+    /* Each world file gets the slots its records were counted for. */
+    if (world_files) {
+      if (num_files == max_files) {
+        max_files = max_files ? max_files * 2 : 64;
+        RECREATE(files, struct boot_file, max_files);
+      }
+      memset(files + num_files, 0, sizeof(struct boot_file));
+      strlcpy(files[num_files].name, buf2, sizeof(files[num_files].name));
+      files[num_files].mode = mode;
+      files[num_files].first = rec_count;
+      files[num_files].slots = count;
+      num_files++;
+    }
+    rec_count += count;
   }
 
   /* Exit if 0 records, unless this is shops */
@@ -1090,6 +1218,13 @@ void index_boot(int mode)
     break;
   }
 
+  if (world_files) {
+    fclose(db_index);
+    load_world_files(mode, files, num_files, rec_count);
+    free(files);
+    return;
+  }
+
   rewind(db_index);
 
   for (line_number = 1;; ++line_number) {
@@ -1115,15 +1250,10 @@ void index_boot(int mode)
       exit(1);
     }
     switch (mode) {
-    case DB_BOOT_WLD:
-    case DB_BOOT_OBJ:
-    case DB_BOOT_MOB:
-    case DB_BOOT_TRG:
     case DB_BOOT_QST:
-      discrete_load(db_file, mode, buf2);
-      break;
-    case DB_BOOT_ZON:
-      load_zones(db_file, buf2);
+      memset(&quests, 0, sizeof(quests));
+      strlcpy(quests.name, buf2, sizeof(quests.name));
+      discrete_load(db_file, mode, &quests);
       break;
     case DB_BOOT_HLP:
       load_help(db_file, buf2);
@@ -1143,7 +1273,287 @@ void index_boot(int mode)
   }
 }
 
-void discrete_load(FILE *fl, int mode, char *filename)
+/* Gives up on the boot after an error in a world file.  A worker leaves the
+ * exit to load_world_files(), which logs what the file's worker logged and
+ * exits once it gets to the file, after the files before it. */
+static void boot_abort(void)
+{
+#ifdef BOOT_THREADED
+  if (boot_parsing) {
+    end_boot_file(boot_parsing, TRUE);
+    pthread_exit(NULL);
+  }
+#endif
+  exit(1);
+}
+
+/* Reads one world file into the slots set aside for it. */
+static void parse_boot_file(struct boot_file *file)
+{
+  FILE *fl;
+
+  if (!(fl = fopen(file->name, "r"))) {
+    log("SYSERR: %s: %s", file->name, strerror(errno));
+    boot_abort();
+  }
+
+  if (file->mode == DB_BOOT_ZON) {
+    load_zones(fl, file->name, file->first);
+    file->loaded = 1;
+  } else
+    discrete_load(fl, file->mode, file);
+
+  fclose(fl);
+}
+
+#ifdef BOOT_THREADED
+/* Hands a worker's file back to load_world_files(). */
+static void end_boot_file(struct boot_file *file, int failed)
+{
+  log_writer_capture(NULL);
+  boot_parsing = NULL;
+
+  pthread_mutex_lock(&boot_lock);
+  file->failed = failed;
+  file->done = TRUE;
+  pthread_cond_broadcast(&boot_cond);
+  pthread_mutex_unlock(&boot_lock);
+}
+
+/* Reads the files of the current phase, taking them in order, until there
+ * are none left. */
+static void *boot_worker(void *arg)
+{
+  struct boot_file *file;
+
+  for (;;) {
+    pthread_mutex_lock(&boot_lock);
+    file = (boot_taken < boot_queued) ? &boot_queue[boot_taken++] : NULL;
+    pthread_mutex_unlock(&boot_lock);
+
+    if (!file)
+      return (NULL);
+
+    boot_parsing = file;
+    log_writer_capture(&file->log);
+    parse_boot_file(file);
+    end_boot_file(file, FALSE);
+  }
+}
+
+/* Starts the workers on a phase's files, one for each CPU, up to
+ * BOOT_MAX_THREADS.  Returns how many were started. */
+static int start_boot_workers(struct boot_file *files, int count)
+{
+  sigset_t all, old;
+  long want = 1;
+  int started = 0;
+
+#ifdef _SC_NPROCESSORS_ONLN
+  want = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  if (want > BOOT_MAX_THREADS)
+    want = BOOT_MAX_THREADS;
+  if (want > count)
+    want = count;
+  if (want < 2)
+    return (0);
+
+  boot_queue = files;
+  boot_queued = count;
+  boot_taken = 0;
+
+  /* As on the log writer, signals are left to the game loop's thread. */
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  while (started < want &&
+         pthread_create(&boot_workers[started], NULL, boot_worker, NULL) == 0)
+    started++;
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+  if (!started)
+    boot_queued = 0;
+  return (started);
+}
+
+static void wait_for_boot_file(struct boot_file *file)
+{
+  pthread_mutex_lock(&boot_lock);
+  while (!file->done)
+    pthread_cond_wait(&boot_cond, &boot_lock);
+  pthread_mutex_unlock(&boot_lock);
+}
+
+static void stop_boot_workers(int count)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+    pthread_join(boot_workers[i], NULL);
+  boot_queued = 0;
+}
+#endif
+
+/* Reads the files of one world phase and puts their records in the tables.
+ * The files are independent, so workers read them into their own slots at
+ * once, while the records are merged here, a file at a time and in the
+ * order of the index, which keeps the tables sorted by vnum.  Whatever a
+ * worker logs is logged when its file is merged, so the log reads as if the
+ * files had been read one after the other; without workers they are. */
+static void load_world_files(int mode, struct boot_file *files, int count, int slots)
+{
+  struct boot_file *file;
+  zone_rnum zone = 0;
+  int i, merged = 0, workers = 0;
+
+  /* Until the files are merged the tables run to the last slot. */
+  finish_boot_tables(mode, slots, slots);
+
+#ifdef BOOT_THREADED
+  workers = start_boot_workers(files, count);
+#endif
+  boot_threads = MAX(workers, 1);
+
+  for (i = 0; i < count; i++) {
+    file = &files[i];
+#ifdef BOOT_THREADED
+    if (workers)
+      wait_for_boot_file(file);
+    else
+#endif
+      parse_boot_file(file);
+
+    /* Each file's rooms start their walk through the zone table at the
+     * first zone, so check they carry on from where the last file ended. */
+    if (mode == DB_BOOT_WLD && file->loaded && !file->failed) {
+      if (world[file->first].number < zone_table[zone].bot) {
+        log("SYSERR: Room #%d is below zone %d (bot=%d, top=%d).",
+            world[file->first].number, zone_table[zone].number,
+            zone_table[zone].bot, zone_table[zone].top);
+        exit(1);
+      }
+      zone = file->zone;
+    }
+
+    log_writer_release(&file->log);
+    if (file->failed)
+      exit(1);
+
+    merged += merge_boot_file(mode, file, merged);
+  }
+
+#ifdef BOOT_THREADED
+  if (workers)
+    stop_boot_workers(workers);
+#endif
+
+  finish_boot_tables(mode, merged, slots);
+}
+
+/* Moves the records of a file down to slot 'to', just after those of the
+ * files before it, and gives them their real numbers.  Returns how many
+ * records the file had. */
+static int merge_boot_file(int mode, struct boot_file *file, int to)
+{
+  int from = file->first, count = file->loaded, i;
+
+  switch (mode) {
+  case DB_BOOT_ZON:
+    memmove(zone_table + to, zone_table + from, count * sizeof(struct zone_data));
+    break;
+  case DB_BOOT_TRG:
+    memmove(trig_index + to, trig_index + from, count * sizeof(struct index_data *));
+    for (i = to; i < to + count; i++)
+      trig_index[i]->proto->nr = i;
+    break;
+  case DB_BOOT_WLD:
+    memmove(world + to, world + from, count * sizeof(struct room_data));
+    /* Scripts go on the trigger list, which only this thread may touch. */
+    for (i = to; i < to + count; i++)
+      if (world[i].proto_script)
+        assign_triggers(&world[i], WLD_TRIGGER);
+    break;
+  case DB_BOOT_MOB:
+    memmove(mob_proto + to, mob_proto + from, count * sizeof(struct char_data));
+    memmove(mob_index + to, mob_index + from, count * sizeof(struct index_data));
+    for (i = to; i < to + count; i++)
+      mob_proto[i].nr = i;
+    break;
+  case DB_BOOT_OBJ:
+    memmove(obj_proto + to, obj_proto + from, count * sizeof(struct obj_data));
+    memmove(obj_index + to, obj_index + from, count * sizeof(struct index_data));
+    for (i = to; i < to + count; i++)
+      obj_proto[i].item_number = i;
+    break;
+  }
+
+  return (count);
+}
+
+/* Sets the top of a phase's tables to its count of records and clears the
+ * slots past it, which may hold copies of records merged down. */
+static void finish_boot_tables(int mode, int count, int slots)
+{
+  int spare = slots - count;
+
+  switch (mode) {
+  case DB_BOOT_ZON:
+    memset(zone_table + count, 0, spare * sizeof(struct zone_data));
+    top_of_zone_table = count - 1;
+    break;
+  case DB_BOOT_TRG:
+    memset(trig_index + count, 0, spare * sizeof(struct index_data *));
+    top_of_trigt = count;
+    break;
+  case DB_BOOT_WLD:
+    memset(world + count, 0, spare * sizeof(struct room_data));
+    top_of_world = count - 1;
+    break;
+  case DB_BOOT_MOB:
+    memset(mob_proto + count, 0, spare * sizeof(struct char_data));
+    memset(mob_index + count, 0, spare * sizeof(struct index_data));
+    top_of_mobt = count - 1;
+    break;
+  case DB_BOOT_OBJ:
+    memset(obj_proto + count, 0, spare * sizeof(struct obj_data));
+    memset(obj_index + count, 0, spare * sizeof(struct index_data));
+    top_of_objt = count - 1;
+    break;
+  }
+}
+
+/* Puts the zone of a record just converted to 128 bit flags on the list of
+ * zones to save once booted.  The workers share the list. */
+static void save_converted(int vnum, int type)
+{
+#ifdef BOOT_THREADED
+  pthread_mutex_lock(&boot_lock);
+#endif
+  add_to_save_list(zone_table[real_zone_by_thing(vnum)].number, type);
+  converting = TRUE;
+#ifdef BOOT_THREADED
+  pthread_mutex_unlock(&boot_lock);
+#endif
+}
+
+/* TRUE if a short description starts with "a", "an" or "the", which is then
+ * put in lower case.  fname() would tell, but in a buffer of its own that the
+ * workers would share. */
+static int starts_with_article(const char *str)
+{
+  int len = 0;
+
+  while (isalpha(str[len]))
+    len++;
+
+  return ((len == 1 && LOWER(*str) == 'a') ||
+          (len == 2 && !strn_cmp(str, "an", 2)) ||
+          (len == 3 && !strn_cmp(str, "the", 3)));
+}
+
+/* Reads the records of a world or quest file.  World records go in the slots
+ * set aside for the file. */
+static void discrete_load(FILE *fl, int mode, struct boot_file *file)
 {
   int nr = -1, last;
   char line[READ_SIZE];
@@ -1157,14 +1567,14 @@ void discrete_load(FILE *fl, int mode, char *filename)
     if (mode != DB_BOOT_OBJ || nr < 0)
       if (!get_line(fl, line)) {
 	if (nr == -1) {
-	  log("SYSERR: %s file %s is empty!", modes[mode], filename);
+	  log("SYSERR: %s file %s is empty!", modes[mode], file->name);
 	} else {
 	  log("SYSERR: Format error in %s after %s #%d\n"
 	      "...expecting a new %s, but file ended!\n"
-	      "(maybe the file is not terminated with '$'?)", filename,
+	      "(maybe the file is not terminated with '$'?)", file->name,
 	      modes[mode], nr, modes[mode]);
 	}
-	exit(1);
+	boot_abort();
       }
     if (*line == '$')
       return;
@@ -1173,23 +1583,26 @@ void discrete_load(FILE *fl, int mode, char *filename)
       last = nr;
       if (sscanf(line, "#%d", &nr) != 1) {
 	log("SYSERR: Format error after %s #%d", modes[mode], last);
-	exit(1);
+	boot_abort();
       }
       if (nr >= 99999)
 	return;
-      else
+      else if (mode != DB_BOOT_QST && file->loaded == file->slots) {
+	log("SYSERR: %s has more records than were counted.", file->name);
+	boot_abort();
+      } else
 	switch (mode) {
 	case DB_BOOT_WLD:
-	  parse_room(fl, nr);
+	  parse_room(fl, nr, file->first + file->loaded++, &file->zone);
 	  break;
 	case DB_BOOT_MOB:
-	  parse_mobile(fl, nr);
+	  parse_mobile(fl, nr, file->first + file->loaded++);
 	  break;
         case DB_BOOT_TRG:
-          parse_trigger(fl, nr);
+          parse_trigger(fl, nr, file->first + file->loaded++);
           break;
 	case DB_BOOT_OBJ:
-	  strlcpy(line, parse_object(fl, nr), sizeof(line));
+	  parse_object(fl, nr, file->first + file->loaded++, line);
 	  break;
   case DB_BOOT_QST:
     parse_quest(fl, nr);
@@ -1197,9 +1610,9 @@ void discrete_load(FILE *fl, int mode, char *filename)
 	}
     } else {
       log("SYSERR: Format error in %s file %s near %s #%d", modes[mode],
-	  filename, modes[mode], nr);
+	  file->name, modes[mode], nr);
       log("SYSERR: ... offending line: '%s'", line);
-      exit(1);
+      boot_abort();
     }
   }
 }
@@ -1278,9 +1691,10 @@ void ensure_newline_terminated(struct extra_descr_data* new_descr) {
 }
 
 /* load the rooms */
-void parse_room(FILE *fl, int virtual_nr)
+/* Reads a room into world[room_nr].  zone is where the file has got to in the
+ * zone table, which its rooms run through in order. */
+void parse_room(FILE *fl, int virtual_nr, room_rnum room_nr, zone_rnum *zone)
 {
-  static int room_nr = 0, zone = 0;
   int t[10], i, retval;
   char line[READ_SIZE], flags[128], flags2[128], flags3[128];
   char flags4[128], buf2[MAX_STRING_LENGTH], buf[128];
@@ -1290,16 +1704,16 @@ void parse_room(FILE *fl, int virtual_nr)
   /* This really had better fit or there are other problems. */
   snprintf(buf2, sizeof(buf2), "room #%d", virtual_nr);
 
-  if (virtual_nr < zone_table[zone].bot) {
-    log("SYSERR: Room #%d is below zone %d (bot=%d, top=%d).", virtual_nr, zone_table[zone].number, zone_table[zone].bot, zone_table[zone].top);
-    exit(1);
+  if (virtual_nr < zone_table[*zone].bot) {
+    log("SYSERR: Room #%d is below zone %d (bot=%d, top=%d).", virtual_nr, zone_table[*zone].number, zone_table[*zone].bot, zone_table[*zone].top);
+    boot_abort();
   }
-  while (virtual_nr > zone_table[zone].top)
-    if (++zone > top_of_zone_table) {
+  while (virtual_nr > zone_table[*zone].top)
+    if (++*zone > top_of_zone_table) {
       log("SYSERR: Room %d is outside of any zone.", virtual_nr);
-      exit(1);
+      boot_abort();
     }
-  world[room_nr].zone = zone;
+  world[room_nr].zone = *zone;
   world[room_nr].number = virtual_nr;
   world[room_nr].name = fread_string(fl, buf2);
   world[room_nr].description = fread_string(fl, buf2);
@@ -1307,12 +1721,12 @@ void parse_room(FILE *fl, int virtual_nr)
   if (!get_line(fl, line)) {
     log("SYSERR: Expecting roomflags/sector type of room #%d but file ended!",
 	virtual_nr);
-    exit(1);
+    boot_abort();
   }
 
   if (((retval = sscanf(line, " %d %s %s %s %s %d ", t, flags, flags2, flags3, flags4, t + 2)) == 3) && (bitwarning == TRUE)) {
     log("WARNING: Conventional world files detected. See config.c.");
-    exit(1);
+    boot_abort();
   } else if ((retval == 3) && (bitwarning == FALSE)) {
     /* Looks like the implementor is ready, so let's load the world files. We
      * load the extra three flags as 0, since they won't be anything anyway. We
@@ -1332,10 +1746,8 @@ void parse_room(FILE *fl, int virtual_nr)
     /* No need to scan the other three sections; they're 0 anyway. */
     check_bitvector_names(world[room_nr].room_flags[0], room_bits_count, flags, "room");
 
-    if(bitsavetodisk) { /* Maybe the implementor just wants to look at the 128bit files */
-      add_to_save_list(zone_table[real_zone_by_thing(virtual_nr)].number, 3);
-      converting = TRUE;
-    }
+    if(bitsavetodisk) /* Maybe the implementor just wants to look at the 128bit files */
+      save_converted(virtual_nr, 3);
 
   log("   done.");
   } else if (retval == 6) {
@@ -1356,7 +1768,7 @@ void parse_room(FILE *fl, int virtual_nr)
     world[room_nr].sector_type = t[2];
     } else {
       log("SYSERR: Format error in roomflags/sector type of room #%d", virtual_nr);
-    exit(1);
+    boot_abort();
   }
 
   world[room_nr].func = NULL;
@@ -1374,7 +1786,7 @@ void parse_room(FILE *fl, int virtual_nr)
   for (;;) {
     if (!get_line(fl, line)) {
       log("%s", buf);
-      exit(1);
+      boot_abort();
     }
     switch (*line) {
     case 'D':
@@ -1390,7 +1802,8 @@ void parse_room(FILE *fl, int virtual_nr)
       world[room_nr].ex_description = new_descr;
       break;
     case 'S':			/* end of room */
-      /* DG triggers -- script is defined after the end of the room */
+      /* DG triggers -- script is defined after the end of the room.  The
+       * room is given them by merge_boot_file(). */
       letter = fread_letter(fl);
       ungetc(letter, fl);
       while (letter=='T') {
@@ -1398,11 +1811,10 @@ void parse_room(FILE *fl, int virtual_nr)
         letter = fread_letter(fl);
         ungetc(letter, fl);
       }
-      top_of_world = room_nr++;
       return;
     default:
       log("%s", buf);
-      exit(1);
+      boot_abort();
     }
   }
 }
@@ -1426,11 +1838,11 @@ void setup_dir(FILE *fl, int room, int dir)
 
   if (!get_line(fl, line)) {
     log("SYSERR: Format error, %s", buf2);
-    exit(1);
+    boot_abort();
   }
   if (sscanf(line, " %d %d %d ", t, t + 1, t + 2) != 3) {
     log("SYSERR: Format error, %s", buf2);
-    exit(1);
+    boot_abort();
   }
   if (t[0] == 1)
     world[room].dir_option[dir]->exit_info = EX_ISDOOR;
@@ -1565,14 +1977,14 @@ static void parse_simple_mob(FILE *mob_f, int i, int nr)
 
   if (!get_line(mob_f, line)) {
     log("SYSERR: Format error in mob #%d, file ended after S flag!", nr);
-    exit(1);
+    boot_abort();
   }
 
   if (sscanf(line, " %d %d %d %dd%d+%d %dd%d+%d ",
 	  t, t + 1, t + 2, t + 3, t + 4, t + 5, t + 6, t + 7, t + 8) != 9) {
     log("SYSERR: Format error in mob #%d, first line after S flag\n"
 	"...expecting line of form '# # # #d#+# #d#+#'", nr);
-    exit(1);
+    boot_abort();
   }
 
   GET_LEVEL(mob_proto + i) = t[0];
@@ -1595,13 +2007,13 @@ static void parse_simple_mob(FILE *mob_f, int i, int nr)
   if (!get_line(mob_f, line)) {
       log("SYSERR: Format error in mob #%d, second line after S flag\n"
 	  "...expecting line of form '# #', but file ended!", nr);
-      exit(1);
+      boot_abort();
     }
 
   if (sscanf(line, " %d %d ", t, t + 1) != 2) {
     log("SYSERR: Format error in mob #%d, second line after S flag\n"
 	"...expecting line of form '# #'", nr);
-    exit(1);
+    boot_abort();
   }
 
   SET_GOLD(mob_proto + i, t[0]);
@@ -1624,13 +2036,13 @@ static void parse_simple_mob(FILE *mob_f, int i, int nr)
   if (!get_line(mob_f, line)) {
     log("SYSERR: Format error in last line of mob #%d\n"
 	"...expecting line of form '# # #', but file ended!", nr);
-    exit(1);
+    boot_abort();
   }
 
   if (sscanf(line, " %d %d %d ", t, t + 1, t + 2) != 3) {
     log("SYSERR: Format error in last line of mob #%d\n"
 	"...expecting line of form '# # #'", nr);
-    exit(1);
+    boot_abort();
   }
 
   GET_POS(mob_proto + i) = t[0];
@@ -1777,7 +2189,7 @@ static void parse_enhanced_mob(FILE *mob_f, int i, int nr)
       return;
     else if (*line == '#') {	/* we've hit the next mob, maybe? */
       log("SYSERR: Unterminated E section in mob #%d", nr);
-      exit(1);
+      boot_abort();
     } else
       parse_espec(line, i, nr);
 
@@ -1805,12 +2217,12 @@ static void parse_enhanced_mob(FILE *mob_f, int i, int nr)
   }
 
   log("SYSERR: Unexpected end of file reached after mob #%d", nr);
-  exit(1);
+  boot_abort();
 }
 
-void parse_mobile(FILE *mob_f, int nr)
+/* Reads a mobile into mob_proto[i] and mob_index[i]. */
+void parse_mobile(FILE *mob_f, int nr, mob_rnum i)
 {
-  static int i = 0;
   int j, t[10], retval;
   char line[READ_SIZE], *tmpptr, letter;
   char f1[128], f2[128], f3[128], f4[128], f5[128], f6[128], f7[128], f8[128], buf2[128];
@@ -1818,6 +2230,7 @@ void parse_mobile(FILE *mob_f, int nr)
   mob_index[i].vnum = nr;
   mob_index[i].number = 0;
   mob_index[i].func = NULL;
+  mob_index[i].mobs = NULL;
 
   clear_char(mob_proto + i);
 
@@ -1830,10 +2243,8 @@ void parse_mobile(FILE *mob_f, int nr)
   /* String data */
   mob_proto[i].player.name = fread_string(mob_f, buf2);
   tmpptr = mob_proto[i].player.short_descr = fread_string(mob_f, buf2);
-  if (tmpptr && *tmpptr)
-    if (!str_cmp(fname(tmpptr), "a") || !str_cmp(fname(tmpptr), "an") ||
-	!str_cmp(fname(tmpptr), "the"))
-      *tmpptr = LOWER(*tmpptr);
+  if (tmpptr && *tmpptr && starts_with_article(tmpptr))
+    *tmpptr = LOWER(*tmpptr);
   mob_proto[i].player.long_descr = fread_string(mob_f, buf2);
   mob_proto[i].player.description = fread_string(mob_f, buf2);
   GET_TITLE(mob_proto + i) = NULL;
@@ -1842,13 +2253,13 @@ void parse_mobile(FILE *mob_f, int nr)
   if (!get_line(mob_f, line)) {
     log("SYSERR: Format error after string section of mob #%d\n"
 	"...expecting line of form '# # # {S | E}', but file ended!", nr);
-    exit(1);
+    boot_abort();
   }
 
   if (((retval = sscanf(line, "%s %s %s %s %s %s %s %s %d %c", f1, f2, f3, f4, f5, f6, f7, f8, t + 2, &letter)) != 10) && (bitwarning == TRUE)) {
     /* Let's make the implementor read some, before converting his world files. */
     log("WARNING: Conventional mobile files detected. See config.c.");
-    exit(1);
+    boot_abort();
   } else if ((retval == 4) && (bitwarning == FALSE)) {
     log("Converting mobile #%d to 128bits..", nr);
     MOB_FLAGS(mob_proto + i)[0] = asciiflag_conv(f1);
@@ -1883,10 +2294,8 @@ void parse_mobile(FILE *mob_f, int nr)
      * characters, but this shouldn't occur anyway. */
     letter = *f4;
 
-    if(bitsavetodisk) {
-      add_to_save_list(zone_table[real_zone_by_thing(nr)].number, 0);
-      converting =TRUE;
-    }
+    if(bitsavetodisk)
+      save_converted(nr, 0);
 
   log("   done.");
   } else if (retval == 10) {
@@ -1910,7 +2319,7 @@ void parse_mobile(FILE *mob_f, int nr)
       check_bitvector_names(AFF_FLAGS(mob_proto + i)[taeller], affected_bits_count, buf2, "mobile affect");
   } else {
     log("SYSERR: Format error after string section of mob #%d\n ...expecting line of form '# # # {S | E}'", nr);
-    exit(1);
+    boot_abort();
   }
 
   SET_BIT_AR(MOB_FLAGS(mob_proto + i), MOB_ISNPC);
@@ -1930,7 +2339,7 @@ void parse_mobile(FILE *mob_f, int nr)
   /* add new mob types here.. */
   default:
     log("SYSERR: Unsupported mob type '%c' in mob #%d", letter, nr);
-    exit(1);
+    boot_abort();
   }
 
   /* DG triggers -- script info follows mob S/E section */
@@ -1949,15 +2358,12 @@ void parse_mobile(FILE *mob_f, int nr)
 
   mob_proto[i].nr = i;
   mob_proto[i].desc = NULL;
-
-  top_of_mobt = i++;
 }
 
-/* read all objects from obj file; generate index and prototypes */
-char *parse_object(FILE *obj_f, int nr)
+/* Reads an object into obj_proto[i] and obj_index[i].  Leaves the line that
+ * ended it, the next object's number or '$', in line, of READ_SIZE. */
+char *parse_object(FILE *obj_f, int nr, obj_rnum i, char *line)
 {
-  static int i = 0;
-  static char line[READ_SIZE];
   int t[10], j, retval;
   char *tmpptr, buf2[128], f1[READ_SIZE], f2[READ_SIZE], f3[READ_SIZE], f4[READ_SIZE];
   char f5[READ_SIZE], f6[READ_SIZE], f7[READ_SIZE], f8[READ_SIZE];
@@ -1967,6 +2373,7 @@ char *parse_object(FILE *obj_f, int nr)
   obj_index[i].vnum = nr;
   obj_index[i].number = 0;
   obj_index[i].func = NULL;
+  obj_index[i].objs = NULL;
 
   clear_object(obj_proto + i);
   obj_proto[i].item_number = i;
@@ -1976,13 +2383,11 @@ char *parse_object(FILE *obj_f, int nr)
   /* string data */
   if ((obj_proto[i].name = fread_string(obj_f, buf2)) == NULL) {
     log("SYSERR: Null obj name or format error at or near %s", buf2);
-    exit(1);
+    boot_abort();
   }
   tmpptr = obj_proto[i].short_description = fread_string(obj_f, buf2);
-  if (tmpptr && *tmpptr)
-    if (!str_cmp(fname(tmpptr), "a") || !str_cmp(fname(tmpptr), "an") ||
-	!str_cmp(fname(tmpptr), "the"))
-      *tmpptr = LOWER(*tmpptr);
+  if (tmpptr && *tmpptr && starts_with_article(tmpptr))
+    *tmpptr = LOWER(*tmpptr);
 
   tmpptr = obj_proto[i].description = fread_string(obj_f, buf2);
   if (tmpptr && *tmpptr)
@@ -1992,14 +2397,14 @@ char *parse_object(FILE *obj_f, int nr)
   /* numeric data */
   if (!get_line(obj_f, line)) {
     log("SYSERR: Expecting first numeric line of %s, but file ended!", buf2);
-    exit(1);
+    boot_abort();
   }
 
   if (((retval = sscanf(line, " %d %s %s %s %s %s %s %s %s %s %s %s %s", t, f1, f2, f3,
       f4, f5, f6, f7, f8, f9, f10, f11, f12)) == 4) && (bitwarning == TRUE)) {
     /* Let's make the implementor read some, before converting his world files. */
     log("WARNING: Conventional object files detected. Please see config.c.");
-    exit(1);
+    boot_abort();
   } else if (((retval == 4) || (retval == 3)) && (bitwarning == FALSE)) {
 
     if (retval == 3)
@@ -2021,10 +2426,8 @@ char *parse_object(FILE *obj_f, int nr)
     GET_OBJ_AFFECT(obj_proto + i)[2] = 0;
     GET_OBJ_AFFECT(obj_proto + i)[3] = 0;
 
-    if(bitsavetodisk) {
-      add_to_save_list(zone_table[real_zone_by_thing(nr)].number, 1);
-      converting = TRUE;
-    }
+    if(bitsavetodisk)
+      save_converted(nr, 1);
 
     log("   done.");
   } else if (retval == 13) {
@@ -2044,7 +2447,7 @@ char *parse_object(FILE *obj_f, int nr)
 
   } else {
     log("SYSERR: Format error in first numeric line (expecting 13 args, got %d), %s", retval, buf2);
-    exit(1);
+    boot_abort();
   }
 
   /* Object flags checked in check_object(). */
@@ -2052,11 +2455,11 @@ char *parse_object(FILE *obj_f, int nr)
 
   if (!get_line(obj_f, line)) {
     log("SYSERR: Expecting second numeric line of %s, but file ended!", buf2);
-    exit(1);
+    boot_abort();
   }
   if ((retval = sscanf(line, "%d %d %d %d", t, t + 1, t + 2, t + 3)) != 4) {
     log("SYSERR: Format error in second numeric line (expecting 4 args, got %d), %s", retval, buf2);
-    exit(1);
+    boot_abort();
   }
   GET_OBJ_VAL(obj_proto + i, 0) = t[0];
   GET_OBJ_VAL(obj_proto + i, 1) = t[1];
@@ -2065,7 +2468,7 @@ char *parse_object(FILE *obj_f, int nr)
 
   if (!get_line(obj_f, line)) {
     log("SYSERR: Expecting third numeric line of %s, but file ended!", buf2);
-    exit(1);
+    boot_abort();
   }
   if ((retval = sscanf(line, "%d %d %d %d %d", t, t + 1, t + 2, t + 3, t + 4)) != 5) {
     if (retval == 3) {
@@ -2075,7 +2478,7 @@ char *parse_object(FILE *obj_f, int nr)
       t[4] = 0;
     else {
       log("SYSERR: Format error in third numeric line (expecting 5 args, got %d), %s", retval, buf2);
-      exit(1);
+      boot_abort();
     }
   }
 
@@ -2107,7 +2510,7 @@ char *parse_object(FILE *obj_f, int nr)
   for (;;) {
     if (!get_line(obj_f, line)) {
       log("SYSERR: Format error in %s", buf2);
-      exit(1);
+      boot_abort();
     }
     switch (*line) {
     case 'E':
@@ -2120,19 +2523,19 @@ char *parse_object(FILE *obj_f, int nr)
     case 'A':
       if (j >= MAX_OBJ_AFFECT) {
 	log("SYSERR: Too many A fields (%d max), %s", MAX_OBJ_AFFECT, buf2);
-	exit(1);
+	boot_abort();
       }
       if (!get_line(obj_f, line)) {
 	log("SYSERR: Format error in 'A' field, %s\n"
 	    "...expecting 2 numeric constants but file ended!", buf2);
-	exit(1);
+	boot_abort();
       }
 
       if ((retval = sscanf(line, " %d %d ", t, t + 1)) != 2) {
 	log("SYSERR: Format error in 'A' field, %s\n"
 	    "...expecting 2 numeric arguments, got %d\n"
 	    "...offending line: '%s'", buf2, retval, line);
-	exit(1);
+	boot_abort();
       }
       obj_proto[i].affected[j].location = t[0];
       obj_proto[i].affected[j].modifier = t[1];
@@ -2143,22 +2546,20 @@ char *parse_object(FILE *obj_f, int nr)
       break;
     case '$':
     case '#':
-      top_of_objt = i;
       check_object(obj_proto + i);
-      i++;
       return (line);
     default:
       log("SYSERR: Format error in (%c): %s", *line, buf2);
-      exit(1);
+      boot_abort();
     }
   }
 }
 
 #define Z	zone_table[zone]
-/* load the zone table and command tables */
-static void load_zones(FILE *fl, char *zonename)
+/* load the zone table and command tables; the file's zone goes in
+ * zone_table[zone] */
+static void load_zones(FILE *fl, char *zonename, zone_rnum zone)
 {
-  static zone_rnum zone = 0;
   int i, cmd_no, num_of_cmds = 0, line_num = 0, tmp, error;
   char *ptr, buf[READ_SIZE], zname[READ_SIZE], buf2[MAX_STRING_LENGTH];
   int zone_fix = FALSE;
@@ -2183,7 +2584,7 @@ static void load_zones(FILE *fl, char *zonename)
 
   if (num_of_cmds == 0) {
     log("SYSERR: %s is empty!", zname);
-    exit(1);
+    boot_abort();
   } else
     CREATE(Z.cmd, struct reset_com, num_of_cmds);
 
@@ -2191,7 +2592,7 @@ static void load_zones(FILE *fl, char *zonename)
 
   if (sscanf(buf, "#%hd", &Z.number) != 1) {
     log("SYSERR: Format error in %s, line %d", zname, line_num);
-    exit(1);
+    boot_abort();
   }
   snprintf(buf2, sizeof(buf2), "beginning of zone #%d", Z.number);
 
@@ -2222,7 +2623,7 @@ static void load_zones(FILE *fl, char *zonename)
       log("SYSERR: Format error in numeric constant line of %s, attempting to fix.", zname);
       if (sscanf(Z.name, " %hd %hd %d %d ", &Z.bot, &Z.top, &Z.lifespan, &Z.reset_mode) != 4) {
         log("SYSERR: Could not fix previous error, aborting game.");
-        exit(1);
+        boot_abort();
       } else {
         free(Z.name);
         Z.name = strdup(Z.builders);
@@ -2245,7 +2646,7 @@ static void load_zones(FILE *fl, char *zonename)
   }
   if (Z.bot > Z.top) {
     log("SYSERR: Zone %d bottom (%d) > top (%d).", Z.number, Z.bot, Z.top);
-    exit(1);
+    boot_abort();
   }
 
   cmd_no = 0;
@@ -2255,7 +2656,7 @@ static void load_zones(FILE *fl, char *zonename)
     if (zone_fix != TRUE) {
       if ((tmp = get_line(fl, buf)) == 0) {
         log("SYSERR: Format error in %s - premature end of file", zname);
-        exit(1);
+        boot_abort();
       }
     } else
       zone_fix = FALSE;
@@ -2295,7 +2696,7 @@ static void load_zones(FILE *fl, char *zonename)
 
     if (error) {
       log("SYSERR: Format error in %s, line %d: '%s'", zname, line_num, buf);
-      exit(1);
+      boot_abort();
     }
     ZCMD.line = line_num;
     cmd_no++;
@@ -2303,10 +2704,8 @@ static void load_zones(FILE *fl, char *zonename)
 
   if (num_of_cmds != cmd_no + 1) {
     log("SYSERR: Zone command count mismatch for %s. Estimated: %d, Actual: %d", zname, num_of_cmds, cmd_no + 1);
-    exit(1);
+    boot_abort();
   }
-
-  top_of_zone_table = zone++;
 }
 #undef Z
 
@@ -2476,8 +2875,7 @@ struct char_data *create_char(void)
   
   new_mobile_data(ch);
   
-  ch->next = character_list;
-  character_list = ch;
+  LINK_HEAD(ch, character_list, next, prev);
 
   ch->script_id = 0;	// set later by char_script_id
 
@@ -2509,8 +2907,8 @@ struct char_data *read_mobile(mob_vnum nr, int type) /* and mob_rnum */
   clear_char(mob);
  
   *mob = mob_proto[i];
-  mob->next = character_list;
-  character_list = mob;
+  LINK_HEAD(mob, character_list, next, prev);
+  LINK_HEAD(mob, mob_index[i].mobs, next_proto, prev_proto);
   
   new_mobile_data(mob);  
   
@@ -2545,8 +2943,7 @@ struct obj_data *create_obj(void)
 
   CREATE(obj, struct obj_data, 1);
   clear_object(obj);
-  obj->next = object_list;
-  object_list = obj;
+  LINK_HEAD(obj, object_list, next, prev);
   
   obj->events = NULL;
 
@@ -2569,8 +2966,8 @@ struct obj_data *read_object(obj_vnum nr, int type) /* and obj_rnum */
   CREATE(obj, struct obj_data, 1);
   clear_object(obj);
   *obj = obj_proto[i];
-  obj->next = object_list;
-  object_list = obj;
+  LINK_HEAD(obj, object_list, next, prev);
+  LINK_HEAD(obj, obj_index[i].objs, next_proto, prev_proto);
   
   obj->events = NULL;
 
@@ -2623,6 +3020,15 @@ void zone_update(void)
 
 	zone_table[i].age = ZO_DEAD;
       }
+
+      /* A zone nobody has been in for a while stops running its mobiles. */
+      if (zone_table[i].num_players > 0 || !CONFIG_ZONE_DORMANCY) {
+        zone_table[i].empty_minutes = 0;
+        if (zone_table[i].dormant)
+          wake_zone(i);
+      } else if (!zone_table[i].dormant &&
+          ++zone_table[i].empty_minutes >= CONFIG_ZONE_DORMANCY)
+        zone_table[i].dormant = TRUE;
     }
   }	/* end - one minute has passed */
 
@@ -2901,27 +3307,67 @@ void reset_zone(zone_rnum zone)
   }
 }
 
-/* for use in reset_zone; return TRUE if zone 'nr' is free of PC's  */
+/* for use in reset_zone; return TRUE if zone 'nr' is free of PC's.  The
+ * count is kept by char_to_room(), char_from_room() and, when a descriptor
+ * changes state or body, update_zone_player().  If an immortal has
+ * nohassle off, he counts as present. Added for testing zone reset triggers
+ * -Welcor */
 int is_empty(zone_rnum zone_nr)
 {
-  struct descriptor_data *i;
+  if (zone_nr == NOWHERE || zone_nr > top_of_zone_table)
+    return (1);
 
-  for (i = descriptor_list; i; i = i->next) {
-    if (STATE(i) != CON_PLAYING)
-      continue;
-    if (IN_ROOM(i->character) == NOWHERE)
-      continue;
-    if (world[IN_ROOM(i->character)].zone != zone_nr)
-      continue;
-    /* If an immortal has nohassle off, he counts as present. Added for testing
-     * zone reset triggers -Welcor */
-    if ((!IS_NPC(i->character)) && (GET_LEVEL(i->character) >= LVL_IMMORT) && (PRF_FLAGGED(i->character, PRF_NOHASSLE)))
-      continue;
+  return (zone_table[zone_nr].num_players <= 0);
+}
 
-    return (0);
+/* Called when a player walks into a dormant zone, or dormancy is turned off:
+ * brings the mobiles that slept through the quiet up to date before anyone
+ * gets a look at them. */
+void wake_zone(zone_rnum zone)
+{
+  struct char_data *ch;
+
+  zone_table[zone].dormant = FALSE;
+  zone_table[zone].empty_minutes = 0;
+
+  for (ch = character_list; ch; ch = ch->next)
+    if (ch->char_specials.dormant_ticks && IN_ROOM(ch) != NOWHERE &&
+        world[IN_ROOM(ch)].zone == zone)
+      wake_mobile(ch);
+}
+
+/* Debugging aid: recount the players in every zone and complain about, then
+ * repair, any zone whose kept count has drifted. */
+void check_zone_player_counts(void)
+{
+  struct char_data *ch;
+  int *counts;
+  zone_rnum zn;
+
+  CREATE(counts, int, top_of_zone_table + 1);
+
+  for (ch = character_list; ch; ch = ch->next) {
+    if (IN_ROOM(ch) == NOWHERE)
+      continue;
+    if (ch->char_specials.zone_counted != counts_as_zone_player(ch)) {
+      log("SYSERR: %s is %scounted in zone %d but should%s be.", GET_NAME(ch),
+        ch->char_specials.zone_counted ? "" : "not ",
+        zone_table[world[IN_ROOM(ch)].zone].number,
+        counts_as_zone_player(ch) ? "" : " not");
+      update_zone_player(ch);
+    }
+    if (ch->char_specials.zone_counted)
+      counts[world[IN_ROOM(ch)].zone]++;
   }
 
-  return (1);
+  for (zn = 0; zn <= top_of_zone_table; zn++)
+    if (counts[zn] != zone_table[zn].num_players) {
+      mudlog(BRF, LVL_GOD, TRUE, "SYSERR: Zone %d player count is %d, recount found %d.",
+        zone_table[zn].number, zone_table[zn].num_players, counts[zn]);
+      zone_table[zn].num_players = counts[zn];
+    }
+
+  free(counts);
 }
 
 /* Functions of a general utility nature. */
@@ -2937,7 +3383,7 @@ char *fread_string(FILE *fl, const char *error)
   do {
     if (!fgets(tmp, 512, fl)) {
       log("SYSERR: fread_string: format error at or near %s", error);
-      exit(1);
+      boot_abort();
     }
     /* If there is a '~', end the string; else put an "\r\n" over the '\n'. */
     /* now only removes trailing ~'s -- Welcor */
@@ -2961,7 +3407,7 @@ char *fread_string(FILE *fl, const char *error)
     if (length + templength >= MAX_STRING_LENGTH) {
       log("SYSERR: fread_string: string too large (db.c)");
       log("%s", error);
-      exit(1);
+      boot_abort();
     } else {
       strcat(buf + length, tmp);	/* strcat: OK (size checked above) */
       length += templength;
@@ -3376,6 +3822,9 @@ void free_char(struct char_data *ch)
   /* new version of free_followers take the followers pointer as arg */
   free_followers(ch->followers);
 
+  if (TRACK_PATH(ch))
+    free_path(TRACK_PATH(ch));
+
   if (ch->desc)
     ch->desc->character = NULL;
 
@@ -3516,8 +3965,12 @@ void reset_char(struct char_data *ch)
   IN_ROOM(ch) = NOWHERE;
   ch->carrying = NULL;
   ch->next = NULL;
+  ch->prev = NULL;
   ch->next_fighting = NULL;
+  ch->prev_fighting = NULL;
   ch->next_in_room = NULL;
+  ch->prev_in_room = NULL;
+  ch->next_extract = NULL;
   FIGHTING(ch) = NULL;
   char_from_furniture(ch);
   ch->char_specials.position = POS_STANDING;
@@ -3620,9 +4073,10 @@ void init_char(struct char_data *ch)
     GET_HEIGHT(ch) = rand_number(150, 180); /* 5'0" - 6'0" */
   }
 
-  if ((i = get_ptable_by_name(GET_NAME(ch))) != -1)
+  if ((i = get_ptable_by_name(GET_NAME(ch))) != -1) {
     player_table[i].id = GET_IDNUM(ch) = ++top_idnum;
-  else
+    ptable_hash_add(i);
+  } else
     log("SYSERR: init_char: Character '%s' not found in player table.", GET_NAME(ch));
 
   for (i = 1; i <= MAX_SKILLS; i++) {
@@ -3940,6 +4394,7 @@ static void load_default_config( void )
   CONFIG_MINIMAP_SIZE           = default_minimap_size;
   CONFIG_SCRIPT_PLAYERS         = script_players;
   CONFIG_DEBUG_MODE             = debug_mode;
+  CONFIG_ZONE_DORMANCY          = zone_dormancy;
 
   /* Rent / crashsave options. */
   CONFIG_FREE_RENT              = free_rent;
@@ -4238,6 +4693,11 @@ void load_config( void )
         }
         break;
 
+      case 'z':
+        if (!str_cmp(tag, "zone_dormancy"))
+          CONFIG_ZONE_DORMANCY = num;
+        break;
+
       default:
         break;
     }
@@ -87,6 +87,7 @@
 #define TRG_PREFIX  LIB_WORLD"trg"SLASH	/* trigger files	*/
 #define HLP_PREFIX  LIB_TEXT"help"SLASH /* Help files           */
 #define QST_PREFIX  LIB_WORLD"qst"SLASH /* quest files          */
+#define SNAPSHOT_FILE LIB_WORLD"snapshot" /* compiled world, see snapshot.c */
 
 #define CREDITS_FILE	LIB_TEXT"credits" /* for the 'credits' command	*/
 #define NEWS_FILE	LIB_TEXT"news"	/* for the 'news' command	*/
@@ -136,6 +137,7 @@
 #define PLAYER_FILE	LIB_ETC"players"   /* the player database	*/
 #define MAIL_FILE	LIB_ETC"plrmail"   /* for the mudmail system	*/
 #define MAIL_FILE_TMP	LIB_ETC"plrmail_tmp"   /* for the mudmail system	*/
+#define MAIL_FILE_BAD	LIB_ETC"plrmail.bad"   /* malformed mail lines	*/
 #define BAN_FILE	LIB_ETC"badsites"  /* for the siteban system	*/
 #define HCONTROL_FILE	LIB_ETC"hcontrol"  /* for the house system	*/
 #define TIME_FILE	LIB_ETC"time"	   /* for calendar system	*/
@@ -191,6 +193,9 @@ struct zone_data {
    int	reset_mode;         /* conditions for reset (see below)   */
    zone_vnum number;	    /* virtual number of this zone	  */
    struct reset_com *cmd;   /* command table for reset	          */
+   int num_players;         /* players in the zone that keep it awake */
+   int empty_minutes;       /* how long num_players has been 0    */
+   bool dormant;            /* mobiles are left alone; see wake_zone() */
 
    /* Reset mode:
     *   0: Don't reset, and don't update age.
@@ -296,6 +301,7 @@ void   reset_char(struct char_data *ch);
 void   free_char(struct char_data *ch);
 void   save_player_index(void);
 long   get_ptable_by_name(const char *name);
+long   get_ptable_by_id(long id);
 void   remove_player(int pfilepos);
 void   clean_pfiles(void);
 void   build_player_index(void);
@@ -310,11 +316,12 @@ int    vnum_trig(char *, struct char_data *);
 
 void setup_dir(FILE *fl, int room, int dir);
 void index_boot(int mode);
-void discrete_load(FILE *fl, int mode, char *filename);
-void parse_room(FILE *fl, int virtual_nr);
-void parse_mobile(FILE *mob_f, int nr);
-char *parse_object(FILE *obj_f, int nr);
+void parse_room(FILE *fl, int virtual_nr, room_rnum room_nr, zone_rnum *zone);
+void parse_mobile(FILE *mob_f, int nr, mob_rnum i);
+char *parse_object(FILE *obj_f, int nr, obj_rnum i, char *line);
 int is_empty(zone_rnum zone_nr);
+void wake_zone(zone_rnum zone);
+void check_zone_player_counts(void);
 void reset_zone(zone_rnum zone);
 void reboot_wizlists(void);
 ACMD(do_reboot);
@@ -0,0 +1,279 @@
+/**
+* @file dg_compile.c
+* Works out once, when a trigger is loaded or edited, what each line of it is
+* and where its control flow goes.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*
+* script_driver() used to recognise every line by comparing it against each
+* keyword in turn, and every branch scanned forward through the following
+* lines for its else, end, case or done.  Both only depend on the text of
+* the trigger, which all copies of a prototype share, so dg_compile_cmdlist()
+* stores the answers in the cmdlist_element itself.
+*
+* The scans below are the ones script_driver() used to run, with their
+* keyword tests unchanged; only the conditions of elseif and case are left
+* for the driver, which follows the jump chain and evaluates them in order.
+* A malformed trigger therefore runs exactly as it did before, but is only
+* complained about once, when it is compiled.
+*/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "dg_scripts.h"
+
+/** Longest keyword dg_command_op() looks at; a line whose first variable
+ * starts past this has the same command whatever the variable holds. */
+#define DG_OP_LENGTH 10
+
+/* local functions */
+static char *skip_blanks(char *p);
+static struct cmdlist_element *find_end(struct cmdlist_element *cl);
+static struct cmdlist_element *find_done(struct cmdlist_element *cl);
+static struct cmdlist_element *next_else(struct cmdlist_element *cl);
+static struct cmdlist_element *next_case(struct cmdlist_element *cl);
+static char *line_args(char *text, int kind);
+
+/* The commands script_driver() handles itself, in the order it tests them. */
+static const struct {
+  const char *word;
+  int len;
+  int op;
+} dg_ops[] = {
+  { "eval ",       5, DG_OP_EVAL },
+  { "nop ",        4, DG_OP_NOP },
+  { "extract ",    8, DG_OP_EXTRACT },
+  { "dg_letter ", 10, DG_OP_LETTER },
+  { "makeuid ",    8, DG_OP_MAKEUID },
+  { "halt",        4, DG_OP_HALT },
+  { "dg_cast ",    8, DG_OP_CAST },
+  { "dg_affect ", 10, DG_OP_AFFECT },
+  { "global ",     7, DG_OP_GLOBAL },
+  { "context ",    8, DG_OP_CONTEXT },
+  { "remote ",     7, DG_OP_REMOTE },
+  { "rdelete ",    8, DG_OP_RDELETE },
+  { "return ",     7, DG_OP_RETURN },
+  { "set ",        4, DG_OP_SET },
+  { "unset ",      6, DG_OP_UNSET },
+  { "wait ",       5, DG_OP_WAIT },
+  { "attach ",     7, DG_OP_ATTACH },
+  { "detach ",     7, DG_OP_DETACH },
+  { NULL,          0, DG_OP_OTHER }
+};
+
+static char *skip_blanks(char *p)
+{
+  while (*p && isspace(*p))
+    p++;
+  return (p);
+}
+
+/** @return The DG_LINE_ kind of a line, given with its leading blanks
+ * skipped. */
+int dg_line_kind(const char *p)
+{
+  if (*p == '*')
+    return (DG_LINE_COMMENT);
+  if (!strn_cmp(p, "if ", 3))
+    return (DG_LINE_IF);
+  if (!strn_cmp("elseif ", p, 7))
+    return (DG_LINE_ELSEIF);
+  if (!strn_cmp("else", p, 4))
+    return (DG_LINE_ELSE);
+  if (!strn_cmp("while ", p, 6))
+    return (DG_LINE_WHILE);
+  if (!strn_cmp("switch ", p, 7))
+    return (DG_LINE_SWITCH);
+  if (!strn_cmp("end", p, 3))
+    return (DG_LINE_END);
+  if (!strn_cmp("done", p, 4))
+    return (DG_LINE_DONE);
+  if (!strn_cmp("break", p, 5))
+    return (DG_LINE_BREAK);
+  if (!strn_cmp("case", p, 4))
+    return (DG_LINE_CASE);
+  if (!strn_cmp("default", p, 7))
+    return (DG_LINE_DEFAULT);
+  return (DG_LINE_COMMAND);
+}
+
+/** @return The DG_OP_ of a command line after its variables have been
+ * substituted. */
+int dg_command_op(const char *cmd)
+{
+  int i;
+
+  for (i = 0; dg_ops[i].word; i++)
+    if (!strn_cmp(cmd, dg_ops[i].word, dg_ops[i].len))
+      return (dg_ops[i].op);
+  return (DG_OP_OTHER);
+}
+
+/* The condition or value after the keyword, where the driver reads it. */
+static char *line_args(char *text, int kind)
+{
+  switch (kind) {
+  case DG_LINE_IF:     return (text + 3);
+  case DG_LINE_ELSEIF: return (text + 7);
+  case DG_LINE_WHILE:  return (text + 6);
+  case DG_LINE_SWITCH: return (text + 7);
+  case DG_LINE_CASE:   return (text + (text[4] ? 5 : 4));
+  default:             return (text);
+  }
+}
+
+/* Scans for end of if-block.  returns the line containg 'end', or the last
+ * line of the trigger if not found. */
+static struct cmdlist_element *find_end(struct cmdlist_element *cl)
+{
+  struct cmdlist_element *c;
+  char *p;
+
+  if (!(cl->next))
+    return cl;
+
+  for (c = cl->next; c; c = c->next) {
+    p = skip_blanks(c->cmd);
+
+    if (!strn_cmp("if ", p, 3))
+      c = find_end(c);
+    else if (!strn_cmp("end", p, 3))
+      return c;
+
+    if (!c->next)
+      return c;
+  }
+  return c;
+}
+
+/* Scans for end of while/switch-blocks. Returns the line containg 'end', or
+ * the last line of the trigger if not found. Malformed scripts may cause NULL
+ * to be returned. */
+static struct cmdlist_element *find_done(struct cmdlist_element *cl)
+{
+  struct cmdlist_element *c;
+  char *p;
+
+  if (!cl || !(cl->next))
+    return cl;
+
+  for (c = cl->next; c && c->next; c = c->next) {
+    p = skip_blanks(c->cmd);
+
+    if (!strn_cmp("while ", p, 6) || !strn_cmp("switch ", p, 7))
+      c = find_done(c);
+    else if (!strn_cmp("done", p, 3))
+      return c;
+  }
+
+  return c;
+}
+
+/* The next elseif, else or end after cl that belongs to the same if, or the
+ * last line of the trigger.  The driver tries an elseif's condition and goes
+ * on to its own next_else() when it is false. */
+static struct cmdlist_element *next_else(struct cmdlist_element *cl)
+{
+  struct cmdlist_element *c;
+  char *p;
+
+  if (!(cl->next))
+    return cl;
+
+  for (c = cl->next; c->next; c = c->next) {
+    p = skip_blanks(c->cmd);
+
+    if (!strn_cmp("if ", p, 3))
+      c = find_end(c);
+    else if (!strn_cmp("elseif ", p, 7) || !strn_cmp("else", p, 4) ||
+             !strn_cmp("end", p, 3))
+      return c;
+
+    if (!c->next)
+      return c;
+  }
+  return c;
+}
+
+/* The next case, default or done after cl that belongs to the same switch,
+ * or the last line of the trigger. */
+static struct cmdlist_element *next_case(struct cmdlist_element *cl)
+{
+  struct cmdlist_element *c, *last = cl;
+  char *p;
+
+  if (!(cl->next))
+    return cl;
+
+  for (c = cl->next; c && c->next; c = c->next) {
+    p = skip_blanks(c->cmd);
+    last = c;
+
+    if (!strn_cmp("while ", p, 6) || !strn_cmp("switch", p, 6)) {
+      /* An unterminated loop inside the switch runs to the last line. */
+      if (!(c = find_done(c)) || !c->next)
+        break;
+    } else if (!strn_cmp("case ", p, 5) || !strn_cmp("default", p, 7) ||
+               !strn_cmp("done", p, 3))
+      return c;
+  }
+
+  if (!c)
+    for (c = last; c->next; c = c->next);
+  return c;
+}
+
+/** Fills in the compiled fields of every line of a trigger's command list.
+ * The list is shared with every copy of the trigger, so this is done for the
+ * prototype when it is loaded or saved from OLC.
+ * @param cmdlist The first line of the trigger.
+ * @param vnum The trigger, for complaints about it. */
+void dg_compile_cmdlist(struct cmdlist_element *cmdlist, trig_vnum vnum)
+{
+  struct cmdlist_element *cl;
+  char *pct;
+
+  for (cl = cmdlist; cl; cl = cl->next) {
+    cl->text = skip_blanks(cl->cmd);
+    cl->kind = dg_line_kind(cl->text);
+    cl->args = line_args(cl->text, cl->kind);
+    cl->jump = cl->done = NULL;
+    cl->op = DG_OP_NONE;
+
+    switch (cl->kind) {
+    case DG_LINE_IF:
+      cl->jump = next_else(cl);
+      cl->done = find_end(cl);
+      if (strn_cmp("end", skip_blanks(cl->done->cmd), 3))
+        script_log("Trigger VNum %d has 'if' without 'end'.", vnum);
+      break;
+    case DG_LINE_ELSEIF:
+      cl->jump = next_else(cl);
+      cl->done = find_end(cl);
+      break;
+    case DG_LINE_ELSE:
+      cl->done = find_end(cl);
+      break;
+    case DG_LINE_WHILE:
+    case DG_LINE_BREAK:
+      cl->done = find_done(cl);
+      break;
+    case DG_LINE_SWITCH:
+    case DG_LINE_CASE:
+      cl->jump = next_case(cl);
+      break;
+    case DG_LINE_COMMAND:
+    case DG_LINE_DEFAULT:
+      /* Variables can only change the command if they come early enough. */
+      pct = strchr(cl->text, '%');
+      if (!pct || pct - cl->text >= DG_OP_LENGTH)
+        cl->op = dg_command_op(cl->text);
+      break;
+    }
+  }
+}
@@ -27,10 +27,11 @@
 /* local functions */
 static void trig_data_init(trig_data *this_data);
 
-void parse_trigger(FILE *trig_f, int nr)
+/* Reads a trigger into trig_index[rnum]. */
+void parse_trigger(FILE *trig_f, int nr, trig_rnum rnum)
 {
     int t[2], k, attach_type;
-    char line[256], *cmds, *s, flags[256], errors[MAX_INPUT_LENGTH];
+    char line[256], *cmds, *s, *end, flags[256], errors[MAX_INPUT_LENGTH];
     struct cmdlist_element *cle;
     struct index_data *t_index;
     struct trig_data *trig;
@@ -45,7 +46,7 @@ void parse_trigger(FILE *trig_f, int nr)
 
     snprintf(errors, sizeof(errors), "trig vnum %d", nr);
 
-    trig->nr = top_of_trigt;
+    trig->nr = rnum;
     trig->name = fread_string(trig_f, errors);
 
     get_line(trig_f, line);
@@ -58,19 +59,29 @@ void parse_trigger(FILE *trig_f, int nr)
 
     cmds = s = fread_string(trig_f, errors);
 
-    CREATE(trig->cmdlist, struct cmdlist_element, 1);
-    trig->cmdlist->cmd = strdup(strtok(s, "\n\r"));
-    cle = trig->cmdlist;
-
-    while ((s = strtok(NULL, "\n\r"))) {
-	CREATE(cle->next, struct cmdlist_element, 1);
-	cle = cle->next;
+    /* One line per element, skipping blank ones.  Not with strtok(), as
+     * triggers are read on several threads at boot. */
+    cle = NULL;
+    for (s += strspn(s, "\n\r"); *s; s = end + strspn(end, "\n\r")) {
+	end = s + strcspn(s, "\n\r");
+	if (*end)
+	  *end++ = '\0';
+
+	if (cle) {
+	  CREATE(cle->next, struct cmdlist_element, 1);
+	  cle = cle->next;
+	} else {
+	  CREATE(trig->cmdlist, struct cmdlist_element, 1);
+	  cle = trig->cmdlist;
+	}
 	cle->cmd = strdup(s);
     }
 
     free(cmds);
 
-    trig_index[top_of_trigt++] = t_index;
+    dg_compile_cmdlist(trig->cmdlist, nr);
+
+    trig_index[rnum] = t_index;
 }
 
 /* Create a new trigger from a prototype. nr is the real number of the trigger. */
@@ -197,16 +208,8 @@ void dg_read_trigger(FILE *fp, void *proto, int type)
           trg_proto = trg_proto->next;
         trg_proto->next = new_trg;
       }
-
-      if (rnum != NOTHING) {
-        if (!(room->script))
-          CREATE(room->script, struct script_data, 1);
-        add_trigger(SCRIPT(room), read_trigger(rnum), -1);
-      } else {
-        mudlog(BRF, LVL_BUILDER, TRUE,
-               "SYSERR: non-existant trigger #%d assigned to room #%d",
-               vnum, room->number);
-      }
+      /* The room's script is made once the world is merged, as the files
+       * are read on several threads (see load_world_files()). */
       break;
     default:
       mudlog(BRF, LVL_BUILDER, TRUE,
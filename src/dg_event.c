@@ -13,6 +13,10 @@
 * $Author: Mark A. Heilpern/egreen/Welcor $                              
 * $Date: 2004/10/11 12:07:00$                                            
 * $Revision: 1.0.14 $                                                    
+*
+* The queue is a hierarchical timing wheel, so scheduling and cancelling an
+* event cost the same however many events are waiting.  Events and queue
+* elements come from slabs that are recycled rather than freed.
 */
 
 
@@ -26,6 +30,83 @@
 #include "comm.h"  /* For access to the game pulse */
 #include "mud_event.h"
 
+/***************************************************************************
+ * Begin node allocation functions
+ **************************************************************************/
+/** How many nodes each slab block holds. */
+#define EVENT_SLAB_NODES 256
+
+/** A block of nodes; the nodes follow the header in the same allocation. */
+struct slab_block {
+  struct slab_block *next;
+};
+
+/** Fixed-size node allocator.  Freed nodes are kept on a free list and
+ * handed out again, so a busy queue stops calling malloc() once warm. */
+struct slab {
+  size_t node_size;           /**< Bytes per node, at least a pointer. */
+  void *free_list;            /**< Free nodes, linked through their first word. */
+  struct slab_block *blocks;  /**< Every block allocated. */
+  int allocated;              /**< Nodes in all blocks. */
+  int free;                   /**< Nodes on the free list. */
+};
+
+static struct slab event_slab = { sizeof(struct event), NULL, NULL, 0, 0 };
+static struct slab element_slab = { sizeof(struct q_element), NULL, NULL, 0, 0 };
+
+static void *slab_alloc(struct slab *sl)
+{
+  struct slab_block *block;
+  char *node;
+  int i;
+
+  if (!sl->free_list) {
+    if (!(block = (struct slab_block *) malloc(sizeof(struct slab_block) + sl->node_size * EVENT_SLAB_NODES))) {
+      perror("SYSERR: slab_alloc");
+      abort();
+    }
+    block->next = sl->blocks;
+    sl->blocks = block;
+
+    node = (char *) (block + 1);
+    for (i = 0; i < EVENT_SLAB_NODES; i++, node += sl->node_size) {
+      *(void **) node = sl->free_list;
+      sl->free_list = node;
+    }
+    sl->allocated += EVENT_SLAB_NODES;
+    sl->free += EVENT_SLAB_NODES;
+  }
+
+  node = sl->free_list;
+  sl->free_list = *(void **) node;
+  sl->free--;
+  memset(node, 0, sl->node_size);
+
+  return node;
+}
+
+static void slab_free(struct slab *sl, void *node)
+{
+  *(void **) node = sl->free_list;
+  sl->free_list = node;
+  sl->free++;
+}
+
+static void slab_destroy(struct slab *sl)
+{
+  struct slab_block *block;
+
+  while ((block = sl->blocks) != NULL) {
+    sl->blocks = block->next;
+    free(block);
+  }
+  sl->free_list = NULL;
+  sl->allocated = sl->free = 0;
+}
+/***************************************************************************
+ * End node allocation functions
+ **************************************************************************/
+
 /***************************************************************************
  * Begin mud specific event queue functions
  **************************************************************************/
@@ -61,7 +142,7 @@ struct event *event_create(EVENTFUNC(*func), void *event_obj, long when)
   if (when < 1) /* make sure its in the future */
     when = 1;
 
-  CREATE(new_event, struct event, 1);
+  new_event = (struct event *) slab_alloc(&event_slab);
   new_event->func = func;
   new_event->event_obj = event_obj;
   new_event->q_el = queue_enq(event_q, new_event, when + pulse);
@@ -88,7 +169,7 @@ void event_cancel(struct event *event)
   if (event->event_obj)
       cleanup_event_obj(event);
 
-  free(event);
+  slab_free(&event_slab, event);
 }
 
 /* The memory freeing routine tied into the mud event system */
@@ -130,7 +211,7 @@ void event_process(void)
       if (the_event->isMudEvent && the_event->event_obj != NULL)
         free_mud_event((struct mud_event_data *) the_event->event_obj);
       /* It is assumed that the_event will already have freed ->event_obj. */
-      free(the_event);
+      slab_free(&event_slab, the_event);
     }
       
   }
@@ -153,6 +234,10 @@ void event_free_all(void)
 {
   if (event_q != NULL)
     queue_free(event_q);
+  event_q = NULL;
+
+  slab_destroy(&event_slab);
+  slab_destroy(&element_slab);
 }
 
 /** Boolean function to tell whether an event is queued or not. Does this by
@@ -166,6 +251,16 @@ int event_is_queued(struct event *event)
    else
      return 0;
 }
+/** Reports how full event_q is, for the show events command.
+ * @param stats Filled in with the current occupancy. */
+void event_queue_stats(struct dg_queue_stats *stats)
+{
+  if (event_q)
+    queue_stats(event_q, stats);
+  else
+    memset(stats, 0, sizeof(*stats));
+}
+
 /***************************************************************************
  * End mud specific event queue functions
  **************************************************************************/
@@ -173,6 +268,136 @@ int event_is_queued(struct event *event)
 /***************************************************************************
  * Begin generic (abstract) priority queue functions
  **************************************************************************/
+/* local functions */
+static void slot_append(struct q_slot *slot, struct q_element *qe);
+static void slot_remove(struct q_element *qe);
+static void queue_place(struct dg_queue *q, struct q_element *qe);
+static void queue_cascade(struct dg_queue *q, struct q_slot *slot);
+static void queue_tick(struct dg_queue *q);
+static void queue_advance(struct dg_queue *q);
+static void queue_free_slot(struct q_slot *slot);
+
+/** Index mask for one wheel level. */
+#define WHEEL_MASK      (EVENT_WHEEL_SLOTS - 1)
+/** Bit position of level 'lvl' within a key. */
+#define WHEEL_SHIFT(lvl) (EVENT_WHEEL_BITS * (lvl))
+
+static void slot_append(struct q_slot *slot, struct q_element *qe)
+{
+  qe->slot = slot;
+  qe->next = NULL;
+  qe->prev = slot->tail;
+  if (slot->tail)
+    slot->tail->next = qe;
+  else
+    slot->head = qe;
+  slot->tail = qe;
+  slot->count++;
+}
+
+static void slot_remove(struct q_element *qe)
+{
+  struct q_slot *slot = qe->slot;
+
+  if (qe->prev == NULL)
+    slot->head = qe->next;
+  else
+    qe->prev->next = qe->next;
+
+  if (qe->next == NULL)
+    slot->tail = qe->prev;
+  else
+    qe->next->prev = qe->prev;
+
+  qe->prev = qe->next = NULL;
+  qe->slot = NULL;
+  slot->count--;
+}
+
+/* Put qe on the lowest level whose span covers its distance from q->now. */
+static void queue_place(struct dg_queue *q, struct q_element *qe)
+{
+  unsigned long delta;
+  int level;
+
+  if (qe->key < q->now) {
+    slot_append(&q->due, qe);
+    return;
+  }
+
+  delta = (unsigned long) (qe->key - q->now);
+  for (level = 0; level < EVENT_WHEEL_LEVELS; level++)
+    if ((delta >> WHEEL_SHIFT(level)) < EVENT_WHEEL_SLOTS) {
+      slot_append(&q->wheel[level][((unsigned long) qe->key >> WHEEL_SHIFT(level)) & WHEEL_MASK], qe);
+      return;
+    }
+
+  slot_append(&q->overflow, qe);
+}
+
+/* Empty a slot and place its elements again, which moves them down. */
+static void queue_cascade(struct dg_queue *q, struct q_slot *slot)
+{
+  struct q_element *qe, *next_qe;
+
+  qe = slot->head;
+  slot->head = slot->tail = NULL;
+  slot->count = 0;
+
+  for (; qe; qe = next_qe) {
+    next_qe = qe->next;
+    queue_place(q, qe);
+  }
+}
+
+/* Move the elements keyed for pulse q->now onto the due list. */
+static void queue_tick(struct dg_queue *q)
+{
+  unsigned long now = (unsigned long) q->now;
+  struct q_slot *slot;
+  struct q_element *qe;
+  int level;
+
+  /* When a level wraps, the level above hands down its next slot.  The top
+   * level takes back the overflow list when it wraps. */
+  if ((now & ((1UL << WHEEL_SHIFT(EVENT_WHEEL_LEVELS - 1)) - 1)) == 0 &&
+      ((now >> WHEEL_SHIFT(EVENT_WHEEL_LEVELS - 1)) & WHEEL_MASK) == 0)
+    queue_cascade(q, &q->overflow);
+  for (level = EVENT_WHEEL_LEVELS - 1; level > 0; level--)
+    if ((now & ((1UL << WHEEL_SHIFT(level)) - 1)) == 0)
+      queue_cascade(q, &q->wheel[level][(now >> WHEEL_SHIFT(level)) & WHEEL_MASK]);
+
+  slot = &q->wheel[0][now & WHEEL_MASK];
+  if (slot->head) {
+    for (qe = slot->head; qe; qe = qe->next)
+      qe->slot = &q->due;
+    if (q->due.tail) {
+      q->due.tail->next = slot->head;
+      slot->head->prev = q->due.tail;
+    } else
+      q->due.head = slot->head;
+    q->due.tail = slot->tail;
+    q->due.count += slot->count;
+    slot->head = slot->tail = NULL;
+    slot->count = 0;
+  }
+
+  q->now++;
+}
+
+/* Turn the wheel until something is due or it has caught up with pulse. */
+static void queue_advance(struct dg_queue *q)
+{
+  while (!q->due.head && q->now <= (long) pulse) {
+    /* Nothing queued at all: jump straight to the current pulse. */
+    if (q->size == 0) {
+      q->now = pulse + 1;
+      break;
+    }
+    queue_tick(q);
+  }
+}
+
 /** Create a new, empty, priority queue and return it.
  * @retval dg_queue * Pointer to the newly created queue structure. */
 struct dg_queue *queue_init(void)
@@ -180,14 +405,15 @@ struct dg_queue *queue_init(void)
   struct dg_queue *q;
 
   CREATE(q, struct dg_queue, 1);
+  q->now = pulse;
 
   return q;
 }
 
-/** Add some 'data' to a priority queue. 
+/** Add some 'data' to a priority queue.
  * @pre The paremeter q must have been previously created by queue_init.
  * @post A new q_element is created to hold the data parameter.
- * @param q The existing dg_queue to add an element to. 
+ * @param q The existing dg_queue to add an element to.
  * @param data The data to be associated with, and theoretically used, when
  * the element comes up in q. data is wrapped in a new q_element.
  * @param key Indicates where this event should be located in the queue, and
@@ -196,110 +422,71 @@ struct dg_queue *queue_init(void)
  * the data. */
 struct q_element *queue_enq(struct dg_queue *q, void *data, long key)
 {
-  struct q_element *qe, *i;
-  int bucket;
+  struct q_element *qe;
+
+  /* An empty wheel may have fallen behind; it has nothing to catch up on. */
+  if (q->size == 0 && q->now < (long) pulse)
+    q->now = pulse;
 
-  CREATE(qe, struct q_element, 1);
+  qe = (struct q_element *) slab_alloc(&element_slab);
   qe->data = data;
   qe->key = key;
+  queue_place(q, qe);
 
-  bucket = key % NUM_EVENT_QUEUES;   /* which queue does this go in */
-
-  if (!q->head[bucket]) { /* queue is empty */
-    q->head[bucket] = qe;
-    q->tail[bucket] = qe;
-  }
-
-  else {
-    for (i = q->tail[bucket]; i; i = i->prev) {
-
-      if (i->key < key) { /* found insertion point */
-	if (i == q->tail[bucket])
-	  q->tail[bucket] = qe;
-	else {
-	  qe->next = i->next;
-	  i->next->prev = qe;
-	}
-
-	qe->prev = i;
-	i->next = qe;
-	break;
-      }
-    }
-
-    if (i == NULL) { /* insertion point is front of list */
-      qe->next = q->head[bucket];
-      q->head[bucket] = qe;
-      qe->next->prev = qe;
-    }
-  }
+  if (++q->size > q->peak)
+    q->peak = q->size;
 
   return qe;
 }
 
 /** Remove queue element qe from the priority queue q.
  * @pre qe->data has been dealt with in some way.
- * @post qe has been freed. 
+ * @post qe has been freed.
  * @param q Pointer to the queue containing qe.
  * @param qe Pointer to the q_element to remove from q.
  */
 void queue_deq(struct dg_queue *q, struct q_element *qe)
 {
-  int i;
-
   assert(qe);
 
-  i = qe->key % NUM_EVENT_QUEUES;
-
-  if (qe->prev == NULL)
-    q->head[i] = qe->next;
-  else
-    qe->prev->next = qe->next;
-
-  if (qe->next == NULL)
-    q->tail[i] = qe->prev;
-  else
-    qe->next->prev = qe->prev;
-
-  free(qe);
+  slot_remove(qe);
+  q->size--;
+  slab_free(&element_slab, qe);
 }
 
-/** Removes and returns the data of the first element of the priority queue q. 
- * @pre pulse must be defined. This is a multi-headed queue, the current
- * head is determined by the current pulse.
- * @post the q->head is dequeued. 
+/** Removes and returns the data of the first element of the priority queue q.
+ * @pre pulse must be defined. Only elements keyed at or before the current
+ * pulse are returned.
+ * @post the q->head is dequeued.
  * @param q The queue to return the head of.
  * @retval void * NULL if there is not a currently available head, pointer
  * to any data object associated with the queue element. */
 void *queue_head(struct dg_queue *q)
 {
   void *dg_data;
-  int i;
 
-  i = pulse % NUM_EVENT_QUEUES;
+  queue_advance(q);
 
-  if (!q->head[i])
+  if (!q->due.head)
     return NULL;
 
-  dg_data = q->head[i]->data;
-  queue_deq(q, q->head[i]);
+  dg_data = q->due.head->data;
+  queue_deq(q, q->due.head);
   return dg_data;
 }
 
 /** Returns the key of the head element of the priority queue.
- * @pre pulse must be defined. This is a multi-headed queue, the current
- * head is determined by the current pulse. 
+ * @pre pulse must be defined. Only elements keyed at or before the current
+ * pulse are considered.
  * @param q Queue to check for.
  * @retval long Return the key element of the head q_element. If no head
  * q_element is available, return LONG_MAX. */
 long queue_key(struct dg_queue *q)
 {
-  int i;
-
-  i = pulse % NUM_EVENT_QUEUES;
+  queue_advance(q);
 
-  if (q->head[i])
-    return q->head[i]->key;
+  if (q->due.head)
+    return q->due.head->key;
   else
     return LONG_MAX;
 }
@@ -312,33 +499,70 @@ long queue_elmt_key(struct q_element *qe)
   return qe->key;
 }
 
-/** Free q and all contents.
- * @pre Function requires definition of struct event.
- * @post All items associeated qith q, including non-abstract data, are freed.
- * @param q The priority queue to free.
- */
-void queue_free(struct dg_queue *q)
+/* Free every element of a slot along with its event. */
+static void queue_free_slot(struct q_slot *slot)
 {
-  int i;
   struct q_element *qe, *next_qe;
   struct event *event;
 
-  for (i = 0; i < NUM_EVENT_QUEUES; i++)
+  for (qe = slot->head; qe; qe = next_qe)
   {
-    for (qe = q->head[i]; qe; qe = next_qe) 
+    next_qe = qe->next;
+    if ((event = (struct event *) qe->data) != NULL)
     {
-      next_qe = qe->next;
-      if ((event = (struct event *) qe->data) != NULL) 
-      {
-        if (event->event_obj)
-          cleanup_event_obj(event);
-
-        free(event);
-      }
-      free(qe);
+      if (event->event_obj)
+        cleanup_event_obj(event);
+
+      slab_free(&event_slab, event);
     }
+    slab_free(&element_slab, qe);
   }
+  slot->head = slot->tail = NULL;
+  slot->count = 0;
+}
+
+/** Free q and all contents.
+ * @pre Function requires definition of struct event.
+ * @post All items associeated qith q, including non-abstract data, are freed.
+ * @param q The priority queue to free.
+ */
+void queue_free(struct dg_queue *q)
+{
+  int i, j;
+
+  for (i = 0; i < EVENT_WHEEL_LEVELS; i++)
+    for (j = 0; j < EVENT_WHEEL_SLOTS; j++)
+      queue_free_slot(&q->wheel[i][j]);
+  queue_free_slot(&q->overflow);
+  queue_free_slot(&q->due);
 
   free(q);
 }
 
+/** Reports how the elements of q are spread over the wheel.
+ * @param q The queue to examine.
+ * @param stats Filled in with the element counts. */
+void queue_stats(struct dg_queue *q, struct dg_queue_stats *stats)
+{
+  int i, j, n, bucket;
+
+  memset(stats, 0, sizeof(*stats));
+  stats->size = q->size;
+  stats->peak = q->peak;
+
+  for (i = 0; i < EVENT_WHEEL_LEVELS; i++)
+    for (j = 0; j < EVENT_WHEEL_SLOTS; j++) {
+      if ((n = q->wheel[i][j].count) == 0)
+        continue;
+      stats->level[i] += n;
+      stats->slots_used++;
+      for (bucket = 0; n > 1 && bucket < EVENT_DEPTH_BUCKETS - 1; n >>= 1)
+        bucket++;
+      stats->depth[bucket]++;
+    }
+
+  stats->overflow = q->overflow.count;
+  stats->due = q->due.count;
+  stats->nodes_allocated = event_slab.allocated + element_slab.allocated;
+  stats->nodes_free = event_slab.free + element_slab.free;
+}
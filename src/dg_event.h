@@ -42,13 +42,33 @@ struct event {
 /**************************************************************************
  * Begin priority queue structures and defines.
  **************************************************************************/
-/** Number of buckets available in each queue. Reduces enqueue cost. */
-#define NUM_EVENT_QUEUES    10
+/** Bits of the key handled by each level of the timing wheel. */
+#define EVENT_WHEEL_BITS    8
+/** Slots on each level of the timing wheel. */
+#define EVENT_WHEEL_SLOTS   (1 << EVENT_WHEEL_BITS)
+/** Levels of the timing wheel.  Four levels of 256 slots cover 2^32 pulses;
+ * anything further out waits on the overflow list. */
+#define EVENT_WHEEL_LEVELS  4
+/** Buckets in the slot depth histogram: 1, 2-3, 4-7, ... 64 or more. */
+#define EVENT_DEPTH_BUCKETS 7
 
-/** The priority queue. */
+/** One slot of the timing wheel, a FIFO of q_elements. */
+struct q_slot {
+  struct q_element *head, *tail; /**< Ends of the slot's list. */
+  int count;                     /**< Elements in the slot. */
+};
+
+/** The priority queue, a hierarchical timing wheel.  Level 0 holds keys due
+ * in the next EVENT_WHEEL_SLOTS pulses, one slot per pulse.  Each higher level
+ * holds keys EVENT_WHEEL_SLOTS times further out, and a slot is moved down a
+ * level when the wheel below it wraps around to it. */
 struct dg_queue {
-  struct q_element *head[NUM_EVENT_QUEUES]; /**< Front of each queue bucket. */
-  struct q_element *tail[NUM_EVENT_QUEUES]; /**< Rear of each queue bucket. */
+  struct q_slot wheel[EVENT_WHEEL_LEVELS][EVENT_WHEEL_SLOTS]; /**< The levels. */
+  struct q_slot overflow; /**< Keys beyond the top level. */
+  struct q_slot due;      /**< Keys that have come up, oldest first. */
+  long now;               /**< Next pulse to be moved onto the due list. */
+  int size;               /**< Elements queued. */
+  int peak;               /**< Most elements ever queued at once. */
 };
 
 /** Queued elements. */
@@ -56,6 +76,20 @@ struct q_element {
   void *data;  /**< The event to be handled. */
   long key;    /**< When the event should be handled. */
   struct q_element *prev, *next; /**< Points to other q_elements in line. */
+  struct q_slot *slot;           /**< The wheel slot holding this element. */
+};
+
+/** Snapshot of queue occupancy, filled in by queue_stats(). */
+struct dg_queue_stats {
+  int size;                            /**< Elements queued. */
+  int peak;                            /**< Most elements ever queued. */
+  int level[EVENT_WHEEL_LEVELS];       /**< Elements on each wheel level. */
+  int overflow;                        /**< Elements past the top level. */
+  int due;                             /**< Elements waiting to be handled. */
+  int slots_used;                      /**< Non-empty wheel slots. */
+  int depth[EVENT_DEPTH_BUCKETS];      /**< Non-empty slots by element count. */
+  int nodes_allocated;                 /**< Event and element nodes in slabs. */
+  int nodes_free;                      /**< Of those, nodes on free lists. */
 };
 /**************************************************************************
  * End priority queue structures and defines.
@@ -79,5 +113,7 @@ long queue_key(struct dg_queue *q);
 long queue_elmt_key(struct q_element *qe);
 void queue_free(struct dg_queue *q);
 int  event_is_queued(struct event *event);
+void queue_stats(struct dg_queue *q, struct dg_queue_stats *stats);
+void event_queue_stats(struct dg_queue_stats *stats);
 
 #endif /* _DG_EVENT_H_ */
@@ -50,8 +50,9 @@ void free_varlist(struct trig_var_data *vd)
 int remove_var(struct trig_var_data **var_list, char *name)
 {
   struct trig_var_data *i, *j;
+  unsigned long hash = dg_var_hash(name);
 
-  for (j = NULL, i = *var_list; i && str_cmp(name, i->name);
+  for (j = NULL, i = *var_list; i && (i->hash != hash || str_cmp(name, i->name));
        j = i, i = i->next);
 
   if (i) {
@@ -22,6 +22,7 @@
 #include "genzon.h" /* for real_zone_by_thing */
 #include "act.h"
 #include "fight.h"
+#include "pathfind.h"
 
 
 /* Local file scope functions. */
@@ -958,8 +959,14 @@ ACMD(do_mtransform)
     tmpmob.memory = ch->memory;
     tmpmob.events = ch->events;
     tmpmob.next_in_room = ch->next_in_room;
+    tmpmob.prev_in_room = ch->prev_in_room;
     tmpmob.next = ch->next;
+    tmpmob.prev = ch->prev;
     tmpmob.next_fighting = ch->next_fighting;
+    tmpmob.prev_fighting = ch->prev_fighting;
+    tmpmob.next_proto = ch->next_proto;
+    tmpmob.prev_proto = ch->prev_proto;
+    tmpmob.next_extract = ch->next_extract;
     tmpmob.followers = ch->followers;
     tmpmob.master = ch->master;
     tmpmob.group = ch->group;
@@ -1049,6 +1056,7 @@ ACMD(do_mdoor)
                 free(newexit->keyword);
             free(newexit);
             rm->dir_option[dir] = NULL;
+            pathfind_world_changed();
         }
     }
 
@@ -1079,9 +1087,10 @@ ACMD(do_mdoor)
             strcpy(newexit->keyword, value);
             break;
         case 5:  /* room        */
-            if ((to_room = real_room(atoi(value))) != NOWHERE)
+            if ((to_room = real_room(atoi(value))) != NOWHERE) {
                 newexit->to_room = to_room;
-            else
+                pathfind_world_changed();
+            } else
                 mob_log(ch, "mdoor: invalid door target");
             break;
         }
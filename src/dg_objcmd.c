@@ -20,6 +20,7 @@
 #include "constants.h"
 #include "genzon.h" /* for access to real_zone_by_thing */
 #include "fight.h" /* for die() */
+#include "pathfind.h"
 
 
 
@@ -322,6 +323,12 @@ static OCMD(do_otransform)
       unequip_char(obj->worn_by, pos);
     }
 
+    /* the old object becomes an instance of the new prototype */
+    if (GET_OBJ_RNUM(obj) != NOTHING) {
+      obj_index[GET_OBJ_RNUM(obj)].number--;
+      UNLINK_HEAD(obj, obj_index[GET_OBJ_RNUM(obj)].objs, next_proto, prev_proto);
+    }
+
     /* move new obj info over to old object and delete new obj */
     memcpy(&tmpobj, o, sizeof(*o));
     tmpobj.in_room = IN_ROOM(obj);
@@ -334,9 +341,14 @@ static OCMD(do_otransform)
     tmpobj.proto_script = obj->proto_script;
     tmpobj.script = obj->script;
     tmpobj.next_content = obj->next_content;
+    tmpobj.prev_content = obj->prev_content;
     tmpobj.next = obj->next;
+    tmpobj.prev = obj->prev;
     memcpy(obj, &tmpobj, sizeof(*obj));
 
+    obj_index[GET_OBJ_RNUM(obj)].number++;
+    LINK_HEAD(obj, obj_index[GET_OBJ_RNUM(obj)].objs, next_proto, prev_proto);
+
     if (wearer) {
       equip_char(wearer, obj, pos);
     }
@@ -650,6 +662,7 @@ static OCMD(do_odoor)
                 free(newexit->keyword);
             free(newexit);
             rm->dir_option[dir] = NULL;
+            pathfind_world_changed();
         }
     }
 
@@ -680,9 +693,10 @@ static OCMD(do_odoor)
             strcpy(newexit->keyword, value);
             break;
         case 5:  /* room        */
-            if ((to_room = real_room(atoi(value))) != NOWHERE)
+            if ((to_room = real_room(atoi(value))) != NOWHERE) {
                 newexit->to_room = to_room;
-            else
+                pathfind_world_changed();
+            } else
                 obj_log(obj, "odoor: invalid door target");
             break;
         }
@@ -669,6 +669,8 @@ void trigedit_save(struct descriptor_data *d)
     } else
       trig->cmdlist->cmd = strdup("* No Script");
 
+    dg_compile_cmdlist(trig->cmdlist, OLC_NUM(d));
+
     /* make the prorotype look like what we have */
     trig_data_copy(proto, trig);
 
@@ -735,6 +737,8 @@ void trigedit_save(struct descriptor_data *d)
     } else
       trig->cmdlist->cmd = strdup("* No Script");
 
+    dg_compile_cmdlist(trig->cmdlist, OLC_NUM(d));
+
     for (i = 0; i < top_of_trigt; i++) {
       if (!found) {
         if (trig_index[i]->vnum > OLC_NUM(d)) {
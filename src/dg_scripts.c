@@ -29,6 +29,7 @@
 #include "genzon.h" /* for real_zone_by_thing */
 #include "act.h"
 #include "modify.h"
+#include "profiler.h"
 
 #define PULSES_PER_MUD_HOUR     (SECS_PER_MUD_HOUR*PASSES_PER_SEC)
 
@@ -48,7 +49,6 @@ static int eval_lhs_op_rhs(char *expr, char *result, void *go, struct script_dat
           trig_data *trig, int type);
 static int process_if(char *cond, void *go, struct script_data *sc,
           trig_data *trig, int type);
-static struct cmdlist_element *find_end(trig_data *trig, struct cmdlist_element *cl);
 static struct cmdlist_element *find_else_end(trig_data *trig,
           struct cmdlist_element *cl, void *go, struct script_data *sc, int type);
 static void process_wait(void *go, trig_data *trig, int type, char *cmd,
@@ -70,10 +70,10 @@ static void extract_value(struct script_data *sc, trig_data *trig, char *cmd);
 static void dg_letter_value(struct script_data *sc, trig_data *trig, char *cmd);
 static struct cmdlist_element * find_case(struct trig_data *trig, struct cmdlist_element *cl,
           void *go, struct script_data *sc, int type, char *cond);
-static struct cmdlist_element *find_done(struct cmdlist_element *cl);
 static struct char_data *find_char_by_uid_in_lookup_table(long uid);
 static struct obj_data *find_obj_by_uid_in_lookup_table(long uid);
 static EVENTFUNC(trig_wait_event);
+static int run_script(void *go_adress, trig_data *trig, int type, int mode);
 
 
 /* Return pointer to first occurrence of string ct in cs, or NULL if not 
@@ -1607,81 +1607,27 @@ static int process_if(char *cond, void *go, struct script_data *sc,
     return 1;
 }
 
-/* Scans for end of if-block.  returns the line containg 'end', or the last
- * line of the trigger if not found. */
-static struct cmdlist_element *find_end(trig_data *trig, struct cmdlist_element *cl)
-{
-  struct cmdlist_element *c;
-  char *p;
-
-  if (!(cl->next)) { /* rryan: if this is the last line, theres no end */
-    script_log("Trigger VNum %d has 'if' without 'end'. (error 1)", GET_TRIG_VNUM(trig));
-    return cl;
-  }
-
-  for (c = cl->next; c; c = c->next) {
-    for (p = c->cmd; *p && isspace(*p); p++);
-
-    if (!strn_cmp("if ", p, 3))
-      c = find_end(trig, c);
-    else if (!strn_cmp("end", p, 3))
-      return c;
-
-    /* thanks to Russell Ryan for this fix */
-    if(!c->next) { /* rryan: this is the last line, we didn't find an end. */
-      script_log("Trigger VNum %d has 'if' without 'end'. (error 2)", GET_TRIG_VNUM(trig));
-      return c;
-    }
-  }
-
-  /* rryan: we didn't find an end */
-  script_log("Trigger VNum %d has 'if' without 'end'. (error 3)", GET_TRIG_VNUM(trig));
-  return c;
-}
-
-/* Searches for valid elseif, else, or end to continue execution at. Returns 
- * line of elseif, else, or end if found, or last line of trigger. */
+/* Follows the compiled chain of elseif, else and end lines after an 'if'
+ * whose condition was false.  Returns the line of the elseif or else whose
+ * block runs, the end, or the last line of the trigger. */
 static struct cmdlist_element *find_else_end(trig_data *trig,
     struct cmdlist_element *cl, void *go, struct script_data *sc, int type)
 {
   struct cmdlist_element *c;
-  char *p;
-
-  if (!(cl->next))
-    return cl;
-
-  for (c = cl->next;c->next; c = c->next) {
-    for (p = c->cmd; *p && isspace(*p); p++); /* skip spaces */
-
-    if (!strn_cmp("if ", p, 3))
-      c = find_end(trig, c);
 
-    else if (!strn_cmp("elseif ", p, 7)) {
-      if (process_if(p + 7, go, sc, trig, type)) {
+  for (c = cl->jump; c->next; c = c->jump) {
+    if (c->kind == DG_LINE_ELSEIF) {
+      if (process_if(c->args, go, sc, trig, type)) {
         GET_TRIG_DEPTH(trig)++;
         return c;
       }
-    }
-
-    else if (!strn_cmp("else", p, 4)) {
+    } else if (c->kind == DG_LINE_ELSE) {
       GET_TRIG_DEPTH(trig)++;
       return c;
-    }
-
-    else if (!strn_cmp("end", p, 3))
-      return c;
-
-    /* thanks to Russell Ryan for this fix */
-    if(!c->next) { /* rryan: this is the last line, return. */
-      script_log("Trigger VNum %d has 'if' without 'end'. (error 4)", GET_TRIG_VNUM(trig));
+    } else
       return c;
-    }
   }
 
-  /* rryan: if we got here, it's the last line, if its not an end, log it. */
-  for (p = c->cmd; *p && isspace(*p); p++); /* skip spaces */
-  if(strn_cmp("end", p, 3))
-    script_log("Trigger VNum %d has 'if' without 'end'. (error 5)", GET_TRIG_VNUM(trig));
   return c;
 }
 
@@ -2126,15 +2072,10 @@ static void process_remote(struct script_data *sc, trig_data *trig, char *cmd)
   }
 
   /* find the locally owned variable */
-  for (vd = GET_TRIG_VARS(trig); vd; vd = vd->next)
-    if (!str_cmp(vd->name, buf))
-      break;
+  vd = find_var(GET_TRIG_VARS(trig), buf);
 
   if (!vd)
-    for (vd = sc->global_vars; vd; vd = vd->next)
-      if (!str_cmp(vd->name, var) &&
-          (vd->context==0 || vd->context==sc->context))
-        break;
+    vd = find_var_context(sc->global_vars, var, sc->context);
 
   if (!vd) {
     script_log("Trigger: %s, VNum %d. local var '%s' not found in remote call",
@@ -2176,6 +2117,7 @@ static void process_remote(struct script_data *sc, trig_data *trig, char *cmd)
 ACMD(do_vdelete)
 {
   struct trig_var_data *vd, *vd_prev=NULL;
+  unsigned long hash;
   struct script_data *sc_remote=NULL;
   char *var, *uid_p;
   char buf[MAX_INPUT_LENGTH], buf2[MAX_INPUT_LENGTH];
@@ -2238,8 +2180,9 @@ ACMD(do_vdelete)
   }
 
   /* find the global */
+  hash = dg_var_hash(var);
   for (vd = sc_remote->global_vars; vd; vd_prev = vd, vd = vd->next)
-    if (!str_cmp(vd->name, var))
+    if (vd->hash == hash && !str_cmp(vd->name, var))
       break;
 
   if (!vd) {
@@ -2283,6 +2226,7 @@ int perform_set_dg_var(struct char_data *ch, struct char_data *vict, char *val_a
 static void process_rdelete(struct script_data *sc, trig_data *trig, char *cmd)
 {
   struct trig_var_data *vd, *vd_prev=NULL;
+  unsigned long hash;
   struct script_data *sc_remote=NULL;
   char *line, *var, *uid_p;
   char arg[MAX_INPUT_LENGTH], buf[MAX_STRING_LENGTH], buf2[MAX_STRING_LENGTH];
@@ -2328,8 +2272,9 @@ static void process_rdelete(struct script_data *sc, trig_data *trig, char *cmd)
   if (sc_remote->global_vars==NULL) return; /* no script globals */
 
   /* find the global */
+  hash = dg_var_hash(var);
   for (vd = sc_remote->global_vars; vd; vd_prev = vd, vd = vd->next)
-    if (!str_cmp(vd->name, var) &&
+    if (vd->hash == hash && !str_cmp(vd->name, var) &&
         (vd->context==0 || vd->context==sc->context))
       break;
 
@@ -2361,9 +2306,7 @@ static void process_global(struct script_data *sc, trig_data *trig, char *cmd, l
     return;
   }
 
-  for (vd = GET_TRIG_VARS(trig); vd; vd = vd->next)
-    if (!str_cmp(vd->name, var))
-      break;
+  vd = find_var(GET_TRIG_VARS(trig), var);
 
   if (!vd) {
     script_log("Trigger: %s, VNum %d. local var '%s' not found in global call",
@@ -2479,11 +2422,22 @@ static void dg_letter_value(struct script_data *sc, trig_data *trig, char *cmd)
      TRIG_NEW     just started from dg_triggers.c
      TRIG_RESTART restarted after a 'wait' */
 int script_driver(void *go_adress, trig_data *trig, int type, int mode)
+{
+  /* The trigger may be gone by the time it returns. */
+  trig_vnum vnum = GET_TRIG_VNUM(trig);
+  long start = profile_clock();
+  int ret_val = run_script(go_adress, trig, type, mode);
+
+  profile_add(PROF_TRIGGER, vnum, start);
+  return (ret_val);
+}
+
+static int run_script(void *go_adress, trig_data *trig, int type, int mode)
 {
   static int depth = 0;
-  int ret_val = 1;
+  int ret_val = 1, op;
   struct cmdlist_element *cl;
-  char cmd[MAX_INPUT_LENGTH], *p;
+  char cmd[MAX_INPUT_LENGTH];
   struct script_data *sc = 0;
   struct cmdlist_element *temp;
   void *go = NULL;
@@ -2535,6 +2489,10 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode)
 
   depth++;
 
+  /* Loading and trigedit compile the prototype; this catches anything else. */
+  if (trig->cmdlist && trig->cmdlist->kind == DG_LINE_NEW)
+    dg_compile_cmdlist(trig->cmdlist, GET_TRIG_VNUM(trig));
+
   if (mode == TRIG_NEW) {
     GET_TRIG_DEPTH(trig) = 1;
     GET_TRIG_LOOPS(trig) = 0;
@@ -2545,44 +2503,41 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode)
 
   for (cl = (mode == TRIG_NEW) ? trig->cmdlist : trig->curr_state;
       cl && GET_TRIG_DEPTH(trig); cl = cl->next) {
-    for (p = cl->cmd; *p && isspace(*p); p++);
-
-    if (*p == '*') /* comment */
+    if (cl->kind == DG_LINE_COMMENT)
       continue;
 
-    else if (!strn_cmp(p, "if ", 3)) {
-      if (process_if(p + 3, go, sc, trig, type))
+    else if (cl->kind == DG_LINE_IF) {
+      if (process_if(cl->args, go, sc, trig, type))
         GET_TRIG_DEPTH(trig)++;
       else
         cl = find_else_end(trig, cl, go, sc, type);
     }
 
-    else if (!strn_cmp("elseif ", p, 7) ||
-       !strn_cmp("else", p, 4)) {
+    else if (cl->kind == DG_LINE_ELSEIF || cl->kind == DG_LINE_ELSE) {
       /* If not in an if-block, ignore the extra 'else[if]' and warn about it. */
       if (GET_TRIG_DEPTH(trig) == 1) {
         script_log("Trigger VNum %d has 'else' without 'if'.",
                    GET_TRIG_VNUM(trig));
         continue;
       }
-      cl = find_end(trig, cl);
+      cl = cl->done;
       GET_TRIG_DEPTH(trig)--;
-    } else if (!strn_cmp("while ", p, 6)) {
-      temp = find_done(cl);
+    } else if (cl->kind == DG_LINE_WHILE) {
+      temp = cl->done;
       if (!temp) {
         script_log("Trigger VNum %d has 'while' without 'done'.",
                    GET_TRIG_VNUM(trig));
         return ret_val;
       }
-      if (process_if(p + 6, go, sc, trig, type)) {
+      if (process_if(cl->args, go, sc, trig, type)) {
          temp->original = cl;
       } else {
          cl->loops = 0;
          cl = temp;
       }
-    } else if (!strn_cmp("switch ", p, 7)) {
-      cl = find_case(trig, cl, go, sc, type, p + 7);
-    } else if (!strn_cmp("end", p, 3)) {
+    } else if (cl->kind == DG_LINE_SWITCH) {
+      cl = find_case(trig, cl, go, sc, type, cl->args);
+    } else if (cl->kind == DG_LINE_END) {
       /* If not in an if-block, ignore the extra 'end' and warn about it. */
       if (GET_TRIG_DEPTH(trig) == 1) {
         script_log("Trigger VNum %d has 'end' without 'if'.",
@@ -2590,12 +2545,10 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode)
         continue;
       }
       GET_TRIG_DEPTH(trig)--;
-    } else if (!strn_cmp("done", p, 4)) {
+    } else if (cl->kind == DG_LINE_DONE) {
       /* if in a while loop, cl->original is non-NULL */
       if (cl->original) {
-      char *orig_cmd = cl->original->cmd;
-      while (*orig_cmd && isspace(*orig_cmd)) orig_cmd++;
-      if (cl->original && process_if(orig_cmd + 6, go, sc, trig,
+      if (cl->original && process_if(cl->original->args, go, sc, trig,
           type)) {
         cl = cl->original;
         cl->loops++;
@@ -2615,69 +2568,72 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode)
          /* if we're falling through a switch statement, this ends it. */
         }
       }
-    } else if (!strn_cmp("break", p, 5)) {
-      cl = find_done(cl);
-    } else if (!strn_cmp("case", p, 4)) {
+    } else if (cl->kind == DG_LINE_BREAK) {
+      cl = cl->done;
+    } else if (cl->kind == DG_LINE_CASE) {
        /* Do nothing, this allows multiple cases to a single instance */
     }
 
     else {
-      var_subst(go, sc, trig, type, p, cmd);
+      var_subst(go, sc, trig, type, cl->text, cmd);
+
+      /* A variable in the first word could have made it any command. */
+      op = cl->op != DG_OP_NONE ? cl->op : dg_command_op(cmd);
 
-      if (!strn_cmp(cmd, "eval ", 5))
+      if (op == DG_OP_EVAL)
         process_eval(go, sc, trig, type, cmd);
 
-      else if (!strn_cmp(cmd, "nop ", 4)); /* nop: do nothing */
+      else if (op == DG_OP_NOP); /* nop: do nothing */
 
-      else if (!strn_cmp(cmd, "extract ", 8))
+      else if (op == DG_OP_EXTRACT)
         extract_value(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "dg_letter ", 10))
+      else if (op == DG_OP_LETTER)
         dg_letter_value(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "makeuid ", 8))
+      else if (op == DG_OP_MAKEUID)
         makeuid_var(go, sc, trig, type, cmd);
 
-      else if (!strn_cmp(cmd, "halt", 4))
+      else if (op == DG_OP_HALT)
         break;
 
-      else if (!strn_cmp(cmd, "dg_cast ", 8))
+      else if (op == DG_OP_CAST)
         do_dg_cast(go, sc, trig, type, cmd);
 
-      else if (!strn_cmp(cmd, "dg_affect ", 10))
+      else if (op == DG_OP_AFFECT)
         do_dg_affect(go, sc, trig, type, cmd);
 
-      else if (!strn_cmp(cmd, "global ", 7))
+      else if (op == DG_OP_GLOBAL)
         process_global(sc, trig, cmd, sc->context);
 
-      else if (!strn_cmp(cmd, "context ", 8))
+      else if (op == DG_OP_CONTEXT)
         process_context(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "remote ", 7))
+      else if (op == DG_OP_REMOTE)
         process_remote(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "rdelete ", 8))
+      else if (op == DG_OP_RDELETE)
         process_rdelete(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "return ", 7))
+      else if (op == DG_OP_RETURN)
         ret_val = process_return(trig, cmd);
 
-      else if (!strn_cmp(cmd, "set ", 4))
+      else if (op == DG_OP_SET)
         process_set(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "unset ", 6))
+      else if (op == DG_OP_UNSET)
         process_unset(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "wait ", 5)) {
+      else if (op == DG_OP_WAIT) {
         process_wait(go, trig, type, cmd, cl);
         depth--;
         return ret_val;
       }
 
-      else if (!strn_cmp(cmd, "attach ", 7))
+      else if (op == DG_OP_ATTACH)
         process_attach(go, sc, trig, type, cmd);
 
-      else if (!strn_cmp(cmd, "detach ", 7))
+      else if (op == DG_OP_DETACH)
         process_detach(go, sc, trig, type, cmd);
 
       else {
@@ -2760,66 +2716,31 @@ ACMD(do_tstat)
     send_to_char(ch, "Usage: tstat <vnum>\r\n");
 }
 
-/* Scans for a case/default instance. Returns the line containg the correct 
- * case instance, or the last line of the trigger if not found. */
+/* Follows the compiled chain of case, default and done lines of a switch.
+ * Returns the line containg the correct case instance, or the last line of
+ * the trigger if not found. */
 static struct cmdlist_element *
 find_case(struct trig_data *trig, struct cmdlist_element *cl,
           void *go, struct script_data *sc, int type, char *cond)
 {
   char result[MAX_INPUT_LENGTH];
   struct cmdlist_element *c;
-  char *p, *buf;
+  char *buf;
 
   eval_expr(cond, result, go, sc, trig, type);
 
-  if (!(cl->next))
-    return cl;
-
-  for (c = cl->next; c->next; c = c->next) {
-    for (p = c->cmd; *p && isspace(*p); p++);
-
-    if (!strn_cmp("while ", p, 6) || !strn_cmp("switch", p, 6))
-      c = find_done(c);
-    else if (!strn_cmp("case ", p, 5)) {
-      buf = (char*)malloc(MAX_STRING_LENGTH);
-      eval_op("==", result, p + 5, buf, go, sc, trig);
-      if (*buf && *buf!='0') {
-        free(buf);
-        return c;
-      }
+  for (c = cl->jump; c && c->next && c->kind == DG_LINE_CASE; c = c->jump) {
+    buf = (char*)malloc(MAX_STRING_LENGTH);
+    eval_op("==", result, c->args, buf, go, sc, trig);
+    if (*buf && *buf!='0') {
       free(buf);
-    } else if (!strn_cmp("default", p, 7))
-      return c;
-    else if (!strn_cmp("done", p, 3))
-     return c;
-  }
-  return c;
-}
-
-/* Scans for end of while/switch-blocks. Returns the line containg 'end', or 
- * the last line of the trigger if not found. Malformed scripts may cause NULL 
- * to be returned. */
-static struct cmdlist_element *find_done(struct cmdlist_element *cl)
-{
-  struct cmdlist_element *c;
-  char *p;
-
-  if (!cl || !(cl->next))
-    return cl;
-
-  for (c = cl->next; c && c->next; c = c->next) {
-    for (p = c->cmd; *p && isspace(*p); p++);
-
-    if (!strn_cmp("while ", p, 6) || !strn_cmp("switch ", p, 7))
-      c = find_done(c);
-    else if (!strn_cmp("done", p, 3))
       return c;
+    }
+    free(buf);
   }
-
   return c;
 }
 
-
 /* load in a character's saved variables */
 void read_saved_vars(struct char_data *ch)
 {
@@ -131,18 +131,64 @@
 
 #define SCRIPT_ERROR_CODE     -9999999   /* this shouldn't happen too often */
 
+/* What a trigger line is, see dg_compile_cmdlist() */
+#define DG_LINE_NEW       0   /* not compiled yet */
+#define DG_LINE_COMMAND   1
+#define DG_LINE_COMMENT   2
+#define DG_LINE_IF        3
+#define DG_LINE_ELSEIF    4
+#define DG_LINE_ELSE      5
+#define DG_LINE_WHILE     6
+#define DG_LINE_SWITCH    7
+#define DG_LINE_END       8
+#define DG_LINE_DONE      9
+#define DG_LINE_BREAK    10
+#define DG_LINE_CASE     11
+#define DG_LINE_DEFAULT  12   /* run as a command, but ends a case search */
+
+/* Which command a DG_LINE_COMMAND runs */
+#define DG_OP_NONE        0   /* depends on a variable: decided when run */
+#define DG_OP_OTHER       1   /* handed to the command interpreter */
+#define DG_OP_EVAL        2
+#define DG_OP_NOP         3
+#define DG_OP_EXTRACT     4
+#define DG_OP_LETTER      5
+#define DG_OP_MAKEUID     6
+#define DG_OP_HALT        7
+#define DG_OP_CAST        8
+#define DG_OP_AFFECT      9
+#define DG_OP_GLOBAL     10
+#define DG_OP_CONTEXT    11
+#define DG_OP_REMOTE     12
+#define DG_OP_RDELETE    13
+#define DG_OP_RETURN     14
+#define DG_OP_SET        15
+#define DG_OP_UNSET      16
+#define DG_OP_WAIT       17
+#define DG_OP_ATTACH     18
+#define DG_OP_DETACH     19
+
 /* one line of the trigger */
 struct cmdlist_element {
   char *cmd;				/* one line of a trigger */
   struct cmdlist_element *original;
   struct cmdlist_element *next;
   int loops;        /* for counting number of runs in a while loop */
+
+  /* Filled in by dg_compile_cmdlist(), shared by every copy of the trigger */
+  int kind;                       /* DG_LINE_ type */
+  int op;                         /* DG_OP_ of a command line */
+  char *text;                     /* cmd without its leading blanks */
+  char *args;                     /* condition of if/elseif/while/switch/case */
+  struct cmdlist_element *jump;   /* next elseif/else/end, or case/default/done */
+  struct cmdlist_element *done;   /* end of an if block, done of a while/break */
 };
 
 struct trig_var_data {
   char *name;				/* name of variable  */
   char *value;				/* value of variable */
   long context;				/* 0: global context */
+  unsigned long hash;			/* dg_var_hash() of name */
 
   struct trig_var_data *next;
 };
@@ -318,8 +364,13 @@ void init_lookup_table(void);
 void add_to_lookup_table(long uid, void *c);
 void remove_from_lookup_table(long uid);
 
+/* from dg_compile.c */
+int dg_line_kind(const char *p);
+int dg_command_op(const char *cmd);
+void dg_compile_cmdlist(struct cmdlist_element *cmdlist, trig_vnum vnum);
+
 /* from dg_db_scripts.c */
-void parse_trigger(FILE *trig_f, int nr);
+void parse_trigger(FILE *trig_f, int nr, trig_rnum rnum);
 trig_data *read_trigger(int nr);
 void trig_data_copy(trig_data *this_data, const trig_data *trg);
 void dg_read_trigger(FILE *fp, void *proto, int type);
@@ -327,6 +378,10 @@ void dg_obj_trigger(char *line, struct obj_data *obj);
 void assign_triggers(void *i, int type);
 
 /* From dg_variables.c */
+unsigned long dg_var_hash(const char *name);
+struct trig_var_data *find_var(struct trig_var_data *var_list, const char *name);
+struct trig_var_data *find_var_context(struct trig_var_data *var_list,
+                const char *name, long context);
 void add_var(struct trig_var_data **var_list, const char *name, const char *value, long id);
 int item_in_list(char *item, obj_data *list);
 char *skill_percent(struct char_data *ch, char *skill);
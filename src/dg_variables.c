@@ -27,9 +27,164 @@
 #include "act.h"
 #include "genobj.h"
 #include "race.h"
+#include "pathfind.h"
+
+/* Every variable and field name find_replacement() and text_processed()
+ * know about.  A name is looked up once, and each of the many tests below
+ * compares a number instead of a string.  Keep both lists in the same order. */
+enum dg_name {
+  DGF_NONE = -1,
+  DGF_AFFECT, DGF_AFFECTS, DGF_ALIAS, DGF_ALIGN,
+  DGF_ARMOR, DGF_ASOUND, DGF_AT, DGF_CANBESEEN,
+  DGF_CAR, DGF_CARRIED_BY, DGF_CDR, DGF_CHA,
+  DGF_CHAR, DGF_CHARAT, DGF_CLASS, DGF_CON,
+  DGF_CONTAINS, DGF_CONTENTS, DGF_COST, DGF_COST_PER_DAY,
+  DGF_COUNT, DGF_DAMAGE, DGF_DAMROLL, DGF_DAY,
+  DGF_DEX, DGF_DIR, DGF_DOOR, DGF_DOWN,
+  DGF_DRUNK, DGF_EAST, DGF_ECHO, DGF_ECHOAROUND,
+  DGF_EQ, DGF_EXP, DGF_EXTRA, DGF_FIGHTING,
+  DGF_FINDMOB, DGF_FINDOBJ, DGF_FOLLOWER, DGF_FORCE,
+  DGF_GLOBAL, DGF_GOLD, DGF_HAPPYHOUR, DGF_HAS_IN,
+  DGF_HAS_ITEM, DGF_HASATTACHED, DGF_HESHE, DGF_HIMHER,
+  DGF_HISHER, DGF_HITP, DGF_HITROLL, DGF_HOUR,
+  DGF_HUNGER, DGF_ID, DGF_INT, DGF_INVENTORY,
+  DGF_IS_INROOM, DGF_IS_KILLER, DGF_IS_PC, DGF_IS_THIEF,
+  DGF_LEVEL, DGF_LOAD, DGF_LOG, DGF_MANA,
+  DGF_MASTER, DGF_MAXHITP, DGF_MAXMANA, DGF_MAXMOVE,
+  DGF_MONTH, DGF_MOVE, DGF_MUDCOMMAND, DGF_NAME,
+  DGF_NEXT_IN_LIST, DGF_NEXT_IN_ROOM, DGF_NORTH, DGF_NPCFLAG,
+  DGF_OSET, DGF_PATHTO, DGF_PEOPLE, DGF_POS,
+  DGF_PRAC, DGF_PREF, DGF_PURGE, DGF_QP,
+  DGF_QPNTS, DGF_QUEST, DGF_QUESTDONE, DGF_QUESTPOINTS,
+  DGF_RANDOM, DGF_RECHO, DGF_ROOM, DGF_ROOMFLAG,
+  DGF_SAVING_BREATH, DGF_SAVING_PARA, DGF_SAVING_PETRI, DGF_SAVING_ROD,
+  DGF_SAVING_SPELL, DGF_SECTOR, DGF_SELF, DGF_SEND,
+  DGF_SEX, DGF_SHORTDESC, DGF_SKILL, DGF_SKILLSET,
+  DGF_SOUTH, DGF_STR, DGF_STRADD, DGF_STRLEN,
+  DGF_TELEPORT, DGF_THIRST, DGF_TIME, DGF_TIMER,
+  DGF_TITLE, DGF_TOUPPER, DGF_TRANSFORM, DGF_TRIM,
+  DGF_TYPE, DGF_UP, DGF_VAL0, DGF_VAL1,
+  DGF_VAL2, DGF_VAL3, DGF_VAREXISTS, DGF_VNUM,
+  DGF_WAIT, DGF_WEARFLAG, DGF_WEATHER, DGF_WEIGHT,
+  DGF_WEST, DGF_WIS, DGF_WORN_BY, DGF_YEAR,
+  DGF_ZONEECHO, DGF_ZONENAME, DGF_ZONENUMBER,
+  NUM_DGF
+};
+
+static const char *dg_names[NUM_DGF] = {
+  "affect", "affects", "alias", "align", "armor",
+  "asound", "at", "canbeseen", "car", "carried_by",
+  "cdr", "cha", "char", "charat", "class",
+  "con", "contains", "contents", "cost", "cost_per_day",
+  "count", "damage", "damroll", "day", "dex",
+  "dir", "door", "down", "drunk", "east",
+  "echo", "echoaround", "eq", "exp", "extra",
+  "fighting", "findmob", "findobj", "follower", "force",
+  "global", "gold", "happyhour", "has_in", "has_item",
+  "hasattached", "heshe", "himher", "hisher", "hitp",
+  "hitroll", "hour", "hunger", "id", "int",
+  "inventory", "is_inroom", "is_killer", "is_pc", "is_thief",
+  "level", "load", "log", "mana", "master",
+  "maxhitp", "maxmana", "maxmove", "month", "move",
+  "mudcommand", "name", "next_in_list", "next_in_room", "north",
+  "npcflag", "oset", "pathto", "people", "pos",
+  "prac", "pref", "purge", "qp", "qpnts",
+  "quest", "questdone", "questpoints", "random", "recho",
+  "room", "roomflag", "saving_breath", "saving_para", "saving_petri",
+  "saving_rod", "saving_spell", "sector", "self", "send",
+  "sex", "shortdesc", "skill", "skillset", "south",
+  "str", "stradd", "strlen", "teleport", "thirst",
+  "time", "timer", "title", "toupper", "transform",
+  "trim", "type", "up", "val0", "val1",
+  "val2", "val3", "varexists", "vnum", "wait",
+  "wearflag", "weather", "weight", "west", "wis",
+  "worn_by", "year", "zoneecho", "zonename", "zonenumber",
+};
+
+/** Slots in dg_name_table, a power of two well over NUM_DGF. */
+#define DG_NAME_SLOTS 512
+
+/* local functions */
+static int dg_name_id(const char *name);
+
+/** Finds a variable or field name in dg_names.
+ * @param name The name as written in the script, in any case.
+ * @return Its DGF_ id, or DGF_NONE. */
+static int dg_name_id(const char *name)
+{
+  static short dg_name_table[DG_NAME_SLOTS];
+  static bool built = FALSE;
+  unsigned long slot;
+  int i;
+
+  if (!built) {
+    for (i = 0; i < DG_NAME_SLOTS; i++)
+      dg_name_table[i] = DGF_NONE;
+    for (i = 0; i < NUM_DGF; i++) {
+      for (slot = dg_var_hash(dg_names[i]) & (DG_NAME_SLOTS - 1);
+           dg_name_table[slot] != DGF_NONE; slot = (slot + 1) & (DG_NAME_SLOTS - 1));
+      dg_name_table[slot] = i;
+    }
+    built = TRUE;
+  }
+
+  if (!name || !*name)
+    return (DGF_NONE);
+
+  for (slot = dg_var_hash(name) & (DG_NAME_SLOTS - 1);
+       dg_name_table[slot] != DGF_NONE; slot = (slot + 1) & (DG_NAME_SLOTS - 1))
+    if (!str_cmp(dg_names[dg_name_table[slot]], name))
+      return (dg_name_table[slot]);
+  return (DGF_NONE);
+}
 
 /* Utility functions */
 
+/** Hashes a variable name the way str_cmp() compares it, ignoring case, so
+ * that lookups only compare the names of variables that can match.
+ * @param name The variable name.
+ * @return The FNV-1a hash of the lowercased name. */
+unsigned long dg_var_hash(const char *name)
+{
+  unsigned long hash = 2166136261UL;
+
+  for (; *name; name++)
+    hash = (hash ^ (unsigned char)LOWER(*name)) * 16777619UL;
+  return (hash);
+}
+
+/** Finds the first variable of a list with the given name.
+ * @param var_list The trigger's local or a script's global variables.
+ * @param name The variable name, in any case.
+ * @return The variable, or NULL if there is none. */
+struct trig_var_data *find_var(struct trig_var_data *var_list, const char *name)
+{
+  unsigned long hash = dg_var_hash(name);
+
+  for (; var_list; var_list = var_list->next)
+    if (var_list->hash == hash && !str_cmp(var_list->name, name))
+      break;
+  return (var_list);
+}
+
+/** Finds the first global variable with the given name that is visible in a
+ * context: set outside any context, or in this one.
+ * @param var_list A script's global variables.
+ * @param name The variable name, in any case.
+ * @param context The script's current context.
+ * @return The variable, or NULL if there is none. */
+struct trig_var_data *find_var_context(struct trig_var_data *var_list,
+                const char *name, long context)
+{
+  unsigned long hash = dg_var_hash(name);
+
+  for (; var_list; var_list = var_list->next)
+    if (var_list->hash == hash && !str_cmp(var_list->name, name) &&
+        (var_list->context==0 || var_list->context==context))
+      break;
+  return (var_list);
+}
+
 /* Thanks to James Long for his assistance in plugging the memory leak that
  * used to be here. - Welcor */
 /* Adds a variable with given name and value to trigger. */
@@ -42,7 +197,7 @@ void add_var(struct trig_var_data **var_list, const char *name, const char *valu
     return;
   }
 
-  for (vd = *var_list; vd && str_cmp(vd->name, name); vd = vd->next);
+  vd = find_var(*var_list, name);
 
   if (vd && (!vd->context || vd->context==id)) {
     free(vd->value);
@@ -54,6 +209,7 @@ void add_var(struct trig_var_data **var_list, const char *name, const char *valu
 
     CREATE(vd->name, char, strlen(name) + 1);
     strcpy(vd->name, name);                            /* strcpy: ok*/
+    vd->hash = dg_var_hash(name);
 
     CREATE(vd->value, char, strlen(value) + 1);
 
@@ -176,16 +332,17 @@ int text_processed(char *field, char *subfield, struct trig_var_data *vd,
 {
   char *p, *p2;
   char tmpvar[MAX_STRING_LENGTH];
+  int field_id = dg_name_id(field);
 
-  if (!str_cmp(field, "strlen")) {                     /* strlen    */
+  if (field_id == DGF_STRLEN) {                     /* strlen    */
     snprintf(str, slen, "%d", (int)strlen(vd->value));
     return TRUE;
-  } else if (!str_cmp(field, "toupper")) {             /* toupper   */
+  } else if (field_id == DGF_TOUPPER) {             /* toupper   */
     char *upper = vd->value;
     if (*upper)
       snprintf(str, slen, "%c%s", UPPER(*upper), upper + 1);
     return TRUE;
-  } else if (!str_cmp(field, "trim")) {                /* trim      */
+  } else if (field_id == DGF_TRIM) {                /* trim      */
     /* trim whitespace from ends */
     snprintf(tmpvar, sizeof(tmpvar)-1 , "%s", vd->value); /* -1 to use later*/
     p = tmpvar;
@@ -199,34 +356,34 @@ int text_processed(char *field, char *subfield, struct trig_var_data *vd,
     *(++p2) = '\0';                                         /* +1 ok (see above) */
     snprintf(str, slen, "%s", p);
     return TRUE;
-  } else if (!str_cmp(field, "contains")) {            /* contains  */
+  } else if (field_id == DGF_CONTAINS) {            /* contains  */
     if (str_str(vd->value, subfield))
       strcpy(str, "1");
     else
       strcpy(str, "0");
     return TRUE;
-  } else if (!str_cmp(field, "car")) {                 /* car       */
+  } else if (field_id == DGF_CAR) {                 /* car       */
     char *car = vd->value;
     while (*car && !isspace(*car))
       *str++ = *car++;
     *str = '\0';
     return TRUE;
 
-  } else if (!str_cmp(field, "cdr")) {                 /* cdr       */
+  } else if (field_id == DGF_CDR) {                 /* cdr       */
     char *cdr = vd->value;
     while (*cdr && !isspace(*cdr)) cdr++; /* skip 1st field */
     while (*cdr && isspace(*cdr)) cdr++;  /* skip to next */
 
     snprintf(str, slen, "%s", cdr);
     return TRUE;
-  } else if (!str_cmp(field, "charat")) {              /* CharAt    */
+  } else if (field_id == DGF_CHARAT) {              /* CharAt    */
     size_t len = strlen(vd->value), cindex = atoi(subfield);
     if (cindex > len || cindex < 1)
       strcpy(str, "");
     else
       snprintf(str, slen, "%c", vd->value[cindex - 1]);
     return TRUE;
-  } else if (!str_cmp(field, "mudcommand")) {
+  } else if (field_id == DGF_MUDCOMMAND) {
     /* find the mud command returned from this text */
 /* NOTE: you may need to replace "cmd_info" with "complete_cmd_info", */
 /* depending on what patches you've got applied.                      */
@@ -257,6 +414,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
   struct room_data *room, *r = NULL;
   char *name;
   int num, count, i, j, doors;
+  int var_id = dg_name_id(var), field_id = dg_name_id(field);
 
   char *log_cmd[]        = {"mlog ",        "olog ",        "wlog "       };
   char *send_cmd[]       = {"msend ",       "osend ",       "wsend "      };
@@ -282,22 +440,17 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
 
   /* X.global() will have a NULL trig */
   if (trig)
-    for (vd = GET_TRIG_VARS(trig); vd; vd = vd->next)
-      if (!str_cmp(vd->name, var))
-        break;
+    vd = find_var(GET_TRIG_VARS(trig), var);
 
   /* some evil waitstates could crash the mud if sent here with sc==NULL*/
   if (!vd && sc)
-    for (vd = sc->global_vars; vd; vd = vd->next)
-      if (!str_cmp(vd->name, var) &&
-          (vd->context==0 || vd->context==sc->context))
-        break;
+    vd = find_var_context(sc->global_vars, var, sc->context);
 
   if (!*field) {
     if (vd)
       snprintf(str, slen, "%s", vd->value);
     else {
-      if (!str_cmp(var, "self")) {
+      if (var_id == DGF_SELF) {
         switch (type) {
         case MOB_TRIGGER:
           snprintf(str, slen, "%c%ld", UID_CHAR, char_script_id((char_data *) go));
@@ -310,42 +463,42 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           break;
         }
       }
-      else if (!str_cmp(var, "global")) {
+      else if (var_id == DGF_GLOBAL) {
         /* so "remote varname %global%" will work */
         snprintf(str, slen, "%d", ROOM_ID_BASE);
         return;
       }
-      else if (!str_cmp(var, "door"))
+      else if (var_id == DGF_DOOR)
         snprintf(str, slen, "%s", door[type]);
-      else if (!str_cmp(var, "force"))
+      else if (var_id == DGF_FORCE)
         snprintf(str, slen, "%s", force[type]);
-      else if (!str_cmp(var, "load"))
+      else if (var_id == DGF_LOAD)
         snprintf(str, slen, "%s", load[type]);
-      else if (!str_cmp(var, "purge"))
+      else if (var_id == DGF_PURGE)
         snprintf(str, slen, "%s", purge[type]);
-      else if (!str_cmp(var, "teleport"))
+      else if (var_id == DGF_TELEPORT)
         snprintf(str, slen, "%s", teleport[type]);
-      else if (!str_cmp(var, "damage"))
+      else if (var_id == DGF_DAMAGE)
         snprintf(str, slen, "%s", xdamage[type]);
-      else if (!str_cmp(var, "send"))
+      else if (var_id == DGF_SEND)
         snprintf(str, slen, "%s", send_cmd[type]);
-      else if (!str_cmp(var, "echo"))
+      else if (var_id == DGF_ECHO)
         snprintf(str, slen, "%s", echo_cmd[type]);
-      else if (!str_cmp(var, "echoaround"))
+      else if (var_id == DGF_ECHOAROUND)
         snprintf(str, slen, "%s", echoaround_cmd[type]);
-      else if (!str_cmp(var, "zoneecho"))
+      else if (var_id == DGF_ZONEECHO)
         snprintf(str, slen, "%s", zoneecho[type]);
-      else if (!str_cmp(var, "asound"))
+      else if (var_id == DGF_ASOUND)
         snprintf(str, slen, "%s", asound[type]);
-      else if (!str_cmp(var, "at"))
+      else if (var_id == DGF_AT)
         snprintf(str, slen, "%s", at[type]);
-      else if (!str_cmp(var, "transform"))
+      else if (var_id == DGF_TRANSFORM)
         snprintf(str, slen, "%s", transform[type]);
-      else if (!str_cmp(var, "recho"))
+      else if (var_id == DGF_RECHO)
         snprintf(str, slen, "%s", recho[type]);
-      else if (!str_cmp(var, "move"))
+      else if (var_id == DGF_MOVE)
         snprintf(str, slen, "%s", omove[type]);
-      else if (!str_cmp(var, "log"))
+      else if (var_id == DGF_LOG)
         snprintf(str, slen, "%s", log_cmd[type]);
       else
         *str = '\0';
@@ -393,7 +546,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
     }
 
     else {
-      if (!str_cmp(var, "self")) {
+      if (var_id == DGF_SELF) {
         switch (type) {
         case MOB_TRIGGER:
           c = (char_data *) go;
@@ -413,44 +566,42 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
         }
       }
 
-      else if (!str_cmp(var, "global")) {
+      else if (var_id == DGF_GLOBAL) {
         struct script_data *thescript = SCRIPT(&world[0]);
         *str = '\0';
         if (!thescript) {
           script_log("Attempt to find global var. Apparently the void has no script.");
           return;
         }
-        for (vd = thescript->global_vars; vd ; vd = vd->next)
-          if (!str_cmp(vd->name, field))
-            break;
+        vd = find_var(thescript->global_vars, field);
 
         if (vd)
           snprintf(str, slen, "%s", vd->value);
 
         return;
       }
-      else if (!str_cmp(var, "people")) {
+      else if (var_id == DGF_PEOPLE) {
         snprintf(str, slen, "%d",((num = atoi(field)) > 0) ? trgvar_in_room(num) : 0);
         return;
       }
-      else if (!str_cmp(var, "happyhour")) {
-        if (!str_cmp(field, "qp") && IS_HAPPYHOUR)
+      else if (var_id == DGF_HAPPYHOUR) {
+        if (field_id == DGF_QP && IS_HAPPYHOUR)
           snprintf(str, slen, "%d", HAPPY_QP);
-        else if (!str_cmp(field, "exp") && IS_HAPPYHOUR)
+        else if (field_id == DGF_EXP && IS_HAPPYHOUR)
           snprintf(str, slen, "%d", HAPPY_EXP);
-        else if (!str_cmp(field, "gold") && IS_HAPPYHOUR)
+        else if (field_id == DGF_GOLD && IS_HAPPYHOUR)
           snprintf(str, slen, "%d", HAPPY_GOLD);
         else snprintf(str, slen, "%d", HAPPY_TIME);
         return;
       }
-      else if (!str_cmp(var, "time")) {
-        if (!str_cmp(field, "hour"))
+      else if (var_id == DGF_TIME) {
+        if (field_id == DGF_HOUR)
           snprintf(str, slen, "%d", time_info.hours);
-        else if (!str_cmp(field, "day"))
+        else if (field_id == DGF_DAY)
           snprintf(str, slen, "%d", time_info.day + 1);
-        else if (!str_cmp(field, "month"))
+        else if (field_id == DGF_MONTH)
           snprintf(str, slen, "%d", time_info.month + 1);
-        else if (!str_cmp(field, "year"))
+        else if (field_id == DGF_YEAR)
           snprintf(str, slen, "%d", time_info.year);
         else *str = '\0';
         return;
@@ -465,7 +616,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
  * gold (vnum: 1234). In the vault (vnum: 453). Use: %findobj.453(1234)% and it
  * will return the number of bags of gold.
  * Addition inspired by Jamie Nelson */
-      else if (!str_cmp(var, "findmob")) {
+      else if (var_id == DGF_FINDMOB) {
         if (!field || !*field || !subfield || !*subfield) {
           script_log("findmob.vnum(mvnum) - illegal syntax");
           strcpy(str, "0");
@@ -486,7 +637,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
         }
       }
       /* Addition inspired by Jamie Nelson. */
-      else if (!str_cmp(var, "findobj")) {
+      else if (var_id == DGF_FINDOBJ) {
         if (!field || !*field || !subfield || !*subfield) {
           script_log("findobj.vnum(ovnum) - illegal syntax");
           strcpy(str, "0");
@@ -502,8 +653,8 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
         }
       }
-      else if (!str_cmp(var, "random")) {
-        if (!str_cmp(field, "char")) {
+      else if (var_id == DGF_RANDOM) {
+        if (field_id == DGF_CHAR) {
           rndm = NULL;
           count = 0;
 
@@ -545,7 +696,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             *str = '\0';
         }
 
-        else if (!str_cmp(field, "dir")) {
+        else if (field_id == DGF_DIR) {
           room_rnum in_room = NOWHERE;
 
           switch (type) {
@@ -588,7 +739,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
     }
 
     if (c) {
-      if (!str_cmp(field, "global")) { /* get global of something else */
+      if (field_id == DGF_GLOBAL) { /* get global of something else */
         if (IS_NPC(c) && c->script) {
           find_replacement(go, c->script, NULL, MOB_TRIGGER,
             subfield, NULL, NULL, str, slen);
@@ -599,7 +750,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
 
       switch (LOWER(*field)) {
         case 'a':
-          if (!str_cmp(field, "affect")) {
+          if (field_id == DGF_AFFECT) {
             if (subfield && *subfield) {
               int spell = find_skill_num(subfield);
               if (affected_by_spell(c, spell))
@@ -609,27 +760,27 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             } else
               strcpy(str, "0");
           }
-          else if (!str_cmp(field, "alias"))
+          else if (field_id == DGF_ALIAS)
             snprintf(str, slen, "%s", GET_PC_NAME(c));
 
-          else if (!str_cmp(field, "align")) {
+          else if (field_id == DGF_ALIGN) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
              GET_ALIGNMENT(c) = MAX(-1000, MIN(addition, 1000));
             }
 	    snprintf(str, slen, "%d", GET_ALIGNMENT(c));
           }
-          else if (!str_cmp(field, "armor"))
+          else if (field_id == DGF_ARMOR)
             snprintf(str, slen, "%d", compute_armor_class(c));
           break;
         case 'c':
-          if (!str_cmp(field, "canbeseen")) {
+          if (field_id == DGF_CANBESEEN) {
             if ((type == MOB_TRIGGER) && !CAN_SEE(((char_data *)go), c))
               strcpy(str, "0");
             else
               strcpy(str, "1");
           }
-          else if (!str_cmp(field, "cha")) {
+          else if (field_id == DGF_CHA) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               c->real_abils.cha += addition;
@@ -638,7 +789,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             }
             snprintf(str, slen, "%d", GET_CHA(c));
           }
-          else if (!str_cmp(field, "class")) {
+          else if (field_id == DGF_CLASS) {
             if (subfield && *subfield) {
               int cl = get_class_by_name(subfield);
               if (cl != -1) {
@@ -650,7 +801,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             } else
               sprinttype(GET_CLASS(c), pc_class_types, str, slen);
           }
-          else if (!str_cmp(field, "con")) {
+          else if (field_id == DGF_CON) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               c->real_abils.con += addition;
@@ -661,13 +812,13 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'd':
-          if (!str_cmp(field, "damroll")) {
+          if (field_id == DGF_DAMROLL) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_DAMROLL(c) = MAX(1, GET_DAMROLL(c) + addition);
             }
             snprintf(str, slen, "%d", GET_DAMROLL(c));
-            } else if (!str_cmp(field, "dex")) {
+            } else if (field_id == DGF_DEX) {
               if (subfield && *subfield) {
                 int addition = atoi(subfield);
                 c->real_abils.dex += addition;
@@ -676,7 +827,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
               }
             snprintf(str, slen, "%d", GET_DEX(c));
           }
-          else if (!str_cmp(field, "drunk")) {
+          else if (field_id == DGF_DRUNK) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_COND(c, DRUNK) = MAX(-1, MIN(addition, 24));
@@ -685,7 +836,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'e':
-          if (!str_cmp(field, "eq")) {
+          if (field_id == DGF_EQ) {
             int pos;
             if (!subfield || !*subfield)
               *str = '\0';
@@ -704,7 +855,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             else
               snprintf(str, slen, "%c%ld",UID_CHAR, obj_script_id(GET_EQ(c, pos)));
           }
-          else if (!str_cmp(field, "exp")) {
+          else if (field_id == DGF_EXP) {
             if (subfield && *subfield) {
               int addition = MIN(atoi(subfield), 1000);
 
@@ -714,13 +865,13 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'f':
-          if (!str_cmp(field, "fighting")) {
+          if (field_id == DGF_FIGHTING) {
             if (FIGHTING(c))
               snprintf(str, slen, "%c%ld", UID_CHAR, char_script_id(FIGHTING(c)));
             else
               *str = '\0';
           }
-          else if (!str_cmp(field, "follower")) {
+          else if (field_id == DGF_FOLLOWER) {
             if (!c->followers || !c->followers->follower)
               *str = '\0';
             else
@@ -728,7 +879,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'g':
-          if (!str_cmp(field, "gold")) {
+          if (field_id == DGF_GOLD) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               increase_gold(c, addition);
@@ -737,13 +888,13 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'h':
-          if (!str_cmp(field, "has_item")) {
+          if (field_id == DGF_HAS_ITEM) {
             if (!(subfield && *subfield))
               *str = '\0';
             else
               snprintf(str, slen, "%d", char_has_item(subfield, c));
           }
-          else if (!str_cmp(field, "hasattached")) {
+          else if (field_id == DGF_HASATTACHED) {
             if (!(subfield && *subfield) || !IS_NPC(c))
               *str = '\0';
             else {
@@ -751,13 +902,13 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
               snprintf(str, slen, "%d", trig_is_attached(SCRIPT(c), i));
             }
           }
-          else if (!str_cmp(field, "heshe"))
+          else if (field_id == DGF_HESHE)
             snprintf(str, slen, "%s", HSSH(c));
-          else if (!str_cmp(field, "himher"))
+          else if (field_id == DGF_HIMHER)
             snprintf(str, slen, "%s", HMHR(c));
-          else if (!str_cmp(field, "hisher"))
+          else if (field_id == DGF_HISHER)
             snprintf(str, slen, "%s", HSHR(c));
-          else if (!str_cmp(field, "hitp")) {
+          else if (field_id == DGF_HITP) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_HIT(c) += addition;
@@ -765,14 +916,14 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             }
             snprintf(str, slen, "%d", GET_HIT(c));
           }
-          else if (!str_cmp(field, "hitroll")) {
+          else if (field_id == DGF_HITROLL) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_HITROLL(c) = MAX(1, GET_HITROLL(c) + addition);
             }
             snprintf(str, slen, "%d", GET_HITROLL(c));
           }
-          else if (!str_cmp(field, "hunger")) {
+          else if (field_id == DGF_HUNGER) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_COND(c, HUNGER) = MAX(-1, MIN(addition, 24));
@@ -781,16 +932,16 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'i':
-          if (!str_cmp(field, "id"))
+          if (field_id == DGF_ID)
             snprintf(str, slen, "%ld", char_script_id(c));
           /* new check for pc/npc status */
-          else if (!str_cmp(field, "is_pc")) {
+          else if (field_id == DGF_IS_PC) {
             if (IS_NPC(c))
               strcpy(str, "0");
             else
               strcpy(str, "1");
           }
-          else if (!str_cmp(field, "int")) {
+          else if (field_id == DGF_INT) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               c->real_abils.intel += addition;
@@ -799,7 +950,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             }
             snprintf(str, slen, "%d", GET_INT(c));
           }
-          else if (!str_cmp(field, "inventory")) {
+          else if (field_id == DGF_INVENTORY) {
             if(subfield && *subfield) {
               for (obj = c->carrying;obj;obj=obj->next_content) {
                 if(GET_OBJ_VNUM(obj)==atoi(subfield)) {
@@ -817,7 +968,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
               }
             }
           }
-          else if (!str_cmp(field, "is_killer")) {
+          else if (field_id == DGF_IS_KILLER) {
             if (subfield && *subfield) {
               if (!str_cmp("on", subfield))
                 SET_BIT_AR(PLR_FLAGS(c), PLR_KILLER);
@@ -829,7 +980,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             else
               strcpy(str, "0");
           }
-          else if (!str_cmp(field, "is_thief")) {
+          else if (field_id == DGF_IS_THIEF) {
             if (subfield && *subfield) {
               if (!str_cmp("on", subfield))
                 SET_BIT_AR(PLR_FLAGS(c), PLR_THIEF);
@@ -843,50 +994,51 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'l':
-          if (!str_cmp(field, "level")) {
+          if (field_id == DGF_LEVEL) {
             if (subfield && *subfield) {
               int lev = atoi(subfield);
               GET_LEVEL(c) = MIN(MAX(lev, 0), LVL_IMMORT-1);
+              update_zone_player(c);
             } else
               snprintf(str, slen, "%d", GET_LEVEL(c));
           }
           break;
         case 'm':
-          if (!str_cmp(field, "mana")) {
+          if (field_id == DGF_MANA) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_MANA(c) += addition;
             }
             snprintf(str, slen, "%d", GET_MANA(c));
           }
-          else if (!str_cmp(field, "master")) {
+          else if (field_id == DGF_MASTER) {
             if (!c->master)
               *str = '\0';
             else
               snprintf(str, slen, "%c%ld", UID_CHAR, char_script_id(c->master));
           }
-          else if (!str_cmp(field, "maxhitp")) {
+          else if (field_id == DGF_MAXHITP) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_MAX_HIT(c) = MAX(GET_MAX_HIT(c) + addition, 1);
             }
             snprintf(str, slen, "%d", GET_MAX_HIT(c));
           }
-          else if (!str_cmp(field, "maxmana")) {
+          else if (field_id == DGF_MAXMANA) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_MAX_MANA(c) = MAX(GET_MAX_MANA(c) + addition, 1);
             }
             snprintf(str, slen, "%d", GET_MAX_MANA(c));
           }
-          else if (!str_cmp(field, "maxmove")) {
+          else if (field_id == DGF_MAXMOVE) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_MAX_MOVE(c) = MAX(GET_MAX_MOVE(c) + addition, 1);
             }
             snprintf(str, slen, "%d", GET_MAX_MOVE(c));
           }
-          else if (!str_cmp(field, "move")) {
+          else if (field_id == DGF_MOVE) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_MOVE(c) += addition;
@@ -895,16 +1047,16 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'n':
-          if (!str_cmp(field, "name"))
+          if (field_id == DGF_NAME)
             snprintf(str, slen, "%s", GET_NAME(c));
 
-          else if (!str_cmp(field, "next_in_room")) {
+          else if (field_id == DGF_NEXT_IN_ROOM) {
             if (c->next_in_room)
               snprintf(str, slen,"%c%ld",UID_CHAR, char_script_id(c->next_in_room));
             else
               *str = '\0';
           }
-          else if (!str_cmp(field, "npcflag")) {
+          else if (field_id == DGF_NPCFLAG) {
             if (subfield && *subfield) {
                char buf[MAX_STRING_LENGTH];
                sprintbitarray(MOB_FLAGS(c), action_bits, PM_ARRAY_MAX, buf);
@@ -921,7 +1073,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
         case 'p':
           /* Thanks to Christian Ejlertsen for this idea
              And to Ken Ray for speeding the implementation up :)*/
-          if (!str_cmp(field, "pos")) {
+          if (field_id == DGF_POS) {
             if (subfield && *subfield) {
               for (i = POS_SLEEPING; i <= POS_STANDING; i++) {
                 /* allows : Sleeping, Resting, Sitting, Fighting, Standing */
@@ -933,14 +1085,14 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             }
             snprintf(str, slen, "%s", position_types[GET_POS(c)]);
           }
-          else if (!str_cmp(field, "prac")) {
+          else if (field_id == DGF_PRAC) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_PRACTICES(c) = MAX(0, GET_PRACTICES(c) + addition);
             }
             snprintf(str, slen, "%d", GET_PRACTICES(c));
           }
-          else if (!str_cmp(field, "pref")) {
+          else if (field_id == DGF_PREF) {
             if (subfield && *subfield) {
               int pref = get_flag_by_name(preference_bits, subfield);
               if (!IS_NPC(c) && pref != NOFLAG && PRF_FLAGGED(c, pref))
@@ -950,10 +1102,20 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             } else
               strcpy(str, "0");
           }
+          /* %actor.pathto(vnum)% is the next direction on the way to a room */
+          else if (field_id == DGF_PATHTO) {
+            room_rnum to = (subfield && *subfield) ? real_room(atoi(subfield)) : NOWHERE;
+
+            if (to == NOWHERE || IN_ROOM(c) == NOWHERE ||
+                (i = path_next_step(&TRACK_PATH(c), IN_ROOM(c), to, PATHF_ASTAR)) < 0)
+              *str = '\0';
+            else
+              snprintf(str, slen, "%s", dirs[i]);
+          }
           break;
         case 'q':
-          if (!IS_NPC(c) && (!str_cmp(field, "questpoints") ||
-              !str_cmp(field, "qp") || !str_cmp(field, "qpnts")))
+          if (!IS_NPC(c) && (field_id == DGF_QUESTPOINTS ||
+              field_id == DGF_QP || field_id == DGF_QPNTS))
           {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
@@ -961,14 +1123,14 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             }
             snprintf(str, slen, "%d", GET_QUESTPOINTS(c));
           }
-           else if (!str_cmp(field, "quest"))
+           else if (field_id == DGF_QUEST)
            {
                if (!IS_NPC(c) && (GET_QUEST(c) != NOTHING) && (real_quest(GET_QUEST(c)) != NOTHING))
                  snprintf(str, slen, "%d", GET_QUEST(c));
                else
                  strcpy(str, "0");
              }
-           else if (!str_cmp(field, "questdone"))
+           else if (field_id == DGF_QUESTDONE)
            {
                if (!IS_NPC(c) && subfield && *subfield) {
                  int q_num = atoi(subfield);
@@ -982,7 +1144,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
              }
           break;
         case 'r':
-          if (!str_cmp(field, "room")) {  /* in NOWHERE, return the void */
+          if (field_id == DGF_ROOM) {  /* in NOWHERE, return the void */
 /* see note in dg_scripts.h */
 #ifdef ACTOR_ROOM_IS_UID
             snprintf(str, slen, "%c%ld",UID_CHAR,
@@ -993,46 +1155,46 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 's':
-          if (!str_cmp(field, "saving_breath")) {
+          if (field_id == DGF_SAVING_BREATH) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_SAVE(c, SAVING_BREATH) += addition;
             }
             snprintf(str, slen, "%d", GET_SAVE(c, SAVING_BREATH));
           }
-          else if (!str_cmp(field, "saving_para")) {
+          else if (field_id == DGF_SAVING_PARA) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_SAVE(c, SAVING_PARA) += addition;
             }
             snprintf(str, slen, "%d", GET_SAVE(c, SAVING_PARA));
           }
-          else if (!str_cmp(field, "saving_petri")) {
+          else if (field_id == DGF_SAVING_PETRI) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_SAVE(c, SAVING_PETRI) += addition;
             }
             snprintf(str, slen, "%d", GET_SAVE(c, SAVING_PETRI));
           }
-          else if (!str_cmp(field, "saving_rod")) {
+          else if (field_id == DGF_SAVING_ROD) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_SAVE(c, SAVING_ROD) += addition;
             }
             snprintf(str, slen, "%d", GET_SAVE(c, SAVING_ROD));
           }
-          else if (!str_cmp(field, "saving_spell")) {
+          else if (field_id == DGF_SAVING_SPELL) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_SAVE(c, SAVING_SPELL) += addition;
             }
             snprintf(str, slen, "%d", GET_SAVE(c, SAVING_SPELL));
           }
-          else if (!str_cmp(field, "sex"))
+          else if (field_id == DGF_SEX)
             snprintf(str, slen, "%s", genders[(int)GET_SEX(c)]);
-          else if (!str_cmp(field, "skill"))
+          else if (field_id == DGF_SKILL)
             snprintf(str, slen, "%s", skill_percent(c, subfield));
-          else if (!str_cmp(field, "skillset")) {
+          else if (field_id == DGF_SKILLSET) {
             if (!IS_NPC(c) && subfield && *subfield) {
               char skillname[MAX_INPUT_LENGTH], *amount;
               amount = one_word(subfield, skillname);
@@ -1047,7 +1209,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             }
             *str = '\0'; /* so the parser know we recognize 'skillset' as a field */
           }
-          else if (!str_cmp(field, "str")) {
+          else if (field_id == DGF_STR) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               c->real_abils.str += addition;
@@ -1056,7 +1218,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             }
             snprintf(str, slen, "%d", GET_STR(c));
           }
-          else if (!str_cmp(field, "stradd")) {
+          else if (field_id == DGF_STRADD) {
             if (GET_STR(c) >= 18) {
               if (subfield && *subfield) {
                 int addition = atoi(subfield);
@@ -1070,14 +1232,14 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 't':
-          if (!str_cmp(field, "thirst")) {
+          if (field_id == DGF_THIRST) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_COND(c, THIRST) = MAX(-1, MIN(addition, 24));
             }
             snprintf(str, slen, "%d", GET_COND(c, THIRST));
           }
-          else if (!str_cmp(field, "title")) {
+          else if (field_id == DGF_TITLE) {
             if (!IS_NPC(c) && subfield && *subfield && valid_dg_target(c, DG_ALLOW_GODS)) {
               if (GET_TITLE(c)) free(GET_TITLE(c));
                 GET_TITLE(c) = strdup(subfield);
@@ -1086,17 +1248,14 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
 	case 'v':
-          if (!str_cmp(field, "varexists")) {
-            struct trig_var_data *remote_vd;
+          if (field_id == DGF_VAREXISTS) {
             strcpy(str, "0");
             if (SCRIPT(c)) {
-              for (remote_vd = SCRIPT(c)->global_vars; remote_vd; remote_vd = remote_vd->next) {
-                if (!str_cmp(remote_vd->name, subfield)) break;
-              }
-              if (remote_vd) strcpy(str, "1");
+              if (find_var(SCRIPT(c)->global_vars, subfield))
+                strcpy(str, "1");
             }
           }
-          else if (!str_cmp(field, "vnum")) {
+          else if (field_id == DGF_VNUM) {
             if (subfield && *subfield) {
              /* When this had -1 at the end of the line it returned true for PC's if you did
               * something like if %actor.vnum(500)%. It should return false for PC's instead 
@@ -1117,9 +1276,9 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'w':
-          if (!str_cmp(field, "weight"))
+          if (field_id == DGF_WEIGHT)
             snprintf(str, slen, "%d", GET_WEIGHT(c));
-          else if (!str_cmp(field, "wis")) {
+          else if (field_id == DGF_WIS) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               c->real_abils.wis += addition;
@@ -1129,7 +1288,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             snprintf(str, slen, "%d", GET_WIS(c));
           }
           
-          else if (!str_cmp(field, "wait")) 
+          else if (field_id == DGF_WAIT) 
           {
             if (subfield && *subfield)
             {
@@ -1144,9 +1303,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
 
       if (*str == '\x1') { /* no match found in switch */
         if (SCRIPT(c)) {
-          for (vd = (SCRIPT(c))->global_vars; vd; vd = vd->next)
-            if (!str_cmp(vd->name, field))
-              break;
+          vd = find_var((SCRIPT(c))->global_vars, field);
           if (vd)
             snprintf(str, slen, "%s", vd->value);
           else {
@@ -1167,7 +1324,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
       *str = '\x1';
       switch (LOWER(*field)) {
         case 'a':
-          if (!str_cmp(field, "affects")) {
+          if (field_id == DGF_AFFECTS) {
             if (subfield && *subfield) {
               if (check_flags_by_name_ar(GET_OBJ_AFFECT(o), NUM_AFF_FLAGS, subfield, affected_bits) == TRUE)
                 snprintf(str, slen, "1");
@@ -1177,7 +1334,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
               snprintf(str, slen, "0");
           }
 	case 'c':
-          if (!str_cmp(field, "cost")) {
+          if (field_id == DGF_COST) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_OBJ_COST(o) = MAX(1, addition + GET_OBJ_COST(o));
@@ -1185,7 +1342,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             snprintf(str, slen, "%d", GET_OBJ_COST(o));
           }
 
-          else if (!str_cmp(field, "cost_per_day")) {
+          else if (field_id == DGF_COST_PER_DAY) {
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_OBJ_RENT(o) = MAX(1, addition + GET_OBJ_RENT(o));
@@ -1193,21 +1350,21 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             snprintf(str, slen, "%d", GET_OBJ_RENT(o));
           }
 
-          else if (!str_cmp(field, "carried_by")) {
+          else if (field_id == DGF_CARRIED_BY) {
             if (o->carried_by)
               snprintf(str, slen,"%c%ld",UID_CHAR, char_script_id(o->carried_by));
             else
               *str = '\0';
           }
 
-          else if (!str_cmp(field, "contents")) {
+          else if (field_id == DGF_CONTENTS) {
             if (o->contains)
               snprintf(str, slen, "%c%ld", UID_CHAR, obj_script_id(o->contains));
             else
               *str = '\0';
           }
           /* thanks to Jamie Nelson (Mordecai of 4 Dimensions MUD) */
-          else if (!str_cmp(field, "count")) {
+          else if (field_id == DGF_COUNT) {
             if (GET_OBJ_TYPE(o) == ITEM_CONTAINER)
               snprintf(str, slen, "%d", item_in_list(subfield, o->contains));
             else
@@ -1215,7 +1372,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'e':
-          if (!str_cmp(field, "extra")) {
+          if (field_id == DGF_EXTRA) {
             if (subfield && *subfield) {
               if (check_flags_by_name_ar(GET_OBJ_EXTRA(o), NUM_ITEM_FLAGS, subfield, extra_bits) > 0)
                 snprintf(str, slen, "1");
@@ -1228,13 +1385,13 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           break;
 	case 'h':
           /* thanks to Jamie Nelson (Mordecai of 4 Dimensions MUD) */
-          if (!str_cmp(field, "has_in")) {
+          if (field_id == DGF_HAS_IN) {
             if (GET_OBJ_TYPE(o) == ITEM_CONTAINER)
               snprintf(str, slen, "%s", (item_in_list(subfield, o->contains) ? "1" : "0"));
             else
               strcpy(str, "0");
           }
-          else if (!str_cmp(field, "hasattached")) {
+          else if (field_id == DGF_HASATTACHED) {
             if (!(subfield && *subfield))
               *str = '\0';
             else {
@@ -1244,24 +1401,24 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'i':
-          if (!str_cmp(field, "id"))
+          if (field_id == DGF_ID)
             snprintf(str, slen, "%ld", obj_script_id(o));
 
-          else if (!str_cmp(field, "is_inroom")) {
+          else if (field_id == DGF_IS_INROOM) {
             if (IN_ROOM(o) != NOWHERE)
               snprintf(str, slen,"%c%ld",UID_CHAR, room_script_id(world + IN_ROOM(o)));
             else
               *str = '\0';
           }
-          else if (!str_cmp(field, "is_pc")) {
+          else if (field_id == DGF_IS_PC) {
             strcpy(str, "-1");
           }
 	  break;
         case 'n':
-          if (!str_cmp(field, "name"))
+          if (field_id == DGF_NAME)
             snprintf(str, slen, "%s",  o->name);
 
-          else if (!str_cmp(field, "next_in_list")) {
+          else if (field_id == DGF_NEXT_IN_LIST) {
             if (o->next_content)
               snprintf(str, slen,"%c%ld",UID_CHAR, obj_script_id(o->next_content));
             else
@@ -1269,7 +1426,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'o':
-          if (!str_cmp(field, "oset")) {
+          if (field_id == DGF_OSET) {
             if (subfield && *subfield) {
               if (handle_oset(o, subfield))
                 strcpy(str, "1");
@@ -1279,7 +1436,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 'r':
-          if (!str_cmp(field, "room")) {
+          if (field_id == DGF_ROOM) {
             if (obj_room(o) != NOWHERE)
               snprintf(str, slen,"%c%ld",UID_CHAR, room_script_id(world + obj_room(o)));
             else
@@ -1287,37 +1444,37 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           }
           break;
         case 's':
-          if (!str_cmp(field, "shortdesc"))
+          if (field_id == DGF_SHORTDESC)
             snprintf(str, slen, "%s",  o->short_description);
           break;
         case 't':
-          if (!str_cmp(field, "type"))
+          if (field_id == DGF_TYPE)
             sprinttype(GET_OBJ_TYPE(o), item_types, str, slen);
 
-          else if (!str_cmp(field, "timer"))
+          else if (field_id == DGF_TIMER)
             snprintf(str, slen, "%d", GET_OBJ_TIMER(o));
           break;
         case 'v':
-          if (!str_cmp(field, "vnum"))
+          if (field_id == DGF_VNUM)
             if (subfield && *subfield) {
               snprintf(str, slen, "%d", (int)(GET_OBJ_VNUM(o) == atoi(subfield)));
             } else {
               snprintf(str, slen, "%d", GET_OBJ_VNUM(o));
             }
-          else if (!str_cmp(field, "val0"))
+          else if (field_id == DGF_VAL0)
             snprintf(str, slen, "%d", GET_OBJ_VAL(o, 0));
 
-          else if (!str_cmp(field, "val1"))
+          else if (field_id == DGF_VAL1)
             snprintf(str, slen, "%d", GET_OBJ_VAL(o, 1));
 
-          else if (!str_cmp(field, "val2"))
+          else if (field_id == DGF_VAL2)
             snprintf(str, slen, "%d", GET_OBJ_VAL(o, 2));
 
-          else if (!str_cmp(field, "val3"))
+          else if (field_id == DGF_VAL3)
             snprintf(str, slen, "%d", GET_OBJ_VAL(o, 3));
           break;
         case 'w':
-          if (!str_cmp(field, "wearflag")) {
+          if (field_id == DGF_WEARFLAG) {
 	    if (subfield && *subfield) {
 	      if (can_wear_on_pos(o, find_eq_pos_script(subfield)))
 	        snprintf(str, slen, "1");
@@ -1327,7 +1484,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
               snprintf(str, slen, "0");
 	  }
 
-	  else if (!str_cmp(field, "weight")){
+	  else if (field_id == DGF_WEIGHT){
             if (subfield && *subfield) {
               int addition = atoi(subfield);
               GET_OBJ_WEIGHT(o) = MAX(1, addition + GET_OBJ_WEIGHT(o));
@@ -1335,7 +1492,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             snprintf(str, slen, "%d", GET_OBJ_WEIGHT(o));
           }
 
-          else if (!str_cmp(field, "worn_by")) {
+          else if (field_id == DGF_WORN_BY) {
             if (o->worn_by)
               snprintf(str, slen,"%c%ld",UID_CHAR, char_script_id(o->worn_by));
             else
@@ -1347,9 +1504,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
 
       if (*str == '\x1') { /* no match in switch */
         if (SCRIPT(o)) { /* check for global var */
-          for (vd = (SCRIPT(o))->global_vars; vd; vd = vd->next)
-            if (!str_cmp(vd->name, field))
-              break;
+          vd = find_var((SCRIPT(o))->global_vars, field);
           if (vd)
             snprintf(str, slen, "%s", vd->value);
           else {
@@ -1374,9 +1529,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           script_log("Trigger: %s, Vnum %d, type %d. Trying to access Global var list of void. Apparently this has not been set up!",
                      GET_TRIG_NAME(trig), GET_TRIG_VNUM(trig), type);
         } else {
-          for (vd = (SCRIPT(r))->global_vars; vd; vd = vd->next)
-            if (!str_cmp(vd->name, field))
-              break;
+          vd = find_var((SCRIPT(r))->global_vars, field);
           if (vd)
             snprintf(str, slen, "%s", vd->value);
           else
@@ -1384,19 +1537,19 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
         }
       }
 
-      else if (!str_cmp(field, "name"))
+      else if (field_id == DGF_NAME)
         snprintf(str, slen, "%s",  r->name);
 
-      else if (!str_cmp(field, "sector"))
+      else if (field_id == DGF_SECTOR)
         sprinttype(r->sector_type, sector_types, str, slen);
 
-      else if (!str_cmp(field, "vnum")) {
+      else if (field_id == DGF_VNUM) {
         if (subfield && *subfield) {
           snprintf(str, slen, "%d", (int)(r->number == atoi(subfield)));
         } else {
           snprintf(str, slen,"%d",r->number);
         }
-      } else if (!str_cmp(field, "contents")) {
+      } else if (field_id == DGF_CONTENTS) {
         if (subfield && *subfield) {
           for (obj = r->contents; obj; obj = obj->next_content) {
             if (GET_OBJ_VNUM(obj) == atoi(subfield)) {
@@ -1416,20 +1569,20 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
         }
       }
 
-      else if (!str_cmp(field, "people")) {
+      else if (field_id == DGF_PEOPLE) {
         if (r->people)
           snprintf(str, slen, "%c%ld", UID_CHAR, char_script_id(r->people));
         else
           *str = '\0';
       }
-      else if (!str_cmp(field, "id")) {
+      else if (field_id == DGF_ID) {
         room_rnum rnum = real_room(r->number);
         if (rnum != NOWHERE)
           snprintf(str, slen, "%ld", room_script_id(world + rnum));
         else
           *str = '\0';
       }
-      else if (!str_cmp(field, "weather")) {
+      else if (field_id == DGF_WEATHER) {
         const char *sky_look[] = {
           "sunny",
           "cloudy",
@@ -1442,7 +1595,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
         else
           *str = '\0';
       }
-      else if (!str_cmp(field, "hasattached")) {
+      else if (field_id == DGF_HASATTACHED) {
         if (!(subfield && *subfield))
           *str = '\0';
         else {
@@ -1450,11 +1603,11 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           snprintf(str, slen, "%d", trig_is_attached(SCRIPT(r), i));
         }
       }
-      else if (!str_cmp(field, "zonenumber"))
+      else if (field_id == DGF_ZONENUMBER)
         snprintf(str, slen, "%d",  zone_table[r->zone].number);
-      else if (!str_cmp(field, "zonename"))
+      else if (field_id == DGF_ZONENAME)
         snprintf(str, slen, "%s",  zone_table[r->zone].name);
-      else if (!str_cmp(field, "roomflag")) {
+      else if (field_id == DGF_ROOMFLAG) {
         if (subfield && *subfield) {
           room_rnum thisroom = real_room(r->number);
           if (check_flags_by_name_ar(ROOM_FLAGS(thisroom), NUM_ROOM_FLAGS, subfield, room_bits) == TRUE)
@@ -1464,7 +1617,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
         } else
           snprintf(str, slen, "0");
       }
-      else if (!str_cmp(field, "north")) {
+      else if (field_id == DGF_NORTH) {
         if (R_EXIT(r, NORTH)) {
           if (subfield && *subfield) {
             if (!str_cmp(subfield, "vnum"))
@@ -1484,7 +1637,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
         } else
           *str = '\0';
       }
-      else if (!str_cmp(field, "east")) {
+      else if (field_id == DGF_EAST) {
         if (R_EXIT(r, EAST)) {
           if (subfield && *subfield) {
             if (!str_cmp(subfield, "vnum"))
@@ -1504,7 +1657,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
         } else
           *str = '\0';
       }
-      else if (!str_cmp(field, "south")) {
+      else if (field_id == DGF_SOUTH) {
         if (R_EXIT(r, SOUTH)) {
           if (subfield && *subfield) {
             if (!str_cmp(subfield, "vnum"))
@@ -1524,7 +1677,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
         } else
           *str = '\0';
       }
-      else if (!str_cmp(field, "west")) {
+      else if (field_id == DGF_WEST) {
         if (R_EXIT(r, WEST)) {
           if (subfield && *subfield) {
             if (!str_cmp(subfield, "vnum"))
@@ -1544,7 +1697,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
         } else
           *str = '\0';
       }
-      else if (!str_cmp(field, "up")) {
+      else if (field_id == DGF_UP) {
         if (R_EXIT(r, UP)) {
           if (subfield && *subfield) {
             if (!str_cmp(subfield, "vnum"))
@@ -1564,7 +1717,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
         } else
           *str = '\0';
       }
-      else if (!str_cmp(field, "down")) {
+      else if (field_id == DGF_DOWN) {
         if (R_EXIT(r, DOWN)) {
           if (subfield && *subfield) {
             if (!str_cmp(subfield, "vnum"))
@@ -1586,9 +1739,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
       }
       else {
         if (SCRIPT(r)) { /* check for global var */
-          for (vd = (SCRIPT(r))->global_vars; vd; vd = vd->next)
-            if (!str_cmp(vd->name, field))
-              break;
+          vd = find_var((SCRIPT(r))->global_vars, field);
           if (vd)
             snprintf(str, slen, "%s", vd->value);
           else {
@@ -20,6 +20,7 @@
 #include "constants.h"
 #include "genzon.h" /* for zone_rnum real_zone_by_thing */
 #include "fight.h"  /* for die() */
+#include "pathfind.h"
 
 /* Local functions, macros, defines and structs */
 
@@ -249,6 +250,7 @@ WCMD(do_wdoor)
                 free(newexit->keyword);
             free(newexit);
             rm->dir_option[dir] = NULL;
+            pathfind_world_changed();
         }
     }
 
@@ -279,9 +281,10 @@ WCMD(do_wdoor)
             strcpy(newexit->keyword, value);
             break;
         case 5:  /* room        */
-            if ((to_room = real_room(atoi(value))) != NOWHERE)
+            if ((to_room = real_room(atoi(value))) != NOWHERE) {
                 newexit->to_room = to_room;
-            else
+                pathfind_world_changed();
+            } else
                 wld_log(room, "wdoor: invalid door target");
             break;
         }
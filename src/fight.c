@@ -26,6 +26,7 @@
 #include "shop.h"
 #include "quest.h"
 #include "criticalhits.h"
+#include "profiler.h"
 
 #define PVP_GLORY_COOLDOWN 600 /* seconds */
 
@@ -336,8 +337,7 @@ void set_fighting(struct char_data *ch, struct char_data *vict)
     return;
   }
 
-  ch->next_fighting = combat_list;
-  combat_list = ch;
+  LINK_HEAD(ch, combat_list, next_fighting, prev_fighting);
 
   if (AFF_FLAGGED(ch, AFF_SLEEP))
     affect_from_char(ch, SPELL_SLEEP);
@@ -352,12 +352,10 @@ void set_fighting(struct char_data *ch, struct char_data *vict)
 /* remove a char from the list of fighting chars */
 void stop_fighting(struct char_data *ch)
 {
-  struct char_data *temp;
-
   if (ch == next_combat_list)
     next_combat_list = ch->next_fighting;
 
-  REMOVE_FROM_LIST(ch, combat_list, next_fighting);
+  UNLINK_HEAD(ch, combat_list, next_fighting, prev_fighting);
   ch->next_fighting = NULL;
   FIGHTING(ch) = NULL;
   GET_POS(ch) = POS_STANDING;
@@ -1480,7 +1478,7 @@ void perform_violence(void)
 
     if (MOB_FLAGGED(ch, MOB_SPEC) && GET_MOB_SPEC(ch) && !MOB_FLAGGED(ch, MOB_NOTDEADYET)) {
       char actbuf[MAX_INPUT_LENGTH] = "";
-      (GET_MOB_SPEC(ch)) (ch, ch, 0, actbuf);
+      profile_special(GET_MOB_SPEC(ch), ch, ch, 0, actbuf);
     }
   }
 }
@@ -19,7 +19,7 @@
 #include "spells.h"
 
 /* local functions */
-static void extract_mobile_all(mob_vnum vnum);
+static void extract_mobile_all(mob_rnum i);
 
 int add_mobile(struct char_data *mob, mob_vnum vnum)
 {
@@ -32,9 +32,8 @@ int add_mobile(struct char_data *mob, mob_vnum vnum)
     copy_mobile(&mob_proto[rnum], mob);
 
     /* Now re-point all existing mobile strings to here. */
-    for (live_mob = character_list; live_mob; live_mob = live_mob->next)
-      if (rnum == live_mob->nr)
-        update_mobile_strings(live_mob, &mob_proto[rnum]);
+    for (live_mob = mob_index[rnum].mobs; live_mob; live_mob = live_mob->next_proto)
+      update_mobile_strings(live_mob, &mob_proto[rnum]);
 
     add_to_save_list(zone_table[real_zone_by_thing(vnum)].number, SL_MOB);
     log("GenOLC: add_mobile: Updated existing mobile #%d.", vnum);
@@ -53,6 +52,7 @@ int add_mobile(struct char_data *mob, mob_vnum vnum)
       mob_index[i].vnum = vnum;
       mob_index[i].number = 0;
       mob_index[i].func = 0;
+      mob_index[i].mobs = NULL;
       found = i;
       break;
     }
@@ -67,6 +67,7 @@ int add_mobile(struct char_data *mob, mob_vnum vnum)
     mob_index[0].vnum = vnum;
     mob_index[0].number = 0;
     mob_index[0].func = 0;
+    mob_index[0].mobs = NULL;
   }
 
   log("GenOLC: add_mobile: Added mobile %d at index #%d.", vnum, found);
@@ -99,42 +100,41 @@ int copy_mobile(struct char_data *to, struct char_data *from)
   return TRUE;
 }
 
-static void extract_mobile_all(mob_vnum vnum)
+static void extract_mobile_all(mob_rnum i)
 {
-  struct char_data *next, *ch;
-  int i;
-
-  for (ch = character_list; ch; ch = next) {
-    next = ch->next;
-    if (GET_MOB_VNUM(ch) == vnum) {
-			if ((i = GET_MOB_RNUM(ch)) != NOBODY) {
-	    if (ch->player.name && ch->player.name != mob_proto[i].player.name)
-          free(ch->player.name);
-				ch->player.name = NULL;
-				
-        if (ch->player.title && ch->player.title != mob_proto[i].player.title)
-          free(ch->player.title);
-				ch->player.title = NULL;
-				
-        if (ch->player.short_descr && ch->player.short_descr != mob_proto[i].player.short_descr)
-          free(ch->player.short_descr);
-				ch->player.short_descr = NULL;
-				
-        if (ch->player.long_descr && ch->player.long_descr != mob_proto[i].player.long_descr)
-          free(ch->player.long_descr);
-				ch->player.long_descr = NULL;
-				
-        if (ch->player.description && ch->player.description != mob_proto[i].player.description)
-          free(ch->player.description);
-				ch->player.description = NULL;
-    
-        /* free script proto list if it's not the prototype */
-        if (ch->proto_script && ch->proto_script != mob_proto[i].proto_script)
-          free_proto_script(ch, MOB_TRIGGER);			
-				ch->proto_script = NULL;
-			}
-      extract_char(ch);
-		}
+  struct char_data *ch;
+
+  /* Each mob leaves the prototype's list here rather than when it is finally
+   * extracted, since by then the index entry will belong to another mob. */
+  while ((ch = mob_index[i].mobs) != NULL) {
+    UNLINK_HEAD(ch, mob_index[i].mobs, next_proto, prev_proto);
+
+    if (ch->player.name && ch->player.name != mob_proto[i].player.name)
+      free(ch->player.name);
+    ch->player.name = NULL;
+
+    if (ch->player.title && ch->player.title != mob_proto[i].player.title)
+      free(ch->player.title);
+    ch->player.title = NULL;
+
+    if (ch->player.short_descr && ch->player.short_descr != mob_proto[i].player.short_descr)
+      free(ch->player.short_descr);
+    ch->player.short_descr = NULL;
+
+    if (ch->player.long_descr && ch->player.long_descr != mob_proto[i].player.long_descr)
+      free(ch->player.long_descr);
+    ch->player.long_descr = NULL;
+
+    if (ch->player.description && ch->player.description != mob_proto[i].player.description)
+      free(ch->player.description);
+    ch->player.description = NULL;
+
+    /* free script proto list if it's not the prototype */
+    if (ch->proto_script && ch->proto_script != mob_proto[i].proto_script)
+      free_proto_script(ch, MOB_TRIGGER);
+    ch->proto_script = NULL;
+
+    extract_char(ch);
   }
 }
 
@@ -158,7 +158,7 @@ int delete_mobile(mob_rnum refpt)
   vnum = mob_index[refpt].vnum;
   proto = &mob_proto[refpt];
   
-  extract_mobile_all(vnum);
+  extract_mobile_all(refpt);
   extract_char(proto);
 
   for (counter = refpt; counter < top_of_mobt; counter++) {
@@ -30,6 +30,9 @@ obj_rnum add_object(struct obj_data *newobj, obj_vnum ovnum)
   int found = NOTHING;
   zone_rnum rznum = real_zone_by_thing(ovnum);
 
+  /* Shops may think differently of the new prototype. */
+  shop_forget_trades();
+
   /* Write object to internal tables. */
   if ((newobj->item_number = real_object(ovnum)) != NOTHING) {
     copy_object(&obj_proto[newobj->item_number], newobj);
@@ -44,19 +47,15 @@ obj_rnum add_object(struct obj_data *newobj, obj_vnum ovnum)
   return found;
 }
 
-/* Fix all existing objects to have these values. We need to run through each
- * and every object currently in the game to see which ones are pointing to
- * this prototype. If object is pointing to this prototype, then we need to
- * replace it with the new one. */
+/* Fix all existing objects to have these values. The prototype's own list
+ * holds every object currently in the game that points to it, and each one
+ * is replaced with the new version. */
 static int update_all_objects(struct obj_data *refobj)
 {
   struct obj_data *obj, swap;
   int count = 0;
 
-  for (obj = object_list; obj; obj = obj->next) {
-    if (obj->item_number != refobj->item_number)
-      continue;
-
+  for (obj = obj_index[refobj->item_number].objs; obj; obj = obj->next_proto) {
     count++;
 
     /* Update the existing object but save a copy for private information. */
@@ -72,7 +71,11 @@ static int update_all_objects(struct obj_data *refobj)
     obj->in_obj = swap.in_obj;
     obj->contains = swap.contains;
     obj->next_content = swap.next_content;
+    obj->prev_content = swap.prev_content;
     obj->next = swap.next;
+    obj->prev = swap.prev;
+    obj->next_proto = swap.next_proto;
+    obj->prev_proto = swap.prev_proto;
     obj->sitting_here = swap.sitting_here;
   }
 
@@ -169,6 +172,7 @@ obj_rnum index_object(struct obj_data *obj, obj_vnum ovnum, obj_rnum ornum)
   obj_index[ornum].vnum = ovnum;
   obj_index[ornum].number = 0;
   obj_index[ornum].func = NULL;
+  obj_index[ornum].objs = NULL;
 
   copy_object_preserve(&obj_proto[ornum], obj);
   obj_proto[ornum].in_room = NOWHERE;
@@ -384,7 +388,7 @@ int delete_object(obj_rnum rnum)
 {
   obj_rnum i;
   zone_rnum zrnum;
-  struct obj_data *obj, *tmp, *next_obj;
+  struct obj_data *obj, *tmp;
   int shop, j, zone, cmd_no;
 
   if (rnum == NOTHING || rnum > top_of_objt)
@@ -397,11 +401,7 @@ int delete_object(obj_rnum rnum)
   /* This is something you might want to read about in the logs. */
   log("GenOLC: delete_object: Deleting object #%d (%s).", GET_OBJ_VNUM(obj), obj->short_description);
 
-  for (tmp = object_list; tmp; tmp = next_obj) {
-	next_obj = tmp->next;
-    if (tmp->item_number != obj->item_number)
-      continue;
-
+  while ((tmp = obj_index[rnum].objs) != NULL) {
     /* extract_obj() will just axe contents. */
     if (tmp->contains) {
       struct obj_data *this_content, *next_content;
@@ -452,6 +452,7 @@ int delete_object(obj_rnum rnum)
   for (shop = 0; shop <= top_shop; shop++)
     for (j = 0; SHOP_PRODUCT(shop, j) != NOTHING; j++)
       SHOP_PRODUCT(shop, j) -= (SHOP_PRODUCT(shop, j) > rnum);
+  shop_forget_trades();
 
   /* Renumber zone table. */
   for (zone = 0; zone <= top_of_zone_table; zone++) {
@@ -47,6 +47,12 @@ void copy_shop(struct shop_data *tshop, struct shop_data *fshop, int free_old_st
   copy_shop_list(&(S_PRODUCTS(tshop)), S_PRODUCTS(fshop));
   copy_shop_type_list(&(tshop->type), fshop->type);
 
+  /* What the shop used to buy no longer applies. */
+  if (free_old_strings && tshop->trade_cache)
+    free(tshop->trade_cache);
+  tshop->trade_cache = NULL;
+  tshop->trade_cache_size = 0;
+
   /* Copy notification strings over. */
   if (free_old_strings)
     free_shop_strings(tshop);
@@ -100,6 +106,8 @@ static void copy_shop_type_list(struct shop_buy_data **tlist, struct shop_buy_da
     (*tlist)[i].type = flist[i].type;
     if (BUY_WORD(flist[i]))
       BUY_WORD((*tlist)[i]) = strdup(BUY_WORD(flist[i]));
+    if (BUY_TYPE(flist[i]) != NOTHING)
+      compile_buy_word(&(*tlist)[i]);
   }
 }
 
@@ -120,7 +128,7 @@ void remove_shop_from_type_list(struct shop_buy_data **list, int num)
   for (i = 0; i < num_items; i++)
     nlist[i] = (i < num) ? (*list)[i] : (*list)[i + 1];
 
-  free(BUY_WORD((*list)[num]));
+  free_buy_word(&(*list)[num]);
   free(*list);
   *list = nlist;
 }
@@ -231,8 +239,7 @@ static void free_shop_type_list(struct shop_buy_data **list)
   int i;
 
   for (i = 0; (*list)[i].type != NOTHING; i++)
-    if (BUY_WORD((*list)[i]))
-      free(BUY_WORD((*list)[i]));
+    free_buy_word(&(*list)[i]);
 
   free(*list);
   *list = NULL;
@@ -245,6 +252,8 @@ void free_shop(struct shop_data *shop)
   free_shop_type_list(&(S_NAMELISTS(shop)));
   free(S_ROOMS(shop));
   free(S_PRODUCTS(shop));
+  if (shop->trade_cache)
+    free(shop->trade_cache);
   free(shop);
 }
 
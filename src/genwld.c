@@ -18,6 +18,7 @@
 #include "shop.h"
 #include "dg_olc.h"
 #include "mud_event.h"
+#include "pathfind.h"
 
 
 /* This function will copy the strings so be sure you free your own copies of 
@@ -41,6 +42,7 @@ room_rnum add_room(struct room_data *room)
     world[i].people = tch;
     world[i].contents = tobj;
     add_to_save_list(zone_table[room->zone].number, SL_WLD);
+    pathfind_world_changed();
     log("GenOLC: add_room: Updated existing room #%d.", room->number);
     return i;
   }
@@ -114,6 +116,7 @@ room_rnum add_room(struct room_data *room)
   } while (i > 0);
 
   add_to_save_list(zone_table[room->zone].number, SL_WLD);
+  pathfind_world_changed();
 
   /* Return what array entry we placed the new room in. */
   return found;
@@ -257,6 +260,7 @@ int delete_room(room_rnum rnum)
 
   top_of_world--;
   RECREATE(world, struct room_data, top_of_world + 1);
+  pathfind_world_changed();
 
   return TRUE;
 }
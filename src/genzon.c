@@ -202,6 +202,9 @@ rznum = i;
   zone->reset_mode = 2;
   zone->min_level = -1;
   zone->max_level = -1;
+  zone->num_players = 0;
+  zone->empty_minutes = 0;
+  zone->dormant = FALSE;
 
   for (i=0; i<ZN_ARRAY_MAX; i++)  zone->zone_flags[i] = 0;
 
@@ -21,123 +21,9 @@
 #include "constants.h"
 #include "graph.h"
 #include "fight.h"
+#include "pathfind.h"
 
-/* local functions */
-static int VALID_EDGE(room_rnum x, int y);
-static void bfs_enqueue(room_rnum room, int dir);
-static void bfs_dequeue(void);
-static void bfs_clear_queue(void);
-static int find_first_step(room_rnum src, room_rnum target);
-
-struct bfs_queue_struct {
-  room_rnum room;
-  char dir;
-  struct bfs_queue_struct *next;
-};
-
-static struct bfs_queue_struct *queue_head = 0, *queue_tail = 0;
-
-/* Utility macros */
-#define MARK(room)	(SET_BIT_AR(ROOM_FLAGS(room), ROOM_BFS_MARK))
-#define UNMARK(room)	(REMOVE_BIT_AR(ROOM_FLAGS(room), ROOM_BFS_MARK))
-#define IS_MARKED(room)	(ROOM_FLAGGED(room, ROOM_BFS_MARK))
-#define TOROOM(x, y)	(world[(x)].dir_option[(y)]->to_room)
-#define IS_CLOSED(x, y)	(EXIT_FLAGGED(world[(x)].dir_option[(y)], EX_CLOSED))
-
-static int VALID_EDGE(room_rnum x, int y)
-{
-  if (world[x].dir_option[y] == NULL || TOROOM(x, y) == NOWHERE)
-    return 0;
-  if (CONFIG_TRACK_T_DOORS == FALSE && IS_CLOSED(x, y))
-    return 0;
-  if (ROOM_FLAGGED(TOROOM(x, y), ROOM_NOTRACK) || IS_MARKED(TOROOM(x, y)))
-    return 0;
-
-  return 1;
-}
-
-static void bfs_enqueue(room_rnum room, int dir)
-{
-  struct bfs_queue_struct *curr;
-
-  CREATE(curr, struct bfs_queue_struct, 1);
-  curr->room = room;
-  curr->dir = dir;
-  curr->next = 0;
-
-  if (queue_tail) {
-    queue_tail->next = curr;
-    queue_tail = curr;
-  } else
-    queue_head = queue_tail = curr;
-}
-
-static void bfs_dequeue(void)
-{
-  struct bfs_queue_struct *curr;
-
-  curr = queue_head;
-
-  if (!(queue_head = queue_head->next))
-    queue_tail = 0;
-  free(curr);
-}
-
-static void bfs_clear_queue(void)
-{
-  while (queue_head)
-    bfs_dequeue();
-}
-
-/* find_first_step: given a source room and a target room, find the first step 
- * on the shortest path from the source to the target. Intended usage: in 
- * mobile_activity, give a mob a dir to go if they're tracking another mob or a
- * PC.  Or, a 'track' skill for PCs. */
-static int find_first_step(room_rnum src, room_rnum target)
-{
-  int curr_dir;
-  room_rnum curr_room;
-
-  if (src == NOWHERE || target == NOWHERE || src > top_of_world || target > top_of_world) {
-    log("SYSERR: Illegal value %d or %d passed to find_first_step. (%s)", src, target, __FILE__);
-    return (BFS_ERROR);
-  }
-  if (src == target)
-    return (BFS_ALREADY_THERE);
-
-  /* clear marks first, some OLC systems will save the mark. */
-  for (curr_room = 0; curr_room <= top_of_world; curr_room++)
-    UNMARK(curr_room);
-
-  MARK(src);
-
-  /* first, enqueue the first steps, saving which direction we're going. */
-  for (curr_dir = 0; curr_dir < DIR_COUNT; curr_dir++)
-    if (VALID_EDGE(src, curr_dir)) {
-      MARK(TOROOM(src, curr_dir));
-      bfs_enqueue(TOROOM(src, curr_dir), curr_dir);
-    }
-
-  /* now, do the classic BFS. */
-  while (queue_head) {
-    if (queue_head->room == target) {
-      curr_dir = queue_head->dir;
-      bfs_clear_queue();
-      return (curr_dir);
-    } else {
-      for (curr_dir = 0; curr_dir < DIR_COUNT; curr_dir++)
-	if (VALID_EDGE(queue_head->room, curr_dir)) {
-	  MARK(TOROOM(queue_head->room, curr_dir));
-	  bfs_enqueue(TOROOM(queue_head->room, curr_dir), queue_head->dir);
-	}
-      bfs_dequeue();
-    }
-  }
-
-  return (BFS_NO_PATH);
-}
-
-/* Functions and Commands which use the above functions. */
+/* Commands which use the route finder in pathfind.c. */
 ACMD(do_track)
 {
   char arg[MAX_INPUT_LENGTH];
@@ -177,7 +63,7 @@ ACMD(do_track)
   }
 
   /* They passed the skill check. */
-  dir = find_first_step(IN_ROOM(ch), IN_ROOM(vict));
+  dir = path_next_step(&TRACK_PATH(ch), IN_ROOM(ch), IN_ROOM(vict), PATHF_ASTAR);
 
   switch (dir) {
   case BFS_ERROR:
@@ -216,7 +102,7 @@ void hunt_victim(struct char_data *ch)
     HUNTING(ch) = NULL;
     return;
   }
-  if ((dir = find_first_step(IN_ROOM(ch), IN_ROOM(HUNTING(ch)))) < 0) {
+  if ((dir = path_next_step(&TRACK_PATH(ch), IN_ROOM(ch), IN_ROOM(HUNTING(ch)), PATHF_ASTAR)) < 0) {
     char buf[MAX_INPUT_LENGTH];
 
     snprintf(buf, sizeof(buf), "Damn!  I lost %s!", HMHR(HUNTING(ch)));
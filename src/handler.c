@@ -27,7 +27,7 @@
 #include "race.h"
 
 /* local file scope variables */
-static int extractions_pending = 0;
+static struct char_data *extract_list = NULL; /* chars waiting for extract_pending_chars() */
 
 /* local file scope functions */
 static int apply_ac(struct char_data *ch, int eq_pos);
@@ -446,8 +446,6 @@ void affect_join(struct char_data *ch, struct affected_type *af,
 /* move a player out of a room */
 void char_from_room(struct char_data *ch)
 {
-  struct char_data *temp;
-
   if (ch == NULL || IN_ROOM(ch) == NOWHERE) {
     log("SYSERR: NULL character or NOWHERE in %s, char_from_room", __FILE__);
     exit(1);
@@ -463,11 +461,65 @@ void char_from_room(struct char_data *ch)
       if (GET_OBJ_VAL(GET_EQ(ch, WEAR_LIGHT), 2))	/* Light is ON */
 	world[IN_ROOM(ch)].light--;
 
-  REMOVE_FROM_LIST(ch, world[IN_ROOM(ch)].people, next_in_room);
+  UNLINK_HEAD(ch, world[IN_ROOM(ch)].people, next_in_room, prev_in_room);
+  if (ch->char_specials.zone_counted) {
+    zone_table[world[IN_ROOM(ch)].zone].num_players--;
+    ch->char_specials.zone_counted = FALSE;
+  }
   IN_ROOM(ch) = NOWHERE;
   ch->next_in_room = NULL;
 }
 
+/* Whether ch keeps its zone from being empty; see is_empty().  Only a
+ * character someone is playing counts: not a linkdead player, not a builder
+ * sitting in OLC, and not the body of a switched immortal, though the mobile
+ * they drive does.  Immortals with nohassle on can watch a zone without it
+ * noticing them. */
+int counts_as_zone_player(struct char_data *ch)
+{
+  if (!ch->desc || STATE(ch->desc) != CON_PLAYING)
+    return FALSE;
+  if (!IS_NPC(ch) && GET_LEVEL(ch) >= LVL_IMMORT && PRF_FLAGGED(ch, PRF_NOHASSLE))
+    return FALSE;
+  return TRUE;
+}
+
+/* Call after changing anything counts_as_zone_player() looks at. */
+void update_zone_player(struct char_data *ch)
+{
+  int counts;
+
+  if (IN_ROOM(ch) == NOWHERE)
+    return;
+
+  counts = counts_as_zone_player(ch);
+  if (counts == ch->char_specials.zone_counted)
+    return;
+
+  zone_table[world[IN_ROOM(ch)].zone].num_players += counts ? 1 : -1;
+  ch->char_specials.zone_counted = counts;
+  if (counts && zone_table[world[IN_ROOM(ch)].zone].dormant)
+    wake_zone(world[IN_ROOM(ch)].zone);
+}
+
+/* Whether the mobile ch is left alone because its zone is dormant.  Mobiles
+ * with special procedures or global triggers are meant to carry on without
+ * an audience, and ones that are fighting, hunting or hurting themselves are
+ * in the middle of something wake_mobile() could not finish for them. */
+int mobile_dormant(struct char_data *ch)
+{
+  if (!IS_NPC(ch) || IN_ROOM(ch) == NOWHERE ||
+      !zone_table[world[IN_ROOM(ch)].zone].dormant)
+    return FALSE;
+  if (MOB_FLAGGED(ch, MOB_SPEC) || SCRIPT_CHECK(ch, MTRIG_GLOBAL))
+    return FALSE;
+  if (FIGHTING(ch) || HUNTING(ch) || GET_POS(ch) < POS_STUNNED)
+    return FALSE;
+  if (AFF_FLAGGED(ch, AFF_POISON) || affected_by_spell(ch, SPELL_CORRUPTION))
+    return FALSE;
+  return TRUE;
+}
+
 /* place a character in a room */
 void char_to_room(struct char_data *ch, room_rnum room)
 {
@@ -475,10 +527,16 @@ void char_to_room(struct char_data *ch, room_rnum room)
     log("SYSERR: Illegal value(s) passed to char_to_room. (Room: %d/%d Ch: %p",
 		room, top_of_world, (void *)ch);
   else {
-    ch->next_in_room = world[room].people;
-    world[room].people = ch;
+    LINK_HEAD(ch, world[room].people, next_in_room, prev_in_room);
     IN_ROOM(ch) = room;
 
+    if (counts_as_zone_player(ch)) {
+      zone_table[world[room].zone].num_players++;
+      ch->char_specials.zone_counted = TRUE;
+      if (zone_table[world[room].zone].dormant)
+        wake_zone(world[room].zone);
+    }
+
     autoquest_trigger_check(ch, 0, 0, AQ_ROOM_FIND);
     autoquest_trigger_check(ch, 0, 0, AQ_MOB_FIND);
 
@@ -499,8 +557,7 @@ void char_to_room(struct char_data *ch, room_rnum room)
 void obj_to_char(struct obj_data *object, struct char_data *ch)
 {
   if (object && ch) {
-    object->next_content = ch->carrying;
-    ch->carrying = object;
+    LINK_HEAD(object, ch->carrying, next_content, prev_content);
     object->carried_by = ch;
     IN_ROOM(object) = NOWHERE;
     IS_CARRYING_W(ch) += GET_OBJ_WEIGHT(object);
@@ -518,13 +575,11 @@ void obj_to_char(struct obj_data *object, struct char_data *ch)
 /* take an object from a char */
 void obj_from_char(struct obj_data *object)
 {
-  struct obj_data *temp;
-
   if (object == NULL) {
     log("SYSERR: NULL object passed to obj_from_char.");
     return;
   }
-  REMOVE_FROM_LIST(object, object->carried_by->carrying, next_content);
+  UNLINK_HEAD(object, object->carried_by->carrying, next_content, prev_content);
 
   /* set flag for crash-save system, but not on mobs! */
   if (!IS_NPC(object->carried_by))
@@ -701,16 +756,14 @@ struct obj_data *get_obj_in_list_num(int num, struct obj_data *list)
   return (NULL);
 }
 
-/* search the entire world for an object number, and return a pointer  */
+/* search the entire world for an object number, and return a pointer.  The
+ * newest instance heads its prototype's list, as it does the object list. */
 struct obj_data *get_obj_num(obj_rnum nr)
 {
-  struct obj_data *i;
-
-  for (i = object_list; i; i = i->next)
-    if (GET_OBJ_RNUM(i) == nr)
-      return (i);
+  if (nr == NOTHING || nr > top_of_objt)
+    return (NULL);
 
-  return (NULL);
+  return (obj_index[nr].objs);
 }
 
 /* search a room for a char, and return a pointer if found..  */
@@ -738,13 +791,10 @@ struct char_data *get_char_room(char *name, int *number, room_rnum room)
 /* search all over the world for a char num, and return a pointer if found */
 struct char_data *get_char_num(mob_rnum nr)
 {
-  struct char_data *i;
-
-  for (i = character_list; i; i = i->next)
-    if (GET_MOB_RNUM(i) == nr)
-      return (i);
+  if (nr == NOBODY || nr > top_of_mobt)
+    return (NULL);
 
-  return (NULL);
+  return (mob_index[nr].mobs);
 }
 
 /* put an object in a room */
@@ -755,6 +805,7 @@ void obj_to_room(struct obj_data *object, room_rnum room)
 	room, top_of_world, (void *)object);
   }
   else {
+    object->prev_content = NULL;
     if (world[room].contents == NULL){  // if list is empty
       world[room].contents = object; // add object to list
     }
@@ -762,6 +813,7 @@ void obj_to_room(struct obj_data *object, room_rnum room)
       struct obj_data *i = world[room].contents; // define a temporary pointer
       while (i->next_content != NULL) i = i->next_content; // find the first without a next_content
         i->next_content = object; // add object at the end
+      object->prev_content = i;
     }
     object->next_content = NULL; // mostly for sanity. should do nothing.
     IN_ROOM(object) = room;
@@ -774,7 +826,6 @@ void obj_to_room(struct obj_data *object, room_rnum room)
 /* Take an object from a room */
 void obj_from_room(struct obj_data *object)
 {
-  struct obj_data *temp;
   struct char_data *t, *tempch;
 
   if (!object || IN_ROOM(object) == NOWHERE) {
@@ -792,7 +843,7 @@ void obj_from_room(struct obj_data *object)
     }
   }
 
-  REMOVE_FROM_LIST(object, world[IN_ROOM(object)].contents, next_content);
+  UNLINK_HEAD(object, world[IN_ROOM(object)].contents, next_content, prev_content);
 
   if (ROOM_FLAGGED(IN_ROOM(object), ROOM_HOUSE))
     SET_BIT_AR(ROOM_FLAGS(IN_ROOM(object)), ROOM_HOUSE_CRASH);
@@ -811,8 +862,7 @@ void obj_to_obj(struct obj_data *obj, struct obj_data *obj_to)
     return;
   }
 
-  obj->next_content = obj_to->contains;
-  obj_to->contains = obj;
+  LINK_HEAD(obj, obj_to->contains, next_content, prev_content);
   obj->in_obj = obj_to;
 
   /* Add weight to container, unless unlimited. */
@@ -837,7 +887,7 @@ void obj_from_obj(struct obj_data *obj)
     return;
   }
   obj_from = obj->in_obj;
-  REMOVE_FROM_LIST(obj, obj_from->contains, next_content);
+  UNLINK_HEAD(obj, obj_from->contains, next_content, prev_content);
 
   /* Subtract weight from containers container unless unlimited. */
   if (GET_OBJ_VAL(obj->in_obj, 0) > 0) {
@@ -867,7 +917,6 @@ void object_list_new_owner(struct obj_data *list, struct char_data *ch)
 void extract_obj(struct obj_data *obj)
 {
   struct char_data *ch, *next = NULL;
-  struct obj_data *temp;
 
   if (obj->worn_by != NULL)
     if (unequip_char(obj->worn_by, obj->worn_on) != obj)
@@ -894,10 +943,12 @@ void extract_obj(struct obj_data *obj)
   while (obj->contains)
     extract_obj(obj->contains);
 
-  REMOVE_FROM_LIST(obj, object_list, next);
+  UNLINK_HEAD(obj, object_list, next, prev);
 
-  if (GET_OBJ_RNUM(obj) != NOTHING)
+  if (GET_OBJ_RNUM(obj) != NOTHING) {
     (obj_index[GET_OBJ_RNUM(obj)].number)--;
+    UNLINK_HEAD(obj, obj_index[GET_OBJ_RNUM(obj)].objs, next_proto, prev_proto);
+  }
 
   if (SCRIPT(obj))
     extract_script(obj, OBJ_TRIGGER);
@@ -1051,8 +1102,10 @@ void extract_char_final(struct char_data *ch)
   char_from_room(ch);
 
   if (IS_NPC(ch)) {
-    if (GET_MOB_RNUM(ch) != NOTHING)	/* prototyped */
+    if (GET_MOB_RNUM(ch) != NOTHING) {	/* prototyped */
       mob_index[GET_MOB_RNUM(ch)].number--;
+      UNLINK_HEAD(ch, mob_index[GET_MOB_RNUM(ch)].mobs, next_proto, prev_proto);
+    }
     clearMemory(ch);
 
     if (SCRIPT(ch))
@@ -1085,55 +1138,107 @@ void extract_char(struct char_data *ch)
   char_from_furniture(ch);
   clear_char_event_list(ch);
 
-  if (IS_NPC(ch) && !MOB_FLAGGED(ch, MOB_NOTDEADYET)) {
+  if (IS_NPC(ch) && !MOB_FLAGGED(ch, MOB_NOTDEADYET))
     SET_BIT_AR(MOB_FLAGS(ch), MOB_NOTDEADYET);
-    ++extractions_pending;
-  }
-  else if (!IS_NPC(ch) && !PLR_FLAGGED(ch, PLR_NOTDEADYET)) {
+  else if (!IS_NPC(ch) && !PLR_FLAGGED(ch, PLR_NOTDEADYET))
     SET_BIT_AR(PLR_FLAGS(ch), PLR_NOTDEADYET);
-    ++extractions_pending;
-  }
+  else
+    return;
+
+  ch->next_extract = extract_list;
+  extract_list = ch;
 }
 
-/* I'm not particularly pleased with the MOB/PLR hoops that have to be jumped
- * through but it hardly calls for a completely new variable. Ideally it would
- * be its own list, but that would change the '->next' pointer, potentially
- * confusing some code. -gg This doesn't handle recursive extractions. */
+/* The characters flagged by extract_char() wait on their own list, so only
+ * they are visited here rather than the whole character_list.  Anything
+ * extracted while this runs is picked up before it returns. */
 void extract_pending_chars(void)
 {
-  struct char_data *vict, *next_vict, *prev_vict;
+  struct char_data *vict;
 
-  if (extractions_pending < 0)
-    log("SYSERR: Negative (%d) extractions pending.", extractions_pending);
-
-  for (vict = character_list, prev_vict = NULL; vict && extractions_pending; vict = next_vict) {
-    next_vict = vict->next;
+  while ((vict = extract_list) != NULL) {
+    extract_list = vict->next_extract;
+    vict->next_extract = NULL;
 
     if (MOB_FLAGGED(vict, MOB_NOTDEADYET))
       REMOVE_BIT_AR(MOB_FLAGS(vict), MOB_NOTDEADYET);
     else if (PLR_FLAGGED(vict, PLR_NOTDEADYET))
       REMOVE_BIT_AR(PLR_FLAGS(vict), PLR_NOTDEADYET);
     else {
-      /* Last non-free'd character to continue chain from. */
-      prev_vict = vict;
+      log("SYSERR: %s is waiting for extraction but is not flagged.", GET_NAME(vict));
       continue;
     }
 
+    UNLINK_HEAD(vict, character_list, next, prev);
     extract_char_final(vict);
-    extractions_pending--;
-
-    if (prev_vict)
-      prev_vict->next = next_vict;
-    else
-      character_list = next_vict;
   }
+}
 
-  if (extractions_pending > 0)
-    log("SYSERR: Couldn't find %d extractions as counted.", extractions_pending);
-
-  extractions_pending = 0;
+/* Walks one world list and complains about the first item whose prev link
+ * does not point back at the item before it, or that claims to be somewhere
+ * else.  Stopping at the first bad link also stops the walk on a cycle. */
+#define CHECK_LIST(type, head, next, prev, belongs, what, where, bad)  \
+  do {                                                                 \
+    type *i_, *last_ = NULL;                                           \
+    for (i_ = (head); i_; last_ = i_, i_ = i_->next)                   \
+      if (i_->prev != last_ || !(belongs)) {                           \
+        log("SYSERR: %s %d: bad %s link.", (what), (int) (where),      \
+          i_->prev != last_ ? "back" : "owner");                       \
+        (bad)++;                                                       \
+        break;                                                         \
+      }                                                                \
+  } while (0)
+
+/* Debugging aid: check that every doubly-linked world list still agrees
+ * with itself in both directions.  Returns the number of broken lists. */
+int check_world_lists(void)
+{
+  struct char_data *ch;
+  struct obj_data *obj;
+  room_rnum rm;
+  mob_rnum mrn;
+  obj_rnum orn;
+  int bad = 0;
+
+  CHECK_LIST(struct char_data, character_list, next, prev, TRUE,
+    "character_list", 0, bad);
+  CHECK_LIST(struct char_data, combat_list, next_fighting, prev_fighting,
+    FIGHTING(i_) != NULL, "combat_list", 0, bad);
+  CHECK_LIST(struct obj_data, object_list, next, prev, TRUE,
+    "object_list", 0, bad);
+
+  for (rm = 0; rm <= top_of_world; rm++) {
+    CHECK_LIST(struct char_data, world[rm].people, next_in_room, prev_in_room,
+      IN_ROOM(i_) == rm, "people of room", world[rm].number, bad);
+    CHECK_LIST(struct obj_data, world[rm].contents, next_content, prev_content,
+      IN_ROOM(i_) == rm, "contents of room", world[rm].number, bad);
+  }
+
+  for (mrn = 0; mrn <= top_of_mobt; mrn++)
+    CHECK_LIST(struct char_data, mob_index[mrn].mobs, next_proto, prev_proto,
+      GET_MOB_RNUM(i_) == mrn, "instances of mob", mob_index[mrn].vnum, bad);
+  for (orn = 0; orn <= top_of_objt; orn++)
+    CHECK_LIST(struct obj_data, obj_index[orn].objs, next_proto, prev_proto,
+      GET_OBJ_RNUM(i_) == orn, "instances of object", obj_index[orn].vnum, bad);
+
+  for (ch = character_list; ch; ch = ch->next)
+    CHECK_LIST(struct obj_data, ch->carrying, next_content, prev_content,
+      i_->carried_by == ch, "inventory of char in room",
+      GET_ROOM_VNUM(IN_ROOM(ch)), bad);
+
+  for (obj = object_list; obj; obj = obj->next)
+    CHECK_LIST(struct obj_data, obj->contains, next_content, prev_content,
+      i_->in_obj == obj, "contents of object", GET_OBJ_VNUM(obj), bad);
+
+  if (bad)
+    mudlog(BRF, LVL_GOD, TRUE, "SYSERR: %d world list%s failed the link check.",
+      bad, bad == 1 ? "" : "s");
+
+  return (bad);
 }
 
+#undef CHECK_LIST
+
 /* Here follows high-level versions of some earlier routines, ie functions
  * which incorporate the actual player-data */
 struct char_data *get_player_vis(struct char_data *ch, char *name, int *number, int inroom)
@@ -53,9 +53,13 @@ struct char_data *get_char_num(mob_rnum nr);
 
 void	char_from_room(struct char_data *ch);
 void	char_to_room(struct char_data *ch, room_rnum room);
+int	counts_as_zone_player(struct char_data *ch);
+void	update_zone_player(struct char_data *ch);
+int	mobile_dormant(struct char_data *ch);
 void	extract_char(struct char_data *ch);
 void	extract_char_final(struct char_data *ch);
 void	extract_pending_chars(void);
+int	check_world_lists(void);
 
 /* find if character can see */
 struct char_data *get_player_vis(struct char_data *ch, char *name, int *number, int inroom);
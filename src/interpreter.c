@@ -39,6 +39,8 @@
 #include "prefedit.h"
 #include "ibt.h"
 #include "mud_event.h"
+#include "cmdtrie.h"
+#include "profiler.h"
 ACMD(do_saudit);
 ACMD(do_shopdisc);
 ACMD(do_pull);
@@ -533,6 +535,8 @@ void sort_commands(void)
     num_of_cmds++;
   num_of_cmds++;  /* \n */
 
+  if (cmd_sort_info)
+    free(cmd_sort_info);
   CREATE(cmd_sort_info, int, num_of_cmds);
 
   for (a = 0; a < num_of_cmds; a++)
@@ -548,7 +552,7 @@ void sort_commands(void)
  * then calls the appropriate function. */
 void command_interpreter(struct char_data *ch, char *argument)
 {
-  int cmd, length;
+  int cmd;
   char *line;
   char arg[MAX_INPUT_LENGTH];
 
@@ -585,42 +589,18 @@ void command_interpreter(struct char_data *ch, char *argument)
        return;
    }
 
-  for (length = strlen(arg), cmd = 0; *complete_cmd_info[cmd].command != '\n'; cmd++)
-    if(complete_cmd_info[cmd].command_pointer != do_action &&
-       !strncmp(complete_cmd_info[cmd].command, arg, length))
-      if (GET_LEVEL(ch) >= complete_cmd_info[cmd].minimum_level)
-        break;
-
-  /* it's not a 'real' command, so it's a social */
-
-  if(*complete_cmd_info[cmd].command == '\n')
-    for (length = strlen(arg), cmd = 0; *complete_cmd_info[cmd].command != '\n'; cmd++)
-      if (complete_cmd_info[cmd].command_pointer == do_action &&
-          !strncmp(complete_cmd_info[cmd].command, arg, length))
-        if (GET_LEVEL(ch) >= complete_cmd_info[cmd].minimum_level)
-          break;
-
-  if (*complete_cmd_info[cmd].command == '\n') {
-    int found = 0;
+  /* Real commands are tried before socials, and the first abbreviation match
+   * the character's level allows wins. */
+  if ((cmd = cmd_trie_lookup(arg, GET_LEVEL(ch))) < 0) {
+    int found[CMD_MAX_SUGGEST], num_found, i;
     send_to_char(ch, "%s", CONFIG_HUH);
 
-    for (cmd = 0; *cmd_info[cmd].command != '\n'; cmd++)
-    {
-      if (*arg != *cmd_info[cmd].command || cmd_info[cmd].minimum_level > GET_LEVEL(ch))
-        continue;
-
-      /* Only apply levenshtein counts if the command is not a trigger command. */
-      if ( (levenshtein_distance(arg, cmd_info[cmd].command) <= 2) &&
-           (cmd_info[cmd].minimum_level >= 0) )
-      {
-        if (!found)
-        {
-          send_to_char(ch, "\r\nDid you mean:\r\n");
-          found = 1;
-        }
-        send_to_char(ch, "  %s\r\n", cmd_info[cmd].command);
-      }
-    }
+    /* Trigger commands (negative levels) are never suggested. */
+    num_found = cmd_trie_suggest(arg, GET_LEVEL(ch), found, CMD_MAX_SUGGEST);
+    if (num_found > 0)
+      send_to_char(ch, "\r\nDid you mean:\r\n");
+    for (i = 0; i < num_found; i++)
+      send_to_char(ch, "  %s\r\n", cmd_info[found[i]].command);
   }
   else if (!IS_NPC(ch) && PLR_FLAGGED(ch, PLR_FROZEN) && GET_LEVEL(ch) < LVL_IMPL)
     send_to_char(ch, "You try, but the mind-numbing cold prevents you...\r\n");
@@ -652,8 +632,13 @@ void command_interpreter(struct char_data *ch, char *argument)
     case POS_FIGHTING:
       send_to_char(ch, "No way!  You're fighting for your life!\r\n");
       break;
-  } else if (no_specials || !special(ch, cmd, line))
-    ((*complete_cmd_info[cmd].command_pointer) (ch, line, cmd, complete_cmd_info[cmd].subcmd));
+  } else {
+    long start = profile_clock();
+
+    if (no_specials || !special(ch, cmd, line))
+      ((*complete_cmd_info[cmd].command_pointer) (ch, line, cmd, complete_cmd_info[cmd].subcmd));
+    profile_add(PROF_COMMAND, cmd, start);
+  }
 }
 
 /* Routines to handle aliasing. */
@@ -1033,13 +1018,7 @@ void half_chop(char *string, char *arg1, char *arg2)
 /* Used in specprocs, mostly.  (Exactly) matches "command" to cmd number */
 int find_command(const char *command)
 {
-  int cmd;
-
-  for (cmd = 0; *complete_cmd_info[cmd].command != '\n'; cmd++)
-    if (!strcmp(complete_cmd_info[cmd].command, command))
-      return (cmd);
-
-  return (-1);
+  return (cmd_trie_exact(command));
 }
 
 int special(struct char_data *ch, int cmd, char *arg)
@@ -1050,31 +1029,31 @@ int special(struct char_data *ch, int cmd, char *arg)
 
   /* special in room? */
   if (GET_ROOM_SPEC(IN_ROOM(ch)) != NULL)
-    if (GET_ROOM_SPEC(IN_ROOM(ch)) (ch, world + IN_ROOM(ch), cmd, arg))
+    if (profile_special(GET_ROOM_SPEC(IN_ROOM(ch)), ch, world + IN_ROOM(ch), cmd, arg))
       return (1);
 
   /* special in equipment list? */
   for (j = 0; j < NUM_WEARS; j++)
     if (GET_EQ(ch, j) && GET_OBJ_SPEC(GET_EQ(ch, j)) != NULL)
-      if (GET_OBJ_SPEC(GET_EQ(ch, j)) (ch, GET_EQ(ch, j), cmd, arg))
+      if (profile_special(GET_OBJ_SPEC(GET_EQ(ch, j)), ch, GET_EQ(ch, j), cmd, arg))
 	return (1);
 
   /* special in inventory? */
   for (i = ch->carrying; i; i = i->next_content)
     if (GET_OBJ_SPEC(i) != NULL)
-      if (GET_OBJ_SPEC(i) (ch, i, cmd, arg))
+      if (profile_special(GET_OBJ_SPEC(i), ch, i, cmd, arg))
 	return (1);
 
   /* special in mobile present? */
   for (k = world[IN_ROOM(ch)].people; k; k = k->next_in_room)
     if (!MOB_FLAGGED(k, MOB_NOTDEADYET))
-      if (GET_MOB_SPEC(k) && GET_MOB_SPEC(k) (ch, k, cmd, arg))
+      if (GET_MOB_SPEC(k) && profile_special(GET_MOB_SPEC(k), ch, k, cmd, arg))
 	return (1);
 
   /* special in object present? */
   for (i = world[IN_ROOM(ch)].contents; i; i = i->next_content)
     if (GET_OBJ_SPEC(i) != NULL)
-      if (GET_OBJ_SPEC(i) (ch, i, cmd, arg))
+      if (profile_special(GET_OBJ_SPEC(i), ch, i, cmd, arg))
 	return (1);
 
   return (0);
@@ -1129,8 +1108,10 @@ static int perform_dupe_check(struct descriptor_data *d)
 	target = k->original;
 	mode = UNSWITCH;
       }
-      if (k->character)
+      if (k->character) {
 	k->character->desc = NULL;
+	update_zone_player(k->character);
+      }
       k->character = NULL;
       k->original = NULL;
     } else if (k->character && GET_IDNUM(k->character) == id && k->original) {
@@ -1335,8 +1316,7 @@ int enter_player_game (struct descriptor_data *d)
   if (!SCRIPT(d->character))
     read_saved_vars(d->character);
 
-  d->character->next = character_list;
-  character_list = d->character;
+  LINK_HEAD(d->character, character_list, next, prev);
   char_to_room(d->character, load_room);
   load_result = Crash_load(d->character);
   
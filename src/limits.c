@@ -454,6 +454,7 @@ static void check_idling(struct char_data *ch)
 	 */
 	ch->desc->character = NULL;
 	ch->desc = NULL;
+	update_zone_player(ch);
       }
       if (CONFIG_FREE_RENT)
 	Crash_rentsave(ch, 0);
@@ -476,6 +477,9 @@ void point_update(void)
   for (i = character_list; i; i = next_char) {
     next_char = i->next;
 
+    if (i->char_specials.dormant_ticks)
+      continue;	/* asleep with its zone; see affect_update() */
+
     gain_condition(i, HUNGER, -1);
     gain_condition(i, DRUNK, -1);
     gain_condition(i, THIRST, -1);
@@ -569,6 +573,38 @@ void point_update(void)
   }
 }
 
+/* Brings a mobile that slept through its zone's quiet up to date in one go:
+ * it gets back what it would have regained, and the affects that would have
+ * run out are gone.  Nobody was there to see them end, so nothing is said. */
+void wake_mobile(struct char_data *ch)
+{
+  struct affected_type *af, *next;
+  int ticks = ch->char_specials.dormant_ticks;
+
+  ch->char_specials.dormant_ticks = 0;
+
+  /* An affect is taken off on the tick after its duration reaches 0.  As in
+   * affect_update(), that happens before the tick's regeneration, so the
+   * gains are capped by the maximums left afterwards. */
+  for (af = ch->affected; af; af = next) {
+    next = af->next;
+    if (af->duration == -1)
+      continue;
+    if (af->duration >= ticks)
+      af->duration -= ticks;
+    else
+      affect_remove(ch, af);
+  }
+
+  if (GET_POS(ch) >= POS_STUNNED) {
+    GET_HIT(ch) = MIN(GET_HIT(ch) + hit_gain(ch) * ticks, GET_MAX_HIT(ch));
+    GET_MANA(ch) = MIN(GET_MANA(ch) + mana_gain(ch) * ticks, effective_max_mana(ch));
+    GET_MOVE(ch) = MIN(GET_MOVE(ch) + move_gain(ch) * ticks, effective_max_move(ch));
+    if (GET_POS(ch) <= POS_STUNNED)
+      update_pos(ch);
+  }
+}
+
 
 long long increase_money_gold(struct char_data *ch, long long amt)
 {
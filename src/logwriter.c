@@ -0,0 +1,429 @@
+/**
+* @file logwriter.c
+* Log lines written to disk by a background thread.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*
+* basic_mud_vlog() used to format the time stamp, vfprintf() the line and
+* fflush() the log for every line, on the game thread.  A burst of script
+* errors or zone reset complaints then held up the pulse on disk writes.
+*
+* Now the caller formats the message once and appends it to a fixed ring of
+* records.  Appending takes no lock: producers claim a slot by bumping
+* enqueue_pos with a compare-and-swap, and each slot carries a sequence
+* number saying whether it is free or holds a record for the one consumer,
+* the writer thread.  The writer adds the time stamp, writes the line in the
+* old format and calls fflush() once LOG_FLUSH_BYTES have built up or the
+* oldest unflushed line is LOG_FLUSH_MSEC old.  If the ring is full the line
+* is dropped and counted, and the writer notes the gap in the log.
+*
+* log_writer_flush() waits until every line logged so far is written, and
+* with 'durable' set also fsync()s the log; core dumps and copyover use it.
+* The writer is stopped, and the ring emptied, by log_writer_shutdown(),
+* which also runs from atexit() so a plain exit() loses nothing.  Before
+* log_writer_init() and on systems without pthreads or atomic builtins,
+* lines are written straight away as they always were.
+*
+* A thread can also hold its lines back with log_writer_capture() and have
+* them logged later by log_writer_release(), still with the time they were
+* logged at.  The world file parsers use this so that a boot logs the same
+* lines in the same order however many threads read the files.
+*/
+
+#include "conf.h"
+#include "sysdep.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "logwriter.h"
+
+#if defined(HAVE_PTHREAD_H) && defined(__GNUC__)
+#define LOG_THREADED
+#endif
+
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+
+struct log_record {
+  struct log_record *next; /* in a log_capture */
+  time_t when;
+  size_t len;
+  char text[1];          /* len bytes, no terminator needed */
+};
+
+struct log_slot {
+  unsigned long seq;     /* == position: free; == position + 1: holds rec */
+  struct log_record *rec;
+};
+
+/* local functions */
+static void write_line(time_t when, const char *text, size_t len);
+
+static struct log_writer_stats stats;
+static char stamp[21];            /* time stamp of stamp_when */
+static time_t stamp_when = -1;
+
+#ifdef LOG_THREADED
+static long msec_now(void);
+static int ring_take(struct log_record **rec);
+static int drain_ring(void);
+static void *log_writer_main(void *arg);
+static void log_writer_atexit(void);
+
+static struct log_slot ring[LOG_RING_SIZE];
+static unsigned long enqueue_pos = 0;   /* next slot a producer claims */
+static unsigned long dequeue_pos = 0;   /* next slot the writer reads */
+static unsigned long dropped = 0;
+
+static pthread_t writer;
+static int writer_running = FALSE;
+static int stopping = FALSE;
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flush_cond = PTHREAD_COND_INITIALIZER;
+static unsigned long flush_target = 0;  /* records a caller wants on disk */
+static unsigned long flushed_pos = 0;   /* records fflush()ed so far */
+static __thread struct log_capture *capture = NULL;
+#endif
+
+/* Same layout as always: "Mon DD HH:MM:SS YYYY :: message".  The stamp only
+ * changes once a second, so it is formatted once a second. */
+static void write_line(time_t when, const char *text, size_t len)
+{
+  struct tm tm;
+
+  if (when != stamp_when) {
+#ifdef LOG_THREADED
+    /* The game thread uses localtime() too, and it has only one buffer. */
+    localtime_r(&when, &tm);
+#else
+    tm = *localtime(&when);
+#endif
+    memset(stamp, 0, sizeof(stamp));
+    strftime(stamp, sizeof(stamp), "%b %d %H:%M:%S %Y", &tm);
+    stamp_when = when;
+  }
+
+  fprintf(logfile, "%-20.20s :: ", stamp);
+  fwrite(text, 1, len, logfile);
+  fputc('\n', logfile);
+
+  stats.records++;
+  stats.bytes += len + 25;
+}
+
+#ifdef LOG_THREADED
+static long msec_now(void)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec * 1000L + now.tv_usec / 1000);
+}
+
+/* Take the next record off the ring.  Only the writer calls this. */
+static int ring_take(struct log_record **rec)
+{
+  struct log_slot *slot = &ring[dequeue_pos & LOG_RING_MASK];
+
+  if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != dequeue_pos + 1)
+    return (FALSE);
+
+  *rec = slot->rec;
+  slot->rec = NULL;
+  __atomic_store_n(&slot->seq, dequeue_pos + LOG_RING_SIZE, __ATOMIC_RELEASE);
+  __atomic_store_n(&dequeue_pos, dequeue_pos + 1, __ATOMIC_RELEASE);
+  return (TRUE);
+}
+
+/* Write out everything on the ring.  Returns the bytes written. */
+static int drain_ring(void)
+{
+  static unsigned long reported_drops = 0;
+  struct log_record *rec;
+  unsigned long drops;
+  char buf[80];
+  int bytes = 0;
+
+  while (ring_take(&rec)) {
+    write_line(rec->when, rec->text, rec->len);
+    bytes += rec->len + 25;
+    free(rec);
+  }
+
+  if ((drops = __atomic_load_n(&dropped, __ATOMIC_RELAXED)) != reported_drops) {
+    snprintf(buf, sizeof(buf), "SYSERR: Log ring full, %lu line%s dropped.",
+             drops - reported_drops, drops - reported_drops == 1 ? "" : "s");
+    write_line(time(0), buf, strlen(buf));
+    reported_drops = drops;
+  }
+
+  return (bytes);
+}
+
+static void *log_writer_main(void *arg)
+{
+  long last_flush = msec_now(), wait;
+  unsigned long target;
+  int unflushed = 0, quit = FALSE;
+  struct timespec until;
+  struct timeval now;
+
+  while (!quit) {
+    unflushed += drain_ring();
+
+    pthread_mutex_lock(&flush_lock);
+    target = flush_target;
+    pthread_mutex_unlock(&flush_lock);
+
+    quit = __atomic_load_n(&stopping, __ATOMIC_ACQUIRE);
+
+    if (unflushed >= LOG_FLUSH_BYTES || msec_now() - last_flush >= LOG_FLUSH_MSEC ||
+        target > flushed_pos || quit) {
+      if (unflushed) {
+        fflush(logfile);
+        stats.flushes++;
+        unflushed = 0;
+      }
+      last_flush = msec_now();
+      pthread_mutex_lock(&flush_lock);
+      flushed_pos = __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+      pthread_cond_broadcast(&flush_cond);
+      pthread_mutex_unlock(&flush_lock);
+    }
+
+    if (quit)
+      break;
+
+    /* Sleep until the next flush is due, or less if a caller is waiting on a
+     * record that has not been published yet. */
+    wait = target > flushed_pos ? 1 : LOG_FLUSH_MSEC;
+    gettimeofday(&now, NULL);
+    until.tv_sec = now.tv_sec + (now.tv_usec / 1000 + wait) / 1000;
+    until.tv_nsec = ((now.tv_usec / 1000 + wait) % 1000) * 1000000L;
+
+    pthread_mutex_lock(&wake_lock);
+    if (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE) &&
+        __atomic_load_n(&ring[dequeue_pos & LOG_RING_MASK].seq, __ATOMIC_ACQUIRE) != dequeue_pos + 1)
+      pthread_cond_timedwait(&wake_cond, &wake_lock, &until);
+    pthread_mutex_unlock(&wake_lock);
+  }
+
+  return (NULL);
+}
+
+static void log_writer_atexit(void)
+{
+  log_writer_shutdown();
+}
+#endif
+
+/** Starts the writer thread.  Lines logged before this were written
+ * directly. */
+void log_writer_init(void)
+{
+#ifdef LOG_THREADED
+  static int registered = FALSE, ring_ready = FALSE;
+  sigset_t all, old;
+  unsigned long i;
+  int err;
+
+  if (writer_running)
+    return;
+
+  /* Once set up the ring stays consistent, even across a restart. */
+  if (!ring_ready) {
+    for (i = 0; i < LOG_RING_SIZE; i++)
+      ring[i].seq = i;
+    ring_ready = TRUE;
+  }
+  stopping = FALSE;
+
+  /* A signal handled on the writer would exit() from under it and join
+   * itself, so leave signals to the game loop's thread. */
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  err = pthread_create(&writer, NULL, log_writer_main, NULL);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  if (err != 0) {
+    log("SYSERR: Unable to start log writer thread: %s", strerror(err));
+    return;
+  }
+  __atomic_store_n(&writer_running, TRUE, __ATOMIC_RELEASE);
+  stats.threaded = TRUE;
+
+  if (!registered) {
+    atexit(log_writer_atexit);
+    registered = TRUE;
+  }
+#endif
+}
+
+/** Writes out every queued line and stops the writer thread. */
+void log_writer_shutdown(void)
+{
+#ifdef LOG_THREADED
+  struct log_record *rec;
+
+  if (!__atomic_load_n(&writer_running, __ATOMIC_ACQUIRE))
+    return;
+
+  pthread_mutex_lock(&wake_lock);
+  __atomic_store_n(&stopping, TRUE, __ATOMIC_RELEASE);
+  pthread_cond_signal(&wake_cond);
+  pthread_mutex_unlock(&wake_lock);
+  pthread_join(writer, NULL);
+
+  __atomic_store_n(&writer_running, FALSE, __ATOMIC_RELEASE);
+  stats.threaded = FALSE;
+
+  /* Anything appended while the writer was stopping. */
+  while (ring_take(&rec)) {
+    write_line(rec->when, rec->text, rec->len);
+    free(rec);
+  }
+  fflush(logfile);
+#endif
+}
+
+/** Queues one preformatted line for the log.
+ * @param when The time the line is stamped with.
+ * @param text The message, without time stamp or newline.
+ * @param len The length of text. */
+void log_writer_append(time_t when, const char *text, size_t len)
+{
+#ifdef LOG_THREADED
+  struct log_record *rec;
+  struct log_slot *slot;
+  unsigned long pos;
+  long diff;
+
+  if (capture || __atomic_load_n(&writer_running, __ATOMIC_ACQUIRE)) {
+    rec = (struct log_record *) malloc(sizeof(struct log_record) + len);
+    if (!rec) {
+      __atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+      return;
+    }
+    rec->next = NULL;
+    rec->when = when;
+    rec->len = len;
+    memcpy(rec->text, text, len);
+
+    if (capture) {
+      if (capture->last)
+        capture->last->next = rec;
+      else
+        capture->first = rec;
+      capture->last = rec;
+      return;
+    }
+
+    pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+      slot = &ring[pos & LOG_RING_MASK];
+      diff = (long) (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+      if (diff == 0) {
+        if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, TRUE,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+          break;
+      } else if (diff < 0) {
+        /* The writer has not freed this slot yet: the ring is full. */
+        __atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+        free(rec);
+        return;
+      } else
+        pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    }
+
+    slot->rec = rec;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    diff = (long) (pos + 1 - __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED));
+    if (diff > stats.peak)
+      stats.peak = diff;
+    /* Past a quarter full, wake the writer rather than wait for its timer. */
+    if (diff == LOG_RING_SIZE / 4)
+      pthread_cond_signal(&wake_cond);
+    return;
+  }
+#endif
+
+  write_line(when, text, len);
+  fflush(logfile);
+}
+
+/** Waits until every line logged so far has reached the log file.
+ * @param durable If TRUE, also fsync() the log, for crash reporting. */
+void log_writer_flush(int durable)
+{
+#ifdef LOG_THREADED
+  unsigned long target;
+
+  if (__atomic_load_n(&writer_running, __ATOMIC_ACQUIRE)) {
+    target = __atomic_load_n(&enqueue_pos, __ATOMIC_ACQUIRE);
+
+    pthread_mutex_lock(&flush_lock);
+    if (target > flush_target)
+      flush_target = target;
+    pthread_mutex_unlock(&flush_lock);
+
+    pthread_mutex_lock(&wake_lock);
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_lock);
+
+    pthread_mutex_lock(&flush_lock);
+    while (flushed_pos < target && __atomic_load_n(&writer_running, __ATOMIC_ACQUIRE))
+      pthread_cond_wait(&flush_cond, &flush_lock);
+    pthread_mutex_unlock(&flush_lock);
+  } else
+#endif
+    fflush(logfile);
+
+  if (durable)
+    fsync(fileno(logfile));
+}
+
+void log_writer_stats(struct log_writer_stats *out)
+{
+  *out = stats;
+#ifdef LOG_THREADED
+  out->dropped = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+#endif
+}
+
+/** Holds back the lines this thread logs until it is called again with
+ * NULL.  They are logged by log_writer_release().
+ * @param cap Where to keep the lines, initially zeroed, or NULL. */
+void log_writer_capture(struct log_capture *cap)
+{
+#ifdef LOG_THREADED
+  capture = cap;
+#endif
+}
+
+/** Logs, in order, the lines held back in a capture and empties it.  Any
+ * thread may do this once the thread that captured them has stopped. */
+void log_writer_release(struct log_capture *cap)
+{
+  struct log_record *rec;
+  int lines = 0;
+
+  while ((rec = cap->first) != NULL) {
+    cap->first = rec->next;
+    log_writer_append(rec->when, rec->text, rec->len);
+    free(rec);
+
+    /* A long capture would fill the ring faster than the writer empties it. */
+    if (++lines % (LOG_RING_SIZE / 2) == 0)
+      log_writer_flush(FALSE);
+  }
+  cap->last = NULL;
+}
@@ -0,0 +1,42 @@
+/**
+* @file logwriter.h
+* Log lines written to disk by a background thread.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*/
+#ifndef _LOGWRITER_H_
+#define _LOGWRITER_H_
+
+#define LOG_RING_SIZE       4096   /**< records the ring holds; a power of two */
+#define LOG_FLUSH_BYTES     16384  /**< unflushed bytes that force an fflush() */
+#define LOG_FLUSH_MSEC      100    /**< longest a line waits before an fflush() */
+
+struct log_record;
+
+/** Lines a thread holds back with log_writer_capture(). */
+struct log_capture {
+  struct log_record *first, *last;
+};
+
+/** Numbers for 'show stats'. */
+struct log_writer_stats {
+  int threaded;          /**< TRUE if the writer thread is running */
+  unsigned long records; /**< Lines written */
+  unsigned long dropped; /**< Lines lost because the ring was full */
+  unsigned long bytes;   /**< Bytes written */
+  unsigned long flushes; /**< fflush() calls made by the writer */
+  int peak;              /**< Most records ever waiting in the ring */
+};
+
+void log_writer_init(void);
+void log_writer_shutdown(void);
+void log_writer_append(time_t when, const char *text, size_t len);
+void log_writer_flush(int durable);
+void log_writer_stats(struct log_writer_stats *stats);
+void log_writer_capture(struct log_capture *cap);
+void log_writer_release(struct log_capture *cap);
+
+#endif /* _LOGWRITER_H_ */
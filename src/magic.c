@@ -146,7 +146,15 @@ void affect_update(void)
   struct affected_type *af, *next;
   struct char_data *i;
 
-  for (i = character_list; i; i = i->next)
+  for (i = character_list; i; i = i->next) {
+    /* point_update() skips whoever this counts, so the two stay in step. */
+    if (mobile_dormant(i)) {
+      i->char_specials.dormant_ticks++;
+      continue;
+    }
+    if (i->char_specials.dormant_ticks)
+      wake_mobile(i);
+
     for (af = i->affected; af; af = next) {
       next = af->next;
       if (af->duration >= 1)
@@ -167,6 +175,7 @@ void affect_update(void)
 	affect_remove(i, af);
       }
     }
+  }
 }
 
 /* Checks for up to 3 vnums (spell reagents) in the player's inventory. If
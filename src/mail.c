@@ -19,6 +19,15 @@
 #include "handler.h"
 #include "mail.h"
 #include "modify.h"
+#include "savequeue.h"
+
+/* Letters waiting for one player, oldest first. */
+struct mail_box {
+  long recipient;
+  struct mail_t *first;
+  struct mail_t *last;
+  struct mail_box *next;   /* next box in the same hash bucket */
+};
 
 /* local (file scope) function prototypes */
 static void postmaster_send_mail(struct char_data *ch, struct char_data *mailman, int cmd, char *arg);
@@ -27,7 +36,20 @@ static void postmaster_receive_mail(struct char_data *ch, struct char_data *mail
 static int mail_recip_ok(const char *name);
 static void write_mail_record(FILE *mail_file, struct mail_t *record);
 static void free_mail_record(struct mail_t *record);
-static struct mail_t *read_mail_record(FILE *mail_file);
+static struct mail_box *find_mail_box(long recipient, int create);
+static void queue_mail(struct mail_t *record);
+static struct mail_t *dequeue_mail(long recipient);
+static int append_journal(struct mail_t *record, long taken_from);
+static int compact_mail_file(void);
+
+/* The mail file is a journal: a "###" record for every letter sent and a
+ * "---" record every time a recipient takes their oldest letter.  It is
+ * read once at boot into the boxes below and rewritten with just the
+ * waiting letters whenever the taken ones start to outweigh them. */
+static struct mail_box *mail_boxes[MAIL_HASH_SIZE];
+static int waiting_letters = 0;   /* letters in the boxes */
+static int dead_records = 0;      /* records in the file for letters already taken */
+static int keep_mail_file = FALSE; /* holds bad lines we could not set aside */
 
 static int mail_recip_ok(const char *name)
 {
@@ -47,52 +69,132 @@ static void free_mail_record(struct mail_t *record)
   free(record);
 }
 
-static struct mail_t *read_mail_record(FILE *mail_file)
+static void write_mail_record(FILE *mail_file, struct mail_t *record)
 {
-  char line[READ_SIZE];
-  long sender, recipient;
-  time_t sent_time;
+	fprintf(mail_file, "### %ld %ld %ld\n"
+	                   "%s~\n",
+                     record->recipient,
+                     record->sender,
+                     (long)record->sent_time,
+                     record->body ? record->body : "" );
+}
+
+static struct mail_box *find_mail_box(long recipient, int create)
+{
+  struct mail_box *box;
+  int bucket = (int) ((unsigned long) recipient % MAIL_HASH_SIZE);
+
+  for (box = mail_boxes[bucket]; box; box = box->next)
+    if (box->recipient == recipient)
+      return (box);
+
+  if (!create)
+    return (NULL);
+
+  CREATE(box, struct mail_box, 1);
+  box->recipient = recipient;
+  box->next = mail_boxes[bucket];
+  mail_boxes[bucket] = box;
+  return (box);
+}
+
+static void queue_mail(struct mail_t *record)
+{
+  struct mail_box *box = find_mail_box(record->recipient, TRUE);
+
+  record->next = NULL;
+  if (box->last)
+    box->last->next = record;
+  else
+    box->first = record;
+  box->last = record;
+  waiting_letters++;
+}
+
+/* Takes the oldest letter for recipient out of its box, or returns NULL. */
+static struct mail_t *dequeue_mail(long recipient)
+{
+  struct mail_box *box = find_mail_box(recipient, FALSE);
   struct mail_t *record;
 
-  if (!get_line(mail_file, line))
-  	return NULL;
+  if (!box || !(record = box->first))
+    return (NULL);
 
-  if (sscanf(line, "### %ld %ld %ld", &recipient, &sender, (long *)&sent_time) != 3) {
-  	log("Mail system - fatal error - malformed mail header");
-  	log("Line was: %s", line);
-  	return NULL;
-  }
+  if (!(box->first = record->next))
+    box->last = NULL;
+  record->next = NULL;
+  waiting_letters--;
+  return (record);
+}
 
-  CREATE(record, struct mail_t, 1);
+/* Adds one record to the end of the mail file: the letter if record is set,
+ * otherwise a note that taken_from took their oldest letter. */
+static int append_journal(struct mail_t *record, long taken_from)
+{
+  FILE *mail_file;
 
-  record->recipient = recipient;
-  record->sender = sender;
-  record->sent_time = sent_time;
-  record->body = fread_string(mail_file, "read mail record");
+  /* A compaction still on its way to disk would replace what we append. */
+  save_queue_wait(MAIL_FILE);
+
+  if (!(mail_file = fopen(MAIL_FILE, "a"))) {
+    log("SYSERR: Mail file not accessible: %s", strerror(errno));
+    return (FALSE);
+  }
+
+  if (record)
+    write_mail_record(mail_file, record);
+  else
+    fprintf(mail_file, "--- %ld\n", taken_from);
 
-  return record;
+  if (fclose(mail_file) != 0) {
+    log("SYSERR: Error writing mail file: %s", strerror(errno));
+    return (FALSE);
+  }
+  return (TRUE);
 }
 
-static void write_mail_record(FILE *mail_file, struct mail_t *record)
+/* Rewrites the mail file with only the letters still waiting. */
+static int compact_mail_file(void)
 {
-	fprintf(mail_file, "### %ld %ld %ld\n"
-	                   "%s~\n",
-                     record->recipient,
-                     record->sender,
-                     (long)record->sent_time,
-                     record->body );
+  struct save_file sf;
+  struct mail_box *box;
+  struct mail_t *record;
+  FILE *mail_file;
+  int i;
+
+  if (keep_mail_file)
+    return (FALSE);
+
+  if (!(mail_file = save_file_open(&sf, MAIL_FILE)))
+    return (FALSE);
+
+  for (i = 0; i < MAIL_HASH_SIZE; i++)
+    for (box = mail_boxes[i]; box; box = box->next)
+      for (record = box->first; record; record = record->next)
+        write_mail_record(mail_file, record);
+
+  if (!save_file_close(&sf))
+    return (FALSE);
+
+  dead_records = 0;
+  return (TRUE);
 }
 
 /* int scan_file(none)
- * Returns false if mail file is corrupted or true if everything correct.
+ * Returns true; mail is only disabled if this ever returns false.
  *
- * This is called once during boot-up.  It scans through the mail file
- * and indexes all entries currently in the mail file. */
+ * This is called once during boot-up.  It replays the mail file into the
+ * mail boxes and, if anything in it was already taken, compacts it.  A
+ * malformed record is logged, copied to MAIL_FILE_BAD and skipped, so one
+ * bad line does not cost everybody their mail.  If the copy fails the mail
+ * file is never compacted, which would throw the bad lines away. */
 int scan_file(void)
 {
-  FILE *mail_file;
-  int count = 0;
+  FILE *mail_file, *bad_file = NULL;
+  char line[READ_SIZE];
+  long sender, recipient, sent_time;
   struct mail_t *record;
+  int bad_lines = 0, skipping = FALSE, set_aside = TRUE;
 
   if (!(mail_file = fopen(MAIL_FILE, "r"))) {
     log("   Mail file non-existant... creating new file.");
@@ -100,17 +202,56 @@ int scan_file(void)
     return TRUE;
   }
 
-  record = read_mail_record(mail_file);
-
-  while (record) {
-    free_mail_record(record);
-    record = read_mail_record(mail_file);
-    count++;
+  while (get_line(mail_file, line)) {
+    if (sscanf(line, "### %ld %ld %ld", &recipient, &sender, &sent_time) == 3) {
+      CREATE(record, struct mail_t, 1);
+      record->recipient = recipient;
+      record->sender = sender;
+      record->sent_time = (time_t) sent_time;
+      record->body = fread_string(mail_file, "read mail record");
+      queue_mail(record);
+    } else if (sscanf(line, "--- %ld", &recipient) == 1) {
+      if ((record = dequeue_mail(recipient)) != NULL) {
+        free_mail_record(record);
+        dead_records++;
+      } else
+        log("SYSERR: Mail file takes a letter for %ld that was never sent.", recipient);
+      dead_records++;
+    } else {
+      /* Only the first line of a bad stretch is worth logging. */
+      if (!skipping)
+        log("SYSERR: Mail file has a malformed record, skipping: %s", line);
+      if (!bad_lines && !(bad_file = fopen(MAIL_FILE_BAD, "a"))) {
+        log("SYSERR: Cannot open %s: %s", MAIL_FILE_BAD, strerror(errno));
+        set_aside = FALSE;
+      }
+      if (bad_file)
+        fprintf(bad_file, "%s\n", line);
+      skipping = TRUE;
+      bad_lines++;
+      continue;
+    }
+    skipping = FALSE;
   }
 
   fclose(mail_file);
- 	log("   Mail file read -- %d messages.", count);
- 	return TRUE;
+  if (bad_file && fclose(bad_file) != 0) {
+    log("SYSERR: Error writing %s: %s", MAIL_FILE_BAD, strerror(errno));
+    set_aside = FALSE;
+  }
+
+  log("   Mail file read -- %d messages waiting, %d old records.", waiting_letters, dead_records);
+  if (bad_lines)
+    log("SYSERR: Skipped %d malformed line%s in the mail file; %s.",
+      bad_lines, bad_lines == 1 ? "" : "s",
+      set_aside ? "copied to " MAIL_FILE_BAD : "left it uncompacted");
+
+  /* Leave bad lines where someone can look at them. */
+  keep_mail_file = !set_aside;
+  if (dead_records)
+    compact_mail_file();
+
+  return (TRUE);
 }
 
 /* int has_mail(long #1)
@@ -120,27 +261,9 @@ int scan_file(void)
  * A simple little function which tells you if the player has mail or not. */
 int has_mail(long recipient)
 {
-  FILE *mail_file;
-  struct mail_t *record;
-
-  if (!(mail_file = fopen(MAIL_FILE, "r"))) {
-    perror("read_delete: Mail file not accessible.");
-    return FALSE;
-  }
-
-  record = read_mail_record(mail_file);
+  struct mail_box *box = find_mail_box(recipient, FALSE);
 
-  while (record) {
-  	if (record->recipient == recipient) {
-  		free_mail_record(record);
-  		fclose(mail_file);
-  		return TRUE;
-    }
-    free_mail_record(record);
-    record = read_mail_record(mail_file);
-  }
-  fclose(mail_file);
-  return FALSE;
+  return (box && box->first);
 }
 
 /* void store_mail(long #1, long #2, char * #3)
@@ -150,26 +273,32 @@ int has_mail(long recipient)
  *
  * call store_mail to store mail.  (hard, huh? :-) )  Pass 3 arguments:
  * who the mail is to (long), who it's from (long), and a pointer to the
- * actual message text (char *). */
+ * actual message text (char *).  The text is copied. */
 void store_mail(long to, long from, char *message_pointer)
 {
-  FILE *mail_file;
   struct mail_t *record;
+  int append_ok;
 
-  if (!(mail_file = fopen(MAIL_FILE, "a"))) {
-    perror("store_mail: Mail file not accessible.");
-    return;
-  }
   CREATE(record, struct mail_t, 1);
 
   record->recipient = to;
   record->sender = from;
   record->sent_time = time(0);
   record->body = message_pointer;
+  append_ok = append_journal(record, 0);
 
-  write_mail_record(mail_file, record);
-  free(record); /* don't free the body */
-  fclose(mail_file);
+  /* Keep the body exactly as reading it back from the file would. */
+  if (*message_pointer) {
+    record->body = strdup(message_pointer);
+    parse_at(record->body);
+  } else
+    record->body = NULL;
+
+  queue_mail(record);
+
+  /* Failing that, get it onto disk the long way. */
+  if (!append_ok)
+    compact_mail_file();
 }
 
 /* char *read_delete(long #1)
@@ -180,39 +309,20 @@ void store_mail(long to, long from, char *message_pointer)
  * the file. Expects mail to exist. */
 char *read_delete(long recipient)
 {
-  FILE *mail_file, *new_file;
-  struct mail_t *record, *record_to_keep = NULL;
+  struct mail_t *record_to_keep;
   char buf[MAX_STRING_LENGTH];
 
-  if (!(mail_file = fopen(MAIL_FILE, "r"))) {
-    perror("read_delete: Mail file not accessible.");
-    return strdup("Mail system malfunction - please report this");
-  }
-
-  if (!(new_file = fopen(MAIL_FILE_TMP, "w"))) {
-    perror("read_delete: new Mail file not accessible.");
-    fclose(mail_file);
-    return strdup("Mail system malfunction - please report this");
-  }
-
-  record = read_mail_record(mail_file);
-
-  while (record) {
-  	if (!record_to_keep && record->recipient == recipient) {
-  		record_to_keep = record;
-  		record = read_mail_record(mail_file);
-  		continue; /* don't write and free this one just yet */
-    }
-    write_mail_record(new_file, record);
-    free_mail_record(record);
-    record = read_mail_record(mail_file);
-  }
-
-  if (!record_to_keep)
+  if (!(record_to_keep = dequeue_mail(recipient)))
   	sprintf(buf, "Mail system error - please report");
   else {
     char timestr[25], *from, *to;
 
+    /* The letter itself and the record that took it are both dead now. */
+    if (append_journal(NULL, recipient))
+      dead_records += 2;
+    else
+      compact_mail_file();
+
     strftime(timestr, sizeof(timestr), "%c", localtime(&(record_to_keep->sent_time)));
 
     from = get_name_by_id(record_to_keep->sender);
@@ -233,15 +343,34 @@ char *read_delete(long recipient)
 
     free_mail_record(record_to_keep);
   }
-  fclose(mail_file);
-  fclose(new_file);
 
-  remove(MAIL_FILE);
-  rename(MAIL_FILE_TMP, MAIL_FILE);
+  if (dead_records >= MAIL_COMPACT_MIN && dead_records > waiting_letters)
+    compact_mail_file();
 
   return strdup(buf);
 }
 
+/* Frees every waiting letter at shutdown. */
+void free_mail(void)
+{
+  struct mail_box *box, *next_box;
+  struct mail_t *record, *next_record;
+  int i;
+
+  for (i = 0; i < MAIL_HASH_SIZE; i++) {
+    for (box = mail_boxes[i]; box; box = next_box) {
+      next_box = box->next;
+      for (record = box->first; record; record = next_record) {
+        next_record = record->next;
+        free_mail_record(record);
+      }
+      free(box);
+    }
+    mail_boxes[i] = NULL;
+  }
+  waiting_letters = dead_records = 0;
+}
+
 /* spec_proc for a postmaster using the above routines.  By Jeremy Elson */
 SPECIAL(postmaster)
 {
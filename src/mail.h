@@ -27,6 +27,12 @@
 /* size of mail file allocation blocks		*/
 #define BLOCK_SIZE 100
 
+/* buckets in the table of mail boxes		*/
+#define MAIL_HASH_SIZE 1024
+
+/* taken letters left in the mail file before it is compacted */
+#define MAIL_COMPACT_MIN 100
+
 /* General, publicly available functions */
 SPECIAL(postmaster);
 
@@ -41,6 +47,7 @@ int	scan_file(void);
 int	has_mail(long recipient);
 void	store_mail(long to, long from, char *message_pointer);
 char	*read_delete(long recipient);
+void	free_mail(void);
 void    notify_if_playing(struct char_data *from, int recipient_id);
 
 struct mail_t {
@@ -48,6 +55,7 @@ struct mail_t {
 	long sender;
 	time_t sent_time;
 	char *body;
+	struct mail_t *next;	/* next letter for the same recipient */
 };
 
 /* old stuff below */
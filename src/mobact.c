@@ -21,6 +21,7 @@
 #include "act.h"
 #include "graph.h"
 #include "fight.h"
+#include "profiler.h"
 
 
 /* local file scope only function prototypes */
@@ -36,7 +37,7 @@ void mobile_activity(void)
   for (ch = character_list; ch; ch = next_ch) {
     next_ch = ch->next;
 
-    if (!IS_MOB(ch))
+    if (!IS_MOB(ch) || mobile_dormant(ch))
       continue;
 
     /* Examine call for special procedure */
@@ -47,7 +48,7 @@ void mobile_activity(void)
 	REMOVE_BIT_AR(MOB_FLAGS(ch), MOB_SPEC);
       } else {
         char actbuf[MAX_INPUT_LENGTH] = "";
-	if ((mob_index[GET_MOB_RNUM(ch)].func) (ch, ch, 0, actbuf))
+	if (profile_special(mob_index[GET_MOB_RNUM(ch)].func, ch, ch, 0, actbuf))
 	  continue;		/* go to next char */
       }
     }
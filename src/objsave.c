@@ -22,6 +22,7 @@
 #include "config.h"
 #include "modify.h"
 #include "genolc.h" /* for strip_cr and sprintascii */
+#include "savequeue.h"
 
 /* these factors should be unique integers */
 #define RENT_FACTOR    1
@@ -56,14 +57,20 @@ int objsave_save_obj_record(struct obj_data *obj, FILE *fp, int locate)
   int counter2;
   struct extra_descr_data *ex_desc;
   char buf1[MAX_STRING_LENGTH +1];
-  struct obj_data *temp = NULL;
-
-  if (GET_OBJ_VNUM(obj) != NOTHING)
-    temp=read_object(GET_OBJ_VNUM(obj), VIRTUAL);
-  else {
-    temp = create_obj();
-    temp->item_number = NOWHERE;
-  }
+  const struct obj_data *temp;
+  obj_rnum rnum;
+  /* What a unique object (or one whose prototype is gone) is compared to:
+   * everything zero, which is what create_obj() gives the loader. */
+  static struct obj_data blank_obj;
+
+  /* Compare against the prototype itself rather than a fresh copy of it.
+   * read_object() would copy it, link it into object_list, count it and
+   * attach its scripts only for us to extract it again at the end, and that
+   * happened once for every object in every crash save and house save. */
+  if (GET_OBJ_VNUM(obj) != NOTHING && (rnum = real_object(GET_OBJ_VNUM(obj))) != NOTHING)
+    temp = &obj_proto[rnum];
+  else
+    temp = &blank_obj;
 
   if (obj->action_description) {
 
@@ -72,6 +79,12 @@ int objsave_save_obj_record(struct obj_data *obj, FILE *fp, int locate)
   } else
     *buf1 = 0;
 
+#define TEST_OBJS(obj1, obj2, field) ((!obj1->field || !obj2->field || \
+                                      strcmp(obj1->field, obj2->field)))
+#define TEST_OBJN(field) (obj->obj_flags.field != temp->obj_flags.field)
+#define TEST_OBJF(field) (memcmp(obj->obj_flags.field, temp->obj_flags.field, \
+                                 sizeof(obj->obj_flags.field)))
+
   fprintf(fp, "#%d\n", GET_OBJ_VNUM(obj));
   if (locate)
     fprintf(fp, "Loc : %d\n", locate);
@@ -86,12 +99,9 @@ int objsave_save_obj_record(struct obj_data *obj, FILE *fp, int locate)
              GET_OBJ_VAL(obj, 2),
              GET_OBJ_VAL(obj, 3)
              );
-  if (GET_OBJ_EXTRA(obj) != GET_OBJ_EXTRA(temp))
+  if (TEST_OBJF(extra_flags))
     fprintf(fp, "Flag: %d %d %d %d\n", GET_OBJ_EXTRA(obj)[0], GET_OBJ_EXTRA(obj)[1], GET_OBJ_EXTRA(obj)[2], GET_OBJ_EXTRA(obj)[3]);
 
-#define TEST_OBJS(obj1, obj2, field) ((!obj1->field || !obj2->field || \
-                                      strcmp(obj1->field, obj2->field)))
-#define TEST_OBJN(field) (obj->obj_flags.field != temp->obj_flags.field)
 
   if (TEST_OBJS(obj, temp, name))
     fprintf(fp, "Name: %s\n", obj->name ? obj->name : "Undefined");
@@ -115,9 +125,9 @@ int objsave_save_obj_record(struct obj_data *obj, FILE *fp, int locate)
     fprintf(fp, "Cost: %d\n", GET_OBJ_COST(obj));
   if (TEST_OBJN(cost_per_day))
     fprintf(fp, "Rent: %d\n", GET_OBJ_RENT(obj));
-  if (TEST_OBJN(bitvector))
+  if (TEST_OBJF(bitvector))
     fprintf(fp, "Perm: %d %d %d %d\n", GET_OBJ_AFFECT(obj)[0], GET_OBJ_AFFECT(obj)[1], GET_OBJ_AFFECT(obj)[2], GET_OBJ_AFFECT(obj)[3]);
-  if (TEST_OBJN(wear_flags))
+  if (TEST_OBJF(wear_flags))
     fprintf(fp, "Wear: %d %d %d %d\n", GET_OBJ_WEAR(obj)[0], GET_OBJ_WEAR(obj)[1], GET_OBJ_WEAR(obj)[2], GET_OBJ_WEAR(obj)[3]);
 
   /* Do we have affects? */
@@ -155,13 +165,12 @@ int objsave_save_obj_record(struct obj_data *obj, FILE *fp, int locate)
 
   fprintf(fp, "\n");
 
-  extract_obj(temp);
-
   return 1;
 }
 
 #undef TEST_OBJS
 #undef TEST_OBJN
+#undef TEST_OBJF
 
 /* AutoEQ by Burkhard Knopf. */
 static void auto_equip(struct char_data *ch, struct obj_data *obj, int location)
@@ -274,6 +283,9 @@ int Crash_delete_file(char *name)
   if (!get_filename(filename, sizeof(filename), CRASH_FILE, name))
     return FALSE;
 
+  /* A queued save would otherwise bring the file back. */
+  save_queue_discard(filename);
+
   if (!(fl = fopen(filename, "r"))) {
     if (errno != ENOENT)  /* if it fails but NOT because of no file */
       log("SYSERR: deleting crash file %s (1): %s", filename, strerror(errno));
@@ -299,6 +311,7 @@ int Crash_delete_crashfile(struct char_data *ch)
   if (!get_filename(filename, sizeof(filename), CRASH_FILE, GET_NAME(ch)))
     return FALSE;
 
+  save_queue_wait(filename);
   if (!(fl = fopen(filename, "r"))) {
     if (errno != ENOENT)  /* if it fails, NOT because of no file */
       log("SYSERR: checking for crash file %s (3): %s", filename, strerror(errno));
@@ -329,6 +342,7 @@ int Crash_clean_file(char *name)
     return FALSE;
 
   /* Open so that permission problems will be flagged now, at boot time. */
+  save_queue_wait(filename);
   if (!(fl = fopen(filename, "r"))) {
     if (errno != ENOENT)  /* if it fails, NOT because of no file */
       log("SYSERR: OPENING OBJECT FILE %s (4): %s", filename, strerror(errno));
@@ -394,6 +408,7 @@ void Crash_listrent(struct char_data *ch, char *name)
   if (!get_filename(filename, sizeof(filename), CRASH_FILE, name))
     return;
 
+  save_queue_wait(filename);
   if (!(fl = fopen(filename, "r"))) {
     send_to_char(ch, "%s has no rent file.\r\n", name);
     return;
@@ -566,6 +581,7 @@ void Crash_crashsave(struct char_data *ch)
 {
   char buf[MAX_INPUT_LENGTH];
   int j;
+  struct save_file sf;
   FILE *fp;
 
   if (IS_NPC(ch))
@@ -574,29 +590,31 @@ void Crash_crashsave(struct char_data *ch)
   if (!get_filename(buf, sizeof(buf), CRASH_FILE, GET_NAME(ch)))
     return;
 
-  if (!(fp = fopen(buf, "w")))
+  if (!(fp = save_file_open(&sf, buf)))
     return;
 
-  if (!objsave_write_rentcode(fp, RENT_CRASH, 0, ch))
-  	return;
+  if (!objsave_write_rentcode(fp, RENT_CRASH, 0, ch)) {
+    save_file_abort(&sf);
+    return;
+  }
 
   for (j = 0; j < NUM_WEARS; j++)
     if (GET_EQ(ch, j)) {
       if (!Crash_save(GET_EQ(ch, j), fp, j + 1)) {
-        fclose(fp);
+        save_file_abort(&sf);
         return;
       }
       Crash_restore_weight(GET_EQ(ch, j));
     }
 
   if (!Crash_save(ch->carrying, fp, 0)) {
-    fclose(fp);
+    save_file_abort(&sf);
     return;
   }
   Crash_restore_weight(ch->carrying);
 
   fprintf(fp, "$~\n");
-  fclose(fp);
+  save_file_close(&sf);
   REMOVE_BIT_AR(PLR_FLAGS(ch), PLR_CRASH);
 }
 
@@ -605,6 +623,7 @@ void Crash_idlesave(struct char_data *ch)
   char buf[MAX_INPUT_LENGTH];
   int j;
   int cost, cost_eq;
+  struct save_file sf;
   FILE *fp;
 
   if (IS_NPC(ch))
@@ -613,7 +632,7 @@ void Crash_idlesave(struct char_data *ch)
   if (!get_filename(buf, sizeof(buf), CRASH_FILE, GET_NAME(ch)))
     return;
 
-  if (!(fp = fopen(buf, "w")))
+  if (!(fp = save_file_open(&sf, buf)))
     return;
 
   Crash_extract_norent_eq(ch);
@@ -645,19 +664,21 @@ void Crash_idlesave(struct char_data *ch)
   if (ch->carrying == NULL) {
     for (j = 0; j < NUM_WEARS && GET_EQ(ch, j) == NULL; j++) /* Nothing */ ;
     if (j == NUM_WEARS) {  /* No equipment or inventory. */
-      fclose(fp);
+      save_file_abort(&sf);
       Crash_delete_file(GET_NAME(ch));
       return;
     }
   }
 
-  if (!objsave_write_rentcode(fp, RENT_TIMEDOUT, cost, ch))
-  	return;
+  if (!objsave_write_rentcode(fp, RENT_TIMEDOUT, cost, ch)) {
+    save_file_abort(&sf);
+    return;
+  }
 
   for (j = 0; j < NUM_WEARS; j++) {
     if (GET_EQ(ch, j)) {
       if (!Crash_save(GET_EQ(ch, j), fp, j + 1)) {
-        fclose(fp);
+        save_file_abort(&sf);
         return;
       }
       Crash_restore_weight(GET_EQ(ch, j));
@@ -665,11 +686,11 @@ void Crash_idlesave(struct char_data *ch)
     }
   }
   if (!Crash_save(ch->carrying, fp, 0)) {
-    fclose(fp);
+    save_file_abort(&sf);
     return;
   }
   fprintf(fp, "$~\n");
-  fclose(fp);
+  save_file_close(&sf);
 
   Crash_extract_objs(ch->carrying);
 }
@@ -678,6 +699,7 @@ void Crash_rentsave(struct char_data *ch, int cost)
 {
   char buf[MAX_INPUT_LENGTH];
   int j;
+  struct save_file sf;
   FILE *fp;
 
   if (IS_NPC(ch))
@@ -686,19 +708,21 @@ void Crash_rentsave(struct char_data *ch, int cost)
   if (!get_filename(buf, sizeof(buf), CRASH_FILE, GET_NAME(ch)))
     return;
 
-  if (!(fp = fopen(buf, "w")))
+  if (!(fp = save_file_open(&sf, buf)))
     return;
 
   Crash_extract_norent_eq(ch);
   Crash_extract_norents(ch->carrying);
 
-  if (!objsave_write_rentcode(fp, RENT_RENTED, cost, ch))
-  	return;
+  if (!objsave_write_rentcode(fp, RENT_RENTED, cost, ch)) {
+    save_file_abort(&sf);
+    return;
+  }
 
   for (j = 0; j < NUM_WEARS; j++)
     if (GET_EQ(ch, j)) {
       if (!Crash_save(GET_EQ(ch,j), fp, j + 1)) {
-        fclose(fp);
+        save_file_abort(&sf);
         return;
       }
       Crash_restore_weight(GET_EQ(ch, j));
@@ -706,11 +730,11 @@ void Crash_rentsave(struct char_data *ch, int cost)
 
     }
   if (!Crash_save(ch->carrying, fp, 0)) {
-    fclose(fp);
+    save_file_abort(&sf);
     return;
   }
   fprintf(fp, "$~\n");
-  fclose(fp);
+  save_file_close(&sf);
 
   Crash_extract_objs(ch->carrying);
 }
@@ -737,6 +761,7 @@ static void Crash_cryosave(struct char_data *ch, int cost)
 {
   char buf[MAX_INPUT_LENGTH];
   int j;
+  struct save_file sf;
   FILE *fp;
 
   if (IS_NPC(ch))
@@ -745,7 +770,7 @@ static void Crash_cryosave(struct char_data *ch, int cost)
   if (!get_filename(buf, sizeof(buf), CRASH_FILE, GET_NAME(ch)))
     return;
 
-  if (!(fp = fopen(buf, "w")))
+  if (!(fp = save_file_open(&sf, buf)))
     return;
 
   Crash_extract_norent_eq(ch);
@@ -753,24 +778,26 @@ static void Crash_cryosave(struct char_data *ch, int cost)
 
   increase_money_gold(ch, -(long long)cost);
 
-  if (!objsave_write_rentcode(fp, RENT_CRYO, 0, ch))
-  	return;
+  if (!objsave_write_rentcode(fp, RENT_CRYO, 0, ch)) {
+    save_file_abort(&sf);
+    return;
+  }
 
   for (j = 0; j < NUM_WEARS; j++)
     if (GET_EQ(ch, j)) {
       if (!Crash_save(GET_EQ(ch, j), fp, j + 1)) {
-        fclose(fp);
+        save_file_abort(&sf);
         return;
       }
       Crash_restore_weight(GET_EQ(ch, j));
       Crash_extract_objs(GET_EQ(ch, j));
     }
   if (!Crash_save(ch->carrying, fp, 0)) {
-    fclose(fp);
+    save_file_abort(&sf);
     return;
   }
   fprintf(fp, "$~\n");
-  fclose(fp);
+  save_file_close(&sf);
 
   Crash_extract_objs(ch->carrying);
   SET_BIT_AR(PLR_FLAGS(ch), PLR_CRYO);
@@ -1202,6 +1229,7 @@ static int Crash_load_objs(struct char_data *ch) {
   for (i = 0; i < MAX_BAG_ROWS; i++)
     cont_row[i] = NULL;
 
+  save_queue_wait(filename);
   if (!(fl = fopen(filename, "r"))) {
     if (errno != ENOENT) { /* if it fails, NOT because of no file */
       snprintf(buf, MAX_STRING_LENGTH, "SYSERR: READING OBJECT FILE %s (5)", filename);
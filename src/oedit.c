@@ -238,9 +238,7 @@ void oedit_save_internally(struct descriptor_data *d)
   obj_proto[robj_num].proto_script = OLC_SCRIPT(d);
 
   /* this takes care of the objects currently in-game */
-  for (obj = object_list; obj; obj = obj->next) {
-    if (obj->item_number != robj_num)
-      continue;
+  for (obj = obj_index[robj_num].objs; obj; obj = obj->next_proto) {
     /* remove any old scripts */
     if (SCRIPT(obj))
       extract_script(obj, OBJ_TRIGGER);
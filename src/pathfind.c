@@ -0,0 +1,456 @@
+/**
+* @file pathfind.c
+* Shortest-path searches over the room graph.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*
+* Searches never touch rooms they do not reach.  Instead of clearing a mark
+* on every room in world[] before each search, every search takes a new
+* generation number and a room counts as visited only while its stamp equals
+* the current generation.  The queue is a preallocated array sized to the
+* world, so a search does not allocate anything either.
+*
+* With PATHF_ASTAR the search is ordered by the number of zone borders that
+* still have to be crossed to reach the target's zone.  Every border costs at
+* least one step, so the estimate never overshoots and the route found is
+* still a shortest one; the search simply stops spreading into zones that
+* lead away from the target.
+*
+* A route can be kept in a path_data and replayed by path_next_step(), which
+* only checks the next exit before handing it out.  Routes are thrown away
+* when the target moves, when the next exit no longer leads where it did, or
+* when OLC renumbers or rewires rooms (pathfind_world_changed).
+*/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+#include "pathfind.h"
+
+/** One open node of an A* search. */
+struct path_node {
+  int f;            /**< Steps so far plus estimated steps left */
+  int g;            /**< Steps so far */
+  room_rnum room;
+};
+
+/* Per-room search state, indexed by room rnum. */
+static int scratch_size = 0;
+static unsigned int search_gen = 0;
+static unsigned int *seen_gen = NULL;    /**< == search_gen once reached */
+static unsigned int *closed_gen = NULL;  /**< == search_gen once expanded (A*) */
+static room_rnum *came_from = NULL;
+static sbyte *came_dir = NULL;
+static int *cost = NULL;
+static room_rnum *queue = NULL;
+
+/* A* open list, a binary heap on f. */
+static struct path_node *heap = NULL;
+static int heap_size = 0, heap_count = 0;
+
+/* Zone graph, reversed: zone_adj[zone_adj_start[z] .. zone_adj_start[z+1]]
+ * holds every zone with an exit into zone z. */
+static int zone_count = 0;
+static int *zone_adj_start = NULL;
+static zone_rnum *zone_adj = NULL;
+static unsigned int zone_adj_gen = 0;
+
+/* Borders to cross from each zone to hops_target, or -1 if it cannot. */
+static int *zone_hops = NULL;
+static zone_rnum hops_target = NOWHERE;
+static unsigned int hops_gen = 0;
+
+static unsigned int world_gen = 1;
+
+/* local functions */
+static room_rnum path_edge(room_rnum room, int dir);
+static void path_scratch(void);
+static void path_new_search(void);
+static void zone_graph_build(void);
+static void zone_hops_build(zone_rnum target);
+static void heap_push(int f, int g, room_rnum room);
+static struct path_node heap_pop(void);
+static int bfs_search(room_rnum src, room_rnum target);
+static int astar_search(room_rnum src, room_rnum target);
+static int path_store(room_rnum src, room_rnum target, struct path_data **path);
+
+/* Where an exit leads if a tracker may take it, otherwise NOWHERE. */
+static room_rnum path_edge(room_rnum room, int dir)
+{
+  struct room_direction_data *exit = world[room].dir_option[dir];
+
+  if (exit == NULL || exit->to_room == NOWHERE || exit->to_room > top_of_world)
+    return NOWHERE;
+  if (CONFIG_TRACK_T_DOORS == FALSE && EXIT_FLAGGED(exit, EX_CLOSED))
+    return NOWHERE;
+  if (ROOM_FLAGGED(exit->to_room, ROOM_NOTRACK))
+    return NOWHERE;
+
+  return exit->to_room;
+}
+
+/* Grow the per-room arrays if OLC has added rooms since the last search. */
+static void path_scratch(void)
+{
+  int need = top_of_world + 1;
+
+  if (need <= scratch_size)
+    return;
+
+  RECREATE(seen_gen, unsigned int, need);
+  RECREATE(closed_gen, unsigned int, need);
+  RECREATE(came_from, room_rnum, need);
+  RECREATE(came_dir, sbyte, need);
+  RECREATE(cost, int, need);
+  RECREATE(queue, room_rnum, need);
+  memset(seen_gen + scratch_size, 0, (need - scratch_size) * sizeof(unsigned int));
+  memset(closed_gen + scratch_size, 0, (need - scratch_size) * sizeof(unsigned int));
+  scratch_size = need;
+}
+
+static void path_new_search(void)
+{
+  path_scratch();
+
+  /* Only after four billion searches do the stamps need wiping. */
+  if (++search_gen == 0) {
+    memset(seen_gen, 0, scratch_size * sizeof(unsigned int));
+    memset(closed_gen, 0, scratch_size * sizeof(unsigned int));
+    search_gen = 1;
+  }
+}
+
+static void zone_graph_build(void)
+{
+  room_rnum r, to;
+  zone_rnum z, tz;
+  int d, total;
+
+  if (zone_adj_gen == world_gen && zone_count == top_of_zone_table + 1)
+    return;
+
+  zone_count = top_of_zone_table + 1;
+  RECREATE(zone_adj_start, int, zone_count + 1);
+  RECREATE(zone_hops, int, zone_count);
+  memset(zone_adj_start, 0, (zone_count + 1) * sizeof(int));
+
+  /* Count the border exits leading into each zone... */
+  for (r = 0; r <= top_of_world; r++)
+    for (d = 0; d < NUM_OF_DIRS; d++) {
+      if (!world[r].dir_option[d] || (to = world[r].dir_option[d]->to_room) == NOWHERE || to > top_of_world)
+        continue;
+      if ((tz = world[to].zone) != world[r].zone && tz < zone_count && world[r].zone < zone_count)
+        zone_adj_start[tz + 1]++;
+    }
+  for (z = 0; z < zone_count; z++)
+    zone_adj_start[z + 1] += zone_adj_start[z];
+  total = zone_adj_start[zone_count];
+
+  /* ...then fill them in, using zone_hops as the fill cursor. */
+  RECREATE(zone_adj, zone_rnum, MAX(1, total));
+  for (z = 0; z < zone_count; z++)
+    zone_hops[z] = zone_adj_start[z];
+  for (r = 0; r <= top_of_world; r++)
+    for (d = 0; d < NUM_OF_DIRS; d++) {
+      if (!world[r].dir_option[d] || (to = world[r].dir_option[d]->to_room) == NOWHERE || to > top_of_world)
+        continue;
+      if ((tz = world[to].zone) != world[r].zone && tz < zone_count && world[r].zone < zone_count)
+        zone_adj[zone_hops[tz]++] = world[r].zone;
+    }
+
+  zone_adj_gen = world_gen;
+  hops_target = NOWHERE;
+}
+
+/* Breadth-first over the reversed zone graph, out from the target's zone. */
+static void zone_hops_build(zone_rnum target)
+{
+  zone_rnum *zq, z;
+  int head = 0, tail = 0, i;
+
+  zone_graph_build();
+
+  if (hops_target == target && hops_gen == world_gen)
+    return;
+
+  for (z = 0; z < zone_count; z++)
+    zone_hops[z] = -1;
+
+  CREATE(zq, zone_rnum, zone_count);
+  zone_hops[target] = 0;
+  zq[tail++] = target;
+  while (head < tail) {
+    z = zq[head++];
+    for (i = zone_adj_start[z]; i < zone_adj_start[z + 1]; i++)
+      if (zone_hops[zone_adj[i]] < 0) {
+        zone_hops[zone_adj[i]] = zone_hops[z] + 1;
+        zq[tail++] = zone_adj[i];
+      }
+  }
+  free(zq);
+
+  hops_target = target;
+  hops_gen = world_gen;
+}
+
+static void heap_push(int f, int g, room_rnum room)
+{
+  int i, parent;
+
+  if (heap_count == heap_size) {
+    heap_size = MAX(64, heap_size * 2);
+    RECREATE(heap, struct path_node, heap_size);
+  }
+
+  /* Ties on f go to the node furthest along, which reaches the goal sooner. */
+  for (i = heap_count++; i > 0; i = parent) {
+    parent = (i - 1) / 2;
+    if (heap[parent].f < f || (heap[parent].f == f && heap[parent].g >= g))
+      break;
+    heap[i] = heap[parent];
+  }
+  heap[i].f = f;
+  heap[i].g = g;
+  heap[i].room = room;
+}
+
+static struct path_node heap_pop(void)
+{
+  struct path_node top = heap[0], last = heap[--heap_count];
+  int i = 0, child;
+
+  while ((child = 2 * i + 1) < heap_count) {
+    if (child + 1 < heap_count && (heap[child + 1].f < heap[child].f ||
+        (heap[child + 1].f == heap[child].f && heap[child + 1].g > heap[child].g)))
+      child++;
+    if (last.f < heap[child].f || (last.f == heap[child].f && last.g >= heap[child].g))
+      break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = last;
+
+  return top;
+}
+
+static int bfs_search(room_rnum src, room_rnum target)
+{
+  int head = 0, tail = 0, dir;
+  room_rnum room, to;
+
+  path_new_search();
+
+  seen_gen[src] = search_gen;
+  came_from[src] = NOWHERE;
+  queue[tail++] = src;
+
+  while (head < tail) {
+    room = queue[head++];
+    for (dir = 0; dir < DIR_COUNT; dir++) {
+      if ((to = path_edge(room, dir)) == NOWHERE || seen_gen[to] == search_gen)
+        continue;
+      seen_gen[to] = search_gen;
+      came_from[to] = room;
+      came_dir[to] = dir;
+      if (to == target)
+        return TRUE;
+      queue[tail++] = to;
+    }
+  }
+
+  return FALSE;
+}
+
+static int astar_search(room_rnum src, room_rnum target)
+{
+  struct path_node node;
+  room_rnum to;
+  int dir, h;
+
+  zone_hops_build(world[target].zone);
+  if (zone_hops[world[src].zone] < 0)
+    return FALSE;
+
+  path_new_search();
+
+  seen_gen[src] = search_gen;
+  came_from[src] = NOWHERE;
+  cost[src] = 0;
+  heap_count = 0;
+  heap_push(zone_hops[world[src].zone], 0, src);
+
+  while (heap_count > 0) {
+    node = heap_pop();
+    if (closed_gen[node.room] == search_gen || node.g > cost[node.room])
+      continue;
+    if (node.room == target)
+      return TRUE;
+    closed_gen[node.room] = search_gen;
+
+    for (dir = 0; dir < DIR_COUNT; dir++) {
+      if ((to = path_edge(node.room, dir)) == NOWHERE || closed_gen[to] == search_gen)
+        continue;
+      if ((h = zone_hops[world[to].zone]) < 0)
+        continue;
+      if (seen_gen[to] == search_gen && cost[to] <= node.g + 1)
+        continue;
+      seen_gen[to] = search_gen;
+      cost[to] = node.g + 1;
+      came_from[to] = node.room;
+      came_dir[to] = dir;
+      heap_push(node.g + 1 + h, node.g + 1, to);
+    }
+  }
+
+  return FALSE;
+}
+
+/* Walk came_from[] back from the target.  Returns the first direction. */
+static int path_store(room_rnum src, room_rnum target, struct path_data **path)
+{
+  struct path_data *p;
+  room_rnum room;
+  int len, i;
+
+  if (!path) {
+    for (room = target; came_from[room] != src; room = came_from[room])
+      ;
+    return came_dir[room];
+  }
+
+  for (len = 0, room = target; room != src; room = came_from[room])
+    len++;
+
+  if ((p = *path) == NULL)
+    CREATE(p, struct path_data, 1);
+  if (p->size < len) {
+    RECREATE(p->rooms, room_rnum, len + 1);
+    RECREATE(p->dirs, sbyte, len);
+    p->size = len;
+  }
+
+  for (i = len, room = target; room != src; room = came_from[room]) {
+    p->rooms[i--] = room;
+    p->dirs[i] = came_dir[room];
+  }
+  p->rooms[0] = src;
+  p->len = len;
+  p->pos = 0;
+  p->world_gen = world_gen;
+  *path = p;
+
+  return p->dirs[0];
+}
+
+/** Finds a shortest route from src to target.
+ * @param src Room to start in.
+ * @param target Room to reach.
+ * @param flags PATHF_ASTAR to guide the search by zone distance.
+ * @param path If not NULL, receives the whole route; an existing path_data
+ * is reused.
+ * @retval int The first direction to take, or one of BFS_ERROR,
+ * BFS_ALREADY_THERE or BFS_NO_PATH. */
+int find_path(room_rnum src, room_rnum target, int flags, struct path_data **path)
+{
+  int found;
+
+  if (src == NOWHERE || target == NOWHERE || src > top_of_world || target > top_of_world) {
+    log("SYSERR: Illegal value %d or %d passed to find_path. (%s)", src, target, __FILE__);
+    return (BFS_ERROR);
+  }
+  if (src == target)
+    return (BFS_ALREADY_THERE);
+
+  if (IS_SET(flags, PATHF_ASTAR) && world[src].zone != world[target].zone &&
+      world[target].zone <= top_of_zone_table && world[src].zone <= top_of_zone_table)
+    found = astar_search(src, target);
+  else
+    found = bfs_search(src, target);
+
+  if (!found) {
+    if (path && *path)
+      (*path)->len = 0;
+    return (BFS_NO_PATH);
+  }
+
+  return path_store(src, target, path);
+}
+
+/** Given a source room and a target room, find the first step on the
+ * shortest path from the source to the target. */
+int find_first_step(room_rnum src, room_rnum target)
+{
+  return find_path(src, target, 0, NULL);
+}
+
+/** Like find_path(), but follows a route found earlier when it still leads
+ * from src to target.  Callers keep one path_data per tracker and call this
+ * once per step.
+ * @param path The tracker's route; allocated on first use.
+ * @param src Room the tracker is in now.
+ * @param target Room to reach.
+ * @param flags As for find_path().
+ * @retval int The direction to take, or one of the BFS_ codes. */
+int path_next_step(struct path_data **path, room_rnum src, room_rnum target, int flags)
+{
+  struct path_data *p = *path;
+
+  if (src != target && p && p->len > 0 && p->world_gen == world_gen &&
+      p->rooms[p->len] == target) {
+    /* The tracker has usually taken the step we handed out last time. */
+    if (p->pos < p->len && p->rooms[p->pos] != src && p->rooms[p->pos + 1] == src)
+      p->pos++;
+    if (p->pos < p->len && p->rooms[p->pos] == src &&
+        path_edge(src, p->dirs[p->pos]) == p->rooms[p->pos + 1])
+      return p->dirs[p->pos];
+  }
+
+  return find_path(src, target, flags, path);
+}
+
+void free_path(struct path_data *path)
+{
+  if (!path)
+    return;
+  if (path->rooms)
+    free(path->rooms);
+  if (path->dirs)
+    free(path->dirs);
+  free(path);
+}
+
+/** Call when rooms are added, removed or their exits rewired.  Cached routes
+ * and the zone graph are rebuilt on their next use. */
+void pathfind_world_changed(void)
+{
+  world_gen++;
+}
+
+void pathfind_free(void)
+{
+  if (seen_gen) free(seen_gen);
+  if (closed_gen) free(closed_gen);
+  if (came_from) free(came_from);
+  if (came_dir) free(came_dir);
+  if (cost) free(cost);
+  if (queue) free(queue);
+  if (heap) free(heap);
+  if (zone_adj_start) free(zone_adj_start);
+  if (zone_adj) free(zone_adj);
+  if (zone_hops) free(zone_hops);
+
+  seen_gen = closed_gen = NULL;
+  came_from = queue = NULL;
+  came_dir = NULL;
+  cost = zone_hops = zone_adj_start = NULL;
+  zone_adj = NULL;
+  heap = NULL;
+  scratch_size = heap_size = heap_count = zone_count = 0;
+  hops_target = NOWHERE;
+  world_gen++;
+}
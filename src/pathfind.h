@@ -0,0 +1,33 @@
+/**
+* @file pathfind.h
+* Shortest-path searches over the room graph.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*/
+#ifndef _PATHFIND_H_
+#define _PATHFIND_H_
+
+/* Flags for find_path() and path_next_step() */
+#define PATHF_ASTAR  (1 << 0)  /**< Guide the search with zone distances */
+
+/** A route between two rooms, as returned by find_path(). */
+struct path_data {
+  room_rnum *rooms;        /**< rooms[0] is the start, rooms[len] the goal */
+  sbyte *dirs;             /**< dirs[i] leads from rooms[i] to rooms[i + 1] */
+  int len;                 /**< Number of steps in the route */
+  int size;                /**< Allocated steps in rooms[] and dirs[] */
+  int pos;                 /**< Index in rooms[] of the next expected room */
+  unsigned int world_gen;  /**< pathfind_world_changed() count when found */
+};
+
+int find_first_step(room_rnum src, room_rnum target);
+int find_path(room_rnum src, room_rnum target, int flags, struct path_data **path);
+int path_next_step(struct path_data **path, room_rnum src, room_rnum target, int flags);
+void free_path(struct path_data *path);
+void pathfind_world_changed(void);
+void pathfind_free(void);
+
+#endif /* _PATHFIND_H_ */
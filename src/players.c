@@ -27,6 +27,8 @@
 #include "config.h" /* for pclean_criteria[] */
 #include "dg_scripts.h" /* To enable saving of player variables to disk */
 #include "quest.h"
+#include "savequeue.h"
+#include "ptable.h"
 
 #include "race.h"
 
@@ -67,6 +69,7 @@ void build_player_index(void)
   sprintf(index_name, "%s%s", LIB_PLRFILES, INDEX_FILE);
   if (!(plr_index = fopen(index_name, "r"))) {
     top_of_p_table = -1;
+    ptable_hash_rebuild();
     log("No player index file!  First new char will be IMP!");
     return;
   }
@@ -79,6 +82,7 @@ void build_player_index(void)
   if (rec_count == 0) {
     player_table = NULL;
     top_of_p_table = -1;
+    ptable_hash_rebuild();
     return;
   }
 
@@ -95,6 +99,7 @@ void build_player_index(void)
 
   fclose(plr_index);
   top_of_p_file = top_of_p_table = i - 1;
+  ptable_hash_rebuild();
 }
 
 /* Create a new entry in the in-memory index table for the player file. If the
@@ -123,6 +128,8 @@ int create_entry(char *name)
   /* clear the bitflag in case we have garbage data */
   player_table[pos].flags = 0;
 
+  ptable_hash_add(pos);
+
   return (pos);
 }
 
@@ -159,6 +166,9 @@ static void remove_player_from_index(int pos)
     free(player_table);
     player_table = NULL;
   }
+
+  /* Everything after pos moved down one. */
+  ptable_hash_rebuild();
 }
 
 /* This function necessary to save a seperate ASCII player index */
@@ -166,10 +176,11 @@ void save_player_index(void)
 {
   int i;
   char index_name[50], bits[64];
+  struct save_file sf;
   FILE *index_file;
 
   sprintf(index_name, "%s%s", LIB_PLRFILES, INDEX_FILE);
-  if (!(index_file = fopen(index_name, "w"))) {
+  if (!(index_file = save_file_open(&sf, index_name))) {
     log("SYSERR: Could not write player index file");
     return;
   }
@@ -183,7 +194,7 @@ void save_player_index(void)
     }
   fprintf(index_file, "~\n");
 
-  fclose(index_file);
+  save_file_close(&sf);
 }
 
 void free_player_index(void)
@@ -200,26 +211,25 @@ void free_player_index(void)
   free(player_table);
   player_table = NULL;
   top_of_p_table = 0;
+  ptable_hash_free();
 }
 
 long get_ptable_by_name(const char *name)
 {
-  int i;
-
-  for (i = 0; i <= top_of_p_table; i++)
-    if (!str_cmp(player_table[i].name, name))
-      return (i);
+  return (ptable_hash_name(name));
+}
 
-  return (-1);
+long get_ptable_by_id(long id)
+{
+  return (ptable_hash_id(id));
 }
 
 long get_id_by_name(const char *name)
 {
   int i;
 
-  for (i = 0; i <= top_of_p_table; i++)
-    if (!str_cmp(player_table[i].name, name))
-      return (player_table[i].id);
+  if ((i = ptable_hash_name(name)) != -1)
+    return (player_table[i].id);
 
   return (-1);
 }
@@ -228,9 +238,8 @@ char *get_name_by_id(long id)
 {
   int i;
 
-  for (i = 0; i <= top_of_p_table; i++)
-    if (player_table[i].id == id)
-      return (player_table[i].name);
+  if ((i = ptable_hash_id(id)) != -1)
+    return (player_table[i].name);
 
   return (NULL);
 }
@@ -316,6 +325,7 @@ int load_char(const char *name, struct char_data *ch)
     if (!get_filename(filename, sizeof(filename), PLR_FILE, name))
       
       return (-1);
+    save_queue_wait(filename);
     if (!(fl = fopen(filename, "r"))) {
       mudlog(NRM, LVL_GOD, TRUE, "SYSERR: Couldn't open player file %s", filename);
       return (-1);
@@ -641,6 +651,7 @@ int load_char(const char *name, struct char_data *ch)
 /* This is the ASCII Player Files save routine. */
 void save_char(struct char_data * ch)
 {
+  struct save_file sf;
   FILE *fl;
   char filename[40], buf[MAX_STRING_LENGTH], bits[127], bits2[127], bits3[127], bits4[127];
   int i, j, id, save_index = FALSE;
@@ -671,7 +682,7 @@ void save_char(struct char_data * ch)
 
   if (!get_filename(filename, sizeof(filename), PLR_FILE, GET_NAME(ch)))
     return;
-  if (!(fl = fopen(filename, "w"))) {
+  if (!(fl = save_file_open(&sf, filename))) {
     mudlog(NRM, LVL_GOD, TRUE, "SYSERR: Couldn't open player file %s for write", filename);
     return;
   }
@@ -864,7 +875,8 @@ void save_char(struct char_data * ch)
   write_aliases_ascii(fl, ch);
   save_char_vars_ascii(fl, ch);
 
-  fclose(fl);
+  /* Queue the snapshot; the file is replaced off the game thread. */
+  save_file_close(&sf);
 
   /* More char_to_store code to add spell and eq affections back in. */
   for (i = 0; i < MAX_AFFECT; i++) {
@@ -958,8 +970,10 @@ void remove_player(int pfilepos)
 
   /* Unlink all player-owned files */
   for (i = 0; i < MAX_FILES; i++) {
-    if (get_filename(filename, sizeof(filename), i, player_table[pfilepos].name))
+    if (get_filename(filename, sizeof(filename), i, player_table[pfilepos].name)) {
+      save_queue_discard(filename);
       unlink(filename);
+    }
   }
 
   strftime(timestr, sizeof(timestr), "%c", localtime(&(player_table[pfilepos].last)));
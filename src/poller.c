@@ -0,0 +1,365 @@
+/**
+* @file poller.c
+* Socket readiness polling for the main game loop.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*
+* game_loop() asks the poller which sockets are ready instead of building
+* fd_sets itself.  On Linux the poller uses edge-triggered epoll, so the cost
+* of a pass grows with the number of sockets that actually have something to
+* do, and the number of connections is not bounded by FD_SETSIZE.  Everywhere
+* else (or if epoll cannot be created) the classic select() loop is used.
+*
+* Readiness is kept in descriptor_data.poll_events.  Because epoll only
+* reports edges, a READ bit stays set until a read hits EWOULDBLOCK
+* (poller_read_drained) and a WRITE bit stays set until a write does
+* (poller_write_blocked).  Descriptors with READ or ERROR set are kept on a
+* ready list that game_loop() walks instead of descriptor_list.
+*/
+
+#include "conf.h"
+#include "sysdep.h"
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "poller.h"
+
+#ifndef INVALID_SOCKET
+#define INVALID_SOCKET (-1)
+#endif
+
+/** How many epoll events are fetched per epoll_wait() call. */
+#define POLLER_MAX_EVENTS 256
+
+static int backend = POLLER_SELECT;
+static socket_t poll_mother = INVALID_SOCKET;
+static int mother_ready = FALSE;
+static struct descriptor_data *ready_list = NULL;
+
+#ifdef HAVE_SYS_EPOLL_H
+static int epoll_fd = -1;
+static struct epoll_event poll_events[POLLER_MAX_EVENTS];
+#endif
+
+/* Put a descriptor on the ready list if it is not there already. */
+static void poller_queue(struct descriptor_data *d)
+{
+  if (IS_SET(d->poll_events, POLLER_QUEUED))
+    return;
+
+  SET_BIT(d->poll_events, POLLER_QUEUED);
+  d->poll_next = ready_list;
+  ready_list = d;
+}
+
+/* Drop descriptors from the ready list that have nothing left to do. */
+static void poller_prune(void)
+{
+  struct descriptor_data *d, *next_d, *prev = NULL;
+
+  for (d = ready_list; d; d = next_d) {
+    next_d = d->poll_next;
+    if (d->poll_events & (POLLER_READ | POLLER_ERROR)) {
+      prev = d;
+      continue;
+    }
+    REMOVE_BIT(d->poll_events, POLLER_QUEUED);
+    d->poll_next = NULL;
+    if (prev)
+      prev->poll_next = next_d;
+    else
+      ready_list = next_d;
+  }
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/* Fetch pending epoll events and fold them into the descriptors.  Returns the
+ * number of events seen, or -1 on error. */
+static int epoll_collect(int timeout_ms)
+{
+  struct descriptor_data *d;
+  int i, n, total = 0;
+
+  do {
+    n = epoll_wait(epoll_fd, poll_events, POLLER_MAX_EVENTS, timeout_ms);
+    if (n < 0)
+      return (-1);
+
+    for (i = 0; i < n; i++) {
+      if (poll_events[i].data.ptr == NULL) {
+        mother_ready = TRUE;
+        continue;
+      }
+      d = (struct descriptor_data *) poll_events[i].data.ptr;
+
+      if (poll_events[i].events & (EPOLLERR | EPOLLPRI))
+        SET_BIT(d->poll_events, POLLER_ERROR);
+      /* A hangup is reported as readable so process_input() sees the EOF. */
+      if (poll_events[i].events & (EPOLLIN | EPOLLHUP
+#ifdef EPOLLRDHUP
+          | EPOLLRDHUP
+#endif
+          ))
+        SET_BIT(d->poll_events, POLLER_READ);
+      if (poll_events[i].events & EPOLLOUT)
+        SET_BIT(d->poll_events, POLLER_WRITE);
+
+      if (d->poll_events & (POLLER_READ | POLLER_ERROR))
+        poller_queue(d);
+    }
+    total += n;
+    timeout_ms = 0;
+  } while (n == POLLER_MAX_EVENTS);
+
+  return (total);
+}
+#endif
+
+/* Choose a backend.  Must be called before any descriptor is added. */
+void poller_init(void)
+{
+  backend = POLLER_SELECT;
+  ready_list = NULL;
+  mother_ready = FALSE;
+
+#ifdef HAVE_SYS_EPOLL_H
+  /* Close-on-exec: a copyover must not leak the epoll instance. */
+  if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+    perror("SYSERR: epoll_create1, falling back to select()");
+  else
+    backend = POLLER_EPOLL;
+#endif
+
+  log("Using %s for socket polling.", poller_backend_name());
+}
+
+void poller_shutdown(void)
+{
+#ifdef HAVE_SYS_EPOLL_H
+  if (epoll_fd >= 0)
+    close(epoll_fd);
+  epoll_fd = -1;
+#endif
+  backend = POLLER_SELECT;
+  ready_list = NULL;
+}
+
+/* Register the listening socket.  Its readiness is kept in mother_ready. */
+void poller_set_mother(socket_t mother)
+{
+  poll_mother = mother;
+  mother_ready = FALSE;
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (backend == POLLER_EPOLL) {
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, mother, &ev) < 0) {
+      perror("SYSERR: epoll_ctl(mother)");
+      exit(1);
+    }
+    /* Connections may have queued up before we were watching (copyover). */
+    mother_ready = TRUE;
+  }
+#endif
+}
+
+/* Can this socket be watched by the current backend? */
+int poller_fd_ok(socket_t s)
+{
+#if !defined(CIRCLE_WINDOWS) && defined(FD_SETSIZE)
+  if (backend == POLLER_SELECT && s >= FD_SETSIZE)
+    return (FALSE);
+#endif
+  return (TRUE);
+}
+
+/* The most sockets the backend can watch at once, or -1 for no limit. */
+int poller_max_descriptors(void)
+{
+#if !defined(CIRCLE_WINDOWS) && defined(FD_SETSIZE)
+  if (backend == POLLER_SELECT)
+    return (FD_SETSIZE);
+#endif
+  return (-1);
+}
+
+void poller_add(struct descriptor_data *d)
+{
+  /* A fresh socket is writable; epoll will not tell us so until it isn't. */
+  d->poll_events = POLLER_WRITE;
+  d->poll_next = NULL;
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (backend == POLLER_EPOLL) {
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLET;
+#ifdef EPOLLRDHUP
+    ev.events |= EPOLLRDHUP;
+#endif
+    ev.data.ptr = d;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, d->descriptor, &ev) < 0) {
+      perror("SYSERR: epoll_ctl(add)");
+      SET_BIT(d->poll_events, POLLER_ERROR);
+    }
+    /* Input may already be waiting (copyover), so try a read once. */
+    SET_BIT(d->poll_events, POLLER_READ);
+    poller_queue(d);
+  }
+#endif
+}
+
+/* Forget a descriptor.  Must be called before its socket is closed. */
+void poller_remove(struct descriptor_data *d)
+{
+  struct descriptor_data *temp;
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (backend == POLLER_EPOLL)
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, d->descriptor, NULL);
+#endif
+
+  if (IS_SET(d->poll_events, POLLER_QUEUED)) {
+    REMOVE_FROM_LIST(d, ready_list, poll_next);
+  }
+  d->poll_events = 0;
+  d->poll_next = NULL;
+}
+
+/* Block until a new connection arrives on the mother socket.  Used when
+ * nobody is connected.  Returns -1 (with errno set) on error. */
+int poller_sleep(void)
+{
+  if (mother_ready)
+    return (0);
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (backend == POLLER_EPOLL) {
+    while (!mother_ready)
+      if (epoll_collect(-1) < 0)
+        return (-1);
+    return (0);
+  }
+#endif
+
+  {
+    fd_set input_set;
+
+    FD_ZERO(&input_set);
+    FD_SET(poll_mother, &input_set);
+    if (select(poll_mother + 1, &input_set, (fd_set *) 0, (fd_set *) 0, NULL) < 0)
+      return (-1);
+    if (FD_ISSET(poll_mother, &input_set))
+      mother_ready = TRUE;
+  }
+  return (0);
+}
+
+/* Poll, without blocking, for new connections, input, output room and
+ * exceptions.  Returns -1 on error. */
+int poller_poll(void)
+{
+  poller_prune();
+
+#ifdef HAVE_SYS_EPOLL_H
+  if (backend == POLLER_EPOLL)
+    return (epoll_collect(0) < 0 ? -1 : 0);
+#endif
+
+  {
+    fd_set input_set, output_set, exc_set;
+    struct timeval null_time;
+    struct descriptor_data *d;
+    socket_t maxdesc = poll_mother;
+
+    null_time.tv_sec = 0;
+    null_time.tv_usec = 0;
+
+    FD_ZERO(&input_set);
+    FD_ZERO(&output_set);
+    FD_ZERO(&exc_set);
+    FD_SET(poll_mother, &input_set);
+
+    for (d = descriptor_list; d; d = d->next) {
+#ifndef CIRCLE_WINDOWS
+      if (d->descriptor > maxdesc)
+        maxdesc = d->descriptor;
+#endif
+      FD_SET(d->descriptor, &input_set);
+      FD_SET(d->descriptor, &output_set);
+      FD_SET(d->descriptor, &exc_set);
+    }
+
+    if (select(maxdesc + 1, &input_set, &output_set, &exc_set, &null_time) < 0)
+      return (-1);
+
+    /* select() is level-triggered, so readiness is rebuilt every pass. */
+    mother_ready = FD_ISSET(poll_mother, &input_set) ? TRUE : FALSE;
+
+    for (d = descriptor_list; d; d = d->next) {
+      d->poll_events &= POLLER_QUEUED;
+      if (FD_ISSET(d->descriptor, &exc_set))
+        SET_BIT(d->poll_events, POLLER_ERROR);
+      if (FD_ISSET(d->descriptor, &input_set))
+        SET_BIT(d->poll_events, POLLER_READ);
+      if (FD_ISSET(d->descriptor, &output_set))
+        SET_BIT(d->poll_events, POLLER_WRITE);
+      if (d->poll_events & (POLLER_READ | POLLER_ERROR))
+        poller_queue(d);
+    }
+  }
+
+  return (0);
+}
+
+int poller_mother_ready(void)
+{
+  return (mother_ready);
+}
+
+/* accept() said there is nothing more waiting. */
+void poller_mother_drained(void)
+{
+  mother_ready = FALSE;
+}
+
+/* Descriptors with pending input or exceptions, linked through poll_next. */
+struct descriptor_data *poller_ready_list(void)
+{
+  return (ready_list);
+}
+
+/* A read on this descriptor would block. */
+void poller_read_drained(struct descriptor_data *d)
+{
+  REMOVE_BIT(d->poll_events, POLLER_READ);
+}
+
+/* The kernel send buffer for this descriptor is full. */
+void poller_write_blocked(struct descriptor_data *d)
+{
+  REMOVE_BIT(d->poll_events, POLLER_WRITE);
+}
+
+int poller_backend(void)
+{
+  return (backend);
+}
+
+const char *poller_backend_name(void)
+{
+  return (backend == POLLER_EPOLL ? "epoll" : "select()");
+}
@@ -0,0 +1,40 @@
+/**
+* @file poller.h
+* Socket readiness polling for the main game loop.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*/
+#ifndef _POLLER_H_
+#define _POLLER_H_
+
+/* Readiness bits kept in descriptor_data.poll_events */
+#define POLLER_READ    (1 << 0)  /**< input (or EOF) is waiting to be read */
+#define POLLER_WRITE   (1 << 1)  /**< the kernel send buffer has room */
+#define POLLER_ERROR   (1 << 2)  /**< exceptional condition, drop the link */
+#define POLLER_QUEUED  (1 << 3)  /**< internal: on the ready list */
+
+/* Backends, see poller_backend() */
+#define POLLER_SELECT  0
+#define POLLER_EPOLL   1
+
+void poller_init(void);
+void poller_shutdown(void);
+void poller_set_mother(socket_t mother);
+int  poller_fd_ok(socket_t s);
+int  poller_max_descriptors(void);
+void poller_add(struct descriptor_data *d);
+void poller_remove(struct descriptor_data *d);
+int  poller_sleep(void);
+int  poller_poll(void);
+int  poller_mother_ready(void);
+void poller_mother_drained(void);
+struct descriptor_data *poller_ready_list(void);
+void poller_read_drained(struct descriptor_data *d);
+void poller_write_blocked(struct descriptor_data *d);
+int  poller_backend(void);
+const char *poller_backend_name(void);
+
+#endif /* _POLLER_H_ */
@@ -0,0 +1,478 @@
+/**
+* @file profiler.c
+* Where the time of each pulse goes.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*
+* game_loop() only noticed a slow pulse once whole seconds of pulses had
+* been missed, and could not say what had been slow.  Now every phase of a
+* pass, every command, trigger and special procedure charges the time it
+* took, read from the monotonic clock, to an entry of its own.
+*
+* Each entry keeps a histogram for the current PROFILE_WINDOW seconds and
+* one for the window before, so 'show profile' covers between one and two
+* windows of play.  A power of two is split into four buckets, which puts
+* the p50 and p99 it reports within a quarter of the true value.  Samples
+* nest: a trigger fired by a command counts for both, and both count for
+* the phase they ran in.
+*
+* A pass that takes longer than OPT_USEC is logged with the phases and
+* entries that took longest in it, at most once per PROF_REPORT_PULSES so a
+* struggling game does not also flood its log.
+*/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "interpreter.h"
+#include "db.h"
+#include "dg_scripts.h"
+#include "spec_procs.h"
+#include "profiler.h"
+
+#define PROF_SUB_BITS      2     /* a power of two is split 1 << this ways */
+#define PROF_BUCKETS       116   /* the last one starts at about 15 minutes */
+#define PROF_HASH_SIZE     512
+#define PROF_NAME_LENGTH   32
+#define PROF_MAX_TOUCHED   256   /* entries one slow-pulse report can name */
+#define PROF_REPORT_PHASES 3
+#define PROF_REPORT_OTHERS 5
+#define PROF_WINDOW_PULSES (PROFILE_WINDOW RL_SEC)
+#define PROF_REPORT_PULSES (10 RL_SEC)
+
+/* The samples of one entry in one window. */
+struct prof_window {
+  unsigned int bucket[PROF_BUCKETS];
+  unsigned long samples;
+  long total;
+  long max;
+};
+
+struct prof_entry {
+  int kind;
+  long id;
+  char name[PROF_NAME_LENGTH];
+  unsigned long epoch;            /* the window window[0] is for */
+  struct prof_window window[2];   /* this window and the one before */
+  unsigned long pulse_serial;     /* the pass pulse_usec is for */
+  long pulse_usec;
+  struct prof_entry *next;        /* in its hash chain */
+};
+
+/* local functions */
+static int bucket_of(long usec);
+static long bucket_top(int bucket);
+static struct prof_entry *find_entry(int kind, long id);
+static struct prof_entry *new_entry(int kind, long id);
+static struct prof_entry *get_entry(int kind, long id);
+static void sync_window(struct prof_entry *e);
+static long charge(struct prof_entry *e, long start);
+static long percentile(struct prof_window *w, int num, int pct);
+static int by_pulse_usec(const void *a, const void *b);
+static int by_total(const void *a, const void *b);
+static long window_total(struct prof_entry *e);
+static long window_max(struct prof_entry *e);
+static void report_slow_pulse(long usec);
+
+static const char *phase_names[NUM_PHASES] = {
+  "pulse", "input", "commands", "output", "events", "script checks",
+  "zone update", "mobile activity", "violence", "tick", "affects", "points",
+  "autosave", "extractions", "other"
+};
+
+static const char *kind_titles[NUM_PROF_KINDS] = {
+  "Phase", "Command", "Trigger", "Special"
+};
+
+/* How an entry of each kind is introduced in a slow-pulse report. */
+static const char *kind_words[NUM_PROF_KINDS] = {
+  "", "command ", "trigger ", "special "
+};
+
+static struct prof_entry *prof_hash[PROF_HASH_SIZE];
+static int num_entries[NUM_PROF_KINDS];
+static struct profile_stats stats;
+static struct prof_window run_pulses;   /* every pass since the last reset */
+
+static unsigned long serial = 0;        /* passes started */
+static int in_pulse = FALSE;
+static struct prof_entry *touched[PROF_MAX_TOUCHED];
+static int num_touched = 0;
+static unsigned long last_report = 0;   /* pass of the last slow-pulse report */
+static unsigned long unreported = 0;    /* slow passes since then */
+
+/** @return The monotonic clock, in microseconds. */
+long profile_clock(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec * 1000000L + now.tv_nsec / 1000);
+#else
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec * 1000000L + now.tv_usec);
+#endif
+}
+
+static int bucket_of(long usec)
+{
+  unsigned long v;
+  int shift = 0;
+
+  if (usec < (1 << PROF_SUB_BITS))
+    return (usec > 0 ? (int) usec : 0);
+
+  for (v = usec; v >> (PROF_SUB_BITS + 1); v >>= 1)
+    shift++;
+
+  return (MIN(((shift + 1) << PROF_SUB_BITS) + (int) v - (1 << PROF_SUB_BITS),
+    PROF_BUCKETS - 1));
+}
+
+/* The longest time that falls in a bucket. */
+static long bucket_top(int bucket)
+{
+  int shift = (bucket >> PROF_SUB_BITS) - 1;
+  long sub = bucket & ((1 << PROF_SUB_BITS) - 1);
+
+  if (bucket < (1 << PROF_SUB_BITS))
+    return (bucket);
+
+  return (((sub + (1 << PROF_SUB_BITS) + 1) << shift) - 1);
+}
+
+static struct prof_entry *find_entry(int kind, long id)
+{
+  struct prof_entry *e;
+  unsigned long h = ((unsigned long) id * 2654435761UL + kind) >> 4;
+
+  for (e = prof_hash[h % PROF_HASH_SIZE]; e; e = e->next)
+    if (e->id == id && e->kind == kind)
+      return (e);
+
+  return (NULL);
+}
+
+/* Names are taken when the entry is made, so one for a command or trigger
+ * that is later renumbered or renamed keeps the name it was timed under. */
+static struct prof_entry *new_entry(int kind, long id)
+{
+  struct prof_entry *e;
+  unsigned long h = ((unsigned long) id * 2654435761UL + kind) >> 4;
+  trig_rnum rnum;
+
+  CREATE(e, struct prof_entry, 1);
+  e->kind = kind;
+  e->id = id;
+  e->epoch = serial / PROF_WINDOW_PULSES;
+
+  switch (kind) {
+  case PROF_PHASE:
+    snprintf(e->name, sizeof(e->name), "%s", phase_names[id]);
+    break;
+  case PROF_COMMAND:
+    snprintf(e->name, sizeof(e->name), "%s", complete_cmd_info[id].command);
+    break;
+  case PROF_TRIGGER:
+    rnum = real_trigger(id);
+    snprintf(e->name, sizeof(e->name), "[%ld] %s", id,
+      rnum != NOTHING ? GET_TRIG_NAME(trig_index[rnum]->proto) : "");
+    break;
+  }
+
+  e->next = prof_hash[h % PROF_HASH_SIZE];
+  prof_hash[h % PROF_HASH_SIZE] = e;
+  num_entries[kind]++;
+  return (e);
+}
+
+static struct prof_entry *get_entry(int kind, long id)
+{
+  struct prof_entry *e = find_entry(kind, id);
+
+  return (e ? e : new_entry(kind, id));
+}
+
+/* Moves an entry on to the current window, keeping the last one if it has
+ * just ended. */
+static void sync_window(struct prof_entry *e)
+{
+  unsigned long epoch = serial / PROF_WINDOW_PULSES;
+
+  if (e->epoch == epoch)
+    return;
+
+  if (e->epoch + 1 == epoch)
+    e->window[1] = e->window[0];
+  else
+    memset(&e->window[1], 0, sizeof(e->window[1]));
+  memset(&e->window[0], 0, sizeof(e->window[0]));
+  e->epoch = epoch;
+}
+
+/* Adds the time since start to an entry, and to what it has taken in this
+ * pass.  Returns the time now. */
+static long charge(struct prof_entry *e, long start)
+{
+  long now = profile_clock(), usec = now - start;
+  struct prof_window *w;
+
+  sync_window(e);
+  w = &e->window[0];
+  w->bucket[bucket_of(usec)]++;
+  w->samples++;
+  w->total += usec;
+  if (usec > w->max)
+    w->max = usec;
+
+  if (in_pulse) {
+    if (e->pulse_serial != serial) {
+      e->pulse_serial = serial;
+      e->pulse_usec = 0;
+      if (num_touched < PROF_MAX_TOUCHED)
+        touched[num_touched++] = e;
+    }
+    e->pulse_usec += usec;
+  }
+  return (now);
+}
+
+/** Charges the time since start to an entry.
+ * @param kind One of the PROF_ kinds.
+ * @param id What is being timed, as the kind has it.
+ * @param start When it started, from profile_clock().
+ * @return The time now, to start whatever is timed next. */
+long profile_add(int kind, long id, long start)
+{
+  return (charge(get_entry(kind, id), start));
+}
+
+/** Calls a special procedure, charging the time it takes to it. */
+int profile_special(SPECIAL(*func), struct char_data *ch, void *me, int cmd, char *argument)
+{
+  long start = profile_clock(), id = (long) (size_t) func;
+  struct prof_entry *e;
+  const char *name;
+  int result = func(ch, me, cmd, argument);
+
+  if (!(e = find_entry(PROF_SPECIAL, id))) {
+    e = new_entry(PROF_SPECIAL, id);
+    name = get_spec_func_name(func);
+    snprintf(e->name, sizeof(e->name), "%s", name ? name : "unlisted");
+  }
+  charge(e, start);
+  return (result);
+}
+
+/** Starts timing a pass through game_loop().
+ * @return The time now, for profile_pulse_end(). */
+long profile_pulse_start(void)
+{
+  serial++;
+  num_touched = 0;
+  in_pulse = TRUE;
+  return (profile_clock());
+}
+
+/** Ends the pass started at start, and reports it if it was too slow.
+ * @return How long the pass took, in microseconds. */
+long profile_pulse_end(long start)
+{
+  long usec;
+
+  in_pulse = FALSE;
+  usec = charge(get_entry(PROF_PHASE, PHASE_PULSE), start) - start;
+
+  run_pulses.bucket[bucket_of(usec)]++;
+  run_pulses.samples++;
+  run_pulses.total += usec;
+  if (usec > run_pulses.max)
+    run_pulses.max = usec;
+
+  stats.pulses++;
+  if (usec > stats.worst)
+    stats.worst = usec;
+
+  if (usec <= OPT_USEC)
+    return (usec);
+
+  stats.slow++;
+  if (last_report && serial - last_report < PROF_REPORT_PULSES) {
+    unreported++;
+    return (usec);
+  }
+  report_slow_pulse(usec);
+  last_report = serial;
+  unreported = 0;
+  return (usec);
+}
+
+static int by_pulse_usec(const void *a, const void *b)
+{
+  long ta = (*(struct prof_entry * const *) a)->pulse_usec;
+  long tb = (*(struct prof_entry * const *) b)->pulse_usec;
+
+  return (ta < tb ? 1 : ta > tb ? -1 : 0);
+}
+
+static void report_slow_pulse(long usec)
+{
+  char *buf = stats.last_slow;
+  size_t len;
+  int i, phases = 0, others = 0;
+
+  qsort(touched, num_touched, sizeof(*touched), by_pulse_usec);
+
+  len = snprintf(buf, PROFILE_REPORT_LENGTH, "Slow pulse: %.1f ms of %d ms.",
+    usec / 1000.0, OPT_USEC / 1000);
+
+  for (i = 0; i < num_touched && phases < PROF_REPORT_PHASES; i++)
+    if (touched[i]->kind == PROF_PHASE && touched[i]->id != PHASE_PULSE &&
+        len < PROFILE_REPORT_LENGTH)
+      len += snprintf(buf + len, PROFILE_REPORT_LENGTH - len, "%s %s %.1f ms",
+        phases++ ? "," : " Phases:", touched[i]->name,
+        touched[i]->pulse_usec / 1000.0);
+
+  for (i = 0; i < num_touched && others < PROF_REPORT_OTHERS; i++)
+    if (touched[i]->kind != PROF_PHASE && len < PROFILE_REPORT_LENGTH)
+      len += snprintf(buf + len, PROFILE_REPORT_LENGTH - len, "%s %s%s %.1f ms",
+        others++ ? "," : (phases ? "; slowest:" : " Slowest:"),
+        kind_words[touched[i]->kind], touched[i]->name,
+        touched[i]->pulse_usec / 1000.0);
+
+  if (unreported && len < PROFILE_REPORT_LENGTH)
+    snprintf(buf + len, PROFILE_REPORT_LENGTH - len,
+      " (%lu more since the last report)", unreported);
+
+  log("%s", buf);
+}
+
+/** Forgets every sample taken so far. */
+void profile_reset(void)
+{
+  struct prof_entry *e;
+  int h;
+
+  for (h = 0; h < PROF_HASH_SIZE; h++)
+    for (e = prof_hash[h]; e; e = e->next) {
+      memset(e->window, 0, sizeof(e->window));
+      e->epoch = serial / PROF_WINDOW_PULSES;
+    }
+
+  memset(&stats, 0, sizeof(stats));
+  memset(&run_pulses, 0, sizeof(run_pulses));
+  last_report = unreported = 0;
+}
+
+void profile_stats(struct profile_stats *out)
+{
+  *out = stats;
+}
+
+static long window_total(struct prof_entry *e)
+{
+  return (e->window[0].total + e->window[1].total);
+}
+
+static long window_max(struct prof_entry *e)
+{
+  return (e->window[0].max > e->window[1].max ? e->window[0].max : e->window[1].max);
+}
+
+static int by_total(const void *a, const void *b)
+{
+  long ta = window_total(*(struct prof_entry * const *) a);
+  long tb = window_total(*(struct prof_entry * const *) b);
+
+  return (ta < tb ? 1 : ta > tb ? -1 : 0);
+}
+
+/* The time that pct percent of the samples in num windows took no more
+ * than. */
+static long percentile(struct prof_window *w, int num, int pct)
+{
+  unsigned long samples = 0, want, seen = 0;
+  long max = 0;
+  int i, j;
+
+  for (j = 0; j < num; j++) {
+    samples += w[j].samples;
+    if (w[j].max > max)
+      max = w[j].max;
+  }
+  want = (samples * pct + 99) / 100;
+
+  for (i = 0; i < PROF_BUCKETS; i++) {
+    for (j = 0; j < num; j++)
+      seen += w[j].bucket[i];
+    if (seen && seen >= want)
+      return (bucket_top(i) < max ? bucket_top(i) : max);
+  }
+  return (max);
+}
+
+/** @return The time, in microseconds, that pct percent of the passes
+ * through game_loop() since boot or the last reset took no more than. */
+long profile_pulse_percentile(int pct)
+{
+  return (percentile(&run_pulses, 1, pct));
+}
+
+/** Prints a table of the entries of one kind: the phases in order, anything
+ * else by the time it has taken, longest first.
+ * @param buf Where to print.
+ * @param size Size of buf.
+ * @param kind One of the PROF_ kinds.
+ * @param rows Most entries to print.
+ * @return Length of what was printed. */
+size_t profile_print(char *buf, size_t size, int kind, int rows)
+{
+  struct prof_entry **list, *e;
+  unsigned long samples;
+  size_t len;
+  int h, i, count = 0, shown = 0;
+
+  CREATE(list, struct prof_entry *, MAX(num_entries[kind], 1));
+  if (kind == PROF_PHASE) {
+    for (i = 0; i < NUM_PHASES; i++)
+      if ((e = find_entry(PROF_PHASE, i)) != NULL)
+        list[count++] = e;
+  } else {
+    for (h = 0; h < PROF_HASH_SIZE; h++)
+      for (e = prof_hash[h]; e; e = e->next)
+        if (e->kind == kind)
+          list[count++] = e;
+    for (i = 0; i < count; i++)
+      sync_window(list[i]);
+    qsort(list, count, sizeof(*list), by_total);
+  }
+
+  len = snprintf(buf, size, "%-30s %8s %10s %8s %8s %8s %8s\r\n",
+    kind_titles[kind], "Calls", "Total ms", "Avg ms", "p50 ms", "p99 ms", "Max ms");
+
+  for (i = 0; i < count && shown < rows && len < size; i++) {
+    e = list[i];
+    sync_window(e);
+    if (!(samples = e->window[0].samples + e->window[1].samples))
+      continue;
+    shown++;
+    len += snprintf(buf + len, size - len,
+      "%-30s %8lu %10.1f %8.2f %8.2f %8.2f %8.2f\r\n", e->name, samples,
+      window_total(e) / 1000.0, window_total(e) / 1000.0 / samples,
+      percentile(e->window, 2, 50) / 1000.0, percentile(e->window, 2, 99) / 1000.0,
+      window_max(e) / 1000.0);
+  }
+
+  if (!shown && len < size)
+    len += snprintf(buf + len, size - len, "  None timed yet.\r\n");
+
+  free(list);
+  return (len < size ? len : size - 1);
+}
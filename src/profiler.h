@@ -0,0 +1,59 @@
+/**
+* @file profiler.h
+* Where the time of each pulse goes.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*/
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+/* What a sample is charged to; the id means something different for each. */
+#define PROF_PHASE      0   /**< A part of game_loop() or heartbeat(), PHASE_ */
+#define PROF_COMMAND    1   /**< A command, by its index in complete_cmd_info */
+#define PROF_TRIGGER    2   /**< A trigger, by vnum */
+#define PROF_SPECIAL    3   /**< A special procedure, by its address */
+#define NUM_PROF_KINDS  4
+
+/* The phases of a pass through game_loop(). */
+#define PHASE_PULSE        0   /**< The whole pass, not counting the sleep */
+#define PHASE_INPUT        1   /**< Accepting and reading sockets */
+#define PHASE_COMMANDS     2   /**< Running the commands that were read */
+#define PHASE_OUTPUT       3   /**< Writing output and closing sockets */
+#define PHASE_EVENTS       4   /**< event_process() */
+#define PHASE_SCRIPTS      5   /**< script_trigger_check() */
+#define PHASE_ZONES        6   /**< zone_update() */
+#define PHASE_MOBILES      7   /**< mobile_activity() */
+#define PHASE_VIOLENCE     8   /**< perform_violence() */
+#define PHASE_TICK         9   /**< The whole tick, affects and points too */
+#define PHASE_AFFECTS     10   /**< affect_update() */
+#define PHASE_POINTS      11   /**< point_update() */
+#define PHASE_AUTOSAVE    12   /**< Crash_save_all() and House_save_all() */
+#define PHASE_EXTRACTIONS 13   /**< extract_pending_chars() */
+#define PHASE_OTHER       14   /**< Everything else heartbeat() does */
+#define NUM_PHASES        15
+
+#define PROFILE_WINDOW         60    /**< Seconds each histogram window covers */
+#define PROFILE_REPORT_LENGTH  512   /**< Longest slow-pulse report */
+
+/** Numbers for 'show profile' that are not in the tables. */
+struct profile_stats {
+  unsigned long pulses;    /**< Passes of game_loop() timed */
+  unsigned long slow;      /**< Passes that went over budget */
+  long worst;              /**< Longest pass, in microseconds */
+  char last_slow[PROFILE_REPORT_LENGTH]; /**< The last slow-pulse report */
+};
+
+long profile_clock(void);
+long profile_add(int kind, long id, long start);
+int  profile_special(SPECIAL(*func), struct char_data *ch, void *me, int cmd, char *argument);
+long profile_pulse_start(void);
+long profile_pulse_end(long start);
+long profile_pulse_percentile(int pct);
+void profile_reset(void);
+void profile_stats(struct profile_stats *stats);
+size_t profile_print(char *buf, size_t size, int kind, int rows);
+
+#endif /* _PROFILER_H_ */
@@ -45,7 +45,7 @@ static void Write( descriptor_t *apDescriptor, const char *apData )
 {
    if ( apDescriptor != NULL)
    {
-      if ( apDescriptor->pProtocol->WriteOOB > 0 || *(apDescriptor->output) == '\0' )
+      if ( apDescriptor->pProtocol->WriteOOB > 0 || apDescriptor->output_len == 0 )
       {
          apDescriptor->pProtocol->WriteOOB = 2;
       }
@@ -66,24 +66,13 @@ static void InfoMessage( descriptor_t *apDescriptor, const char *apData )
 
 static void CompressStart( descriptor_t *apDescriptor )
 {
-   /* If your mud uses MCCP (Mud Client Compression Protocol), you need to 
-    * call whatever function normally starts compression from here - the 
-    * ReportBug() call should then be deleted.
-    * 
-    * Otherwise you can just ignore this function.
-    */
-   ReportBug( "CompressStart() in protocol.c is being called, but it doesn't do anything!\n" );
+   /* The deflate stream lives with the output queue in comm.c. */
+   compress_start( apDescriptor );
 }
 
 static void CompressEnd( descriptor_t *apDescriptor )
 {
-   /* If your mud uses MCCP (Mud Client Compression Protocol), you need to 
-    * call whatever function normally starts compression from here - the 
-    * ReportBug() call should then be deleted.
-    * 
-    * Otherwise you can just ignore this function.
-    */
-   ReportBug( "CompressEnd() in protocol.c is being called, but it doesn't do anything!\n" );
+   compress_end( apDescriptor );
 }
 
 /******************************************************************************
@@ -527,7 +516,7 @@ ssize_t ProtocolInput( descriptor_t *apDescriptor, char *apData, int aSize, char
 
 const char *ProtocolOutput( descriptor_t *apDescriptor, const char *apData, int *apLength )
 {
-   static char Result[MAX_OUTPUT_BUFFER+1];
+   static char Result[MAX_PROTOCOL_OUTPUT+1];
    const char Tab[] = "\t";
    const char MSP[] = "!!";
    const char MXPStart[] = "\033[1z<";
@@ -545,7 +534,7 @@ const char *ProtocolOutput( descriptor_t *apDescriptor, const char *apData, int
    if ( pProtocol->bMSP || pProtocol->pVariables[eMSDP_SOUND]->ValueInt )
       bUseMSP = true;
 
-   for ( ; i < MAX_OUTPUT_BUFFER && apData[j] != '\0' && !bTerminate && 
+   for ( ; i < MAX_PROTOCOL_OUTPUT && apData[j] != '\0' && !bTerminate && 
       (*apLength <= 0 || j < *apLength); ++j )
    {
       if ( apData[j] == '\t' )
@@ -823,14 +812,14 @@ const char *ProtocolOutput( descriptor_t *apDescriptor, const char *apData, int
          /* Copy the colour code, if any. */
          if ( pCopyFrom != NULL )
          {
-            while ( *pCopyFrom != '\0' && i < MAX_OUTPUT_BUFFER )
+            while ( *pCopyFrom != '\0' && i < MAX_PROTOCOL_OUTPUT )
                Result[i++] = *pCopyFrom++;
          }
       }
       else if ( bUseMXP && apData[j] == '>' )
       {
          const char *pCopyFrom = MXPStop;
-         while ( *pCopyFrom != '\0' && i < MAX_OUTPUT_BUFFER)
+         while ( *pCopyFrom != '\0' && i < MAX_PROTOCOL_OUTPUT)
             Result[i++] = *pCopyFrom++;
          bUseMXP = false;
       }
@@ -847,7 +836,7 @@ const char *ProtocolOutput( descriptor_t *apDescriptor, const char *apData, int
    }
 
    /* If we'd overflow the buffer, we don't send any output */
-   if ( i >= MAX_OUTPUT_BUFFER )
+   if ( i >= MAX_PROTOCOL_OUTPUT )
    {
       i = 0;
       ReportBug("ProtocolOutput: Too much outgoing data to store in the buffer.\n");
@@ -17,9 +17,9 @@ typedef struct descriptor_data descriptor_t;
  If your mud supports MCCP (compression), uncomment the next line.
  ******************************************************************************/
 
-/*
+#ifdef HAVE_ZLIB_H
 #define USING_MCCP
-*/
+#endif
 
 /******************************************************************************
  If your offer a Mudlet GUI for autoinstallation, put the path/filename here.
@@ -38,6 +38,7 @@ typedef struct descriptor_data descriptor_t;
 #define MAX_PROTOCOL_BUFFER            MAX_RAW_INPUT_LENGTH
 #define MAX_VARIABLE_LENGTH            4096
 #define MAX_OUTPUT_BUFFER              LARGE_BUFSIZE
+#define MAX_PROTOCOL_OUTPUT            (2 * MAX_STRING_LENGTH) /* one ProtocolOutput() result */
 #define MAX_MSSP_BUFFER                4096
 
 #define SEND                           1
@@ -0,0 +1,165 @@
+/**
+* @file ptable.c
+* Hashed name and id lookups into the player index.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*
+* player_table[] holds every player who ever made a character, so scanning
+* it for a name or an id costs more the longer the mud has run.  Two open
+* addressing tables with linear probing map a name (ignoring case) and an id
+* to a position in player_table[].
+*
+* The slots hold positions only; a probe compares against the live entry.
+* A slot left behind when an entry is renamed or given a new id therefore
+* never produces a wrong answer, it just takes up room until the next
+* rebuild.  Removing a player shifts the positions after it, so that
+* rebuilds the tables outright, which costs no more than the shift itself.
+*/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+#include "ptable.h"
+
+/** Fewest slots a table is built with; always a power of two. */
+#define PTABLE_MIN_SLOTS 64
+
+/* local functions */
+static unsigned long hash_name(const char *name);
+static unsigned long hash_id(long id);
+static void insert_slot(int *slots, unsigned long hash, int pos);
+
+static int *name_slots = NULL;  /* player_table positions by name, -1 if empty */
+static int *id_slots = NULL;    /* player_table positions by id, -1 if empty */
+static int num_slots = 0;       /* size of each table */
+static int used_slots = 0;      /* filled slots in each table, stale ones too */
+
+/* FNV-1a over the lowercased name. */
+static unsigned long hash_name(const char *name)
+{
+  unsigned long h = 2166136261UL;
+
+  for (; *name; name++) {
+    h ^= (unsigned char) LOWER(*name);
+    h *= 16777619UL;
+  }
+  return (h);
+}
+
+static unsigned long hash_id(long id)
+{
+  unsigned long h = (unsigned long) id;
+
+  h ^= h >> 16;
+  h *= 0x45d9f3bUL;
+  h ^= h >> 16;
+  return (h);
+}
+
+static void insert_slot(int *slots, unsigned long hash, int pos)
+{
+  unsigned long i = hash & (num_slots - 1);
+
+  while (slots[i] != -1) {
+    if (slots[i] == pos)
+      return;
+    i = (i + 1) & (num_slots - 1);
+  }
+  slots[i] = pos;
+}
+
+/** Builds both tables from scratch out of player_table[]. */
+void ptable_hash_rebuild(void)
+{
+  int i, want = PTABLE_MIN_SLOTS;
+
+  /* Keep the tables no more than a quarter full after a rebuild. */
+  while (want < (top_of_p_table + 1) * 4)
+    want <<= 1;
+
+  if (want != num_slots) {
+    ptable_hash_free();
+    CREATE(name_slots, int, want);
+    CREATE(id_slots, int, want);
+    num_slots = want;
+  }
+
+  for (i = 0; i < num_slots; i++)
+    name_slots[i] = id_slots[i] = -1;
+  used_slots = 0;
+
+  for (i = 0; i <= top_of_p_table; i++) {
+    if (player_table[i].name)
+      insert_slot(name_slots, hash_name(player_table[i].name), i);
+    insert_slot(id_slots, hash_id(player_table[i].id), i);
+    used_slots++;
+  }
+}
+
+/** Adds player_table[pos] under its current name and id.  Call it again
+ * after either one changes. */
+void ptable_hash_add(int pos)
+{
+  if (pos < 0 || pos > top_of_p_table)
+    return;
+
+  if ((used_slots + 1) * 2 > num_slots) {
+    ptable_hash_rebuild();
+    return;
+  }
+
+  if (player_table[pos].name)
+    insert_slot(name_slots, hash_name(player_table[pos].name), pos);
+  insert_slot(id_slots, hash_id(player_table[pos].id), pos);
+  used_slots++;
+}
+
+void ptable_hash_free(void)
+{
+  if (name_slots)
+    free(name_slots);
+  if (id_slots)
+    free(id_slots);
+  name_slots = id_slots = NULL;
+  num_slots = used_slots = 0;
+}
+
+/** @return The player_table[] position of name, or -1. */
+int ptable_hash_name(const char *name)
+{
+  unsigned long i;
+  int pos;
+
+  if (!num_slots || !name)
+    return (-1);
+
+  for (i = hash_name(name) & (num_slots - 1); (pos = name_slots[i]) != -1;
+       i = (i + 1) & (num_slots - 1))
+    if (pos <= top_of_p_table && player_table[pos].name &&
+        !str_cmp(player_table[pos].name, name))
+      return (pos);
+
+  return (-1);
+}
+
+/** @return The player_table[] position of id, or -1. */
+int ptable_hash_id(long id)
+{
+  unsigned long i;
+  int pos;
+
+  if (!num_slots)
+    return (-1);
+
+  for (i = hash_id(id) & (num_slots - 1); (pos = id_slots[i]) != -1;
+       i = (i + 1) & (num_slots - 1))
+    if (pos <= top_of_p_table && player_table[pos].id == id)
+      return (pos);
+
+  return (-1);
+}
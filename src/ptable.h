@@ -0,0 +1,19 @@
+/**
+* @file ptable.h
+* Hashed name and id lookups into the player index.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*/
+#ifndef _PTABLE_H_
+#define _PTABLE_H_
+
+void ptable_hash_rebuild(void);
+void ptable_hash_add(int pos);
+void ptable_hash_free(void);
+int  ptable_hash_name(const char *name);
+int  ptable_hash_id(long id);
+
+#endif /* _PTABLE_H_ */
@@ -0,0 +1,314 @@
+/**
+* @file resolver.c
+* Asynchronous reverse DNS lookups for new connections.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*
+* new_descriptor() used to call gethostbyaddr() on the game thread, so a slow
+* nameserver froze the whole world.  Now a connection starts out with its
+* numeric address and a lookup is queued for a small pool of worker threads.
+* Finished lookups are handed back through a result queue that game_loop()
+* drains every pass with resolver_process(), which calls the done function
+* given to resolver_init() on the main thread.  Answers (and failures) are
+* cached per address so reconnecting players are named immediately.
+*
+* Only the request queue and the result queue are shared with the workers.
+* The cache and the request -> descriptor link are touched by the main thread
+* alone.  Without pthreads, requests are answered synchronously.
+*/
+
+#include "conf.h"
+#include "sysdep.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "structs.h"
+#include "utils.h"
+#include "resolver.h"
+
+struct dns_request {
+  struct in_addr addr;
+  char host[HOST_LENGTH + 1];
+  int found;                    /* set by the worker */
+  struct descriptor_data *d;    /* main thread only; NULL once cancelled */
+  struct dns_request *next;
+};
+
+struct dns_cache_entry {
+  struct in_addr addr;
+  char host[HOST_LENGTH + 1];
+  int found;
+  time_t expires;
+  struct dns_cache_entry *next;
+};
+
+static int default_lookup(const struct in_addr *addr, char *host, size_t len);
+
+static resolver_lookup_func lookup_func = default_lookup;
+static resolver_done_func done_func = NULL;
+static struct dns_cache_entry *dns_cache[RESOLVER_CACHE_SIZE];
+static int dns_cache_count = 0;
+
+#ifdef HAVE_PTHREAD_H
+static pthread_t *workers = NULL;
+static int num_workers = 0;
+static int stopping = FALSE;
+static pthread_mutex_t request_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t request_cond = PTHREAD_COND_INITIALIZER;
+static struct dns_request *request_head = NULL, *request_tail = NULL;
+static pthread_mutex_t result_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct dns_request *result_list = NULL;
+#endif
+
+/* getnameinfo() is reentrant, unlike gethostbyaddr(). */
+static int default_lookup(const struct in_addr *addr, char *host, size_t len)
+{
+  struct sockaddr_in sa;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr = *addr;
+
+  return (getnameinfo((struct sockaddr *) &sa, sizeof(sa), host, len,
+                      NULL, 0, NI_NAMEREQD) == 0);
+}
+
+static void cache_purge(int all)
+{
+  struct dns_cache_entry *e, *next_e, **prev;
+  time_t now = time(0);
+  int i;
+
+  for (i = 0; i < RESOLVER_CACHE_SIZE; i++)
+    for (prev = &dns_cache[i], e = dns_cache[i]; e; e = next_e) {
+      next_e = e->next;
+      if (all || e->expires <= now) {
+        *prev = next_e;
+        free(e);
+        dns_cache_count--;
+      } else
+        prev = &e->next;
+    }
+}
+
+static void cache_insert(const struct dns_request *req)
+{
+  struct dns_cache_entry *e;
+  int bucket = req->addr.s_addr % RESOLVER_CACHE_SIZE;
+
+  for (e = dns_cache[bucket]; e; e = e->next)
+    if (e->addr.s_addr == req->addr.s_addr)
+      break;
+
+  if (!e) {
+    if (dns_cache_count >= RESOLVER_CACHE_MAX) {
+      cache_purge(FALSE);
+      if (dns_cache_count >= RESOLVER_CACHE_MAX)
+        cache_purge(TRUE);
+    }
+    CREATE(e, struct dns_cache_entry, 1);
+    e->addr = req->addr;
+    e->next = dns_cache[bucket];
+    dns_cache[bucket] = e;
+    dns_cache_count++;
+  }
+
+  strlcpy(e->host, req->host, sizeof(e->host));
+  e->found = req->found;
+  e->expires = time(0) + (req->found ? RESOLVER_CACHE_TTL : RESOLVER_NEGATIVE_TTL);
+}
+
+/* Hand a finished request to the game and free it. */
+static void finish_request(struct dns_request *req)
+{
+  cache_insert(req);
+
+  if (req->d) {
+    req->d->dns_request = NULL;
+    if (req->found && done_func)
+      (done_func)(req->d, req->host);
+  }
+  free(req);
+}
+
+#ifdef HAVE_PTHREAD_H
+static void *resolver_worker(void *arg)
+{
+  struct dns_request *req;
+
+  for (;;) {
+    pthread_mutex_lock(&request_lock);
+    while (!request_head && !stopping)
+      pthread_cond_wait(&request_cond, &request_lock);
+    if (stopping) {
+      pthread_mutex_unlock(&request_lock);
+      return (NULL);
+    }
+    req = request_head;
+    if (!(request_head = req->next))
+      request_tail = NULL;
+    pthread_mutex_unlock(&request_lock);
+
+    req->found = (lookup_func)(&req->addr, req->host, sizeof(req->host));
+
+    pthread_mutex_lock(&result_lock);
+    req->next = result_list;
+    result_list = req;
+    pthread_mutex_unlock(&result_lock);
+  }
+}
+#endif
+
+/* Start the lookup threads.  'done' is called on the main thread from
+ * resolver_process() whenever a queued lookup produces a name. */
+void resolver_init(int count, resolver_done_func done)
+{
+  done_func = done;
+
+#ifdef HAVE_PTHREAD_H
+  sigset_t all, old;
+  int rc;
+
+  stopping = FALSE;
+  CREATE(workers, pthread_t, count);
+
+  /* The workers start with every signal blocked, so the handlers only ever
+   * run on the game loop's thread. */
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  for (num_workers = 0; num_workers < count; num_workers++)
+    if ((rc = pthread_create(&workers[num_workers], NULL, resolver_worker, NULL)) != 0) {
+      /* pthread_create() returns its error instead of setting errno. */
+      log("SYSERR: Unable to start resolver thread: %s", strerror(rc));
+      break;
+    }
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  log("Started %d resolver thread%s.", num_workers, num_workers == 1 ? "" : "s");
+#else
+  (void) count;
+  log("No thread support, hostnames will be resolved synchronously.");
+#endif
+}
+
+void resolver_shutdown(void)
+{
+#ifdef HAVE_PTHREAD_H
+  struct dns_request *req;
+  int i;
+
+  pthread_mutex_lock(&request_lock);
+  stopping = TRUE;
+  pthread_cond_broadcast(&request_cond);
+  pthread_mutex_unlock(&request_lock);
+
+  for (i = 0; i < num_workers; i++)
+    pthread_join(workers[i], NULL);
+  if (workers)
+    free(workers);
+  workers = NULL;
+  num_workers = 0;
+
+  while ((req = request_head) != NULL) {
+    request_head = req->next;
+    free(req);
+  }
+  request_tail = NULL;
+  while ((req = result_list) != NULL) {
+    result_list = req->next;
+    free(req);
+  }
+#endif
+
+  cache_purge(TRUE);
+}
+
+/* Replace the function used to look names up, e.g. with a local stub. */
+void resolver_set_lookup(resolver_lookup_func func)
+{
+  lookup_func = func ? func : default_lookup;
+}
+
+/* Fill 'host' from the cache.  Returns TRUE if the address has a known name. */
+int resolver_cache_lookup(struct in_addr addr, char *host, size_t len)
+{
+  struct dns_cache_entry *e;
+
+  for (e = dns_cache[addr.s_addr % RESOLVER_CACHE_SIZE]; e; e = e->next)
+    if (e->addr.s_addr == addr.s_addr) {
+      if (e->expires <= time(0) || !e->found)
+        return (FALSE);
+      strlcpy(host, e->host, len);
+      return (TRUE);
+    }
+
+  return (FALSE);
+}
+
+/* Queue a lookup for a descriptor.  d->host keeps the numeric address until
+ * the name arrives. */
+void resolver_request(struct descriptor_data *d, struct in_addr addr)
+{
+  struct dns_cache_entry *e;
+  struct dns_request *req;
+
+  resolver_cancel(d);
+
+  /* A recent failure is not worth asking the nameserver about again. */
+  for (e = dns_cache[addr.s_addr % RESOLVER_CACHE_SIZE]; e; e = e->next)
+    if (e->addr.s_addr == addr.s_addr && !e->found && e->expires > time(0))
+      return;
+
+  CREATE(req, struct dns_request, 1);
+  req->addr = addr;
+  req->d = d;
+  d->dns_request = req;
+
+#ifdef HAVE_PTHREAD_H
+  if (num_workers > 0) {
+    pthread_mutex_lock(&request_lock);
+    if (request_tail)
+      request_tail->next = req;
+    else
+      request_head = req;
+    request_tail = req;
+    pthread_cond_signal(&request_cond);
+    pthread_mutex_unlock(&request_lock);
+    return;
+  }
+#endif
+
+  req->found = (lookup_func)(&req->addr, req->host, sizeof(req->host));
+  finish_request(req);
+}
+
+/* The descriptor is going away; drop its answer when it arrives. */
+void resolver_cancel(struct descriptor_data *d)
+{
+  if (d->dns_request) {
+    d->dns_request->d = NULL;
+    d->dns_request = NULL;
+  }
+}
+
+/* Deliver finished lookups.  Called from game_loop() every pass. */
+void resolver_process(void)
+{
+#ifdef HAVE_PTHREAD_H
+  struct dns_request *req, *next_req;
+
+  pthread_mutex_lock(&result_lock);
+  req = result_list;
+  result_list = NULL;
+  pthread_mutex_unlock(&result_lock);
+
+  for (; req; req = next_req) {
+    next_req = req->next;
+    finish_request(req);
+  }
+#endif
+}
@@ -0,0 +1,34 @@
+/**
+* @file resolver.h
+* Asynchronous reverse DNS lookups for new connections.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*/
+#ifndef _RESOLVER_H_
+#define _RESOLVER_H_
+
+#define RESOLVER_WORKERS      2     /**< lookup threads started at boot */
+#define RESOLVER_CACHE_SIZE   1024  /**< hash buckets in the name cache */
+#define RESOLVER_CACHE_MAX    4096  /**< cached addresses before a purge */
+#define RESOLVER_CACHE_TTL    3600  /**< seconds a resolved name is trusted */
+#define RESOLVER_NEGATIVE_TTL 300   /**< seconds a failed lookup is trusted */
+
+/** Turns an address into a name.  Returns TRUE and fills 'host' on success.
+ * Runs on a worker thread, so it must be thread safe. */
+typedef int (*resolver_lookup_func)(const struct in_addr *addr, char *host, size_t len);
+
+/** Called on the main thread when a queued lookup for 'd' has finished. */
+typedef void (*resolver_done_func)(struct descriptor_data *d, const char *host);
+
+void resolver_init(int workers, resolver_done_func done);
+void resolver_shutdown(void);
+void resolver_set_lookup(resolver_lookup_func func);
+int  resolver_cache_lookup(struct in_addr addr, char *host, size_t len);
+void resolver_request(struct descriptor_data *d, struct in_addr addr);
+void resolver_cancel(struct descriptor_data *d);
+void resolver_process(void);
+
+#endif /* _RESOLVER_H_ */
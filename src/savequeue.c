@@ -0,0 +1,485 @@
+/**
+* @file savequeue.c
+* Player and rent files written off the game thread.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*
+* save_char() and the Crash_*save() routines used to fopen() their files for
+* writing in place, so an autosave stalled the pulse on disk I/O and a crash
+* part way through left a truncated file behind.
+*
+* Now the save routines write into an in-memory snapshot (open_memstream())
+* and save_file_close() queues it for a writer thread.  The writer takes
+* everything queued in one batch and, for each file, writes "<file>.tmp",
+* fsync()s it and renames it over the old file, so a file on disk is always
+* either the old or the new version.  A file queued again before the writer
+* reaches it keeps only the newest snapshot.
+*
+* Anything that reads or removes one of these files first calls
+* save_queue_wait() or save_queue_discard() so it never sees or races a
+* write still in the queue.  Failures are logged on the main thread by
+* save_queue_process().  Without pthreads the snapshot is written on the
+* spot, and without open_memstream() the caller writes the temporary file
+* directly; both still replace the old file atomically.
+*/
+
+#include "conf.h"
+#include "sysdep.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "savequeue.h"
+
+struct save_job {
+  char path[SAVE_PATH_LENGTH];
+  char *data;
+  size_t len;
+  struct timeval queued;
+  int error;                  /* errno from the writer, 0 on success */
+  struct save_job *next;
+};
+
+/* local functions */
+static long usec_since(const struct timeval *then);
+static int write_snapshot(const char *path, const char *data, size_t len);
+static void sync_parent_dirs(struct save_job *batch);
+static void free_job(struct save_job *job);
+static void report_failure(const char *path, int error);
+static int job_listed(struct save_job *list, const char *path);
+static void finish_job(struct save_job *job, struct save_job **failed);
+
+static struct save_queue_stats stats;
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_OPEN_MEMSTREAM)
+#define SAVE_THREADED
+static pthread_t writer;
+static int writer_running = FALSE;
+static int stopping = FALSE;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;   /* something queued */
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;   /* a batch finished */
+static struct save_job *pending_head = NULL, *pending_tail = NULL;
+static struct save_job *in_flight = NULL;   /* the batch being written */
+static struct save_job *failed_list = NULL;
+#endif
+
+static long usec_since(const struct timeval *then)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return ((now.tv_sec - then->tv_sec) * 1000000L + (now.tv_usec - then->tv_usec));
+}
+
+/* Write data to path.tmp, flush it to disk and rename it over path.  Runs on
+ * the writer thread, so it reports errors by returning errno. */
+static int write_snapshot(const char *path, const char *data, size_t len)
+{
+  char tmp[SAVE_PATH_LENGTH + 5];
+  size_t off = 0;
+  ssize_t n;
+  int fd, error;
+
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+    return (errno);
+
+  while (off < len) {
+    if ((n = write(fd, data + off, len - off)) < 0) {
+      if (errno == EINTR)
+        continue;
+      error = errno;
+      close(fd);
+      unlink(tmp);
+      return (error);
+    }
+    off += n;
+  }
+
+  if (fsync(fd) < 0) {
+    error = errno;
+    close(fd);
+    unlink(tmp);
+    return (error);
+  }
+  if (close(fd) < 0) {
+    error = errno;
+    unlink(tmp);
+    return (error);
+  }
+
+  if (rename(tmp, path) < 0) {
+    error = errno;
+    unlink(tmp);
+    return (error);
+  }
+
+  return (0);
+}
+
+/* A rename is only durable once its directory is flushed.  The files of one
+ * batch share a handful of directories, so each is flushed once. */
+static void sync_parent_dirs(struct save_job *batch)
+{
+  char dirs[16][SAVE_PATH_LENGTH], *slash;
+  struct save_job *job;
+  int ndirs = 0, i, fd;
+
+  for (job = batch; job; job = job->next) {
+    if (job->error)
+      continue;
+    strlcpy(dirs[ndirs], job->path, sizeof(dirs[ndirs]));
+    if ((slash = strrchr(dirs[ndirs], '/')) != NULL)
+      *slash = '\0';
+    else
+      strcpy(dirs[ndirs], ".");
+    for (i = 0; i < ndirs; i++)
+      if (!strcmp(dirs[i], dirs[ndirs]))
+        break;
+    if (i == ndirs && ndirs < 15)
+      ndirs++;
+  }
+
+  for (i = 0; i < ndirs; i++)
+    if ((fd = open(dirs[i], O_RDONLY)) >= 0) {
+      fsync(fd);
+      close(fd);
+    }
+}
+
+static void free_job(struct save_job *job)
+{
+  if (job->data)
+    free(job->data);
+  free(job);
+}
+
+static void report_failure(const char *path, int error)
+{
+  mudlog(NRM, LVL_GOD, TRUE, "SYSERR: Couldn't write %s: %s", path, strerror(error));
+}
+
+static int job_listed(struct save_job *list, const char *path)
+{
+  for (; list; list = list->next)
+    if (!path || !strcmp(list->path, path))
+      return (TRUE);
+
+  return (FALSE);
+}
+
+/* Count a written job in the stats; keep it on 'failed' if it went wrong. */
+static void finish_job(struct save_job *job, struct save_job **failed)
+{
+  long latency = usec_since(&job->queued);
+
+  stats.last_latency = latency;
+  stats.max_latency = MAX(stats.max_latency, latency);
+  stats.total_latency += latency;
+
+  if (job->error) {
+    stats.failures++;
+    job->next = *failed;
+    *failed = job;
+    return;
+  }
+  stats.writes++;
+  stats.bytes += job->len;
+  free_job(job);
+}
+
+#ifdef SAVE_THREADED
+static void *save_writer(void *arg)
+{
+  struct save_job *batch, *job, *next_job;
+  int count;
+
+  for (;;) {
+    pthread_mutex_lock(&queue_lock);
+    while (!pending_head && !stopping)
+      pthread_cond_wait(&work_cond, &queue_lock);
+    /* Everything queued is written before the thread stops. */
+    if (!pending_head) {
+      pthread_mutex_unlock(&queue_lock);
+      return (NULL);
+    }
+    batch = in_flight = pending_head;
+    pending_head = pending_tail = NULL;
+    stats.pending = 0;
+    pthread_mutex_unlock(&queue_lock);
+
+    for (count = 0, job = batch; job; job = job->next, count++)
+      job->error = write_snapshot(job->path, job->data, job->len);
+    sync_parent_dirs(batch);
+
+    pthread_mutex_lock(&queue_lock);
+    in_flight = NULL;
+    for (job = batch; job; job = next_job) {
+      next_job = job->next;
+      finish_job(job, &failed_list);
+    }
+    stats.batches++;
+    stats.largest_batch = MAX(stats.largest_batch, count);
+    pthread_cond_broadcast(&done_cond);
+    pthread_mutex_unlock(&queue_lock);
+  }
+}
+#endif
+
+/** Starts the writer thread.  Saves made before this are written on the
+ * spot. */
+void save_queue_init(void)
+{
+#ifdef SAVE_THREADED
+  sigset_t all, old;
+  int err;
+
+  /* Keep signals on the game loop's thread; see resolver_init(). */
+  stopping = FALSE;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  err = pthread_create(&writer, NULL, save_writer, NULL);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  if (err != 0) {
+    log("SYSERR: Unable to start save writer thread: %s", strerror(err));
+    return;
+  }
+  writer_running = TRUE;
+  stats.threaded = TRUE;
+  log("Started save writer thread.");
+#elif defined(HAVE_OPEN_MEMSTREAM)
+  log("No thread support, player files will be written synchronously.");
+#else
+  log("No open_memstream(), player files will be written synchronously.");
+#endif
+}
+
+/** Writes out everything still queued and stops the writer.  Called before
+ * shutdown and copyover, as queued files use paths relative to lib/. */
+void save_queue_shutdown(void)
+{
+#ifdef SAVE_THREADED
+  if (!writer_running)
+    return;
+
+  pthread_mutex_lock(&queue_lock);
+  stopping = TRUE;
+  pthread_cond_signal(&work_cond);
+  pthread_mutex_unlock(&queue_lock);
+
+  pthread_join(writer, NULL);
+  writer_running = FALSE;
+  stats.threaded = FALSE;
+  save_queue_process();
+#endif
+}
+
+/** Logs files the writer could not save.  Called from game_loop() every pass. */
+void save_queue_process(void)
+{
+#ifdef SAVE_THREADED
+  struct save_job *job, *next_job;
+
+  pthread_mutex_lock(&queue_lock);
+  job = failed_list;
+  failed_list = NULL;
+  pthread_mutex_unlock(&queue_lock);
+
+  for (; job; job = next_job) {
+    next_job = job->next;
+    report_failure(job->path, job->error);
+    free_job(job);
+  }
+#endif
+}
+
+/** Blocks until no write of 'path' is queued or under way, so the file can be
+ * read back.  Returns at once in the usual case of nothing pending.
+ * @param path The file about to be read, or NULL to wait for every file. */
+void save_queue_wait(const char *path)
+{
+#ifdef SAVE_THREADED
+  pthread_mutex_lock(&queue_lock);
+  while (job_listed(pending_head, path) || job_listed(in_flight, path))
+    pthread_cond_wait(&done_cond, &queue_lock);
+  pthread_mutex_unlock(&queue_lock);
+#else
+  (void) path;
+#endif
+}
+
+/** Drops any queued write of 'path' and waits out one under way, so the file
+ * can be removed without the writer bringing it back.
+ * @param path The file about to be removed. */
+void save_queue_discard(const char *path)
+{
+#ifdef SAVE_THREADED
+  struct save_job *job, **prev;
+
+  pthread_mutex_lock(&queue_lock);
+  pending_tail = NULL;
+  for (prev = &pending_head; (job = *prev) != NULL; ) {
+    if (!strcmp(job->path, path)) {
+      *prev = job->next;
+      free_job(job);
+      stats.pending--;
+    } else {
+      pending_tail = job;
+      prev = &job->next;
+    }
+  }
+  while (job_listed(in_flight, path))
+    pthread_cond_wait(&done_cond, &queue_lock);
+  pthread_mutex_unlock(&queue_lock);
+#else
+  (void) path;
+#endif
+}
+
+void save_queue_stats(struct save_queue_stats *out)
+{
+#ifdef SAVE_THREADED
+  pthread_mutex_lock(&queue_lock);
+  *out = stats;
+  pthread_mutex_unlock(&queue_lock);
+#else
+  *out = stats;
+#endif
+}
+
+/** Opens a snapshot of the file at 'path'.
+ * @param sf Filled in for save_file_close().
+ * @param path The file the snapshot will replace.
+ * @retval FILE * Stream to write the new contents to, or NULL on error. */
+FILE *save_file_open(struct save_file *sf, const char *path)
+{
+  memset(sf, 0, sizeof(*sf));
+  if (strlcpy(sf->path, path, sizeof(sf->path)) >= sizeof(sf->path)) {
+    log("SYSERR: save_file_open: path too long: %s", path);
+    return (NULL);
+  }
+
+#ifdef HAVE_OPEN_MEMSTREAM
+  sf->fl = open_memstream(&sf->data, &sf->len);
+#else
+  {
+    char tmp[SAVE_PATH_LENGTH + 5];
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    sf->fl = fopen(tmp, "w");
+  }
+#endif
+
+  return (sf->fl);
+}
+
+/** Finishes a snapshot and queues it to replace the file.
+ * @param sf A save_file opened by save_file_open().
+ * @retval int FALSE if the snapshot could not be taken or written. */
+int save_file_close(struct save_file *sf)
+{
+  struct save_job *job, *failed = NULL;
+
+#ifdef HAVE_OPEN_MEMSTREAM
+  if (fclose(sf->fl) != 0) {
+    report_failure(sf->path, errno);
+    save_file_abort(sf);
+    return (FALSE);
+  }
+  sf->fl = NULL;
+
+#ifdef SAVE_THREADED
+  if (writer_running) {
+    pthread_mutex_lock(&queue_lock);
+    for (job = pending_head; job; job = job->next)
+      if (!strcmp(job->path, sf->path))
+        break;
+    if (job) {
+      /* Not written yet: the new snapshot simply takes its place. */
+      free(job->data);
+      stats.coalesced++;
+    } else {
+      CREATE(job, struct save_job, 1);
+      strcpy(job->path, sf->path);
+      gettimeofday(&job->queued, NULL);
+      if (pending_tail)
+        pending_tail->next = job;
+      else
+        pending_head = job;
+      pending_tail = job;
+      stats.peak_pending = MAX(stats.peak_pending, ++stats.pending);
+      pthread_cond_signal(&work_cond);
+    }
+    job->data = sf->data;
+    job->len = sf->len;
+    sf->data = NULL;
+    pthread_mutex_unlock(&queue_lock);
+    return (TRUE);
+  }
+#endif
+
+  CREATE(job, struct save_job, 1);
+  strcpy(job->path, sf->path);
+  gettimeofday(&job->queued, NULL);
+  job->data = sf->data;
+  job->len = sf->len;
+  sf->data = NULL;
+  job->error = write_snapshot(job->path, job->data, job->len);
+#else
+  {
+    char tmp[SAVE_PATH_LENGTH + 5];
+
+    CREATE(job, struct save_job, 1);
+    strcpy(job->path, sf->path);
+    gettimeofday(&job->queued, NULL);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", sf->path);
+    if (fflush(sf->fl) != 0 || fsync(fileno(sf->fl)) < 0) {
+      job->error = errno;
+      fclose(sf->fl);
+    } else if (fclose(sf->fl) != 0 || rename(tmp, sf->path) < 0)
+      job->error = errno;
+    if (job->error)
+      unlink(tmp);
+    sf->fl = NULL;
+  }
+#endif
+
+  /* Written on the spot; report straight away. */
+  stats.batches++;
+  stats.largest_batch = MAX(stats.largest_batch, 1);
+  finish_job(job, &failed);
+  if (failed) {
+    report_failure(failed->path, failed->error);
+    free_job(failed);
+  }
+  return (failed == NULL);
+}
+
+/** Throws a snapshot away, leaving the file as it was. */
+void save_file_abort(struct save_file *sf)
+{
+  if (sf->fl)
+    fclose(sf->fl);
+  sf->fl = NULL;
+
+#ifdef HAVE_OPEN_MEMSTREAM
+  if (sf->data)
+    free(sf->data);
+  sf->data = NULL;
+#else
+  {
+    char tmp[SAVE_PATH_LENGTH + 5];
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", sf->path);
+    unlink(tmp);
+  }
+#endif
+}
@@ -0,0 +1,53 @@
+/**
+* @file savequeue.h
+* Player and rent files written off the game thread.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*/
+#ifndef _SAVEQUEUE_H_
+#define _SAVEQUEUE_H_
+
+#define SAVE_PATH_LENGTH 256   /**< longest file name the queue will take */
+
+/** A file being written through the save queue.  Open it with
+ * save_file_open(), write to fl as to any FILE, then hand it to
+ * save_file_close() or throw it away with save_file_abort(). */
+struct save_file {
+  FILE *fl;                       /**< Where the caller writes */
+  char path[SAVE_PATH_LENGTH];    /**< The file being replaced */
+  char *data;                     /**< Snapshot buffer behind fl */
+  size_t len;                     /**< Bytes in data once fl is closed */
+};
+
+/** Numbers for 'show saves'.  Latencies are in microseconds, from the moment
+ * a snapshot was queued until its file was renamed into place. */
+struct save_queue_stats {
+  int pending;            /**< Snapshots waiting for the writer */
+  int peak_pending;       /**< Most snapshots ever waiting at once */
+  int threaded;           /**< TRUE if a writer thread is running */
+  long writes;            /**< Files written */
+  long coalesced;         /**< Snapshots replaced by a newer one before writing */
+  long failures;          /**< Files that could not be written */
+  long batches;           /**< Passes the writer has made */
+  int largest_batch;      /**< Most files written in one pass */
+  long bytes;             /**< Total bytes written */
+  long last_latency;      /**< Latency of the last file written */
+  long max_latency;       /**< Worst latency seen */
+  long total_latency;     /**< Sum of all latencies, for the average */
+};
+
+void save_queue_init(void);
+void save_queue_shutdown(void);
+void save_queue_process(void);
+void save_queue_wait(const char *path);
+void save_queue_discard(const char *path);
+void save_queue_stats(struct save_queue_stats *stats);
+
+FILE *save_file_open(struct save_file *sf, const char *path);
+int  save_file_close(struct save_file *sf);
+void save_file_abort(struct save_file *sf);
+
+#endif /* _SAVEQUEUE_H_ */
@@ -674,6 +674,7 @@ void sedit_parse(struct descriptor_data *d, char *arg)
 
       BUY_TYPE(new_entry) = OLC_VAL(d);
       BUY_WORD(new_entry) = strdup(arg);
+      new_entry.expr = NULL;
       add_shop_to_type_list(&(S_NAMELISTS(OLC_SHOP(d))), &new_entry);
     }
     sedit_namelist_menu(d);
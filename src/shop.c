@@ -88,9 +88,14 @@ static void list_detailed_shop(struct char_data *ch, int shop_nr);
 static int is_ok_char(struct char_data *keeper, struct char_data *ch, int shop_nr);
 static int is_open(struct char_data *keeper, int shop_nr, int msg);
 static int is_ok(struct char_data *keeper, struct char_data *ch, int shop_nr);
-static void evaluate_operation(struct stack_data *ops, struct stack_data *vals);
+static int pop_value(struct stack_data *vals);
+static void evaluate_operation(int oper, struct stack_data *vals);
 static int find_oper_num(char token);
-static int evaluate_expression(struct obj_data *obj, char *expr);
+static void add_expr_step(struct shop_expr *expr, int kind, int value, char *word);
+static int check_expr_stack(struct shop_expr *expr, const char *keywords);
+static void free_buy_expr(struct shop_buy_data *entry);
+static int evaluate_expression(struct obj_data *obj, struct shop_expr *expr);
+static byte *trade_cache_slot(struct obj_data *item, int shop_nr);
 static int trade_with(struct obj_data *item, int shop_nr);
 static int same_obj(struct obj_data *obj1, struct obj_data *obj2);
 static int shop_producing(struct obj_data *item, int shop_nr);
@@ -211,15 +216,20 @@ static int pop(struct stack_data *stack)
   }
 }
 
-static void evaluate_operation(struct stack_data *ops, struct stack_data *vals)
+/* Like pop(), but a missing value was already complained about when the
+ * expression was compiled. */
+static int pop_value(struct stack_data *vals)
 {
-  int oper;
+  return (S_LEN(vals) > 0 ? S_DATA(vals, --S_LEN(vals)) : 0);
+}
 
-  if ((oper = pop(ops)) == OPER_NOT)
-    push(vals, !pop(vals));
+static void evaluate_operation(int oper, struct stack_data *vals)
+{
+  if (oper == OPER_NOT)
+    push(vals, !pop_value(vals));
   else {
-    int val1 = pop(vals),
-	val2 = pop(vals);
+    int val1 = pop_value(vals),
+	val2 = pop_value(vals);
 
     /* Compiler would previously short-circuit these. */
     if (oper == OPER_AND)
@@ -239,17 +249,74 @@ static int find_oper_num(char token)
   return (NOTHING);
 }
 
-static int evaluate_expression(struct obj_data *obj, char *expr)
+static void add_expr_step(struct shop_expr *expr, int kind, int value, char *word)
+{
+  expr->steps[expr->len].kind = kind;
+  expr->steps[expr->len].value = value;
+  expr->steps[expr->len++].word = word;
+}
+
+/* Runs the steps of an expression without an object, to find out whether it
+ * ever runs out of values, leaves too many behind or needs more than a
+ * stack_data can hold.  How many values there are never depends on the
+ * object, so this only has to be done once. */
+static int check_expr_stack(struct shop_expr *expr, const char *keywords)
+{
+  int i, depth = 0, pops, missing = FALSE;
+
+  for (i = 0; i < expr->len; i++) {
+    if (expr->steps[i].kind != SHOP_EXPR_OPER)
+      depth++;
+    else {
+      /* An empty stack pops as 0 without shrinking. */
+      pops = expr->steps[i].value == OPER_NOT ? 1 : 2;
+      if (depth < pops)
+        missing = TRUE;
+      depth = MAX(depth - pops, 0);
+      if (expr->steps[i].value >= OPER_OR)
+        depth++;
+    }
+    if (depth > MAX_SHOP_STACK) {
+      log("SYSERR: Too many operands in shop keyword expression '%s'.", keywords);
+      return (FALSE);
+    }
+  }
+  if (depth > 1) {
+    log("SYSERR: Extra operands left on shop keyword expression '%s'.", keywords);
+    return (FALSE);
+  }
+  if (missing || !depth)
+    log("SYSERR: Illegal shop keyword expression '%s'.", keywords);
+  return (TRUE);
+}
+
+/** Compiles the keywords of a buy type, so that trade_with() does not have to
+ * parse them again for every object it is offered.  The operators are parsed
+ * with the same precedence the keywords were always evaluated with, and a
+ * word that names an extra flag is looked up here rather than every time.
+ * @param entry The buy type; any expression it had is replaced. */
+void compile_buy_word(struct shop_buy_data *entry)
 {
-  struct stack_data ops, vals;
+  struct stack_data ops;
+  struct shop_expr *expr;
   char *ptr, *end, name[MAX_STRING_LENGTH];
   int temp, eindex;
 
-  if (!expr || !*expr)	/* Allows opening ( first. */
-    return (TRUE);
+  free_buy_expr(entry);
+  CREATE(expr, struct shop_expr, 1);
+  entry->expr = expr;
+  expr->result = SHOP_EXPR_RUN;
+
+  if (!BUY_WORD(*entry) || !*BUY_WORD(*entry)) {	/* Allows opening ( first. */
+    expr->result = TRUE;
+    return;
+  }
 
-  ops.len = vals.len = 0;
-  ptr = expr;
+  /* Every step uses up at least one character of the keywords. */
+  CREATE(expr->steps, struct shop_expr_step, strlen(BUY_WORD(*entry)));
+
+  ops.len = 0;
+  ptr = BUY_WORD(*entry);
   while (*ptr) {
     if (isspace(*ptr))
       ptr++;
@@ -262,39 +329,135 @@ static int evaluate_expression(struct obj_data *obj, char *expr)
 	name[ptr - end] = '\0';
 	for (eindex = 0; *extra_bits[eindex] != '\n'; eindex++)
 	  if (!str_cmp(name, extra_bits[eindex])) {
-	    push(&vals, OBJ_FLAGGED(obj, eindex));
+	    add_expr_step(expr, SHOP_EXPR_FLAG, eindex, NULL);
 	    break;
 	  }
 	if (*extra_bits[eindex] == '\n')
-	  push(&vals, isname(name, obj->name));
+	  add_expr_step(expr, SHOP_EXPR_WORD, 0, strdup(name));
       } else {
 	if (temp != OPER_OPEN_PAREN)
 	  while (top(&ops) > temp)
-	    evaluate_operation(&ops, &vals);
+	    add_expr_step(expr, SHOP_EXPR_OPER, pop(&ops), NULL);
 
 	if (temp == OPER_CLOSE_PAREN) {
 	  if ((temp = pop(&ops)) != OPER_OPEN_PAREN) {
-	    log("SYSERR: Illegal parenthesis in shop keyword expression.");
-	    return (FALSE);
+	    log("SYSERR: Illegal parenthesis in shop keyword expression '%s'.", BUY_WORD(*entry));
+	    expr->result = FALSE;
+	    return;
 	  }
-	} else
+	} else if (S_LEN(&ops) < MAX_SHOP_STACK)
 	  push(&ops, temp);
+	else {
+	  log("SYSERR: Too many operators in shop keyword expression '%s'.", BUY_WORD(*entry));
+	  expr->result = FALSE;
+	  return;
+	}
 	ptr++;
       }
     }
   }
   while (top(&ops) != -1)
-    evaluate_operation(&ops, &vals);
-  temp = pop(&vals);
-  if (top(&vals) != -1) {
-    log("SYSERR: Extra operands left on shop keyword expression stack.");
-    return (FALSE);
+    add_expr_step(expr, SHOP_EXPR_OPER, pop(&ops), NULL);
+
+  if (!check_expr_stack(expr, BUY_WORD(*entry)))
+    expr->result = FALSE;
+}
+
+static void free_buy_expr(struct shop_buy_data *entry)
+{
+  int i;
+
+  if (!entry->expr)
+    return;
+  for (i = 0; i < entry->expr->len; i++)
+    if (entry->expr->steps[i].word)
+      free(entry->expr->steps[i].word);
+  if (entry->expr->steps)
+    free(entry->expr->steps);
+  free(entry->expr);
+  entry->expr = NULL;
+}
+
+/** Frees the keywords of a buy type and what they were compiled to.
+ * @param entry The buy type. */
+void free_buy_word(struct shop_buy_data *entry)
+{
+  free_buy_expr(entry);
+  if (BUY_WORD(*entry))
+    free(BUY_WORD(*entry));
+  BUY_WORD(*entry) = NULL;
+}
+
+static int evaluate_expression(struct obj_data *obj, struct shop_expr *expr)
+{
+  struct stack_data vals;
+  struct shop_expr_step *step;
+  int i;
+
+  if (expr->result != SHOP_EXPR_RUN)
+    return (expr->result);
+
+  vals.len = 0;
+  for (i = 0; i < expr->len; i++) {
+    step = &expr->steps[i];
+    if (step->kind == SHOP_EXPR_FLAG)
+      push(&vals, OBJ_FLAGGED(obj, step->value));
+    else if (step->kind == SHOP_EXPR_WORD)
+      push(&vals, isname(step->word, obj->name));
+    else
+      evaluate_operation(step->value, &vals);
+  }
+  return (pop_value(&vals));
+}
+
+/* Where trade_with() keeps its verdict on an object in a shop, or NULL if the
+ * object differs from its prototype in anything the verdict depends on.
+ * Caches are dropped whenever a prototype changes, and made again when the
+ * number of prototypes does. */
+static byte *trade_cache_slot(struct obj_data *item, int shop_nr)
+{
+  struct obj_data *proto;
+  obj_rnum rnum = GET_OBJ_RNUM(item);
+
+  if (rnum == NOTHING || rnum > top_of_objt)
+    return (NULL);
+
+  proto = &obj_proto[rnum];
+  if (item->name != proto->name || GET_OBJ_TYPE(item) != GET_OBJ_TYPE(proto) ||
+      memcmp(GET_OBJ_EXTRA(item), GET_OBJ_EXTRA(proto), sizeof(GET_OBJ_EXTRA(item))))
+    return (NULL);
+
+  /* Used up wands and staves are OBJECT_DEAD instead. */
+  if (GET_OBJ_VAL(item, 2) == 0 &&
+      (GET_OBJ_TYPE(item) == ITEM_WAND || GET_OBJ_TYPE(item) == ITEM_STAFF))
+    return (NULL);
+
+  if (shop_index[shop_nr].trade_cache_size != top_of_objt + 1) {
+    if (shop_index[shop_nr].trade_cache)
+      free(shop_index[shop_nr].trade_cache);
+    CREATE(shop_index[shop_nr].trade_cache, byte, top_of_objt + 1);
+    shop_index[shop_nr].trade_cache_size = top_of_objt + 1;
+  }
+  return (&shop_index[shop_nr].trade_cache[rnum]);
+}
+
+/** Forgets what every shop thought of every object, for when object
+ * prototypes have been changed. */
+void shop_forget_trades(void)
+{
+  int shop_nr;
+
+  for (shop_nr = 0; shop_nr <= top_shop; shop_nr++) {
+    if (shop_index[shop_nr].trade_cache)
+      free(shop_index[shop_nr].trade_cache);
+    shop_index[shop_nr].trade_cache = NULL;
+    shop_index[shop_nr].trade_cache_size = 0;
   }
-  return (temp);
 }
 
 static int trade_with(struct obj_data *item, int shop_nr)
 {
+  byte *verdict;
   int counter;
 
   if (GET_OBJ_COST(item) < 1)
@@ -303,15 +466,25 @@ static int trade_with(struct obj_data *item, int shop_nr)
   if (OBJ_FLAGGED(item, ITEM_NOSELL))
     return (OBJECT_NOTOK);
 
+  if ((verdict = trade_cache_slot(item, shop_nr)) && *verdict != SHOP_TRADE_UNKNOWN)
+    return (*verdict == SHOP_TRADE_YES ? OBJECT_OK : OBJECT_NOTOK);
+
   for (counter = 0; SHOP_BUYTYPE(shop_nr, counter) != NOTHING; counter++)
     if (SHOP_BUYTYPE(shop_nr, counter) == GET_OBJ_TYPE(item)) {
       if (GET_OBJ_VAL(item, 2) == 0 &&
 		(GET_OBJ_TYPE(item) == ITEM_WAND ||
 		 GET_OBJ_TYPE(item) == ITEM_STAFF))
 	return (OBJECT_DEAD);
-      else if (evaluate_expression(item, SHOP_BUYWORD(shop_nr, counter)))
+      if (!shop_index[shop_nr].type[counter].expr)
+	compile_buy_word(&shop_index[shop_nr].type[counter]);
+      if (evaluate_expression(item, shop_index[shop_nr].type[counter].expr)) {
+	if (verdict)
+	  *verdict = SHOP_TRADE_YES;
 	return (OBJECT_OK);
+      }
     }
+  if (verdict)
+    *verdict = SHOP_TRADE_NO;
   return (OBJECT_NOTOK);
 }
 
@@ -792,18 +965,18 @@ static struct obj_data *slide_obj(struct obj_data *obj, struct char_data *keeper
     return (&obj_proto[temp]);
   }
   SHOP_SORT(shop_nr)++;
-  loop = keeper->carrying;
   obj_to_char(obj, keeper);
-  keeper->carrying = loop;
-  while (loop) {
+  for (loop = obj->next_content; loop; loop = loop->next_content)
     if (same_obj(obj, loop)) {
+      /* Move it from the front to just behind its twin. */
+      UNLINK_HEAD(obj, keeper->carrying, next_content, prev_content);
       obj->next_content = loop->next_content;
+      obj->prev_content = loop;
+      if (loop->next_content)
+        loop->next_content->prev_content = obj;
       loop->next_content = obj;
       return (obj);
     }
-    loop = loop->next_content;
-  }
-  keeper->carrying = obj;
   return (obj);
 }
 
@@ -1325,6 +1498,8 @@ void boot_the_shops(FILE *shop_f, char *filename, int rec_count)
       for (count = 0; count < temp; count++) {
 	SHOP_BUYTYPE(top_shop, count) = BUY_TYPE(list[count]);
 	SHOP_BUYWORD(top_shop, count) = BUY_WORD(list[count]);
+	if (BUY_TYPE(list[count]) != NOTHING)
+	  compile_buy_word(&shop_index[top_shop].type[count]);
       }
 
       shop_index[top_shop].no_such_item1 = read_shop_message(0, SHOP_NUM(top_shop), shop_f, buf2);
@@ -1671,10 +1846,11 @@ void destroy_shops(void)
 
     if (shop_index[cnt].type) {
       for (itr = 0; BUY_TYPE(shop_index[cnt].type[itr]) != NOTHING; itr++)
-        if (BUY_WORD(shop_index[cnt].type[itr]))
-          free(BUY_WORD(shop_index[cnt].type[itr]));
+        free_buy_word(&shop_index[cnt].type[itr]);
       free(shop_index[cnt].type);
     }
+    if (shop_index[cnt].trade_cache)
+      free(shop_index[cnt].trade_cache);
   }
 
   free(shop_index);
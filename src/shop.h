@@ -19,15 +19,34 @@ void assign_the_shopkeepers(void);
 void show_shops(struct char_data *ch, char *arg);
 int ok_damage_shopkeeper(struct char_data *ch, struct char_data *victim);
 void destroy_shops(void);
+void shop_forget_trades(void);
+
+/* One step of a compiled keyword expression, in postfix order. */
+struct shop_expr_step {
+   int kind;			/* SHOP_EXPR_FLAG, _WORD or _OPER	*/
+   int value;			/* Extra bit or OPER_ number		*/
+   char *word;			/* Keyword to look for in the name	*/
+};
+
+/* A buy type's keywords, compiled once by compile_buy_word(). */
+struct shop_expr {
+   int result;			/* SHOP_EXPR_RUN, or TRUE/FALSE always	*/
+   int len;			/* Number of steps			*/
+   struct shop_expr_step *steps;
+};
 
 struct shop_buy_data {
    int type;
    char *keywords;
+   struct shop_expr *expr;	/* keywords, compiled			*/
 };
 
 #define BUY_TYPE(i)		((i).type)
 #define BUY_WORD(i)		((i).keywords)
 
+void compile_buy_word(struct shop_buy_data *entry);
+void free_buy_word(struct shop_buy_data *entry);
+
 struct shop_data {
    room_vnum vnum;		/* Virtual number of this shop		*/
    obj_vnum *producing;		/* Which item to produce (virtual)	*/
@@ -51,6 +70,8 @@ struct shop_data {
    int	 bankAccount;		/* Store all gold over 15000 (disabled)	*/
    int	 lastsort;		/* How many items are sorted in inven?	*/
    SPECIAL (*func);		/* Secondary spec_proc for shopkeeper	*/
+   byte *trade_cache;		/* SHOP_TRADE_ verdicts by object rnum	*/
+   int	 trade_cache_size;	/* top_of_objt + 1 when it was made	*/
 };
 
 #define MAX_TRADE	5	/* List maximums for compatibility	*/
@@ -84,8 +105,11 @@ struct shop_data {
 /** Total number of trade types */
 #define NUM_TRADERS     7
 
+/** Deepest a keyword expression's operator or value stack may get. */
+#define MAX_SHOP_STACK	100
+
 struct stack_data {
-   int data[100];
+   int data[MAX_SHOP_STACK];
    int len;
 } ;
 
@@ -100,6 +124,18 @@ struct stack_data {
 #define OPER_NOT		4
 #define MAX_OPER		4
 
+/* What a step of a compiled expression does */
+#define SHOP_EXPR_FLAG		0	/* Push whether an extra bit is set	*/
+#define SHOP_EXPR_WORD		1	/* Push whether the name has a word	*/
+#define SHOP_EXPR_OPER		2	/* Apply an operator			*/
+/** An expression that has to be evaluated, rather than a constant one. */
+#define SHOP_EXPR_RUN		-1
+
+/* What a shop's trade_cache knows about an unmodified object */
+#define SHOP_TRADE_UNKNOWN	0
+#define SHOP_TRADE_NO		1
+#define SHOP_TRADE_YES		2
+
 #define SHOP_NUM(i)		(shop_index[(i)].vnum)
 #define SHOP_KEEPER(i)		(shop_index[(i)].keeper)
 #define SHOP_OPEN1(i)		(shop_index[(i)].open1)
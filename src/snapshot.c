@@ -0,0 +1,916 @@
+/**
+* @file snapshot.c
+* A compiled copy of the world files, read back in one go at boot.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*
+* Most of boot_world() is spent turning the zone, trigger, room, mob and
+* object files into tables.  Once a text boot has done that, snapshot_save()
+* writes the tables out as they stand, and the next boot reads them back with
+* snapshot_load() as long as the world files are still the ones they came
+* from.  Shops and quests are small and are always read from text.
+*
+* The file is a header followed by sections of fixed size records, which are
+* the structures themselves with every pointer replaced by a reference: a
+* string is one past its offset in the string section, a list node or zone
+* command one past its index in its own section, and NULL stays 0.  Nothing
+* in it depends on where it is loaded, so it could as well be mapped, but the
+* rest of the server frees and replaces prototype strings and lists one at a
+* time, so the loader still gives each its own copy.
+*
+* The header holds the size of every record, a checksum of the binary that
+* wrote it, and a checksum of each kind's index and of every file listed in
+* it.  Rebuilding any part of the server changes the binary, so a snapshot is
+* only ever read by the build that wrote it.
+*/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+#include "dg_scripts.h"
+#include "snapshot.h"
+
+#define SNAPSHOT_MAGIC   "TBASNAP"
+#define SNAPSHOT_VERSION 2
+/** Sections start on a multiple of this, so every record is aligned. */
+#define SNAPSHOT_ALIGN   16
+
+/* A reference stored in place of a pointer, and back. */
+#define SNAP_REF(n)   ((void *) (size_t) (n))
+#define SNAP_INDEX(p) ((size_t) (p))
+
+/* FNV-1a, 64 bit, see hash_bytes(). */
+#define SNAP_HASH_INIT  14695981039346656037ULL
+#define SNAP_HASH_PRIME 1099511628211ULL
+
+enum {
+  SNAP_STRINGS,
+  SNAP_ZONES,
+  SNAP_RESETS,
+  SNAP_TRIG_INDEX,
+  SNAP_TRIGGERS,
+  SNAP_CMDLINES,
+  SNAP_ROOMS,
+  SNAP_EXITS,
+  SNAP_EXTRAS,
+  SNAP_PROTOS,
+  SNAP_MOB_INDEX,
+  SNAP_MOBS,
+  SNAP_OBJ_INDEX,
+  SNAP_OBJS,
+  NUM_SNAP_SECTIONS
+};
+
+static const struct {
+  const char *name;
+  size_t size;
+} snap_sections[NUM_SNAP_SECTIONS] = {
+  { "strings",          1 },
+  { "zones",            sizeof(struct zone_data) },
+  { "zone commands",    sizeof(struct reset_com) },
+  { "trigger index",    sizeof(struct index_data) },
+  { "triggers",         sizeof(struct trig_data) },
+  { "trigger lines",    sizeof(struct cmdlist_element) },
+  { "rooms",            sizeof(struct room_data) },
+  { "exits",            sizeof(struct room_direction_data) },
+  { "extra descriptions", sizeof(struct extra_descr_data) },
+  { "trigger lists",    sizeof(struct trig_proto_list) },
+  { "mob index",        sizeof(struct index_data) },
+  { "mobs",             sizeof(struct char_data) },
+  { "object index",     sizeof(struct index_data) },
+  { "objects",          sizeof(struct obj_data) }
+};
+
+/* The world files a snapshot stands in for, in the order boot_world() reads
+ * them. */
+#define NUM_SNAP_SOURCES 5
+static const char *snap_sources[NUM_SNAP_SOURCES] = {
+  ZON_PREFIX, TRG_PREFIX, WLD_PREFIX, MOB_PREFIX, OBJ_PREFIX
+};
+
+struct snapshot_section {
+  size_t offset;        /* from the start of the file */
+  size_t count;         /* records, or bytes of strings */
+  size_t size;          /* of one record */
+  unsigned long long sum;   /* hash_bytes() of the records */
+};
+
+struct snapshot_header {
+  char magic[8];
+  int version;
+  unsigned long long build;   /* build_id() of the binary that wrote it */
+  int mini_mud;         /* which index was read */
+  int diagonal_dirs;    /* setup_dir() drops diagonal exits without it */
+  unsigned long long sources[NUM_SNAP_SOURCES];
+  struct snapshot_section sections[NUM_SNAP_SECTIONS];
+};
+
+/* The tables boot_world() builds, wherever they live. */
+struct snap_world {
+  struct zone_data *zones;
+  int num_zones;
+  struct index_data **trigs;
+  int num_trigs;
+  struct room_data *rooms;
+  int num_rooms;
+  struct index_data *mob_index;
+  struct char_data *mobs;
+  int num_mobs;
+  struct index_data *obj_index;
+  struct obj_data *objs;
+  int num_objs;
+};
+
+struct snap_buf {
+  char *data;
+  size_t len, size;
+};
+
+/* A snapshot being read: the whole file, checked by check_header(). */
+struct snap_in {
+  char *data;
+  size_t len;
+  const struct snapshot_header *hdr;
+  int bad;              /* a reference pointed outside its section */
+};
+
+/* local functions */
+static unsigned long long hash_bytes(unsigned long long h, const void *data, size_t len);
+static int hash_file(const char *path, unsigned long long *h);
+static unsigned long long build_id(void);
+static int source_sums(unsigned long long *sums);
+static void current_world(struct snap_world *w);
+static size_t buf_add(struct snap_buf *b, const void *data, size_t len);
+static void *put_string(struct snap_buf *out, const char *str);
+static void *put_resets(struct snap_buf *out, const struct reset_com *cmd);
+static void *put_cmdlist(struct snap_buf *out, const struct cmdlist_element *cl);
+static void *put_extras(struct snap_buf *out, const struct extra_descr_data *ex);
+static void *put_exit(struct snap_buf *out, const struct room_direction_data *dir);
+static void *put_protos(struct snap_buf *out, const struct trig_proto_list *tp);
+static void *put_index(struct snap_buf *out, int sect, const struct index_data *idx, void *proto);
+static void put_world(struct snap_buf *out, const struct snap_world *w);
+static void free_sections(struct snap_buf *out);
+static int read_snapshot(struct snap_in *in);
+static const char *check_header(struct snap_in *in, const unsigned long long *sums);
+static char *get_string(struct snap_in *in, const void *ref);
+static const void *get_record(struct snap_in *in, int sect, const void *ref);
+static struct reset_com *get_resets(struct snap_in *in, const void *ref);
+static struct cmdlist_element *get_cmdlist(struct snap_in *in, const void *ref);
+static struct extra_descr_data *get_extras(struct snap_in *in, const void *ref);
+static struct room_direction_data *get_exit(struct snap_in *in, const void *ref);
+static struct trig_proto_list *get_protos(struct snap_in *in, const void *ref);
+static int get_world(struct snap_in *in, struct snap_world *w);
+
+/* Checksums of the world files worked out by snapshot_load(), which
+ * snapshot_save() writes if the text boot that follows goes through. */
+static unsigned long long boot_sums[NUM_SNAP_SOURCES];
+static int have_boot_sums = FALSE;
+
+/* Taken eight bytes at a time, which still notices any change to a file but
+ * keeps checking the world files from costing as much as reading them. */
+static unsigned long long hash_bytes(unsigned long long h, const void *data, size_t len)
+{
+  const unsigned char *p = data;
+  unsigned long long word;
+
+  for (; len >= sizeof(word); p += sizeof(word), len -= sizeof(word)) {
+    memcpy(&word, p, sizeof(word));
+    h = (h ^ word) * SNAP_HASH_PRIME;
+  }
+  while (len--)
+    h = (h ^ *p++) * SNAP_HASH_PRIME;
+  return (h);
+}
+
+static int hash_file(const char *path, unsigned long long *h)
+{
+  char buf[65536];
+  size_t len;
+  FILE *fl;
+
+  if (!(fl = fopen(path, "rb")))
+    return (FALSE);
+  while ((len = fread(buf, 1, sizeof(buf), fl)) > 0)
+    *h = hash_bytes(*h, buf, len);
+  fclose(fl);
+  return (TRUE);
+}
+
+/* Identifies the build: a checksum of the running binary, which changes with
+ * any object linked into it, not just this one.  Where the binary cannot be
+ * read back, the time this file was compiled has to do. */
+static unsigned long long build_id(void)
+{
+  static const char stamp[] = __DATE__ " " __TIME__;
+  static unsigned long long id;
+  static int have_id = FALSE;
+
+  if (!have_id) {
+    id = SNAP_HASH_INIT;
+    if (!hash_file("/proc/self/exe", &id))
+      id = hash_bytes(SNAP_HASH_INIT, stamp, strlen(stamp));
+    have_id = TRUE;
+  }
+  return (id);
+}
+
+/* One checksum per kind of world file, over its index and every file the
+ * index lists.  FALSE if any of them cannot be read, which the text boot
+ * will complain about. */
+static int source_sums(unsigned long long *sums)
+{
+  char path[PATH_MAX], name[PATH_MAX - 100];
+  unsigned long long h;
+  FILE *fl;
+  int i;
+
+  for (i = 0; i < NUM_SNAP_SOURCES; i++) {
+    snprintf(path, sizeof(path), "%s%s", snap_sources[i],
+             mini_mud ? MINDEX_FILE : INDEX_FILE);
+    h = SNAP_HASH_INIT;
+    if (!hash_file(path, &h) || !(fl = fopen(path, "r")))
+      return (FALSE);
+    while (fscanf(fl, "%s\n", name) == 1 && *name != '$') {
+      snprintf(path, sizeof(path), "%s%s", snap_sources[i], name);
+      if (!hash_file(path, &h)) {
+        fclose(fl);
+        return (FALSE);
+      }
+    }
+    fclose(fl);
+    sums[i] = h;
+  }
+  return (TRUE);
+}
+
+static void current_world(struct snap_world *w)
+{
+  w->zones = zone_table;
+  w->num_zones = top_of_zone_table + 1;
+  w->trigs = trig_index;
+  w->num_trigs = top_of_trigt;
+  w->rooms = world;
+  w->num_rooms = top_of_world + 1;
+  w->mob_index = mob_index;
+  w->mobs = mob_proto;
+  w->num_mobs = top_of_mobt + 1;
+  w->obj_index = obj_index;
+  w->objs = obj_proto;
+  w->num_objs = top_of_objt + 1;
+}
+
+/* Writing. */
+
+static size_t buf_add(struct snap_buf *b, const void *data, size_t len)
+{
+  size_t at = b->len;
+
+  if (b->len + len > b->size) {
+    b->size = b->size * 2 + len + 4096;
+    RECREATE(b->data, char, b->size);
+  }
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+  return (at);
+}
+
+static void *put_string(struct snap_buf *out, const char *str)
+{
+  if (!str)
+    return (NULL);
+  return (SNAP_REF(buf_add(&out[SNAP_STRINGS], str, strlen(str) + 1) + 1));
+}
+
+/* The zone's commands up to and including its 'S'. */
+static void *put_resets(struct snap_buf *out, const struct reset_com *cmd)
+{
+  size_t first = out[SNAP_RESETS].len / sizeof(struct reset_com);
+  struct reset_com rec;
+
+  if (!cmd)
+    return (NULL);
+  do {
+    memcpy(&rec, cmd, sizeof(rec));
+    rec.sarg1 = put_string(out, cmd->sarg1);
+    rec.sarg2 = put_string(out, cmd->sarg2);
+    buf_add(&out[SNAP_RESETS], &rec, sizeof(rec));
+  } while ((cmd++)->command != 'S');
+
+  return (SNAP_REF(first + 1));
+}
+
+/* Lists are written one node after another, so each node's next is the one
+ * that follows it.  What dg_compile_cmdlist() fills in is worked out again
+ * when the snapshot is read. */
+static void *put_cmdlist(struct snap_buf *out, const struct cmdlist_element *cl)
+{
+  size_t first = out[SNAP_CMDLINES].len / sizeof(struct cmdlist_element);
+  struct cmdlist_element rec;
+
+  if (!cl)
+    return (NULL);
+  for (; cl; cl = cl->next) {
+    memcpy(&rec, cl, sizeof(rec));
+    rec.cmd = put_string(out, cl->cmd);
+    rec.original = NULL;
+    rec.next = cl->next ? SNAP_REF(out[SNAP_CMDLINES].len / sizeof(rec) + 2) : NULL;
+    rec.text = rec.args = NULL;
+    rec.jump = rec.done = NULL;
+    buf_add(&out[SNAP_CMDLINES], &rec, sizeof(rec));
+  }
+  return (SNAP_REF(first + 1));
+}
+
+static void *put_extras(struct snap_buf *out, const struct extra_descr_data *ex)
+{
+  size_t first = out[SNAP_EXTRAS].len / sizeof(struct extra_descr_data);
+  struct extra_descr_data rec;
+
+  if (!ex)
+    return (NULL);
+  for (; ex; ex = ex->next) {
+    memcpy(&rec, ex, sizeof(rec));
+    rec.keyword = put_string(out, ex->keyword);
+    rec.description = put_string(out, ex->description);
+    rec.next = ex->next ? SNAP_REF(out[SNAP_EXTRAS].len / sizeof(rec) + 2) : NULL;
+    buf_add(&out[SNAP_EXTRAS], &rec, sizeof(rec));
+  }
+  return (SNAP_REF(first + 1));
+}
+
+static void *put_exit(struct snap_buf *out, const struct room_direction_data *dir)
+{
+  struct room_direction_data rec;
+
+  if (!dir)
+    return (NULL);
+  memcpy(&rec, dir, sizeof(rec));
+  rec.general_description = put_string(out, dir->general_description);
+  rec.keyword = put_string(out, dir->keyword);
+  return (SNAP_REF(buf_add(&out[SNAP_EXITS], &rec, sizeof(rec)) / sizeof(rec) + 1));
+}
+
+static void *put_protos(struct snap_buf *out, const struct trig_proto_list *tp)
+{
+  size_t first = out[SNAP_PROTOS].len / sizeof(struct trig_proto_list);
+  struct trig_proto_list rec;
+
+  if (!tp)
+    return (NULL);
+  for (; tp; tp = tp->next) {
+    memcpy(&rec, tp, sizeof(rec));
+    rec.next = tp->next ? SNAP_REF(out[SNAP_PROTOS].len / sizeof(rec) + 2) : NULL;
+    buf_add(&out[SNAP_PROTOS], &rec, sizeof(rec));
+  }
+  return (SNAP_REF(first + 1));
+}
+
+/* Special procedures are assigned after boot_world(), and are not something
+ * a file could hold anyway.  The only copies counted yet are the triggers of
+ * rooms, which snapshot_load() attaches again. */
+static void *put_index(struct snap_buf *out, int sect, const struct index_data *idx, void *proto)
+{
+  struct index_data rec;
+
+  memcpy(&rec, idx, sizeof(rec));
+  rec.number = 0;
+  rec.func = NULL;
+  rec.mobs = NULL;
+  rec.objs = NULL;
+  rec.farg = put_string(out, idx->farg);
+  rec.proto = proto;
+  return (SNAP_REF(buf_add(&out[sect], &rec, sizeof(rec)) / sizeof(rec) + 1));
+}
+
+/* Apart from the scripts of rooms, every pointer in a prototype that is not
+ * swapped for a reference here is still NULL when boot_world() is done. */
+static void put_world(struct snap_buf *out, const struct snap_world *w)
+{
+  struct zone_data zone;
+  struct trig_data trig;
+  struct room_data room;
+  struct char_data mob;
+  struct obj_data obj;
+  int i, j;
+
+  for (i = 0; i < w->num_zones; i++) {
+    memcpy(&zone, w->zones + i, sizeof(zone));
+    zone.name = put_string(out, w->zones[i].name);
+    zone.builders = put_string(out, w->zones[i].builders);
+    zone.cmd = put_resets(out, w->zones[i].cmd);
+    buf_add(&out[SNAP_ZONES], &zone, sizeof(zone));
+  }
+
+  for (i = 0; i < w->num_trigs; i++) {
+    memcpy(&trig, w->trigs[i]->proto, sizeof(trig));
+    trig.name = put_string(out, w->trigs[i]->proto->name);
+    trig.arglist = put_string(out, w->trigs[i]->proto->arglist);
+    trig.cmdlist = put_cmdlist(out, w->trigs[i]->proto->cmdlist);
+    trig.curr_state = NULL;
+    trig.wait_event = NULL;
+    trig.var_list = NULL;
+    trig.next = trig.next_in_world = NULL;
+    put_index(out, SNAP_TRIG_INDEX, w->trigs[i],
+      SNAP_REF(buf_add(&out[SNAP_TRIGGERS], &trig, sizeof(trig)) / sizeof(trig) + 1));
+  }
+
+  for (i = 0; i < w->num_rooms; i++) {
+    memcpy(&room, w->rooms + i, sizeof(room));
+    room.name = put_string(out, w->rooms[i].name);
+    room.description = put_string(out, w->rooms[i].description);
+    room.ex_description = put_extras(out, w->rooms[i].ex_description);
+    for (j = 0; j < NUM_OF_DIRS; j++)
+      room.dir_option[j] = put_exit(out, w->rooms[i].dir_option[j]);
+    room.func = NULL;
+    room.proto_script = put_protos(out, w->rooms[i].proto_script);
+    room.script = NULL;
+    buf_add(&out[SNAP_ROOMS], &room, sizeof(room));
+  }
+
+  for (i = 0; i < w->num_mobs; i++) {
+    memcpy(&mob, w->mobs + i, sizeof(mob));
+    mob.player.name = put_string(out, w->mobs[i].player.name);
+    mob.player.short_descr = put_string(out, w->mobs[i].player.short_descr);
+    mob.player.long_descr = put_string(out, w->mobs[i].player.long_descr);
+    mob.player.description = put_string(out, w->mobs[i].player.description);
+    mob.player.title = put_string(out, w->mobs[i].player.title);
+    mob.player_specials = NULL;
+    mob.proto_script = put_protos(out, w->mobs[i].proto_script);
+    buf_add(&out[SNAP_MOBS], &mob, sizeof(mob));
+    put_index(out, SNAP_MOB_INDEX, w->mob_index + i, NULL);
+  }
+
+  for (i = 0; i < w->num_objs; i++) {
+    memcpy(&obj, w->objs + i, sizeof(obj));
+    obj.name = put_string(out, w->objs[i].name);
+    obj.description = put_string(out, w->objs[i].description);
+    obj.short_description = put_string(out, w->objs[i].short_description);
+    obj.action_description = put_string(out, w->objs[i].action_description);
+    obj.ex_description = put_extras(out, w->objs[i].ex_description);
+    obj.proto_script = put_protos(out, w->objs[i].proto_script);
+    buf_add(&out[SNAP_OBJS], &obj, sizeof(obj));
+    put_index(out, SNAP_OBJ_INDEX, w->obj_index + i, NULL);
+  }
+}
+
+static void free_sections(struct snap_buf *out)
+{
+  int i;
+
+  for (i = 0; i < NUM_SNAP_SECTIONS; i++)
+    if (out[i].data)
+      free(out[i].data);
+}
+
+/** Writes the tables boot_world() has just read from the world files to
+ * SNAPSHOT_FILE, for the next boot to load instead. */
+void snapshot_save(void)
+{
+  static const char zeros[SNAPSHOT_ALIGN];
+  struct snap_buf out[NUM_SNAP_SECTIONS];
+  struct snapshot_header hdr;
+  struct snap_world w;
+  size_t at, pad[NUM_SNAP_SECTIONS];
+  char tmpname[PATH_MAX];
+  FILE *fl;
+  int i, ok;
+
+  if (!have_boot_sums) {
+    if (!source_sums(boot_sums))
+      return;
+    have_boot_sums = TRUE;
+  }
+
+  current_world(&w);
+  memset(out, 0, sizeof(out));
+  put_world(out, &w);
+
+  memset(&hdr, 0, sizeof(hdr));
+  strncpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic));
+  hdr.version = SNAPSHOT_VERSION;
+  hdr.build = build_id();
+  hdr.mini_mud = mini_mud;
+  hdr.diagonal_dirs = CONFIG_DIAGONAL_DIRS;
+  memcpy(hdr.sources, boot_sums, sizeof(hdr.sources));
+
+  at = sizeof(hdr);
+  for (i = 0; i < NUM_SNAP_SECTIONS; i++) {
+    pad[i] = (SNAPSHOT_ALIGN - at % SNAPSHOT_ALIGN) % SNAPSHOT_ALIGN;
+    at += pad[i];
+    hdr.sections[i].offset = at;
+    hdr.sections[i].size = snap_sections[i].size;
+    hdr.sections[i].count = out[i].len / snap_sections[i].size;
+    hdr.sections[i].sum = hash_bytes(SNAP_HASH_INIT, out[i].data, out[i].len);
+    at += out[i].len;
+  }
+
+  snprintf(tmpname, sizeof(tmpname), "%s.tmp", SNAPSHOT_FILE);
+  if (!(fl = fopen(tmpname, "wb"))) {
+    log("SYSERR: Unable to write world snapshot %s: %s", tmpname, strerror(errno));
+    free_sections(out);
+    return;
+  }
+  ok = (fwrite(&hdr, sizeof(hdr), 1, fl) == 1);
+  for (i = 0; ok && i < NUM_SNAP_SECTIONS; i++)
+    ok = fwrite(zeros, 1, pad[i], fl) == pad[i] &&
+         fwrite(out[i].data, 1, out[i].len, fl) == out[i].len;
+  if (fclose(fl) || !ok || rename(tmpname, SNAPSHOT_FILE)) {
+    log("SYSERR: Unable to write world snapshot %s: %s", SNAPSHOT_FILE, strerror(errno));
+    remove(tmpname);
+  } else
+    log("Wrote world snapshot, %lu bytes.", (unsigned long) at);
+  free_sections(out);
+}
+
+/* Reading. */
+
+static int read_snapshot(struct snap_in *in)
+{
+  struct stat st;
+  FILE *fl;
+
+  memset(in, 0, sizeof(*in));
+  if (!(fl = fopen(SNAPSHOT_FILE, "rb")))
+    return (FALSE);
+  if (fstat(fileno(fl), &st) < 0 || st.st_size < (off_t) sizeof(struct snapshot_header)) {
+    fclose(fl);
+    return (FALSE);
+  }
+  in->len = st.st_size;
+  CREATE(in->data, char, in->len);
+  if (fread(in->data, 1, in->len, fl) != in->len) {
+    fclose(fl);
+    free(in->data);
+    in->data = NULL;
+    return (FALSE);
+  }
+  fclose(fl);
+  in->hdr = (const struct snapshot_header *) in->data;
+  return (TRUE);
+}
+
+/* @return NULL if the snapshot can stand in for the world files whose
+ * checksums are given, or why not. */
+static const char *check_header(struct snap_in *in, const unsigned long long *sums)
+{
+  const struct snapshot_header *hdr = in->hdr;
+  const struct snapshot_section *s;
+  size_t end = sizeof(*hdr);
+  int i;
+
+  if (strncmp(hdr->magic, SNAPSHOT_MAGIC, sizeof(hdr->magic)) || hdr->version != SNAPSHOT_VERSION)
+    return ("not a snapshot this version can read");
+  if (hdr->build != build_id())
+    return ("written by a different build");
+  if (hdr->mini_mud != mini_mud || hdr->diagonal_dirs != CONFIG_DIAGONAL_DIRS)
+    return ("written with different settings");
+  if (memcmp(hdr->sources, sums, sizeof(hdr->sources)))
+    return ("the world files have changed");
+
+  for (i = 0; i < NUM_SNAP_SECTIONS; i++) {
+    s = &hdr->sections[i];
+    if (s->size != snap_sections[i].size || s->offset < end || s->offset % SNAPSHOT_ALIGN ||
+        s->offset > in->len || s->count > (in->len - s->offset) / s->size)
+      return ("damaged");
+    end = s->offset + s->count * s->size;
+    if (hash_bytes(SNAP_HASH_INIT, in->data + s->offset, end - s->offset) != s->sum)
+      return ("damaged");
+  }
+  s = &hdr->sections[SNAP_STRINGS];
+  if (s->count && in->data[s->offset + s->count - 1])
+    return ("damaged");
+  return (NULL);
+}
+
+static char *get_string(struct snap_in *in, const void *ref)
+{
+  const struct snapshot_section *s = &in->hdr->sections[SNAP_STRINGS];
+  size_t n = SNAP_INDEX(ref);
+
+  if (!n)
+    return (NULL);
+  if (n > s->count) {
+    in->bad = TRUE;
+    return (NULL);
+  }
+  return (strdup(in->data + s->offset + n - 1));
+}
+
+static const void *get_record(struct snap_in *in, int sect, const void *ref)
+{
+  const struct snapshot_section *s = &in->hdr->sections[sect];
+  size_t n = SNAP_INDEX(ref);
+
+  if (!n)
+    return (NULL);
+  if (n > s->count) {
+    in->bad = TRUE;
+    return (NULL);
+  }
+  return (in->data + s->offset + (n - 1) * s->size);
+}
+
+static struct reset_com *get_resets(struct snap_in *in, const void *ref)
+{
+  const struct snapshot_section *s = &in->hdr->sections[SNAP_RESETS];
+  const struct reset_com *first;
+  struct reset_com *cmd;
+  size_t i, num;
+
+  if (!(first = get_record(in, SNAP_RESETS, ref)))
+    return (NULL);
+  for (num = 1; first[num - 1].command != 'S'; num++)
+    if (SNAP_INDEX(ref) + num > s->count) {
+      in->bad = TRUE;
+      return (NULL);
+    }
+
+  CREATE(cmd, struct reset_com, num);
+  for (i = 0; i < num; i++) {
+    cmd[i] = first[i];
+    cmd[i].sarg1 = get_string(in, first[i].sarg1);
+    cmd[i].sarg2 = get_string(in, first[i].sarg2);
+  }
+  return (cmd);
+}
+
+/* The lists below stop after as many nodes as their section holds, so a
+ * damaged file cannot send them round in circles. */
+static struct cmdlist_element *get_cmdlist(struct snap_in *in, const void *ref)
+{
+  struct cmdlist_element *head = NULL, **tail = &head;
+  const struct cmdlist_element *rec;
+  size_t left = in->hdr->sections[SNAP_CMDLINES].count;
+
+  for (; left-- && (rec = get_record(in, SNAP_CMDLINES, ref)); ref = rec->next) {
+    CREATE(*tail, struct cmdlist_element, 1);
+    **tail = *rec;
+    (*tail)->cmd = get_string(in, rec->cmd);
+    (*tail)->next = NULL;
+    tail = &(*tail)->next;
+  }
+  return (head);
+}
+
+static struct extra_descr_data *get_extras(struct snap_in *in, const void *ref)
+{
+  struct extra_descr_data *head = NULL, **tail = &head;
+  const struct extra_descr_data *rec;
+  size_t left = in->hdr->sections[SNAP_EXTRAS].count;
+
+  for (; left-- && (rec = get_record(in, SNAP_EXTRAS, ref)); ref = rec->next) {
+    CREATE(*tail, struct extra_descr_data, 1);
+    (*tail)->keyword = get_string(in, rec->keyword);
+    (*tail)->description = get_string(in, rec->description);
+    tail = &(*tail)->next;
+  }
+  return (head);
+}
+
+static struct room_direction_data *get_exit(struct snap_in *in, const void *ref)
+{
+  const struct room_direction_data *rec;
+  struct room_direction_data *dir;
+
+  if (!(rec = get_record(in, SNAP_EXITS, ref)))
+    return (NULL);
+  CREATE(dir, struct room_direction_data, 1);
+  *dir = *rec;
+  dir->general_description = get_string(in, rec->general_description);
+  dir->keyword = get_string(in, rec->keyword);
+  return (dir);
+}
+
+static struct trig_proto_list *get_protos(struct snap_in *in, const void *ref)
+{
+  struct trig_proto_list *head = NULL, **tail = &head;
+  const struct trig_proto_list *rec;
+  size_t left = in->hdr->sections[SNAP_PROTOS].count;
+
+  for (; left-- && (rec = get_record(in, SNAP_PROTOS, ref)); ref = rec->next) {
+    CREATE(*tail, struct trig_proto_list, 1);
+    (*tail)->vnum = rec->vnum;
+    tail = &(*tail)->next;
+  }
+  return (head);
+}
+
+/* Builds fresh tables from a snapshot that passed check_header().  FALSE if
+ * any reference in it was out of range; what was built is then abandoned,
+ * which only ever happens once, at boot. */
+static int get_world(struct snap_in *in, struct snap_world *w)
+{
+  const struct snapshot_section *sect = in->hdr->sections;
+  const struct zone_data *zone;
+  const struct index_data *idx;
+  const struct trig_data *trig;
+  const struct room_data *room;
+  const struct char_data *mob;
+  const struct obj_data *obj;
+  int i, j;
+
+  memset(w, 0, sizeof(*w));
+  w->num_zones = sect[SNAP_ZONES].count;
+  w->num_trigs = sect[SNAP_TRIG_INDEX].count;
+  w->num_rooms = sect[SNAP_ROOMS].count;
+  w->num_mobs = sect[SNAP_MOBS].count;
+  w->num_objs = sect[SNAP_OBJS].count;
+  if (!w->num_zones || !w->num_rooms || !w->num_mobs || !w->num_objs ||
+      sect[SNAP_TRIGGERS].count != sect[SNAP_TRIG_INDEX].count ||
+      sect[SNAP_MOB_INDEX].count != sect[SNAP_MOBS].count ||
+      sect[SNAP_OBJ_INDEX].count != sect[SNAP_OBJS].count)
+    return (FALSE);
+
+  CREATE(w->zones, struct zone_data, w->num_zones);
+  zone = (const struct zone_data *) (in->data + sect[SNAP_ZONES].offset);
+  for (i = 0; i < w->num_zones; i++) {
+    w->zones[i] = zone[i];
+    w->zones[i].name = get_string(in, zone[i].name);
+    w->zones[i].builders = get_string(in, zone[i].builders);
+    w->zones[i].cmd = get_resets(in, zone[i].cmd);
+    if (!w->zones[i].cmd)
+      in->bad = TRUE;
+  }
+
+  CREATE(w->trigs, struct index_data *, MAX(w->num_trigs, 1));
+  idx = (const struct index_data *) (in->data + sect[SNAP_TRIG_INDEX].offset);
+  for (i = 0; i < w->num_trigs; i++) {
+    CREATE(w->trigs[i], struct index_data, 1);
+    *w->trigs[i] = idx[i];
+    w->trigs[i]->farg = get_string(in, idx[i].farg);
+    w->trigs[i]->proto = NULL;
+    if (!(trig = get_record(in, SNAP_TRIGGERS, idx[i].proto))) {
+      in->bad = TRUE;
+      continue;
+    }
+    CREATE(w->trigs[i]->proto, struct trig_data, 1);
+    *w->trigs[i]->proto = *trig;
+    w->trigs[i]->proto->name = get_string(in, trig->name);
+    w->trigs[i]->proto->arglist = get_string(in, trig->arglist);
+    w->trigs[i]->proto->cmdlist = get_cmdlist(in, trig->cmdlist);
+    dg_compile_cmdlist(w->trigs[i]->proto->cmdlist, idx[i].vnum);
+  }
+
+  CREATE(w->rooms, struct room_data, w->num_rooms);
+  room = (const struct room_data *) (in->data + sect[SNAP_ROOMS].offset);
+  for (i = 0; i < w->num_rooms; i++) {
+    w->rooms[i] = room[i];
+    w->rooms[i].name = get_string(in, room[i].name);
+    w->rooms[i].description = get_string(in, room[i].description);
+    w->rooms[i].ex_description = get_extras(in, room[i].ex_description);
+    for (j = 0; j < NUM_OF_DIRS; j++)
+      w->rooms[i].dir_option[j] = get_exit(in, room[i].dir_option[j]);
+    w->rooms[i].proto_script = get_protos(in, room[i].proto_script);
+  }
+
+  CREATE(w->mob_index, struct index_data, w->num_mobs);
+  CREATE(w->mobs, struct char_data, w->num_mobs);
+  idx = (const struct index_data *) (in->data + sect[SNAP_MOB_INDEX].offset);
+  mob = (const struct char_data *) (in->data + sect[SNAP_MOBS].offset);
+  for (i = 0; i < w->num_mobs; i++) {
+    w->mob_index[i] = idx[i];
+    w->mob_index[i].farg = get_string(in, idx[i].farg);
+    w->mobs[i] = mob[i];
+    w->mobs[i].player.name = get_string(in, mob[i].player.name);
+    w->mobs[i].player.short_descr = get_string(in, mob[i].player.short_descr);
+    w->mobs[i].player.long_descr = get_string(in, mob[i].player.long_descr);
+    w->mobs[i].player.description = get_string(in, mob[i].player.description);
+    w->mobs[i].player.title = get_string(in, mob[i].player.title);
+    w->mobs[i].player_specials = &dummy_mob;
+    w->mobs[i].proto_script = get_protos(in, mob[i].proto_script);
+  }
+
+  CREATE(w->obj_index, struct index_data, w->num_objs);
+  CREATE(w->objs, struct obj_data, w->num_objs);
+  idx = (const struct index_data *) (in->data + sect[SNAP_OBJ_INDEX].offset);
+  obj = (const struct obj_data *) (in->data + sect[SNAP_OBJS].offset);
+  for (i = 0; i < w->num_objs; i++) {
+    w->obj_index[i] = idx[i];
+    w->obj_index[i].farg = get_string(in, idx[i].farg);
+    w->objs[i] = obj[i];
+    w->objs[i].name = get_string(in, obj[i].name);
+    w->objs[i].description = get_string(in, obj[i].description);
+    w->objs[i].short_description = get_string(in, obj[i].short_description);
+    w->objs[i].action_description = get_string(in, obj[i].action_description);
+    w->objs[i].ex_description = get_extras(in, obj[i].ex_description);
+    w->objs[i].proto_script = get_protos(in, obj[i].proto_script);
+  }
+
+  return (!in->bad);
+}
+
+/** Loads the zone, trigger, room, mob and object tables from SNAPSHOT_FILE
+ * in place of the text files, if it was written from the files as they are
+ * now.  Afterwards the tables are where boot_world() would have left them
+ * just before reading the shops.
+ * @return TRUE if the world was loaded, FALSE to read it from text. */
+int snapshot_load(void)
+{
+  struct snap_world w;
+  struct snap_in in;
+  const char *why;
+  int i;
+
+  if (!source_sums(boot_sums))
+    return (FALSE);
+  have_boot_sums = TRUE;
+
+  if (!read_snapshot(&in))
+    return (FALSE);
+  if ((why = check_header(&in, boot_sums)) != NULL) {
+    log("World snapshot not used: %s.", why);
+    free(in.data);
+    return (FALSE);
+  }
+  if (!get_world(&in, &w)) {
+    log("SYSERR: World snapshot %s is damaged, loading the world files instead.", SNAPSHOT_FILE);
+    free(in.data);
+    return (FALSE);
+  }
+  free(in.data);
+
+  zone_table = w.zones;
+  top_of_zone_table = w.num_zones - 1;
+  trig_index = w.trigs;
+  top_of_trigt = w.num_trigs;
+  world = w.rooms;
+  top_of_world = w.num_rooms - 1;
+  mob_index = w.mob_index;
+  mob_proto = w.mobs;
+  top_of_mobt = w.num_mobs - 1;
+  obj_index = w.obj_index;
+  obj_proto = w.objs;
+  top_of_objt = w.num_objs - 1;
+
+  /* As when the world files are merged (see load_world_files()). */
+  for (i = 0; i < w.num_rooms; i++)
+    if (world[i].proto_script)
+      assign_triggers(world + i, WLD_TRIGGER);
+
+  log("Loaded %d zones, %d triggers, %d rooms, %d mobs and %d objects from the world snapshot.",
+      w.num_zones, w.num_trigs, w.num_rooms, w.num_mobs, w.num_objs);
+  return (TRUE);
+}
+
+/** Checks that SNAPSHOT_FILE loads into exactly the tables boot_world() has
+ * just read from the world files.  Both sets of tables are written out as
+ * they would be saved and compared section by section.
+ * @return 0 if they match, 1 if not. */
+int snapshot_verify(void)
+{
+  struct snap_buf text[NUM_SNAP_SECTIONS], snap[NUM_SNAP_SECTIONS];
+  unsigned long long sums[NUM_SNAP_SOURCES];
+  struct snap_world w;
+  struct snap_in in;
+  const char *why;
+  size_t at, size;
+  int i, failed = 0;
+
+  log("Verifying world snapshot %s.", SNAPSHOT_FILE);
+  if (!source_sums(sums)) {
+    log("SYSERR: Unable to read the world files.");
+    return (1);
+  }
+  if (!read_snapshot(&in)) {
+    log("SYSERR: Unable to read world snapshot %s.", SNAPSHOT_FILE);
+    return (1);
+  }
+  if ((why = check_header(&in, sums)) != NULL || !get_world(&in, &w)) {
+    log("SYSERR: World snapshot cannot be used: %s.", why ? why : "damaged");
+    free(in.data);
+    return (1);
+  }
+  free(in.data);
+
+  memset(text, 0, sizeof(text));
+  memset(snap, 0, sizeof(snap));
+  put_world(snap, &w);
+  current_world(&w);
+  put_world(text, &w);
+
+  for (i = 0; i < NUM_SNAP_SECTIONS; i++) {
+    size = snap_sections[i].size;
+    for (at = 0; at < text[i].len && at < snap[i].len; at++)
+      if (text[i].data[at] != snap[i].data[at])
+        break;
+    if (at == text[i].len && at == snap[i].len)
+      continue;
+    log("SYSERR: Snapshot %s differ from the world files: %lu against %lu, first difference in number %lu.",
+        snap_sections[i].name, (unsigned long) (snap[i].len / size),
+        (unsigned long) (text[i].len / size), (unsigned long) (at / size));
+    failed = 1;
+  }
+  free_sections(text);
+  free_sections(snap);
+
+  /* The loaded tables are left for the process to discard as it exits. */
+  if (!failed)
+    log("World snapshot matches the world files: %d zones, %d triggers, %d rooms, %d mobs, %d objects.",
+        top_of_zone_table + 1, top_of_trigt, top_of_world + 1, top_of_mobt + 1, top_of_objt + 1);
+  return (failed);
+}
@@ -0,0 +1,17 @@
+/**
+* @file snapshot.h
+* A compiled copy of the world files, read back in one go at boot.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*/
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+int  snapshot_load(void);
+void snapshot_save(void);
+int  snapshot_verify(void);
+
+#endif /* _SNAPSHOT_H_ */
@@ -631,6 +631,9 @@ void clanedit_parse(struct descriptor_data *d, char *arg);
 #define SMALL_BUFSIZE      1024        /**< Static output buffer size   */
 /** Max amount of output that can be buffered */
 #define LARGE_BUFSIZE      (MAX_SOCK_BUF - GARBAGE_SPACE - MAX_PROMPT_LENGTH)
+#define OUTPUT_CHUNK_SIZE  4096        /**< Bytes per output queue chunk */
+/** Max amount of unsent output queued per descriptor before **OVERFLOW** */
+#define MAX_OUTPUT_QUEUE   (256 * 1024)
 
 #define MAX_STRING_LENGTH     49152  /**< Max length of string, as defined */
 #define MAX_INPUT_LENGTH      512    /**< Max length per *line* of input */
@@ -766,7 +769,11 @@ struct obj_data
   struct script_data *script;           /**< script info for the object */
 
   struct obj_data *next_content;  /**< For 'contains' lists   */
+  struct obj_data *prev_content;  /**< Previous in the 'contains' list */
   struct obj_data *next;          /**< For the object list */
+  struct obj_data *prev;          /**< Previous in the object list */
+  struct obj_data *next_proto;    /**< Next instance of the same prototype */
+  struct obj_data *prev_proto;    /**< Previous instance of the same prototype */
   struct char_data *sitting_here; /**< For furniture, who is sitting in it */
   
   struct list_data *events;      /**< Used for object events */
@@ -979,6 +986,9 @@ struct char_special_data
 {
   struct char_data *fighting;  /**< Target of fight; else NULL */
   struct char_data *hunting;   /**< Target of NPC hunt; else NULL */
+  struct path_data *track_path; /**< Cached route for tracking; else NULL */
+  bool zone_counted;           /**< Counted in its zone's num_players */
+  int dormant_ticks;           /**< Ticks an NPC slept through; see wake_mobile() */
   struct obj_data *furniture;  /**< Object being sat on/in; else NULL */
   struct char_data *next_in_furniture; /**< Next person sitting, else NULL */
   struct char_data *mount;     /**< Pet currently being ridden, else NULL */
@@ -1109,6 +1119,12 @@ struct char_data
   struct char_data *next_in_room;  /**< Next PC in the room */
   struct char_data *next;          /**< Next char_data in the room */
   struct char_data *next_fighting; /**< Next in line to fight */
+  struct char_data *prev_in_room;  /**< Previous PC in the room */
+  struct char_data *prev;          /**< Previous in the character list */
+  struct char_data *prev_fighting; /**< Previous in the combat list */
+  struct char_data *next_proto;    /**< Next instance of the same prototype */
+  struct char_data *prev_proto;    /**< Previous instance of the same prototype */
+  struct char_data *next_extract;  /**< Next char waiting to be extracted */
 
   struct follow_type *followers; /**< List of characters following */
   struct char_data *master;      /**< List of character being followed */
@@ -1128,6 +1144,17 @@ struct txt_block
   struct txt_block *next; /**< ? */
 };
 
+/** One piece of a descriptor's pending output.  Output is formatted once,
+ * appended to the tail chunk, and sent straight from the chunks with writev().
+ */
+struct output_chunk
+{
+  size_t len;                 /**< bytes stored in data */
+  size_t sent;                /**< bytes of data already handed to the kernel */
+  struct output_chunk *next;  /**< next chunk in the queue (or the pool) */
+  char data[OUTPUT_CHUNK_SIZE];
+};
+
 /** ? */
 struct txt_q
 {
@@ -1170,13 +1197,13 @@ struct descriptor_data
   int has_prompt;           /**< is the user at a prompt?             */
   char inbuf[MAX_RAW_INPUT_LENGTH];  /**< buffer for raw input		*/
   char last_input[MAX_INPUT_LENGTH]; /**< the last input			*/
-  char small_outbuf[SMALL_BUFSIZE];  /**< standard output buffer		*/
-  char *output;             /**< ptr to the current output buffer	*/
   char **history;           /**< History of commands, for ! mostly.	*/
   int history_pos;          /**< Circular array position.		*/
-  int bufptr;               /**< ptr to end of current output		*/
-  int bufspace;             /**< space left in the output buffer	*/
-  struct txt_block *large_outbuf; /**< ptr to large buffer, if we need it */
+  struct output_chunk *output_head; /**< oldest unsent output		*/
+  struct output_chunk *output_tail; /**< chunk new output is appended to	*/
+  size_t output_len;        /**< bytes of output waiting to be sent	*/
+  int output_overflow;      /**< dropping output until the queue drains */
+  struct compress_data *compress; /**< MCCP deflate stream, if any	*/
   struct txt_q input;       /**< q of unprocessed input		*/
   struct char_data *character; /**< linked to char			*/
   struct char_data *original;  /**< original char if switched		*/
@@ -1185,6 +1212,9 @@ struct descriptor_data
   struct descriptor_data *next;     /**< link to next descriptor		*/
   struct oasis_olc_data *olc;       /**< OLC info */
   protocol_t *pProtocol;    /**< Kavir plugin */
+  int poll_events;          /**< readiness bits from the poller (POLLER_*) */
+  struct descriptor_data *poll_next; /**< next on the poller's ready list */
+  struct dns_request *dns_request;   /**< reverse lookup still in flight */
   
   struct list_data * events;
 
@@ -1336,6 +1366,10 @@ struct index_data
 
   char *farg; /**< String argument for special function. */
   struct trig_data *proto; /**< Points to the trigger prototype. */
+  /** Live instances of this prototype, newest first, linked through their
+   * next_proto and prev_proto.  Only the list matching the table is used. */
+  struct char_data *mobs;
+  struct obj_data *objs;
 };
 
 /** Master linked list for the mob/object prototype trigger lists. */
@@ -1453,6 +1487,7 @@ struct game_operation
   int protocol_negotiation; /**< Enable the protocol negotiation system ? */
   int special_in_comm; /**< Enable use of a special character in communication channels ? */
   int debug_mode; /**< Current Debug Mode */
+  int zone_dormancy; /**< Minutes a zone stays empty before it sleeps */
 };
 
 /** The Autowizard options. */
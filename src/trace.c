@@ -0,0 +1,384 @@
+/**
+* @file trace.c
+* Recording the input the game is given, and playing it back.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*
+* A slow spell on the live game is hard to chase without the players who
+* caused it.  With --record=<file> the game writes down everything that came
+* in from outside, pass by pass: connections opening, every line taken off a
+* descriptor's input queue, and connections the other end dropped.  Passes
+* that ran more than one heartbeat to catch up are noted too, as is the
+* random seed.
+*
+* --replay=<file> boots the game without a listening socket and feeds the
+* trace back in.  Each connection becomes a descriptor with no socket whose
+* output is thrown away, and each line is queued for it on the pass it was
+* taken in the recording.  --replay-fast=<file> does the same without
+* sleeping between passes, and --pulse-times=<file> writes out how long
+* every pass took, so two builds can be compared pass for pass.
+*
+* Only lines as they reached the game are kept; aliases are expanded again
+* on replay.  A replay follows the recording as long as the game does the
+* same thing with the same input, so it should start from a copy of the lib
+* directory the recording started from.  A trace holds passwords as they
+* were typed, and is made readable by its owner only.
+*
+* The file is TRACE_MAGIC, a version byte and the seed, then one event after
+* another: a type byte, the pulse as a difference from the last event's, and
+* whatever the type needs.  Numbers are written seven bits to a byte, low
+* bits first, with the top bit set on all but the last byte.
+*/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "trace.h"
+
+#ifndef INVALID_SOCKET
+#define INVALID_SOCKET (-1)
+#endif
+
+#define TRACE_MAGIC    "TBATRACE"
+#define TRACE_VERSION  1
+
+/* Event types. */
+#define EV_CONNECT      1   /* descriptor, host */
+#define EV_INPUT        2   /* descriptor, line */
+#define EV_DROP         3   /* descriptor */
+#define EV_DROP_OUTPUT  4   /* descriptor */
+#define EV_HEARTBEATS   5   /* count */
+#define EV_END          6
+
+struct trace_event {
+  int type;
+  unsigned long pulse;
+  int desc;
+  unsigned long count;
+  char text[MAX_INPUT_LENGTH + HOST_LENGTH];
+};
+
+int trace_mode = TRACE_OFF;
+
+static FILE *trace_file;
+static FILE *times_file;
+static unsigned long last_pulse;   /* of the last event written or read */
+static int unflushed;              /* events written this pass */
+static int replay_fast;
+static struct trace_event next;    /* the next event to replay */
+static int have_next;
+static unsigned long events, missing;
+
+/* local functions */
+static void put_number(unsigned long n);
+static void put_event(int type, int desc);
+static void put_text(const char *text);
+static int get_number(unsigned long *n);
+static int get_text(char *buf, size_t size);
+static int read_event(void);
+static struct descriptor_data *find_replayed(int desc);
+
+static void put_number(unsigned long n)
+{
+  while (n >= 0x80) {
+    putc((int) (n & 0x7f) | 0x80, trace_file);
+    n >>= 7;
+  }
+  putc((int) n, trace_file);
+}
+
+static void put_event(int type, int desc)
+{
+  putc(type, trace_file);
+  put_number(pulse - last_pulse);
+  last_pulse = pulse;
+  if (desc >= 0)
+    put_number(desc);
+  unflushed++;
+  events++;
+}
+
+static void put_text(const char *text)
+{
+  size_t len = strlen(text);
+
+  put_number(len);
+  fwrite(text, 1, len, trace_file);
+}
+
+/** Starts recording to fname, replacing whatever was there.
+ * @param fname The trace file.
+ * @param seed The seed the random numbers were started with.
+ * @return FALSE if the file could not be made. */
+int trace_record_start(const char *fname, unsigned long seed)
+{
+  int fd;
+
+  if ((fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0 ||
+      !(trace_file = fdopen(fd, "wb"))) {
+    log("SYSERR: Cannot record input to %s: %s", fname, strerror(errno));
+    if (fd >= 0)
+      close(fd);
+    return (FALSE);
+  }
+
+  last_pulse = pulse;
+  events = unflushed = 0;
+  fwrite(TRACE_MAGIC, 1, strlen(TRACE_MAGIC), trace_file);
+  putc(TRACE_VERSION, trace_file);
+  put_number(seed);
+  trace_mode = TRACE_RECORD;
+  log("Recording input to %s.", fname);
+  return (TRUE);
+}
+
+/** Notes a new connection. */
+void trace_connect(struct descriptor_data *d)
+{
+  if (trace_mode != TRACE_RECORD)
+    return;
+  put_event(EV_CONNECT, d->desc_num);
+  put_text(d->host);
+}
+
+/** Notes a line taken off a descriptor's input queue to be acted on. */
+void trace_input(struct descriptor_data *d, const char *line)
+{
+  if (trace_mode != TRACE_RECORD)
+    return;
+  put_event(EV_INPUT, d->desc_num);
+  put_text(line);
+}
+
+/** Notes a connection closed because its socket failed.
+ * @param d The descriptor about to be closed.
+ * @param where TRACE_DROP_INPUT or TRACE_DROP_OUTPUT. */
+void trace_drop(struct descriptor_data *d, int where)
+{
+  if (trace_mode != TRACE_RECORD)
+    return;
+  put_event(where == TRACE_DROP_OUTPUT ? EV_DROP_OUTPUT : EV_DROP, d->desc_num);
+}
+
+/** Notes how many heartbeats this pass runs, if it is not the usual one. */
+void trace_heartbeats(int count)
+{
+  if (trace_mode != TRACE_RECORD || count == 1)
+    return;
+  put_event(EV_HEARTBEATS, -1);
+  put_number(count);
+}
+
+static int get_number(unsigned long *n)
+{
+  int c, shift = 0;
+
+  *n = 0;
+  do {
+    if ((c = getc(trace_file)) == EOF || shift > 56)
+      return (FALSE);
+    *n |= (unsigned long) (c & 0x7f) << shift;
+    shift += 7;
+  } while (c & 0x80);
+
+  return (TRUE);
+}
+
+static int get_text(char *buf, size_t size)
+{
+  unsigned long len;
+
+  if (!get_number(&len) || len >= size || fread(buf, 1, len, trace_file) != len)
+    return (FALSE);
+  buf[len] = '\0';
+  return (TRUE);
+}
+
+/* Reads the next event into next.  Returns FALSE at the end of the trace. */
+static int read_event(void)
+{
+  unsigned long n;
+  int ok;
+
+  if ((next.type = getc(trace_file)) == EOF) {
+    log("SYSERR: Input trace ends without an end marker.");
+    return (FALSE);
+  }
+  if (!get_number(&n))
+    next.type = -1;
+  next.pulse = last_pulse += n;
+
+  switch (next.type) {
+  case EV_CONNECT:
+  case EV_INPUT:
+    ok = get_number(&n) && get_text(next.text, sizeof(next.text));
+    next.desc = (int) n;
+    break;
+  case EV_DROP:
+  case EV_DROP_OUTPUT:
+    ok = get_number(&n);
+    next.desc = (int) n;
+    break;
+  case EV_HEARTBEATS:
+    ok = get_number(&next.count);
+    break;
+  case EV_END:
+    ok = TRUE;
+    break;
+  default:
+    ok = FALSE;
+    break;
+  }
+
+  if (!ok) {
+    log("SYSERR: Input trace is damaged near pulse %lu.", next.pulse);
+    return (FALSE);
+  }
+  events++;
+  return (TRUE);
+}
+
+/** Starts replaying fname.
+ * @param fname The trace file.
+ * @param fast TRUE to run passes back to back instead of in real time.
+ * @param seed Set to the seed the recording was made with.
+ * @return FALSE if fname is not a trace that can be read. */
+int trace_replay_start(const char *fname, int fast, unsigned long *seed)
+{
+  char magic[sizeof(TRACE_MAGIC)];
+
+  if (!(trace_file = fopen(fname, "rb"))) {
+    log("SYSERR: Cannot replay %s: %s", fname, strerror(errno));
+    return (FALSE);
+  }
+
+  if (fread(magic, 1, strlen(TRACE_MAGIC), trace_file) != strlen(TRACE_MAGIC) ||
+      strncmp(magic, TRACE_MAGIC, strlen(TRACE_MAGIC)) ||
+      getc(trace_file) != TRACE_VERSION || !get_number(seed)) {
+    log("SYSERR: %s is not an input trace this version can replay.", fname);
+    fclose(trace_file);
+    trace_file = NULL;
+    return (FALSE);
+  }
+
+  trace_mode = TRACE_REPLAY;
+  replay_fast = fast;
+  last_pulse = events = missing = 0;
+  have_next = read_event();
+  log("Replaying input from %s%s.", fname, fast ? " at full speed" : "");
+  return (TRUE);
+}
+
+int trace_replay_fast(void)
+{
+  return (trace_mode == TRACE_REPLAY && replay_fast);
+}
+
+static struct descriptor_data *find_replayed(int desc)
+{
+  struct descriptor_data *d;
+
+  for (d = descriptor_list; d; d = d->next)
+    if (d->descriptor == INVALID_SOCKET && d->desc_num == desc)
+      return (d);
+
+  missing++;
+  return (NULL);
+}
+
+/** Opens the connections, queues the lines and drops the connections that
+ * came in from outside on this pass, where the game reads its sockets. */
+void trace_replay_input(void)
+{
+  struct descriptor_data *d;
+
+  for (; have_next && next.pulse <= pulse; have_next = read_event()) {
+    if (next.type == EV_CONNECT)
+      replay_descriptor(next.desc, next.text);
+    else if (next.type == EV_INPUT) {
+      if ((d = find_replayed(next.desc)) != NULL)
+        write_to_q(next.text, &d->input, 0);
+    } else if (next.type == EV_DROP) {
+      if ((d = find_replayed(next.desc)) != NULL)
+        close_socket(d);
+    } else
+      break;
+  }
+}
+
+/** Drops the connections that failed while being written to on this pass. */
+void trace_replay_output(void)
+{
+  struct descriptor_data *d;
+
+  for (; have_next && next.pulse <= pulse && next.type == EV_DROP_OUTPUT;
+       have_next = read_event())
+    if ((d = find_replayed(next.desc)) != NULL)
+      close_socket(d);
+}
+
+/** @return How many heartbeats this pass ran in the recording. */
+int trace_replay_heartbeats(void)
+{
+  int count;
+
+  if (!have_next || next.pulse > pulse || next.type != EV_HEARTBEATS)
+    return (1);
+
+  count = (int) next.count;
+  have_next = read_event();
+  return (count);
+}
+
+/** @return TRUE once the game has run as long as the recording did. */
+int trace_replay_done(void)
+{
+  return (!have_next || (next.type == EV_END && next.pulse <= pulse));
+}
+
+/** Starts writing the time of every pass to fname. */
+int trace_times_start(const char *fname)
+{
+  if (!(times_file = fopen(fname, "w"))) {
+    log("SYSERR: Cannot write pulse times to %s: %s", fname, strerror(errno));
+    return (FALSE);
+  }
+  return (TRUE);
+}
+
+/** Ends a pass through game_loop() that took usec microseconds. */
+void trace_pass_end(long usec)
+{
+  if (times_file)
+    fprintf(times_file, "%lu %ld\n", pulse, usec);
+
+  /* A trace is most wanted after a crash, so it never lags by more than a
+   * pass. */
+  if (trace_mode == TRACE_RECORD && unflushed) {
+    fflush(trace_file);
+    unflushed = 0;
+  }
+}
+
+/** Finishes the trace and the pulse times, if either is being written. */
+void trace_stop(void)
+{
+  if (trace_mode == TRACE_RECORD) {
+    put_event(EV_END, -1);
+    log("Recorded %lu input events over %lu pulses.", events, pulse);
+  } else if (trace_mode == TRACE_REPLAY)
+    log("Replayed %lu input events over %lu pulses%s.", events, pulse,
+      missing ? ", some for connections that were already gone" : "");
+
+  if (trace_file)
+    fclose(trace_file);
+  if (times_file)
+    fclose(times_file);
+  trace_file = times_file = NULL;
+  trace_mode = TRACE_OFF;
+}
@@ -0,0 +1,41 @@
+/**
+* @file trace.h
+* Recording the input the game is given, and playing it back.
+*
+* Part of the core tbaMUD source code distribution, which is a derivative
+* of, and continuation of, CircleMUD.
+*
+* All rights reserved.  See license for complete information.
+*/
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+/* What the game is doing with a trace. */
+#define TRACE_OFF     0
+#define TRACE_RECORD  1   /**< Writing one from live connections */
+#define TRACE_REPLAY  2   /**< Reading one back instead of the sockets */
+
+/* Where in a pass a connection was dropped by the other end. */
+#define TRACE_DROP_INPUT   0   /**< Reading, or an exception on the socket */
+#define TRACE_DROP_OUTPUT  1   /**< Writing */
+
+extern int trace_mode;
+
+int  trace_record_start(const char *fname, unsigned long seed);
+void trace_connect(struct descriptor_data *d);
+void trace_input(struct descriptor_data *d, const char *line);
+void trace_drop(struct descriptor_data *d, int where);
+void trace_heartbeats(int count);
+
+int  trace_replay_start(const char *fname, int fast, unsigned long *seed);
+int  trace_replay_fast(void);
+void trace_replay_input(void);
+void trace_replay_output(void);
+int  trace_replay_heartbeats(void);
+int  trace_replay_done(void);
+
+int  trace_times_start(const char *fname);
+void trace_pass_end(long usec);
+void trace_stop(void);
+
+#endif /* _TRACE_H_ */
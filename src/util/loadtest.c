@@ -0,0 +1,599 @@
+/* ************************************************************************
+*  file:  loadtest.c                                       Part of tbaMUD *
+*  Usage: boot the game under scripted bots and report how it held up     *
+*         loadtest [-b bots] [-t secs] [-s seed] [-m mixfile] ...         *
+*  All Rights Reserved                                                    *
+************************************************************************* */
+
+/*
+ * loadtest copies a lib directory somewhere scratch, boots the game on it
+ * with a fixed random seed, and logs a number of bots in over loopback.
+ * Once they are all playing, each sends a command picked from a weighted
+ * mix every second or so, and the run is timed for a set number of
+ * seconds.  Commands answered per second, output bytes per second and
+ * command latency are measured here; pulse times and memory come from the
+ * game's own --bench-report.  Everything is printed as one JSON object so
+ * runs can be compared by a script.
+ *
+ * A command is answered when the prompt comes back after it.  Other
+ * players' says, gossip and fights arrive without one, so they do not
+ * count.
+ *
+ * Every bot makes its own choices from a generator seeded off the run's
+ * seed, so two runs send the same commands in the same order per bot.
+ * How those interleave still depends on timing.
+ */
+
+#include "conf.h"
+#include "sysdep.h"
+#include <signal.h>
+
+#define MAX_BOTS        500
+#define MAX_MIX         100
+#define MIX_LENGTH      80
+#define MATCH_SIZE      8192   /* unmatched output kept while logging in */
+#define BOOT_TIMEOUT    120    /* seconds to wait for the game to listen */
+#define LOGIN_TIMEOUT   120    /* seconds to wait for every bot to play */
+#define ANSWER_TIMEOUT  10000  /* ms before a command is given up on */
+#define BOT_PASSWORD    "loadtest"
+
+/* Each line of the login is sent when the output so far ends up holding
+ * its prompt.  A NULL line is the bot's name. */
+struct login_step {
+  const char *prompt;
+  const char *line;
+};
+
+static const struct login_step login_script[] = {
+  { "Account name (or NEW): ",         "NEW" },
+  { "New account name: ",              NULL },
+  { "New account password: ",          BOT_PASSWORD },
+  { "Confirm password: ",              BOT_PASSWORD },
+  { "wish to be known?",               NULL },
+  { "Did I get that right",            "y" },
+  { "Give me a password for",          BOT_PASSWORD },
+  { "retype password: ",               BOT_PASSWORD },
+  { "What is your sex",                "m" },
+  { "Enter race (number or letter): ", "1" },
+  { "Class: ",                         "w" },
+  { "Choice: ",                        "7" },
+  { "*** PRESS RETURN: ",              "" },
+  { "Make your choice: ",              "1" },
+  { NULL, NULL }
+};
+
+/* Where a bot that died or was dropped to the menu goes back in. */
+#define MENU_PROMPT "Make your choice: "
+
+/* How the default prompt ends: its last field's bracket, the {X} after it
+ * and the colour reset make_prompt() adds. */
+#define GAME_PROMPT "]\033[0;00m \033[0;00m"
+
+struct mix_entry {
+  int weight;
+  char command[MIX_LENGTH];
+};
+
+/* Used when no -m file is given: mostly walking and looking, with some
+ * talk, fights and shopping around Midgaard. */
+static const struct mix_entry default_mix[] = {
+  { 10, "north" }, { 10, "south" }, { 10, "east" }, { 10, "west" },
+  { 3, "up" }, { 3, "down" },
+  { 15, "look" }, { 5, "who" }, { 5, "score" }, { 3, "inventory" },
+  { 8, "say Hello there." }, { 2, "gossip Anyone around?" },
+  { 3, "kill fido" }, { 3, "kill cat" }, { 2, "kill beggar" }, { 3, "flee" },
+  { 3, "list" }, { 2, "buy bread" }, { 2, "buy water" }, { 1, "eat bread" },
+  { 0, "" }
+};
+
+struct bot {
+  int fd;                 /* -1 once the game has dropped it */
+  int step;               /* next line of login_script, -1 when playing */
+  char name[32];
+  char seen[MATCH_SIZE];  /* output not yet matched against a prompt */
+  size_t seen_len;
+  unsigned long rng;
+  long next_command;      /* when to send the next command, in ms */
+  long sent_at;           /* when the unanswered line went, or 0 */
+  int measured;           /* that line is a command from the mix */
+};
+
+static struct bot *bots;
+static int num_bots = 10;
+static struct mix_entry mix[MAX_MIX];
+static int num_mix, mix_weight;
+
+/* What is being measured.  Commands that time out or are cut short by
+ * death count as unanswered. */
+static unsigned long commands, answered, unanswered, disconnects;
+static unsigned long output_bytes;
+static long *latency;
+static size_t num_latency, max_latency;
+
+static long now_ms(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return (tv.tv_sec * 1000L + tv.tv_usec / 1000);
+}
+
+static unsigned long bot_random(struct bot *b)
+{
+  b->rng = (b->rng * 1103515245UL + 12345UL) & 0x7fffffffUL;
+  return (b->rng >> 8);
+}
+
+/* Names are letters only, and built from syllables that cannot spell
+ * anything the game's name filter would turn down. */
+static void make_name(char *buf, size_t size, int n)
+{
+  static const char *syllables[10] = {
+    "ba", "be", "bi", "bo", "la", "le", "li", "lo", "na", "ne"
+  };
+  size_t len = snprintf(buf, size, "Bot");
+
+  do {
+    len += snprintf(buf + len, size - len, "%s", syllables[n % 10]);
+    n /= 10;
+  } while (n && len < size);
+}
+
+static void load_mix(const char *fname)
+{
+  FILE *fl;
+  char line[256], *cmd;
+  int weight;
+
+  if (!fname) {
+    for (num_mix = 0; default_mix[num_mix].weight; num_mix++)
+      mix[num_mix] = default_mix[num_mix];
+  } else if (!(fl = fopen(fname, "r"))) {
+    perror(fname);
+    exit(1);
+  } else {
+    /* Each line is a weight and a command; # starts a comment. */
+    while (fgets(line, sizeof(line), fl) && num_mix < MAX_MIX) {
+      line[strcspn(line, "\r\n")] = '\0';
+      if (*line == '#' || sscanf(line, "%d", &weight) != 1 || weight <= 0)
+        continue;
+      for (cmd = line; isdigit(*cmd) || isspace(*cmd); cmd++)
+        ;
+      mix[num_mix].weight = weight;
+      snprintf(mix[num_mix].command, MIX_LENGTH, "%.*s", MIX_LENGTH - 1, cmd);
+      num_mix++;
+    }
+    fclose(fl);
+  }
+
+  for (weight = 0; weight < num_mix; weight++)
+    mix_weight += mix[weight].weight;
+  if (!mix_weight) {
+    fprintf(stderr, "No commands in the mix.\n");
+    exit(1);
+  }
+}
+
+static const char *pick_command(struct bot *b)
+{
+  int i, roll = bot_random(b) % mix_weight;
+
+  for (i = 0; roll >= mix[i].weight; i++)
+    roll -= mix[i].weight;
+  return (mix[i].command);
+}
+
+static void send_line(struct bot *b, const char *line)
+{
+  char buf[MIX_LENGTH + 4];
+  int len = snprintf(buf, sizeof(buf), "%s\r\n", line);
+
+  if (write(b->fd, buf, len) != len) {
+    close(b->fd);
+    b->fd = -1;
+    disconnects++;
+  }
+}
+
+static int connect_to(int port)
+{
+  struct sockaddr_in sa;
+  int fd;
+
+  if ((fd = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
+    perror("socket");
+    exit(1);
+  }
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(port);
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if (connect(fd, (struct sockaddr *) &sa, sizeof(sa)) < 0) {
+    close(fd);
+    return (-1);
+  }
+  return (fd);
+}
+
+/* Finds needle in the first len bytes of haystack, which may hold telnet
+ * codes and so cannot be treated as a string. */
+static char *find_bytes(char *haystack, size_t len, const char *needle)
+{
+  size_t n = strlen(needle), i;
+
+  for (i = 0; i + n <= len; i++)
+    if (haystack[i] == *needle && !memcmp(haystack + i, needle, n))
+      return (haystack + i);
+  return (NULL);
+}
+
+/* Drops everything in the bot's output up to the end of prompt, if the
+ * prompt is there. */
+static int take_prompt(struct bot *b, const char *prompt)
+{
+  char *at = find_bytes(b->seen, b->seen_len, prompt);
+  size_t used;
+
+  if (!at)
+    return (0);
+  used = at - b->seen + strlen(prompt);
+  memmove(b->seen, b->seen + used, b->seen_len - used);
+  b->seen_len -= used;
+  return (1);
+}
+
+static void add_latency(long ms)
+{
+  if (num_latency == max_latency) {
+    max_latency = max_latency ? max_latency * 2 : 1024;
+    if (!(latency = realloc(latency, max_latency * sizeof(long)))) {
+      perror("realloc");
+      exit(1);
+    }
+  }
+  latency[num_latency++] = ms;
+}
+
+/* The bot's prompt came back: whatever it sent last has been dealt with. */
+static void bot_answered(struct bot *b, long now)
+{
+  if (b->sent_at && b->measured) {
+    add_latency(now - b->sent_at);
+    answered++;
+  }
+  b->sent_at = 0;
+}
+
+static void bot_read(struct bot *b, long now, int think)
+{
+  char buf[4096];
+  const struct login_step *step;
+  ssize_t len = read(b->fd, buf, sizeof(buf));
+
+  if (len <= 0) {
+    close(b->fd);
+    b->fd = -1;
+    disconnects++;
+    return;
+  }
+  output_bytes += len;
+
+  /* Keep only the newest output if a prompt is slow to turn up. */
+  if (b->seen_len + len > sizeof(b->seen)) {
+    memmove(b->seen, b->seen + b->seen_len + len - sizeof(b->seen),
+      sizeof(b->seen) - len);
+    b->seen_len = sizeof(b->seen) - len;
+  }
+  memcpy(b->seen + b->seen_len, buf, len);
+  b->seen_len += len;
+
+  /* A playing bot only needs enough to find a prompt across two reads. */
+  if (b->step < 0) {
+    while (take_prompt(b, GAME_PROMPT))
+      bot_answered(b, now);
+    if (take_prompt(b, MENU_PROMPT)) {
+      if (b->sent_at && b->measured)
+        unanswered++;
+      send_line(b, "1");
+      b->sent_at = now;	/* back in once the prompt shows */
+      b->measured = 0;
+    }
+    if (b->seen_len > strlen(MENU_PROMPT)) {
+      memmove(b->seen, b->seen + b->seen_len - strlen(MENU_PROMPT),
+        strlen(MENU_PROMPT));
+      b->seen_len = strlen(MENU_PROMPT);
+    }
+    return;
+  }
+
+  for (step = &login_script[b->step]; b->fd >= 0 && step->prompt &&
+       take_prompt(b, step->prompt); step = &login_script[++b->step])
+    send_line(b, step->line ? step->line : b->name);
+
+  if (!step->prompt) {
+    b->step = -1;
+    b->seen_len = 0;
+    b->sent_at = now;	/* in once the prompt shows */
+    b->measured = 0;
+    b->next_command = now + bot_random(b) % think;
+  }
+}
+
+static void bot_command(struct bot *b, long now, int think)
+{
+  if (b->sent_at && now - b->sent_at > ANSWER_TIMEOUT) {
+    if (b->measured)
+      unanswered++;
+    b->sent_at = 0;
+  }
+  if (b->sent_at || now < b->next_command)
+    return;
+
+  send_line(b, pick_command(b));
+  commands++;
+  b->sent_at = now;
+  b->measured = 1;
+  b->next_command = now + think / 2 + bot_random(b) % think;
+}
+
+/* Runs the bots until the time until, sending commands if measuring and
+ * stopping as soon as every bot is playing if not.  Returns how many are
+ * playing. */
+static int run_bots(long until, int measuring, int think)
+{
+  struct timeval timeout;
+  fd_set readers;
+  long now;
+  int i, maxfd, playing;
+
+  for (;;) {
+    now = now_ms();
+    FD_ZERO(&readers);
+    maxfd = -1;
+    playing = 0;
+
+    for (i = 0; i < num_bots; i++) {
+      if (bots[i].fd < 0)
+        continue;
+      if (bots[i].step < 0) {
+        playing++;
+        if (measuring)
+          bot_command(&bots[i], now, think);
+      }
+      if (bots[i].fd < 0)
+        continue;
+      FD_SET(bots[i].fd, &readers);
+      if (bots[i].fd > maxfd)
+        maxfd = bots[i].fd;
+    }
+
+    if (maxfd < 0 || now >= until || (!measuring && playing == num_bots))
+      return (playing);
+
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 20000;
+    if (select(maxfd + 1, &readers, NULL, NULL, &timeout) < 0) {
+      if (errno == EINTR)
+        continue;
+      perror("select");
+      exit(1);
+    }
+
+    now = now_ms();
+    for (i = 0; i < num_bots; i++)
+      if (bots[i].fd >= 0 && FD_ISSET(bots[i].fd, &readers))
+        bot_read(&bots[i], now, think);
+  }
+}
+
+static int by_value(const void *a, const void *b)
+{
+  long la = *(const long *) a, lb = *(const long *) b;
+
+  return (la < lb ? -1 : la > lb ? 1 : 0);
+}
+
+static long latency_at(int pct)
+{
+  size_t i;
+
+  if (!num_latency)
+    return (0);
+  i = (num_latency * pct + 99) / 100;
+  return (latency[i ? i - 1 : 0]);
+}
+
+/* Player files go in lettered directories that a fresh checkout may not
+ * have; without them the bots' characters would never be saved. */
+static void make_player_dirs(const char *dir)
+{
+  static const char *kinds[] = { "plrfiles", "plrobjs", "plrvars" };
+  static const char *letters[] = { "A-E", "F-J", "K-O", "P-T", "U-Z", "ZZZ" };
+  char path[512];
+  int i, j;
+
+  for (i = 0; i < 3; i++) {
+    snprintf(path, sizeof(path), "%s/%s", dir, kinds[i]);
+    mkdir(path, 0755);
+    for (j = 0; j < 6; j++) {
+      snprintf(path, sizeof(path), "%s/%s/%s", dir, kinds[i], letters[j]);
+      mkdir(path, 0755);
+    }
+  }
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr,
+    "Usage: %s [-b bots] [-t seconds] [-s seed] [-i think ms] [-p port]\n"
+    "          [-d lib dir] [-x game binary] [-m mix file] [-o report] [-k]\n"
+    "  -b  Bots to log in (default 10, at most %d).\n"
+    "  -t  Seconds to measure once every bot is playing (default 60).\n"
+    "  -s  Seed for the game and the bots (default 1).\n"
+    "  -i  Average time between one bot's commands, in ms (default 1000).\n"
+    "  -p  Port to run the game on (default 5999).\n"
+    "  -d  Lib directory to copy for the run (default lib).\n"
+    "  -x  Game to run (default bin/circle).\n"
+    "  -m  File of '<weight> <command>' lines to pick commands from.\n"
+    "  -o  Write the JSON report to a file instead of standard output.\n"
+    "  -k  Keep the scratch copy of the lib directory.\n",
+    prog, MAX_BOTS);
+  exit(1);
+}
+
+int main(int argc, char **argv)
+{
+  const char *lib = "lib", *game = "bin/circle", *mixfile = NULL, *out = NULL;
+  char scratch[] = "/tmp/loadtestXXXXXX", cmd[1024], report[256], logname[256];
+  char seedarg[64], reportarg[300], portstr[16], line[256];
+  unsigned long seed = 1;
+  int port = 5999, seconds = 60, think = 1000, keep = 0, playing, status, i;
+  int got_report = 0;
+  long login_start, start, end;
+  struct rusage ru;
+  FILE *fl, *rep;
+  pid_t pid;
+
+  for (i = 1; i < argc; i++) {
+    if (argv[i][0] != '-' || !argv[i][1] || argv[i][2])
+      usage(argv[0]);
+    if (argv[i][1] == 'k') {
+      keep = 1;
+      continue;
+    }
+    if (i + 1 >= argc)
+      usage(argv[0]);
+    switch (argv[i][1]) {
+    case 'b': num_bots = atoi(argv[++i]); break;
+    case 't': seconds = atoi(argv[++i]); break;
+    case 's': seed = strtoul(argv[++i], NULL, 10); break;
+    case 'i': think = atoi(argv[++i]); break;
+    case 'p': port = atoi(argv[++i]); break;
+    case 'd': lib = argv[++i]; break;
+    case 'x': game = argv[++i]; break;
+    case 'm': mixfile = argv[++i]; break;
+    case 'o': out = argv[++i]; break;
+    default: usage(argv[0]);
+    }
+  }
+  if (num_bots < 1 || num_bots > MAX_BOTS || seconds < 1 || think < 1 ||
+      port <= 1024 || strchr(lib, '\''))
+    usage(argv[0]);
+
+  load_mix(mixfile);
+
+  /* The bots make characters and the game saves them, so it runs on a
+   * copy of the lib directory. */
+  if (!mkdtemp(scratch)) {
+    perror("mkdtemp");
+    exit(1);
+  }
+  snprintf(cmd, sizeof(cmd), "cp -R '%s/.' '%s'", lib, scratch);
+  if (system(cmd) != 0) {
+    fprintf(stderr, "Could not copy %s to %s.\n", lib, scratch);
+    exit(1);
+  }
+  make_player_dirs(scratch);
+  snprintf(report, sizeof(report), "%s/bench.json", scratch);
+  snprintf(logname, sizeof(logname), "%s/syslog", scratch);
+  snprintf(seedarg, sizeof(seedarg), "--seed=%lu", seed);
+  snprintf(reportarg, sizeof(reportarg), "--bench-report=%s", report);
+  snprintf(portstr, sizeof(portstr), "%d", port);
+
+  if ((pid = fork()) < 0) {
+    perror("fork");
+    exit(1);
+  } else if (pid == 0) {
+    /* What the game prints before its log is open would end up in the
+     * report if it went to standard output. */
+    if ((i = open("/dev/null", O_WRONLY)) >= 0)
+      dup2(i, STDOUT_FILENO);
+    execl(game, game, "-q", "-o", logname, seedarg, reportarg, "-d", scratch,
+      portstr, (char *) NULL);
+    perror(game);
+    _exit(1);
+  }
+
+  if (!(bots = calloc(num_bots, sizeof(struct bot)))) {
+    perror("calloc");
+    exit(1);
+  }
+  login_start = now_ms();
+  for (i = 0; i < num_bots; i++) {
+    while ((bots[i].fd = connect_to(port)) < 0) {
+      if (waitpid(pid, &status, WNOHANG) == pid ||
+          now_ms() - login_start > BOOT_TIMEOUT * 1000L) {
+        fprintf(stderr, "The game did not start; see %s.\n", logname);
+        exit(1);
+      }
+      usleep(100000);
+    }
+    make_name(bots[i].name, sizeof(bots[i].name), i);
+    bots[i].rng = seed * 7919 + i;
+  }
+
+  playing = run_bots(login_start + LOGIN_TIMEOUT * 1000L, 0, think);
+  start = now_ms();
+  commands = answered = unanswered = output_bytes = num_latency = 0;
+  run_bots(start + seconds * 1000L, 1, think);
+  end = now_ms();
+
+  for (i = 0; i < num_bots; i++)
+    if (bots[i].fd >= 0)
+      close(bots[i].fd);
+  kill(pid, SIGTERM);
+  waitpid(pid, &status, 0);
+  getrusage(RUSAGE_CHILDREN, &ru);
+
+  if (!out)
+    fl = stdout;
+  else if (!(fl = fopen(out, "w"))) {
+    perror(out);
+    exit(1);
+  }
+
+  qsort(latency, num_latency, sizeof(long), by_value);
+  fprintf(fl, "{\n"
+    "  \"seed\": %lu,\n"
+    "  \"bots\": %d,\n"
+    "  \"bots_playing\": %d,\n"
+    "  \"login_secs\": %.1f,\n"
+    "  \"secs\": %.1f,\n"
+    "  \"commands\": %lu,\n"
+    "  \"answered\": %lu,\n"
+    "  \"answered_per_sec\": %.1f,\n"
+    "  \"unanswered\": %lu,\n"
+    "  \"disconnects\": %lu,\n"
+    "  \"output_bytes\": %lu,\n"
+    "  \"output_bytes_per_sec\": %.0f,\n"
+    "  \"latency_ms\": { \"p50\": %ld, \"p90\": %ld, \"p99\": %ld, \"max\": %ld },\n"
+    "  \"max_rss_kb\": %ld,\n"
+    "  \"server\": ",
+    seed, num_bots, playing, (start - login_start) / 1000.0,
+    (end - start) / 1000.0, commands, answered,
+    answered * 1000.0 / (end - start), unanswered, disconnects, output_bytes, output_bytes * 1000.0 / (end - start),
+    latency_at(50), latency_at(90), latency_at(99), latency_at(100),
+    (long) ru.ru_maxrss);
+
+  if ((rep = fopen(report, "r")) != NULL) {
+    for (i = 0; fgets(line, sizeof(line), rep); i++)
+      fprintf(fl, "%s%s", i ? "  " : "", line);
+    fclose(rep);
+    got_report = 1;
+  } else
+    fprintf(fl, "null\n");
+  fprintf(fl, "}\n");
+  if (out)
+    fclose(fl);
+
+  if (keep)
+    fprintf(stderr, "Kept the run's lib directory in %s.\n", scratch);
+  else {
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", scratch);
+    if (system(cmd) != 0)
+      fprintf(stderr, "Could not remove %s.\n", scratch);
+  }
+
+  return (playing == num_bots && got_report ? 0 : 1);
+}
@@ -22,6 +22,7 @@
 #include "handler.h"
 #include "interpreter.h"
 #include "class.h"
+#include "logwriter.h"
 
 
 /** Aportable random number function.
@@ -243,10 +244,10 @@ int strn_cmp(const char *arg1, const char *arg2, int n)
  * @param args The comma delimited, variable substitutions to make in str. */
 void basic_mud_vlog(const char *format, va_list args)
 {
-  time_t ct = time(0);
-  char timestr[21];
-  int i;
-  
+  char buf[MAX_STRING_LENGTH], *msg = buf;
+  va_list args_copy;
+  int len;
+
   if (logfile == NULL) {
     puts("SYSERR: Using log() before stream was initialized!");
     return;
@@ -255,13 +256,22 @@ void basic_mud_vlog(const char *format, va_list args)
   if (format == NULL)
     format = "SYSERR: log() received a NULL format.";
 
-  for (i=0;i<21;i++) timestr[i]=0;
-  strftime(timestr, sizeof(timestr), "%b %d %H:%M:%S %Y", localtime(&ct));
+  va_copy(args_copy, args);
+  len = vsnprintf(buf, sizeof(buf), format, args_copy);
+  va_end(args_copy);
+  if (len < 0)
+    len = 0;
+  else if (len >= (int) sizeof(buf)) {
+    /* Rare enough that a second pass is cheaper than a bigger buffer. */
+    CREATE(msg, char, len + 1);
+    vsnprintf(msg, len + 1, format, args);
+  }
+
+  /* The time stamp is added by the log writer (logwriter.c). */
+  log_writer_append(time(0), msg, len);
 
-  fprintf(logfile, "%-20.20s :: ", timestr);
-  vfprintf(logfile, format, args);
-  fputc('\n', logfile);
-  fflush(logfile);
+  if (msg != buf)
+    free(msg);
 }
 
 /** Log messages directly to syslog on disk, no display to in game immortals.
@@ -316,19 +326,18 @@ void mudlog(int type, int level, int file, const char *str, ...)
   if (str == NULL)
     return;	/* eh, oh well. */
 
-  if (file) {
-    va_start(args, str);
-    basic_mud_vlog(str, args);
-    va_end(args);
-  }
-
-  if (level < 0)
-    return;
-
+  /* Format once, for the log file and the immortals alike. */
   strcpy(buf, "[ ");	/* strcpy: OK */
   va_start(args, str);
   vsnprintf(buf + 2, sizeof(buf) - 6, str, args);
   va_end(args);
+
+  if (file)
+    basic_mud_log("%s", buf + 2);
+
+  if (level < 0)
+    return;
+
   strcat(buf, " ]\r\n");	/* strcat: OK */
 
   for (i = descriptor_list; i; i = i->next) {
@@ -907,7 +916,7 @@ void core_dump_real(const char *who, int line)
   /* These would be duplicated otherwise...make very sure. */
   fflush(stdout);
   fflush(stderr);
-  fflush(logfile);
+  log_writer_flush(TRUE);
   /* Everything, just in case, for the systems that support it. */
   fflush(NULL);
 
@@ -145,6 +145,7 @@ void	gain_exp(struct char_data *ch, int gain);
 void	gain_exp_regardless(struct char_data *ch, int gain, int max_level);
 void	gain_condition(struct char_data *ch, int condition, int value);
 void	point_update(void);
+void	wake_mobile(struct char_data *ch);
 void	update_pos(struct char_data *victim);
 void run_autowiz(void);
 int increase_gold(struct char_data *ch, int amt);
@@ -324,6 +325,45 @@ do                                                              \
       (link)->next->prev        = (link)->prev;                 \
 } while(0)
 
+/* Push 'link' onto the front of a double-linked list that keeps no tail
+ * pointer, such as the world lists.
+ * @param link  Pointer to item to add to the list.
+ * @param first Pointer to the first item of the linked list.
+ * @param next  The variable name pointing to the next in the list.
+ * @param prev  The variable name pointing to the previous in the list.
+ * */
+#define LINK_HEAD(link, first, next, prev)                      \
+do                                                              \
+{                                                               \
+    (link)->next                = (first);                      \
+    (link)->prev                = NULL;                         \
+    if ( (first) )                                              \
+      (first)->prev             = (link);                       \
+    (first)                     = (link);                       \
+} while(0)
+
+/* Remove 'link' from a double-linked list that keeps no tail pointer.
+ * The item's own next pointer is left alone so a loop that is standing on
+ * it can still step forward, and an item that is not on the list is ignored.
+ * @param link  Pointer to item to remove from the list.
+ * @param first Pointer to the first item of the linked list.
+ * @param next  The variable name pointing to the next in the list.
+ * @param prev  The variable name pointing to the previous in the list.
+ * */
+#define UNLINK_HEAD(link, first, next, prev)                    \
+do                                                              \
+{                                                               \
+    if ( (link)->prev || (first) == (link) ) {                  \
+      if ( !(link)->prev )                                      \
+        (first)                 = (link)->next;                 \
+      else                                                      \
+        (link)->prev->next      = (link)->next;                 \
+      if ( (link)->next )                                       \
+        (link)->next->prev      = (link)->prev;                 \
+    }                                                           \
+    (link)->prev                = NULL;                         \
+} while(0)
+
 /* Free a pointer, and log if it was NULL
  * @param point The pointer to be free'd.
  * */
@@ -614,6 +654,8 @@ do                                                              \
 #define FIGHTING(ch)	  ((ch)->char_specials.fighting)
 /** Who or what the ch is hunting. */
 #define HUNTING(ch)	  ((ch)->char_specials.hunting)
+/** The route ch last followed with track or a hunt. */
+#define TRACK_PATH(ch)	  ((ch)->char_specials.track_path)
 /** Saving throw i for character ch. */
 #define GET_SAVE(ch, i)	  ((ch)->char_specials.saved.apply_saving_throw[i])
 /** Alignment value for ch. */
@@ -1129,6 +1171,8 @@ do                                                              \
 #define CONFIG_SPECIAL_IN_COMM config_info.operation.special_in_comm
 /** Activate debug mode? */
 #define CONFIG_DEBUG_MODE config_info.operation.debug_mode
+/** Minutes before an empty zone goes dormant, or 0 for never. */
+#define CONFIG_ZONE_DORMANCY config_info.operation.zone_dormancy
 
 /* Autowiz */
 /** Use autowiz or not? */
@@ -0,0 +1,100 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+#include "comm.h"
+
+/* Stubs and globals required by accounts.c */
+struct config_data config_info;
+
+void basic_mud_log(const char *format, ...) { (void)format; }
+void mudlog(int type, int level, int file, const char *str, ...)
+{ (void)type; (void)level; (void)file; (void)str; }
+size_t write_to_output(struct descriptor_data *t, const char *txt, ...)
+{ (void)t; (void)txt; return (0); }
+#ifndef str_cmp
+int str_cmp(const char *arg1, const char *arg2) { return strcasecmp(arg1, arg2); }
+#endif
+size_t strlcpy(char *dest, const char *source, size_t totalsize)
+{
+  snprintf(dest, totalsize, "%s", source);
+  return strlen(source);
+}
+
+#include "accounts.c"
+
+static int expect_long(const char *label, long expected, long actual)
+{
+  if (expected != actual) {
+    fprintf(stderr, "%s: expected %ld but got %ld\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+static int collect(long id, const char *name, void *arg)
+{
+  char *out = arg;
+
+  (void)id;
+  strcat(out, name);
+  strcat(out, " ");
+  return 1;
+}
+
+static void write_index(const char *text)
+{
+  FILE *fl = fopen("plrfiles/accounts/index.txt.new", "w");
+
+  fputs(text, fl);
+  fclose(fl);
+  rename("plrfiles/accounts/index.txt.new", "plrfiles/accounts/index.txt");
+}
+
+int main(void)
+{
+  char dir[] = "/tmp/accttestXXXXXX", names[256] = "";
+  long id = 0;
+  int failures = 0;
+
+  if (!mkdtemp(dir) || chdir(dir)) {
+    perror(dir);
+    return 1;
+  }
+  ensure_account_dirs();
+  write_index("1 alpha\n7 Beta\n3 gamma\n7 shadowed\n3 GAMMA\n");
+
+  account_index_boot();
+  failures += expect_long("loaded once", 1, acct_index.reloads);
+  failures += expect_long("hit", TRUE, account_id_by_name("beta", &id));
+  failures += expect_long("hit id", 7, id);
+  failures += expect_long("first wins", TRUE, account_id_by_name("Gamma", &id));
+  failures += expect_long("first wins id", 3, id);
+  failures += expect_long("miss", FALSE, account_id_by_name("delta", &id));
+  failures += expect_long("hits", 2, acct_index.hits);
+  failures += expect_long("misses", 1, acct_index.misses);
+
+  /* A new account gets the next id and is written through. */
+  failures += expect_long("create", TRUE, account_create("delta", "secret", &id));
+  failures += expect_long("next id", 8, id);
+  failures += expect_long("duplicate", FALSE, account_create("DELTA", "secret", &id));
+  failures += expect_long("no reload for own write", 1, acct_index.reloads);
+
+  account_foreach_index(collect, names);
+  if (strcmp(names, "alpha Beta gamma shadowed GAMMA delta ")) {
+    fprintf(stderr, "foreach order: '%s'\n", names);
+    failures++;
+  }
+
+  /* Someone else replacing the file is noticed. */
+  write_index("1 alpha\n20 omega\n");
+  failures += expect_long("reloaded", TRUE, account_id_by_name("omega", &id));
+  failures += expect_long("reloaded id", 20, id);
+  failures += expect_long("reload count", 2, acct_index.reloads);
+  failures += expect_long("gone", FALSE, account_id_by_name("delta", &id));
+  failures += expect_long("next after reload", 21, index_next_id());
+
+  return failures;
+}
@@ -0,0 +1,171 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "interpreter.h"
+
+/* Stubs and globals required by cmdtrie.c */
+int MAX(int a, int b) { return a > b ? a : b; }
+int MIN(int a, int b) { return a < b ? a : b; }
+void basic_mud_log(const char *format, ...) { (void)format; }
+
+#include "cmdtrie.c"
+
+ACMD(do_action) { (void)ch; (void)argument; (void)cmd; (void)subcmd; }
+static ACMD(do_test) { (void)ch; (void)argument; (void)cmd; (void)subcmd; }
+
+/* A slice of the real table, in its real order, with socials mixed in the way
+ * create_command_list() sorts them. */
+static const struct command_info test_cmds[] = {
+  { "RESERVED", "", 0, 0, 0, 0 },
+  { "north"    , "n"       , POS_STANDING, do_test  , 0, 0 },
+  { "east"     , "e"       , POS_STANDING, do_test  , 0, 0 },
+  { "south"    , "s"       , POS_STANDING, do_test  , 0, 0 },
+  { "west"     , "w"       , POS_STANDING, do_test  , 0, 0 },
+  { "at"       , "at"      , POS_DEAD    , do_test  , LVL_IMMORT, 0 },
+  { "advance"  , "adv"     , POS_DEAD    , do_test  , LVL_GRGOD, 0 },
+  { "applaud"  , "app"     , POS_RESTING , do_action, 0, 0 },
+  { "ask"      , "ask"     , POS_RESTING , do_test  , 0, 0 },
+  { "bow"      , "bow"     , POS_STANDING, do_action, 0, 0 },
+  { "buy"      , "bu"      , POS_STANDING, do_test  , 0, 0 },
+  { "cast"     , "c"       , POS_SITTING , do_test  , 1, 0 },
+  { "chuckle"  , "chuck"   , POS_RESTING , do_action, 0, 0 },
+  { "get"      , "g"       , POS_RESTING , do_test  , 0, 0 },
+  { "goto"     , "go"      , POS_SLEEPING, do_test  , LVL_IMMORT, 0 },
+  { "grin"     , "gri"     , POS_RESTING , do_action, 0, 0 },
+  { "kill"     , "k"       , POS_FIGHTING, do_test  , 0, 0 },
+  { "look"     , "l"       , POS_RESTING , do_test  , 0, 0 },
+  { "load"     , "load"    , POS_DEAD    , do_test  , LVL_BUILDER, 0 },
+  { "say"      , "s"       , POS_RESTING , do_test  , 0, 0 },
+  { "score"    , "sc"      , POS_DEAD    , do_test  , 0, 0 },
+  { "set"      , "set"     , POS_DEAD    , do_test  , LVL_GOD, 0 },
+  { "smile"    , "smil"    , POS_RESTING , do_action, 0, 0 },
+  { "wield"    , "wie"     , POS_RESTING , do_test  , 0, 0 },
+  { "wink"     , "wink"    , POS_RESTING , do_action, 0, 0 },
+  { "zreset"   , "zreset"  , POS_DEAD    , do_test  , LVL_BUILDER, 0 },
+  { "zzz"      , "zzz"     , POS_DEAD    , do_test  , -1, 0 },
+  { "\n", "zzzzzzz", 0, 0, 0, 0 }
+};
+
+/* What command_interpreter() and find_command() did before the trie. */
+static int linear_lookup(const char *arg, int level)
+{
+  int cmd, length = strlen(arg);
+
+  for (cmd = 0; *test_cmds[cmd].command != '\n'; cmd++)
+    if (test_cmds[cmd].command_pointer != do_action &&
+        !strncmp(test_cmds[cmd].command, arg, length) && level >= test_cmds[cmd].minimum_level)
+      return cmd;
+  for (cmd = 0; *test_cmds[cmd].command != '\n'; cmd++)
+    if (test_cmds[cmd].command_pointer == do_action &&
+        !strncmp(test_cmds[cmd].command, arg, length) && level >= test_cmds[cmd].minimum_level)
+      return cmd;
+
+  return -1;
+}
+
+static int linear_exact(const char *arg)
+{
+  int cmd;
+
+  for (cmd = 0; *test_cmds[cmd].command != '\n'; cmd++)
+    if (!strcmp(test_cmds[cmd].command, arg))
+      return cmd;
+
+  return -1;
+}
+
+static int expect_int(const char *label, int expected, int actual)
+{
+  if (expected != actual) {
+    fprintf(stderr, "%s: expected %d but got %d\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+/* Times both lookups over a file of typed commands, one per line. */
+static void bench(const char *file, int rounds)
+{
+  char line[MAX_INPUT_LENGTH], (*words)[MAX_INPUT_LENGTH] = NULL;
+  struct timeval start;
+  int nwords = 0, max_words = 0, i, r, sink = 0;
+  double t_linear, t_trie;
+  FILE *fl;
+
+  if (!(fl = fopen(file, "r"))) {
+    perror(file);
+    return;
+  }
+  while (fgets(line, sizeof(line), fl)) {
+    if (sscanf(line, "%s", line) != 1)
+      continue;
+    if (nwords == max_words) {
+      max_words = MAX(64, max_words * 2);
+      words = realloc(words, max_words * sizeof(*words));
+    }
+    strcpy(words[nwords++], line);
+  }
+  fclose(fl);
+
+  gettimeofday(&start, NULL);
+  for (r = 0; r < rounds; r++)
+    for (i = 0; i < nwords; i++)
+      sink += linear_lookup(words[i], LVL_IMPL);
+  t_linear = elapsed(&start);
+
+  gettimeofday(&start, NULL);
+  for (r = 0; r < rounds; r++)
+    for (i = 0; i < nwords; i++)
+      sink -= cmd_trie_lookup(words[i], LVL_IMPL);
+  t_trie = elapsed(&start);
+
+  printf("%d commands x %d rounds: linear %.3fs, trie %.3fs (check %d)\n",
+         nwords, rounds, t_linear, t_trie, sink);
+  free(words);
+}
+
+int main(int argc, char **argv)
+{
+  static const char *words[] = { "n", "s", "so", "sa", "sc", "se", "sm", "a",
+    "ap", "at", "b", "bo", "c", "ch", "g", "go", "gr", "l", "lo", "loa", "w",
+    "wi", "wie", "wink", "z", "zz", "zzz", "zreset", "x", "northx", "" };
+  static const int levels[] = { 0, 1, LVL_IMMORT, LVL_BUILDER, LVL_GOD, LVL_GRGOD, LVL_IMPL };
+  int found[CMD_MAX_SUGGEST], i, j, failures = 0;
+  char label[64];
+
+  cmd_trie_build(test_cmds, test_cmds);
+
+  for (i = 0; i < (int)(sizeof(words) / sizeof(words[0])); i++) {
+    for (j = 0; j < (int)(sizeof(levels) / sizeof(levels[0])); j++) {
+      snprintf(label, sizeof(label), "lookup '%s' at %d", words[i], levels[j]);
+      failures += expect_int(label, linear_lookup(words[i], levels[j]), cmd_trie_lookup(words[i], levels[j]));
+    }
+    snprintf(label, sizeof(label), "exact '%s'", words[i]);
+    failures += expect_int(label, linear_exact(words[i]), cmd_trie_exact(words[i]));
+  }
+
+  /* "wiled" is close to "wield" and "wink" is too far; "zzz" is a trigger. */
+  failures += expect_int("suggest wiled", 1, cmd_trie_suggest("wiled", 0, found, CMD_MAX_SUGGEST));
+  failures += expect_int("suggest wiled cmd", 23, found[0]);
+  failures += expect_int("suggest lok", 2, cmd_trie_suggest("lok", LVL_BUILDER, found, CMD_MAX_SUGGEST));
+  failures += expect_int("suggest lok order", 17, found[0]);
+  failures += expect_int("suggest lok level", 1, cmd_trie_suggest("lok", 0, found, CMD_MAX_SUGGEST));
+  failures += expect_int("suggest trigger", 0, cmd_trie_suggest("zz", LVL_IMPL, found, CMD_MAX_SUGGEST));
+
+  if (argc > 1)
+    bench(argv[1], argc > 2 ? atoi(argv[2]) : 1000);
+
+  cmd_trie_free();
+
+  return failures;
+}
@@ -0,0 +1,448 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "dg_scripts.h"
+
+/* Stubs required by dg_compile.c */
+static int complaints = 0;
+
+void script_log(const char *format, ...) { (void)format; complaints++; }
+
+#include "dg_compile.c"
+
+#define MAX_TRIGS  4000
+#define MAX_TRACE  4096
+
+static struct cmdlist_element *trigs[MAX_TRIGS];
+static int num_trigs = 0, num_lines = 0;
+
+/* Condition results, the same sequence for both drivers. */
+static int step;
+
+static int truth(struct cmdlist_element *c)
+{
+  step++;
+  return ((((unsigned long) c >> 4) + step) % 3 == 0);
+}
+
+/* What script_driver() used to do: the scans below are copied from it as
+ * they were, with conditions coming from truth(). */
+static char *skip_text(char *p)
+{
+  for (; *p && isspace(*p); p++);
+  return (p);
+}
+
+static struct cmdlist_element *old_find_end(struct cmdlist_element *cl)
+{
+  struct cmdlist_element *c;
+  char *p;
+
+  if (!(cl->next))
+    return cl;
+
+  for (c = cl->next; c; c = c->next) {
+    p = skip_text(c->cmd);
+    if (!strn_cmp("if ", p, 3))
+      c = old_find_end(c);
+    else if (!strn_cmp("end", p, 3))
+      return c;
+    if (!c->next)
+      return c;
+  }
+  return c;
+}
+
+static struct cmdlist_element *old_find_else_end(struct cmdlist_element *cl, int *depth)
+{
+  struct cmdlist_element *c;
+  char *p;
+
+  if (!(cl->next))
+    return cl;
+
+  for (c = cl->next; c->next; c = c->next) {
+    p = skip_text(c->cmd);
+    if (!strn_cmp("if ", p, 3))
+      c = old_find_end(c);
+    else if (!strn_cmp("elseif ", p, 7)) {
+      if (truth(c)) {
+        (*depth)++;
+        return c;
+      }
+    } else if (!strn_cmp("else", p, 4)) {
+      (*depth)++;
+      return c;
+    } else if (!strn_cmp("end", p, 3))
+      return c;
+    if (!c->next)
+      return c;
+  }
+  return c;
+}
+
+static struct cmdlist_element *old_find_done(struct cmdlist_element *cl)
+{
+  struct cmdlist_element *c;
+  char *p;
+
+  if (!cl || !(cl->next))
+    return cl;
+
+  for (c = cl->next; c && c->next; c = c->next) {
+    p = skip_text(c->cmd);
+    if (!strn_cmp("while ", p, 6) || !strn_cmp("switch ", p, 7))
+      c = old_find_done(c);
+    else if (!strn_cmp("done", p, 3))
+      return c;
+  }
+  return c;
+}
+
+static struct cmdlist_element *old_find_case(struct cmdlist_element *cl)
+{
+  struct cmdlist_element *c;
+  char *p;
+
+  if (!(cl->next))
+    return cl;
+
+  for (c = cl->next; c->next; c = c->next) {
+    p = skip_text(c->cmd);
+    if (!strn_cmp("while ", p, 6) || !strn_cmp("switch", p, 6))
+      c = old_find_done(c);
+    else if (!strn_cmp("case ", p, 5)) {
+      if (truth(c))
+        return c;
+    } else if (!strn_cmp("default", p, 7))
+      return c;
+    else if (!strn_cmp("done", p, 3))
+      return c;
+  }
+  return c;
+}
+
+/* The control flow of script_driver() before and after compiling.  Both
+ * record the lines they pass in trace and return how many. */
+static int run_old(struct cmdlist_element *start, struct cmdlist_element **trace)
+{
+  struct cmdlist_element *cl, *temp;
+  int depth = 1, loops = 0, n = 0;
+  char *p;
+
+  for (cl = start; cl && depth && n < MAX_TRACE; cl = cl->next) {
+    trace[n++] = cl;
+    p = skip_text(cl->cmd);
+
+    if (*p == '*')
+      continue;
+    else if (!strn_cmp(p, "if ", 3)) {
+      if (truth(cl))
+        depth++;
+      else
+        cl = old_find_else_end(cl, &depth);
+    } else if (!strn_cmp("elseif ", p, 7) || !strn_cmp("else", p, 4)) {
+      if (depth == 1)
+        continue;
+      cl = old_find_end(cl);
+      depth--;
+    } else if (!strn_cmp("while ", p, 6)) {
+      if (!(temp = old_find_done(cl)))
+        break;
+      if (truth(cl))
+        temp->original = cl;
+      else
+        cl = temp;
+    } else if (!strn_cmp("switch ", p, 7)) {
+      cl = old_find_case(cl);
+    } else if (!strn_cmp("end", p, 3)) {
+      if (depth > 1)
+        depth--;
+    } else if (!strn_cmp("done", p, 4)) {
+      if (cl->original && truth(cl->original)) {
+        cl = cl->original;
+        if (++loops >= 100)
+          break;
+      }
+    } else if (!strn_cmp("break", p, 5)) {
+      if (!(cl = old_find_done(cl)))
+        break;
+    }
+  }
+  return (n);
+}
+
+static struct cmdlist_element *new_find_else_end(struct cmdlist_element *cl, int *depth)
+{
+  struct cmdlist_element *c;
+
+  for (c = cl->jump; c->next; c = c->jump) {
+    if (c->kind == DG_LINE_ELSEIF) {
+      if (truth(c)) {
+        (*depth)++;
+        return c;
+      }
+    } else if (c->kind == DG_LINE_ELSE) {
+      (*depth)++;
+      return c;
+    } else
+      return c;
+  }
+  return c;
+}
+
+static struct cmdlist_element *new_find_case(struct cmdlist_element *cl)
+{
+  struct cmdlist_element *c;
+
+  for (c = cl->jump; c && c->next && c->kind == DG_LINE_CASE; c = c->jump)
+    if (truth(c))
+      return c;
+  return c;
+}
+
+static int run_new(struct cmdlist_element *start, struct cmdlist_element **trace)
+{
+  struct cmdlist_element *cl;
+  int depth = 1, loops = 0, n = 0;
+
+  for (cl = start; cl && depth && n < MAX_TRACE; cl = cl->next) {
+    trace[n++] = cl;
+
+    if (cl->kind == DG_LINE_COMMENT)
+      continue;
+    else if (cl->kind == DG_LINE_IF) {
+      if (truth(cl))
+        depth++;
+      else
+        cl = new_find_else_end(cl, &depth);
+    } else if (cl->kind == DG_LINE_ELSEIF || cl->kind == DG_LINE_ELSE) {
+      if (depth == 1)
+        continue;
+      cl = cl->done;
+      depth--;
+    } else if (cl->kind == DG_LINE_WHILE) {
+      if (!cl->done)
+        break;
+      if (truth(cl))
+        cl->done->original = cl;
+      else
+        cl = cl->done;
+    } else if (cl->kind == DG_LINE_SWITCH) {
+      cl = new_find_case(cl);
+    } else if (cl->kind == DG_LINE_END) {
+      if (depth > 1)
+        depth--;
+    } else if (cl->kind == DG_LINE_DONE) {
+      if (cl->original && truth(cl->original)) {
+        cl = cl->original;
+        if (++loops >= 100)
+          break;
+      }
+    } else if (cl->kind == DG_LINE_BREAK) {
+      if (!(cl = cl->done))
+        break;
+    }
+  }
+  return (n);
+}
+
+/* Reads the triggers of one .trg file the way parse_trigger() splits them. */
+static void load_trg(const char *path)
+{
+  char line[READ_SIZE], body[MAX_STRING_LENGTH * 4], *s;
+  struct cmdlist_element *cle;
+  FILE *fl = fopen(path, "r");
+  int field = 0;
+  size_t len = 0;
+
+  if (!fl)
+    return;
+
+  while (fgets(line, sizeof(line), fl) && num_trigs < MAX_TRIGS) {
+    if (field == 0) {
+      if (*line == '#')
+        field = 1;
+      continue;
+    }
+    /* name~, the attach line, arglist~, then the commands up to a '~' */
+    if (field == 1 || field == 3) {
+      if (strchr(line, '~'))
+        field++;
+      continue;
+    }
+    if (field == 2) {
+      field++;
+      continue;
+    }
+    if ((s = strrchr(line, '~')) && (s[1] == '\n' || s[1] == '\r' || !s[1])) {
+      *s = '\0';
+      snprintf(body + len, sizeof(body) - len, "%s", line);
+      len = 0;
+      field = 0;
+
+      if (!(s = strtok(body, "\n\r")))
+        continue;
+      CREATE(trigs[num_trigs], struct cmdlist_element, 1);
+      cle = trigs[num_trigs];
+      cle->cmd = strdup(s);
+      num_lines++;
+      while ((s = strtok(NULL, "\n\r"))) {
+        CREATE(cle->next, struct cmdlist_element, 1);
+        cle = cle->next;
+        cle->cmd = strdup(s);
+        num_lines++;
+      }
+      dg_compile_cmdlist(trigs[num_trigs], num_trigs);
+      num_trigs++;
+      continue;
+    }
+    len += snprintf(body + len, sizeof(body) - len, "%s", line);
+    if (len >= sizeof(body))
+      len = sizeof(body) - 1;
+  }
+  fclose(fl);
+}
+
+static void forget_loops(struct cmdlist_element *cl)
+{
+  for (; cl; cl = cl->next)
+    cl->original = NULL;
+}
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return ((now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1000000.0);
+}
+
+static int expect_int(const char *label, long expected, long actual)
+{
+  if (expected != actual) {
+    fprintf(stderr, "%s: expected %ld but got %ld\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+/* Compiles a trigger from text lines joined with '\n'. */
+static struct cmdlist_element *compile_text(char *text)
+{
+  struct cmdlist_element *head = NULL, **tail = &head;
+  char *s;
+
+  for (s = strtok(text, "\n"); s; s = strtok(NULL, "\n")) {
+    CREATE(*tail, struct cmdlist_element, 1);
+    (*tail)->cmd = strdup(s);
+    tail = &(*tail)->next;
+  }
+  dg_compile_cmdlist(head, 1);
+  return (head);
+}
+
+static struct cmdlist_element *line_at(struct cmdlist_element *cl, int n)
+{
+  while (n-- > 0)
+    cl = cl->next;
+  return (cl);
+}
+
+int main(int argc, char **argv)
+{
+  static struct cmdlist_element *old_trace[MAX_TRACE], *new_trace[MAX_TRACE];
+  char text[] = "* comment\n"                   /* 0 */
+                "if %a%\n"                      /* 1 */
+                "  if %b%\n"                    /* 2 */
+                "  end\n"                       /* 3 */
+                "elseif %c%\n"                  /* 4 */
+                "  %send% %actor% hi\n"         /* 5 */
+                "else\n"                        /* 6 */
+                "  set x 1\n"                   /* 7 */
+                "end\n"                         /* 8 */
+                "while %x%\n"                   /* 9 */
+                "  switch %y%\n"                /* 10 */
+                "    case 1\n"                  /* 11 */
+                "      break\n"                 /* 12 */
+                "    default\n"                 /* 13 */
+                "  done\n"                      /* 14 */
+                "  break\n"                     /* 15 */
+                "done\n"                        /* 16 */
+                "wait 5\n"                      /* 17 */
+                "halt";                         /* 18 */
+  char bad[] = "if %a%\nsay no end";
+  struct cmdlist_element *cl;
+  struct timeval start;
+  double t_old = 0, t_new = 0;
+  int i, t, n_old, n_new, rounds, failures = 0, first_bad = -1;
+  const char *trg_dir = argc > 2 ? argv[2] : "../lib/world/trg";
+  char path[256], file[128];
+  FILE *index;
+
+  cl = compile_text(text);
+  failures += expect_int("comment", DG_LINE_COMMENT, line_at(cl, 0)->kind);
+  failures += expect_int("if jump", 4, line_at(cl, 1)->jump == line_at(cl, 4) ? 4 : -1);
+  failures += expect_int("if done", 8, line_at(cl, 1)->done == line_at(cl, 8) ? 8 : -1);
+  failures += expect_int("elseif jump", 6, line_at(cl, 4)->jump == line_at(cl, 6) ? 6 : -1);
+  failures += expect_int("elseif args", 0, strcmp(line_at(cl, 4)->args, "%c%"));
+  failures += expect_int("else done", 8, line_at(cl, 6)->done == line_at(cl, 8) ? 8 : -1);
+  failures += expect_int("variable command", DG_OP_NONE, line_at(cl, 5)->op);
+  failures += expect_int("set", DG_OP_SET, line_at(cl, 7)->op);
+  failures += expect_int("while done", 16, line_at(cl, 9)->done == line_at(cl, 16) ? 16 : -1);
+  failures += expect_int("switch jump", 11, line_at(cl, 10)->jump == line_at(cl, 11) ? 11 : -1);
+  failures += expect_int("case args", 0, strcmp(line_at(cl, 11)->args, "1"));
+  failures += expect_int("case jump", 13, line_at(cl, 11)->jump == line_at(cl, 13) ? 13 : -1);
+  failures += expect_int("inner break", 14, line_at(cl, 12)->done == line_at(cl, 14) ? 14 : -1);
+  failures += expect_int("outer break", 16, line_at(cl, 15)->done == line_at(cl, 16) ? 16 : -1);
+  failures += expect_int("default", DG_LINE_DEFAULT, line_at(cl, 13)->kind);
+  failures += expect_int("wait", DG_OP_WAIT, line_at(cl, 17)->op);
+  failures += expect_int("halt", DG_OP_HALT, line_at(cl, 18)->op);
+  failures += expect_int("no complaints", 0, complaints);
+
+  cl = compile_text(bad);
+  failures += expect_int("missing end", 1, complaints);
+  failures += expect_int("runs to the last line", 1, cl->jump == cl->next);
+
+  /* Every stock trigger must take the same path either way. */
+  snprintf(path, sizeof(path), "%s/index", trg_dir);
+  if ((index = fopen(path, "r"))) {
+    while (fscanf(index, "%127s", file) == 1 && *file != '$') {
+      snprintf(path, sizeof(path), "%s/%s", trg_dir, file);
+      load_trg(path);
+    }
+    fclose(index);
+  } else
+    fprintf(stderr, "%s: no trigger index, only the built-in trigger was checked\n", trg_dir);
+
+  rounds = argc > 1 ? atoi(argv[1]) : 1;
+  for (i = 0; i < rounds; i++)
+    for (t = 0; t < num_trigs; t++) {
+      forget_loops(trigs[t]);
+      step = i;
+      gettimeofday(&start, NULL);
+      n_old = run_old(trigs[t], old_trace);
+      t_old += elapsed(&start);
+
+      forget_loops(trigs[t]);
+      step = i;
+      gettimeofday(&start, NULL);
+      n_new = run_new(trigs[t], new_trace);
+      t_new += elapsed(&start);
+
+      if (n_old != n_new || memcmp(old_trace, new_trace, n_old * sizeof(*old_trace))) {
+        if (first_bad < 0)
+          fprintf(stderr, "trigger %d (round %d) took a different path\n", t, i);
+        first_bad = t;
+        failures++;
+      }
+    }
+
+  if (argc > 1)
+    printf("%d triggers, %d lines, %d rounds: text scans %.3fs, compiled %.3fs\n",
+           num_trigs, num_lines, rounds, t_old, t_new);
+
+  return failures;
+}
@@ -0,0 +1,113 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+
+/* Stubs and globals required by dg_event.c */
+unsigned long pulse = 0;
+
+void basic_mud_log(const char *format, ...) { (void)format; }
+
+#include "dg_event.c"
+
+void free_mud_event(struct mud_event_data *pMudEvent) { (void)pMudEvent; }
+
+#define TEST_EVENTS 2000
+
+static long fired_at[TEST_EVENTS];
+static long due_at[TEST_EVENTS];
+static int fire_order_ok = 1;
+static long last_fired = 0;
+static int repeats = 0;
+
+static EVENTFUNC(record_event)
+{
+  int *id = (int *) event_obj;
+
+  fired_at[*id] = (long) pulse;
+  if ((long) pulse < last_fired)
+    fire_order_ok = 0;
+  last_fired = (long) pulse;
+  free(id);
+  return 0;
+}
+
+/* Reschedules itself three times, 300 pulses apart. */
+static EVENTFUNC(repeat_event)
+{
+  if (++repeats < 4)
+    return 300;
+  free(event_obj);
+  return 0;
+}
+
+static int expect_int(const char *label, long expected, long actual)
+{
+  if (expected != actual) {
+    fprintf(stderr, "%s: expected %ld but got %ld\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+int main(void)
+{
+  struct dg_queue_stats qs;
+  struct event *cancelled[TEST_EVENTS / 10];
+  int *id, i, failures = 0, ncancel = 0;
+  long last = 0;
+
+  event_init();
+  srand(4242);
+
+  /* Spread events from the next pulse to well past the second level. */
+  for (i = 0; i < TEST_EVENTS; i++) {
+    long when = 1 + (i % 3 == 0 ? rand() % 200 : rand() % 150000);
+
+    CREATE(id, int, 1);
+    *id = i;
+    due_at[i] = when + pulse;
+    fired_at[i] = -1;
+    if (i % 10 == 0)
+      cancelled[ncancel++] = event_create(record_event, id, when);
+    else
+      event_create(record_event, id, when);
+    if (due_at[i] > last)
+      last = due_at[i];
+  }
+  failures += expect_int("event_time", due_at[10], event_time(cancelled[1]) + pulse);
+
+  event_queue_stats(&qs);
+  failures += expect_int("queued", TEST_EVENTS, qs.size);
+  failures += expect_int("levels", TEST_EVENTS, qs.level[0] + qs.level[1] + qs.level[2] + qs.level[3] + qs.overflow + qs.due);
+
+  for (i = 0; i < ncancel; i++)
+    event_cancel(cancelled[i]);
+
+  CREATE(id, int, 1);
+  event_create(repeat_event, id, 300);
+
+  while ((long) pulse <= last + 1) {
+    pulse++;
+    event_process();
+  }
+
+  for (i = 0; i < TEST_EVENTS; i++) {
+    if (i % 10 == 0)
+      failures += expect_int("cancelled event fired", -1, fired_at[i]);
+    else if (fired_at[i] != due_at[i]) {
+      fprintf(stderr, "event %d: due %ld but fired %ld\n", i, due_at[i], fired_at[i]);
+      failures++;
+    }
+  }
+  failures += expect_int("fired in order", 1, fire_order_ok);
+  failures += expect_int("repeats", 4, repeats);
+
+  event_queue_stats(&qs);
+  failures += expect_int("drained", 0, qs.size);
+  failures += expect_int("nodes recycled", qs.nodes_allocated, qs.nodes_free);
+
+  event_free_all();
+
+  return failures;
+}
@@ -0,0 +1,140 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+
+/* Stubs and globals required by logwriter.c */
+FILE *logfile = NULL;
+
+void basic_mud_log(const char *format, ...) { (void)format; }
+
+#include "logwriter.c"
+
+#define PRODUCERS     4
+#define PER_PRODUCER  5000
+#define HELD          3000
+
+static int expect_long(const char *label, long expected, long actual)
+{
+  if (expected != actual) {
+    fprintf(stderr, "%s: expected %ld but got %ld\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+static void *producer(void *arg)
+{
+  char buf[64];
+  int i, id = *(int *) arg;
+
+  for (i = 0; i < PER_PRODUCER; i++) {
+    snprintf(buf, sizeof(buf), "producer %d line %d", id, i);
+    log_writer_append(time(0), buf, strlen(buf));
+  }
+  return (NULL);
+}
+
+/* Logs HELD lines into a capture, as a world file worker does. */
+static void *capturer(void *arg)
+{
+  char buf[64];
+  int i;
+
+  log_writer_capture((struct log_capture *) arg);
+  for (i = 0; i < HELD; i++) {
+    snprintf(buf, sizeof(buf), "held %d", i);
+    log_writer_append(time(0), buf, strlen(buf));
+  }
+  log_writer_capture(NULL);
+  return (NULL);
+}
+
+static long produced = 0, held = 0, out_of_order = 0;
+
+/* Counts the lines in the log and checks each has the usual layout. */
+static long count_lines(int *bad)
+{
+  char line[256];
+  long n = 0;
+  int k;
+
+  produced = held = out_of_order = 0;
+  fflush(logfile);
+  rewind(logfile);
+  while (fgets(line, sizeof(line), logfile)) {
+    n++;
+    if (strlen(line) < 25 || strncmp(line + 20, " :: ", 4) || line[strlen(line) - 1] != '\n')
+      (*bad)++;
+    else if (!strncmp(line + 24, "producer ", 9))
+      produced++;
+    else if (sscanf(line + 24, "held %d", &k) == 1 && k != held++)
+      out_of_order++;
+  }
+  fseek(logfile, 0, SEEK_END);
+  return (n);
+}
+
+int main(void)
+{
+  struct log_writer_stats ls;
+  struct log_capture cap = { NULL, NULL };
+  pthread_t threads[PRODUCERS];
+  int ids[PRODUCERS], i, failures = 0, bad = 0;
+  long lines;
+
+  if (!(logfile = tmpfile())) {
+    perror("tmpfile");
+    return 1;
+  }
+
+  /* Without the writer, lines go straight to the file. */
+  log_writer_append(time(0), "direct", 6);
+  failures += expect_long("direct line", 1, count_lines(&bad));
+
+  /* Fill the ring while nothing drains it: the overflow is dropped. */
+  log_writer_init();
+  log_writer_shutdown();
+  writer_running = TRUE;
+  for (i = 0; i < LOG_RING_SIZE + 5; i++)
+    log_writer_append(time(0), "queued", 6);
+  writer_running = FALSE;
+  log_writer_stats(&ls);
+  failures += expect_long("dropped", 5, ls.dropped);
+
+  /* Starting the writer drains the ring and notes the gap. */
+  log_writer_init();
+  log_writer_flush(FALSE);
+  failures += expect_long("drained", 1 + LOG_RING_SIZE + 1, count_lines(&bad));
+
+  /* Captured lines wait for log_writer_release(), which keeps their order
+   * and does not overrun the ring with them. */
+  pthread_create(&threads[0], NULL, capturer, &cap);
+  pthread_join(threads[0], NULL);
+  log_writer_flush(FALSE);
+  failures += expect_long("held back", 1 + LOG_RING_SIZE + 1, count_lines(&bad));
+  log_writer_release(&cap);
+  log_writer_flush(FALSE);
+  failures += expect_long("released", 1 + LOG_RING_SIZE + 1 + HELD, count_lines(&bad));
+  failures += expect_long("released in order", 0, out_of_order);
+  failures += expect_long("capture emptied", 1, cap.first == NULL && cap.last == NULL);
+
+  /* Several threads at once: every line is either written or counted. */
+  for (i = 0; i < PRODUCERS; i++) {
+    ids[i] = i;
+    pthread_create(&threads[i], NULL, producer, &ids[i]);
+  }
+  for (i = 0; i < PRODUCERS; i++)
+    pthread_join(threads[i], NULL);
+  log_writer_flush(TRUE);
+  log_writer_shutdown();
+
+  log_writer_stats(&ls);
+  lines = count_lines(&bad);
+  failures += expect_long("all accounted for", (long) PRODUCERS * PER_PRODUCER,
+                          produced + (long) (ls.dropped - 5));
+  failures += expect_long("lines match records", (long) ls.records, lines);
+  failures += expect_long("badly formed lines", 0, bad);
+
+  return failures;
+}
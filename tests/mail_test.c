@@ -0,0 +1,233 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+#include "comm.h"
+#include "interpreter.h"
+#include "handler.h"
+#include "modify.h"
+#include "savequeue.h"
+
+/* Stubs and globals required by mail.c */
+struct player_index_element *player_table = NULL;
+struct descriptor_data *descriptor_list = NULL;
+struct command_info *complete_cmd_info = NULL;
+int no_mail = 0;
+
+void basic_mud_log(const char *format, ...) { (void)format; }
+int MAX(int a, int b) { return a > b ? a : b; }
+long get_ptable_by_name(const char *name) { (void)name; return (-1); }
+long get_id_by_name(const char *name) { (void)name; return (-1); }
+char *get_name_by_id(long id) { (void)id; return (NULL); }
+char *one_argument(char *argument, char *first_arg) { *first_arg = '\0'; return (argument); }
+char *act(const char *str, int hide_invisible, struct char_data *ch, struct obj_data *obj,
+          void *vict_obj, int type)
+{ (void)str; (void)hide_invisible; (void)ch; (void)obj; (void)vict_obj; (void)type; return (NULL); }
+size_t send_to_char(struct char_data *ch, const char *messg, ...) { (void)ch; (void)messg; return (0); }
+void string_write(struct descriptor_data *d, char **txt, size_t len, long mailto, void *data)
+{ (void)d; (void)txt; (void)len; (void)mailto; (void)data; }
+int decrease_gold(struct char_data *ch, int amt) { (void)ch; return (amt); }
+struct obj_data *create_obj(void) { return (NULL); }
+void obj_to_char(struct obj_data *object, struct char_data *ch) { (void)object; (void)ch; }
+int touch(const char *path) { FILE *fl = fopen(path, "a"); if (fl) fclose(fl); return (fl ? 0 : -1); }
+void save_queue_wait(const char *path) { (void)path; }
+
+/* Written straight to the file, the way the save queue does it before its
+ * thread starts. */
+static int compactions = 0;
+FILE *save_file_open(struct save_file *sf, const char *path)
+{
+  snprintf(sf->path, sizeof(sf->path), "%s", path);
+  return (sf->fl = fopen(MAIL_FILE_TMP, "w"));
+}
+int save_file_close(struct save_file *sf)
+{
+  compactions++;
+  fclose(sf->fl);
+  return (rename(MAIL_FILE_TMP, sf->path) == 0);
+}
+
+void parse_at(char *str)
+{
+  for (; *str; str++)
+    if (*str == '@') {
+      if (*(str + 1) != '@')
+        *str = '\t';
+      else
+        str++;
+    }
+}
+
+int get_line(FILE *fl, char *buf)
+{
+  char temp[READ_SIZE];
+  int sl;
+
+  do {
+    if (!fgets(temp, READ_SIZE, fl))
+      return (0);
+  } while (*temp == '*' || *temp == '\n' || *temp == '\r');
+
+  sl = strlen(temp);
+  while (sl > 0 && (temp[sl - 1] == '\n' || temp[sl - 1] == '\r'))
+    temp[--sl] = '\0';
+  strcpy(buf, temp);
+  return (1);
+}
+
+/* Just enough of fread_string() for the bodies below: one line each. */
+char *fread_string(FILE *fl, const char *error)
+{
+  char buf[MAX_STRING_LENGTH] = "", line[512], *p;
+
+  (void)error;
+  while (fgets(line, sizeof(line), fl)) {
+    for (p = line + strlen(line); p > line && (p[-1] == '\n' || p[-1] == '\r'); p--)
+      ;
+    *p = '\0';
+    if (p > line && p[-1] == '~') {
+      p[-1] = '\0';
+      strcat(buf, line);
+      break;
+    }
+    strcat(buf, line);
+    strcat(buf, "\r\n");
+  }
+  parse_at(buf);
+  return (*buf ? strdup(buf) : NULL);
+}
+
+#include "mail.c"
+
+static int expect_int(const char *label, long expected, long actual)
+{
+  if (expected != actual) {
+    fprintf(stderr, "%s: expected %ld but got %ld\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+static int expect_body(const char *label, long recipient, const char *body)
+{
+  char *text = read_delete(recipient);
+  int bad = !strstr(text, body);
+
+  if (bad)
+    fprintf(stderr, "%s: got '%s'\n", label, text);
+  free(text);
+  return (bad);
+}
+
+static int count_file_lines(const char *path)
+{
+  char line[READ_SIZE];
+  FILE *fl = fopen(path, "r");
+  int n = 0;
+
+  while (fl && fgets(line, sizeof(line), fl))
+    n++;
+  if (fl)
+    fclose(fl);
+  return (n);
+}
+
+/* A taken letter, then one letter on each side of two lines of garbage. */
+static void write_corrupt_file(void)
+{
+  FILE *fl;
+
+  store_mail(7, 2, "taken");
+  free(read_delete(7));
+  store_mail(7, 2, "before");
+  if ((fl = fopen(MAIL_FILE, "a"))) {
+    fputs("garbage\nmore garbage\n", fl);
+    fclose(fl);
+  }
+  store_mail(7, 3, "after");
+  free_mail();
+}
+
+int main(void)
+{
+  char dir[] = "/tmp/mailtestXXXXXX", text[32];
+  int i, failures = 0;
+
+  if (!mkdtemp(dir) || chdir(dir) || mkdir("etc", 0700)) {
+    perror(dir);
+    return 1;
+  }
+
+  failures += expect_int("new file", TRUE, scan_file());
+  failures += expect_int("no mail", FALSE, has_mail(1));
+
+  store_mail(1, 2, "first @rhello");
+  store_mail(1, 3, "second");
+  store_mail(4, 2, "other");
+  failures += expect_int("has mail", TRUE, has_mail(1));
+  failures += expect_int("other box", TRUE, has_mail(4));
+  failures += expect_body("oldest first", 1, "first \trhello");
+  failures += expect_int("journal", 2 * 3 + 1, count_file_lines(MAIL_FILE));
+
+  /* A reboot replays the journal and compacts what was taken. */
+  free_mail();
+  failures += expect_int("reload", TRUE, scan_file());
+  failures += expect_int("compacted", 1, compactions);
+  failures += expect_int("compacted file", 2 * 2, count_file_lines(MAIL_FILE));
+  failures += expect_body("kept order", 1, "second");
+  failures += expect_int("emptied", FALSE, has_mail(1));
+  failures += expect_body("other kept", 4, "other");
+
+  /* Once taken letters outnumber waiting ones, and there are enough of them,
+   * the file is compacted while running.  Four are dead already. */
+  for (i = 0; i < MAIL_COMPACT_MIN; i++) {
+    snprintf(text, sizeof(text), "letter %d", i);
+    store_mail(5, 2, text);
+  }
+  store_mail(6, 2, "keep me");
+  for (i = 0; i < MAIL_COMPACT_MIN / 2 - 3; i++)
+    free(read_delete(5));
+  failures += expect_int("not yet", 1, compactions);
+  free(read_delete(5));
+  failures += expect_int("compacted again", 2, compactions);
+  failures += expect_int("left after compaction", 2 * (MAIL_COMPACT_MIN / 2 + 3), count_file_lines(MAIL_FILE));
+
+  free_mail();
+  failures += expect_int("reload again", TRUE, scan_file());
+  failures += expect_body("survived", 5, "letter 48");
+  failures += expect_body("untouched", 6, "keep me");
+
+  /* A broken record is skipped, and the letters around it are kept.  The
+   * bad lines are copied aside before the taken letter is compacted away. */
+  free_mail();
+  unlink(MAIL_FILE);
+  write_corrupt_file();
+  failures += expect_int("corrupt", TRUE, scan_file());
+  failures += expect_int("corrupt compacted", 3, compactions);
+  failures += expect_int("bad lines kept", 2, count_file_lines(MAIL_FILE_BAD));
+  failures += expect_body("before the damage", 7, "before");
+  failures += expect_body("after the damage", 7, "after");
+
+  /* With nowhere to copy them, the file is left as it is, taken letter and
+   * all, and nothing compacts it later either. */
+  free_mail();
+  unlink(MAIL_FILE);
+  unlink(MAIL_FILE_BAD);
+  mkdir(MAIL_FILE_BAD, 0700);
+  write_corrupt_file();
+  failures += expect_int("corrupt again", TRUE, scan_file());
+  failures += expect_int("corrupt not compacted", 3, compactions);
+  failures += expect_int("no compaction later", FALSE, compact_mail_file());
+  failures += expect_body("before, uncompacted", 7, "before");
+  failures += expect_body("after, uncompacted", 7, "after");
+  rmdir(MAIL_FILE_BAD);
+
+  free_mail();
+  unlink(MAIL_FILE);
+  rmdir("etc");
+  rmdir(dir);
+
+  return failures;
+}
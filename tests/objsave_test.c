@@ -0,0 +1,380 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+#include "comm.h"
+#include "interpreter.h"
+#include "handler.h"
+#include "savequeue.h"
+
+/* Stubs and globals required by objsave.c */
+struct config_data config_info;
+struct descriptor_data *descriptor_list = NULL;
+struct command_info *complete_cmd_info = NULL;
+struct player_special_data dummy_mob;
+struct player_index_element *player_table = NULL;
+int top_of_p_table = -1;
+struct room_data *world = NULL;
+room_rnum top_of_world = NOWHERE;
+struct index_data *obj_index = NULL;
+struct obj_data *obj_proto = NULL;
+obj_rnum top_of_objt = NOTHING;
+
+/* Objects made while saving; the serializer must not make any. */
+static int instantiated = 0;
+
+void basic_mud_log(const char *format, ...) { (void)format; }
+void mudlog(int type, int level, int file, const char *str, ...)
+{ (void)type; (void)level; (void)file; (void)str; }
+int MAX(int a, int b) { return a > b ? a : b; }
+int MIN(int a, int b) { return a < b ? a : b; }
+char *act(const char *str, int hide_invisible, struct char_data *ch, struct obj_data *obj,
+          void *vict_obj, int type)
+{ (void)str; (void)hide_invisible; (void)ch; (void)obj; (void)vict_obj; (void)type; return (NULL); }
+size_t send_to_char(struct char_data *ch, const char *messg, ...) { (void)ch; (void)messg; return (0); }
+void page_string(struct descriptor_data *d, char *str, int keep_internal)
+{ (void)d; (void)str; (void)keep_internal; }
+ACMD(do_action) { (void)ch; (void)argument; (void)cmd; (void)subcmd; }
+int find_command(const char *command) { (void)command; return (-1); }
+int rand_number(int from, int to) { (void)to; return (from); }
+int room_is_dark(room_rnum room) { (void)room; return (0); }
+void save_char(struct char_data *ch) { (void)ch; }
+int get_filename(char *filename, size_t fbufsize, int mode, const char *orig_name)
+{ (void)mode; snprintf(filename, fbufsize, "%s", orig_name); return (1); }
+int invalid_align(struct char_data *ch, struct obj_data *obj) { (void)ch; (void)obj; return (0); }
+int invalid_class(struct char_data *ch, struct obj_data *obj) { (void)ch; (void)obj; return (0); }
+long long increase_bank_gold(struct char_data *ch, long long amt) { (void)ch; return (amt); }
+long long increase_money_gold(struct char_data *ch, long long amt) { (void)ch; return (amt); }
+void equip_char(struct char_data *ch, struct obj_data *obj, int pos) { (void)ch; (void)obj; (void)pos; }
+struct obj_data *unequip_char(struct char_data *ch, int pos) { (void)ch; (void)pos; return (NULL); }
+void obj_to_char(struct obj_data *object, struct char_data *ch) { (void)object; (void)ch; }
+void obj_from_char(struct obj_data *object) { (void)object; }
+void obj_to_obj(struct obj_data *obj, struct obj_data *obj_to) { (void)obj; (void)obj_to; }
+void extract_char(struct char_data *ch) { (void)ch; }
+void save_queue_wait(const char *path) { (void)path; }
+void save_queue_discard(const char *path) { (void)path; }
+FILE *save_file_open(struct save_file *sf, const char *path) { return (sf->fl = fopen(path, "w")); }
+int save_file_close(struct save_file *sf) { return (fclose(sf->fl) == 0); }
+void save_file_abort(struct save_file *sf) { fclose(sf->fl); }
+
+void strip_cr(char *buffer)
+{
+  char *r, *w;
+
+  for (r = w = buffer; *r; r++)
+    if (*r != '\r')
+      *w++ = *r;
+  *w = '\0';
+}
+
+obj_rnum real_object(obj_vnum vnum)
+{
+  obj_rnum i;
+
+  for (i = 0; i <= top_of_objt; i++)
+    if (obj_index[i].vnum == vnum)
+      return (i);
+  return (NOTHING);
+}
+
+struct obj_data *create_obj(void)
+{
+  struct obj_data *obj;
+
+  CREATE(obj, struct obj_data, 1);
+  obj->item_number = NOTHING;
+  obj->in_room = NOWHERE;
+  instantiated++;
+  return (obj);
+}
+
+struct obj_data *read_object(obj_vnum nr, int type)
+{
+  obj_rnum i = type == VIRTUAL ? real_object(nr) : nr;
+  struct obj_data *obj;
+
+  if (i == NOTHING)
+    return (NULL);
+  obj = create_obj();
+  *obj = obj_proto[i];
+  return (obj);
+}
+
+void extract_obj(struct obj_data *obj) { free(obj); }
+
+void tag_argument(char *argument, char *tag, size_t taglen)
+{
+  char *tmp = argument, *wrt = argument;
+  size_t n = 0;
+
+  while (*tmp && *tmp != ':' && n + 1 < taglen)
+    tag[n++] = *tmp++;
+  tag[n] = '\0';
+  while (*tmp && *tmp != ':')
+    tmp++;
+  while (*tmp == ':' || isspace((unsigned char)*tmp))
+    tmp++;
+  while (*tmp)
+    *(wrt++) = *(tmp++);
+  *wrt = '\0';
+}
+
+bitvector_t asciiflag_conv(char *flag)
+{
+  return (atol(flag));
+}
+
+int get_line(FILE *fl, char *buf)
+{
+  char temp[READ_SIZE];
+  int sl;
+
+  do {
+    if (!fgets(temp, READ_SIZE, fl))
+      return (0);
+  } while (*temp == '*' || *temp == '\n' || *temp == '\r');
+
+  sl = strlen(temp);
+  while (sl > 0 && (temp[sl - 1] == '\n' || temp[sl - 1] == '\r'))
+    temp[--sl] = '\0';
+  strcpy(buf, temp);
+  return (1);
+}
+
+/* Just enough of fread_string() for the one line strings below. */
+char *fread_string(FILE *fl, const char *error)
+{
+  char line[512], *p;
+
+  (void)error;
+  if (!fgets(line, sizeof(line), fl))
+    return (NULL);
+  for (p = line + strlen(line); p > line && (p[-1] == '\n' || p[-1] == '\r' || p[-1] == '~'); p--)
+    ;
+  *p = '\0';
+  return (strdup(line));
+}
+
+#include "objsave.c"
+
+#define NUM_PROTOS 3
+
+static struct extra_descr_data sword_look = { "sword", "It is sharp.", NULL };
+
+static int expect_int(const char *label, long expected, long actual)
+{
+  if (expected != actual) {
+    fprintf(stderr, "%s: expected %ld but got %ld\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+/* A bag, a sword with a look description, and a potion. */
+static void make_protos(void)
+{
+  struct obj_data *o;
+
+  CREATE(obj_proto, struct obj_data, NUM_PROTOS);
+  CREATE(obj_index, struct index_data, NUM_PROTOS);
+  top_of_objt = NUM_PROTOS - 1;
+
+  o = &obj_proto[0];
+  obj_index[0].vnum = 100;
+  o->item_number = 0;
+  o->name = "bag";
+  o->short_description = "a bag";
+  o->description = "A bag lies here.";
+  GET_OBJ_TYPE(o) = ITEM_CONTAINER;
+  GET_OBJ_VAL(o, 0) = 50;
+  GET_OBJ_WEAR(o)[0] = 1;
+  GET_OBJ_WEIGHT(o) = 2;
+
+  o = &obj_proto[1];
+  obj_index[1].vnum = 200;
+  o->item_number = 1;
+  o->name = "sword long";
+  o->short_description = "a long sword";
+  o->description = "A long sword lies here.";
+  o->ex_description = &sword_look;
+  GET_OBJ_TYPE(o) = ITEM_WEAPON;
+  GET_OBJ_VAL(o, 1) = 2;
+  GET_OBJ_VAL(o, 2) = 6;
+  GET_OBJ_EXTRA(o)[0] = 64;
+  GET_OBJ_WEAR(o)[0] = 8193;
+  GET_OBJ_WEIGHT(o) = 10;
+  GET_OBJ_COST(o) = 100;
+  o->affected[0].location = APPLY_HITROLL;
+  o->affected[0].modifier = 1;
+
+  o = &obj_proto[2];
+  obj_index[2].vnum = 300;
+  o->item_number = 2;
+  o->name = "potion red";
+  o->short_description = "a red potion";
+  o->description = "A red potion is here.";
+  GET_OBJ_TYPE(o) = ITEM_POTION;
+  GET_OBJ_WEAR(o)[0] = 1;
+  GET_OBJ_WEIGHT(o) = 1;
+}
+
+/* A copy of a prototype, the way read_object() hands one out. */
+static struct obj_data *copy_of(obj_rnum rnum)
+{
+  struct obj_data *obj;
+
+  CREATE(obj, struct obj_data, 1);
+  *obj = obj_proto[rnum];
+  return (obj);
+}
+
+static char *save_to_string(struct obj_data *obj, int locate, char *buf, size_t len)
+{
+  FILE *fl = fmemopen(buf, len, "w");
+
+  objsave_save_obj_record(obj, fl, locate);
+  fclose(fl);
+  return (buf);
+}
+
+/* Writes obj out and reads it back through the rent file loader. */
+static struct obj_data *round_trip(struct obj_data *obj)
+{
+  obj_save_data *loaded;
+  struct obj_data *back;
+  FILE *fl = tmpfile();
+
+  objsave_save_obj_record(obj, fl, 0);
+  fputs("$~\n", fl);
+  rewind(fl);
+  loaded = objsave_parse_objects(fl);
+  fclose(fl);
+
+  if (!loaded)
+    return (NULL);
+  back = loaded->obj;
+  free(loaded);
+  return (back);
+}
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return ((now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1000000.0);
+}
+
+/* Times saves of an inventory of bags, each filled with swords and potions,
+ * about half of which have been touched since they were loaded. */
+static void bench(int saves, int bags)
+{
+  struct obj_data **objs;
+  struct timeval start;
+  long bytes = 0;
+  int i, n, per_bag = 20, count = bags * (per_bag + 1);
+  FILE *fl = tmpfile();
+
+  CREATE(objs, struct obj_data *, count);
+  for (i = n = 0; i < bags; i++) {
+    int j;
+
+    objs[n++] = copy_of(0);
+    for (j = 0; j < per_bag; j++, n++) {
+      objs[n] = copy_of(1 + j % 2);
+      if (j % 2)
+        GET_OBJ_VAL(objs[n], 0) = j;
+    }
+  }
+
+  instantiated = 0;
+  gettimeofday(&start, NULL);
+  for (i = 0; i < saves; i++) {
+    rewind(fl);
+    for (n = 0; n < count; n++)
+      objsave_save_obj_record(objs[n], fl, n % (per_bag + 1) ? -1 : 0);
+    bytes += ftell(fl);
+  }
+  printf("%d saves of %d objects: %.1f us and %ld bytes per save, %d objects made\n",
+         saves, count, elapsed(&start) * 1000000.0 / saves,
+         saves ? bytes / saves : 0, instantiated);
+
+  fclose(fl);
+  for (n = 0; n < count; n++)
+    free(objs[n]);
+  free(objs);
+}
+
+int main(int argc, char **argv)
+{
+  char buf[MAX_STRING_LENGTH];
+  struct obj_data *obj, *back;
+  int failures = 0;
+
+  make_protos();
+
+  /* An untouched object is just its number. */
+  obj = copy_of(1);
+  failures += expect_int("untouched", 0, strcmp("#200\nLoc : 3\n\n", save_to_string(obj, 3, buf, sizeof(buf))));
+  failures += expect_int("nothing made", 0, instantiated);
+
+  /* Changed flags and values are written and come back. */
+  GET_OBJ_EXTRA(obj)[1] = 4;
+  GET_OBJ_WEAR(obj)[0] = 1;
+  GET_OBJ_VAL(obj, 2) = 8;
+  obj->affected[0].modifier = 3;
+  save_to_string(obj, 0, buf, sizeof(buf));
+  failures += expect_int("flags written", 1, strstr(buf, "Flag: 64 4 0 0\n") != NULL);
+  failures += expect_int("wear written", 1, strstr(buf, "Wear: 1 0 0 0\n") != NULL);
+  failures += expect_int("perm skipped", 0, strstr(buf, "Perm:") != NULL);
+  failures += expect_int("strings skipped", 0, strstr(buf, "Name:") != NULL);
+  failures += expect_int("edesc skipped", 0, strstr(buf, "EDes:") != NULL);
+  back = round_trip(obj);
+  failures += expect_int("loaded", 1, back != NULL);
+  if (back) {
+    failures += expect_int("flags back", 4, GET_OBJ_EXTRA(back)[1]);
+    failures += expect_int("wear back", 1, GET_OBJ_WEAR(back)[0]);
+    failures += expect_int("value back", 8, GET_OBJ_VAL(back, 2));
+    failures += expect_int("affect back", 3, back->affected[0].modifier);
+    failures += expect_int("proto edesc", 1, back->ex_description == &sword_look);
+    free(back);
+  }
+  free(obj);
+
+  /* A restrung object keeps its strings. */
+  obj = copy_of(2);
+  obj->short_description = "a blue potion";
+  back = round_trip(obj);
+  failures += expect_int("restrung", 0, back ? strcmp(back->short_description, "a blue potion") : 1);
+  if (back) {
+    free(back->short_description);
+    free(back);
+  }
+  free(obj);
+
+  /* A unique object is compared to an empty one, which is what it loads as. */
+  CREATE(obj, struct obj_data, 1);
+  obj->item_number = NOTHING;
+  obj->name = "note";
+  GET_OBJ_TYPE(obj) = ITEM_NOTE;
+  GET_OBJ_WEAR(obj)[0] = 1;
+  save_to_string(obj, 0, buf, sizeof(buf));
+  failures += expect_int("unique flags skipped", 0, strstr(buf, "Flag:") != NULL);
+  back = round_trip(obj);
+  if (back) {
+    failures += expect_int("unique type", ITEM_NOTE, GET_OBJ_TYPE(back));
+    failures += expect_int("unique wear", 1, GET_OBJ_WEAR(back)[0]);
+    failures += expect_int("unique name", 0, strcmp(back->name, "note"));
+    free(back->name);
+    free(back);
+  } else
+    failures++;
+  free(obj);
+
+  if (argc > 1)
+    bench(atoi(argv[1]), argc > 2 ? atoi(argv[2]) : 10);
+
+  return failures;
+}
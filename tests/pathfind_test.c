@@ -0,0 +1,104 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+
+/* Stubs and globals required by pathfind.c */
+struct room_data *world = NULL;
+struct zone_data *zone_table = NULL;
+zone_rnum top_of_zone_table = 0;
+room_rnum top_of_world = 0;
+struct config_data config_info;
+
+void basic_mud_log(const char *format, ...) { (void)format; }
+int MAX(int a, int b) { return a > b ? a : b; }
+
+#include "pathfind.c"
+
+/* Rooms 0-3 are zone 0 in a line; 4-6 are zone 1 and 7 is zone 2.  3 leads
+ * east to 4 and 4 leads on to 5 and 6; 0 also has a dead end north into 7. */
+#define TEST_ROOMS 8
+
+static void link_rooms(room_rnum from, int dir, room_rnum to)
+{
+  CREATE(world[from].dir_option[dir], struct room_direction_data, 1);
+  world[from].dir_option[dir]->to_room = to;
+}
+
+static void build_world(void)
+{
+  room_rnum r;
+
+  CREATE(world, struct room_data, TEST_ROOMS);
+  CREATE(zone_table, struct zone_data, 3);
+  top_of_world = TEST_ROOMS - 1;
+  top_of_zone_table = 2;
+
+  for (r = 0; r < TEST_ROOMS; r++)
+    world[r].zone = r < 4 ? 0 : (r < 7 ? 1 : 2);
+
+  link_rooms(0, EAST, 1);  link_rooms(1, WEST, 0);
+  link_rooms(1, EAST, 2);  link_rooms(2, WEST, 1);
+  link_rooms(2, EAST, 3);  link_rooms(3, WEST, 2);
+  link_rooms(3, EAST, 4);  link_rooms(4, WEST, 3);
+  link_rooms(4, EAST, 5);  link_rooms(5, WEST, 4);
+  link_rooms(4, SOUTH, 6); link_rooms(6, NORTH, 4);
+  link_rooms(0, NORTH, 7);
+}
+
+static int expect_int(const char *label, int expected, int actual)
+{
+  if (expected != actual) {
+    fprintf(stderr, "%s: expected %d but got %d\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+int main(void)
+{
+  struct path_data *path = NULL;
+  int failures = 0;
+
+  build_world();
+  CONFIG_TRACK_T_DOORS = TRUE;
+
+  failures += expect_int("same room", BFS_ALREADY_THERE, find_first_step(2, 2));
+  failures += expect_int("bad room", BFS_ERROR, find_first_step(0, NOWHERE));
+  failures += expect_int("bfs first step", EAST, find_first_step(0, 6));
+  failures += expect_int("one-way exit", BFS_NO_PATH, find_first_step(7, 0));
+
+  failures += expect_int("astar first step", EAST, find_path(0, 6, PATHF_ASTAR, &path));
+  failures += expect_int("astar length", 5, path->len);
+  failures += expect_int("astar last step", SOUTH, path->dirs[4]);
+  failures += expect_int("astar no path", BFS_NO_PATH, find_path(7, 6, PATHF_ASTAR, &path));
+
+  /* A cached route is followed as the tracker walks it. */
+  find_path(0, 6, PATHF_ASTAR, &path);
+  failures += expect_int("cached step", EAST, path_next_step(&path, 1, 6, PATHF_ASTAR));
+  failures += expect_int("cached pos", 1, path->pos);
+  failures += expect_int("cached step again", EAST, path_next_step(&path, 1, 6, PATHF_ASTAR));
+  failures += expect_int("cached pos kept", 1, path->pos);
+
+  /* Closing a door on the route forces a new search, which fails. */
+  CONFIG_TRACK_T_DOORS = FALSE;
+  SET_BIT(world[2].dir_option[EAST]->exit_info, EX_CLOSED);
+  failures += expect_int("door closed", BFS_NO_PATH, path_next_step(&path, 2, 6, PATHF_ASTAR));
+  REMOVE_BIT(world[2].dir_option[EAST]->exit_info, EX_CLOSED);
+
+  /* No-track rooms cannot be entered. */
+  SET_BIT_AR(world[5].room_flags, ROOM_NOTRACK);
+  failures += expect_int("notrack", BFS_NO_PATH, find_first_step(0, 5));
+  REMOVE_BIT_AR(world[5].room_flags, ROOM_NOTRACK);
+
+  /* A rewired exit is seen once the world is marked changed. */
+  link_rooms(7, SOUTH, 6);
+  pathfind_world_changed();
+  failures += expect_int("rewired", SOUTH, find_path(7, 6, PATHF_ASTAR, &path));
+  failures += expect_int("rewired length", 1, path->len);
+
+  free_path(path);
+  pathfind_free();
+
+  return failures;
+}
@@ -0,0 +1,160 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "interpreter.h"
+#include "db.h"
+#include "dg_scripts.h"
+#include "profiler.h"
+
+/* Stubs and globals required by profiler.c */
+struct command_info *complete_cmd_info = NULL;
+struct index_data **trig_index = NULL;
+
+int MAX(int a, int b) { return a > b ? a : b; }
+int MIN(int a, int b) { return a < b ? a : b; }
+
+static char last_log[PROFILE_REPORT_LENGTH + 64];
+static int logs = 0;
+
+void basic_mud_log(const char *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(last_log, sizeof(last_log), format, args);
+  va_end(args);
+  logs++;
+}
+
+trig_rnum real_trigger(trig_vnum vnum) { (void)vnum; return NOTHING; }
+const char *get_spec_func_name(SPECIAL(*func)) { (void)func; return NULL; }
+
+#include "profiler.c"
+
+static int failures = 0;
+
+static void expect(const char *label, int ok)
+{
+  if (!ok) {
+    fprintf(stderr, "%s\n", label);
+    failures++;
+  }
+}
+
+/* Runs one pass whose phases are charged by hand, usec before now. */
+static void fake_pulse(long events_usec, long zones_usec)
+{
+  long start = profile_pulse_start() - events_usec - zones_usec;
+
+  profile_add(PROF_PHASE, PHASE_EVENTS, start);
+  profile_add(PROF_PHASE, PHASE_ZONES, profile_clock() - zones_usec);
+  profile_pulse_end(start);
+}
+
+int main(void)
+{
+  struct profile_stats ps;
+  struct prof_entry *e;
+  char buf[4096];
+  long v;
+  int b, i;
+
+  /* Every time falls in a bucket whose top is at least it, and above the
+   * top of the bucket before. */
+  for (v = 0; v < 1000000; v += (v < 4096 ? 1 : v / 97)) {
+    b = bucket_of(v);
+    if (b == PROF_BUCKETS - 1)
+      break;
+    if (bucket_top(b) < v || (b && bucket_top(b - 1) >= v)) {
+      fprintf(stderr, "time %ld in bucket %d (%ld..%ld)\n", v, b,
+        b ? bucket_top(b - 1) + 1 : 0, bucket_top(b));
+      failures++;
+      break;
+    }
+  }
+  expect("buckets should stay within a quarter of the time",
+    bucket_top(bucket_of(100000)) < 125000);
+  expect("a huge time should land in the last bucket",
+    bucket_of(1L << 40) == PROF_BUCKETS - 1);
+
+  /* 99 fast samples and one slow one: the median is fast, p99 is not. */
+  for (i = 0; i < 99; i++)
+    profile_add(PROF_TRIGGER, 1200, profile_clock() - 100);
+  profile_add(PROF_TRIGGER, 1200, profile_clock() - 50000);
+  e = find_entry(PROF_TRIGGER, 1200);
+  expect("trigger entry should exist", e != NULL);
+  expect("trigger should be named by vnum", e && !strcmp(e->name, "[1200] "));
+  expect("100 samples", e && e->window[0].samples == 100);
+  expect("p50 should be near 100 usec", e && percentile(e->window, 2, 50) < 200);
+  expect("p99 should be near 100 usec", e && percentile(e->window, 2, 99) < 200);
+  expect("p100 should be the slow one", e && percentile(e->window, 2, 100) >= 50000);
+  expect("max should be the slow one", e && window_max(e) >= 50000);
+
+  /* A fast pass is counted but not reported. */
+  fake_pulse(1000, 1000);
+  profile_stats(&ps);
+  expect("one pulse counted", ps.pulses == 1);
+  expect("fast pulse is not slow", ps.slow == 0 && logs == 0);
+
+  /* A slow pass names its slowest phases. */
+  v = profile_pulse_start() - 3 * OPT_USEC;
+  profile_add(PROF_PHASE, PHASE_EVENTS, v + 2 * OPT_USEC);
+  profile_add(PROF_PHASE, PHASE_ZONES, profile_clock() - 2 * OPT_USEC);
+  profile_add(PROF_TRIGGER, 1200, profile_clock() - 500);
+  profile_pulse_end(v);
+  profile_stats(&ps);
+  expect("slow pulse counted", ps.slow == 1 && logs == 1);
+  expect("report should start with the pass",
+    !strncmp(last_log, "Slow pulse:", 11));
+  expect("zones should be named before events",
+    strstr(last_log, "zone update") && strstr(last_log, "events") &&
+    strstr(last_log, "zone update") < strstr(last_log, "events"));
+  expect("report should name the trigger", strstr(last_log, "trigger [1200]") != NULL);
+  expect("report is kept for show", !strcmp(ps.last_slow, last_log));
+
+  /* Slow passes right after a report are only counted. */
+  fake_pulse(2 * OPT_USEC, 0);
+  profile_stats(&ps);
+  expect("second slow pulse counted", ps.slow == 2);
+  expect("second slow pulse not logged", logs == 1);
+
+  for (i = 0; i < PROF_REPORT_PULSES; i++)
+    fake_pulse(0, 0);
+  fake_pulse(2 * OPT_USEC, 0);
+  expect("next report should be logged", logs == 2);
+  expect("next report should count the skipped one",
+    strstr(last_log, "(1 more since the last report)") != NULL);
+
+  /* Samples age out after two windows. */
+  for (i = 0; i < 2 * PROF_WINDOW_PULSES; i++)
+    fake_pulse(0, 0);
+  profile_print(buf, sizeof(buf), PROF_TRIGGER, 10);
+  expect("old trigger samples should be gone", strstr(buf, "None timed yet.") != NULL);
+  profile_print(buf, sizeof(buf), PROF_PHASE, NUM_PHASES);
+  expect("phase table should list the pulse", strstr(buf, "pulse ") != NULL);
+  expect("phase table should list events", strstr(buf, "events") != NULL);
+
+  /* A table that does not fit is cut short. */
+  expect("short buffer", profile_print(buf, 40, PROF_PHASE, NUM_PHASES) == 39);
+
+  /* The run keeps every pass, however old. */
+  expect("run p50 should be a fast pass", profile_pulse_percentile(50) < 1000);
+  expect("run max should be a slow pass",
+    profile_pulse_percentile(100) >= 3 * OPT_USEC);
+
+  profile_reset();
+  expect("reset clears the run", profile_pulse_percentile(100) == 0);
+  profile_stats(&ps);
+  expect("reset clears the counts", ps.pulses == 0 && ps.slow == 0);
+  profile_print(buf, sizeof(buf), PROF_PHASE, NUM_PHASES);
+  expect("reset clears the phases", strstr(buf, "None timed yet.") != NULL);
+
+  if (failures) {
+    fprintf(stderr, "%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("profiler tests passed\n");
+  return 0;
+}
@@ -35,8 +35,6 @@ static void init_test_character(struct descriptor_data *d, struct char_data *ch)
   ch->desc = d;
   d->character = ch;
   d->connected = CON_PLAYING;
-  d->output = d->small_outbuf;
-  d->bufspace = SMALL_BUFSIZE - 1;
 
   ch->player.name = strdup("Tester");
   ch->player.title = strdup("");
@@ -0,0 +1,172 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+
+/* Stubs and globals required by ptable.c */
+struct player_index_element *player_table = NULL;
+int top_of_p_table = -1;
+
+void basic_mud_log(const char *format, ...) { (void)format; }
+#ifndef str_cmp
+int str_cmp(const char *arg1, const char *arg2) { return strcasecmp(arg1, arg2); }
+#endif
+
+#include "ptable.c"
+
+static int expect_int(const char *label, long expected, long actual)
+{
+  if (expected != actual) {
+    fprintf(stderr, "%s: expected %ld but got %ld\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+/* The scans ptable.c replaces. */
+static int linear_name(const char *name)
+{
+  int i;
+
+  for (i = 0; i <= top_of_p_table; i++)
+    if (!str_cmp(player_table[i].name, name))
+      return (i);
+  return (-1);
+}
+
+static int linear_id(long id)
+{
+  int i;
+
+  for (i = 0; i <= top_of_p_table; i++)
+    if (player_table[i].id == id)
+      return (i);
+  return (-1);
+}
+
+/* Fills player_table[] with count made-up players. */
+static void fake_players(int count)
+{
+  char name[32];
+  int i;
+
+  CREATE(player_table, struct player_index_element, count);
+  for (i = 0; i < count; i++) {
+    snprintf(name, sizeof(name), "player%c%d", 'a' + i % 26, i);
+    player_table[i].name = strdup(name);
+    player_table[i].id = 1000 + i * 7;
+  }
+  top_of_p_table = count - 1;
+}
+
+static void free_players(void)
+{
+  int i;
+
+  for (i = 0; i <= top_of_p_table; i++)
+    free(player_table[i].name);
+  free(player_table);
+  player_table = NULL;
+  top_of_p_table = -1;
+}
+
+static double elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return ((now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1000000.0);
+}
+
+/* Times both lookup paths over a synthetic index of count players. */
+static void bench(int count, int lookups)
+{
+  struct timeval start;
+  double t_linear, t_hash, t_build;
+  long sink = 0;
+  int i, pos;
+
+  fake_players(count);
+
+  gettimeofday(&start, NULL);
+  ptable_hash_rebuild();
+  t_build = elapsed(&start);
+
+  gettimeofday(&start, NULL);
+  for (i = 0; i < lookups; i++) {
+    pos = (int) ((i * 2654435761UL) % count);
+    sink += linear_name(player_table[pos].name) + linear_id(player_table[pos].id);
+  }
+  t_linear = elapsed(&start);
+
+  gettimeofday(&start, NULL);
+  for (i = 0; i < lookups; i++) {
+    pos = (int) ((i * 2654435761UL) % count);
+    sink -= ptable_hash_name(player_table[pos].name) + ptable_hash_id(player_table[pos].id);
+  }
+  t_hash = elapsed(&start);
+
+  printf("%d players, %d lookups: build %.3fs, linear %.3fs, hashed %.3fs (check %ld)\n",
+         count, lookups, t_build, t_linear, t_hash, sink);
+
+  ptable_hash_free();
+  free_players();
+}
+
+int main(int argc, char **argv)
+{
+  int i, failures = 0;
+  char label[64];
+
+  /* An empty index answers nothing. */
+  ptable_hash_rebuild();
+  failures += expect_int("empty name", -1, ptable_hash_name("nobody"));
+  failures += expect_int("empty id", -1, ptable_hash_id(1));
+
+  /* Grow one at a time the way create_entry() does. */
+  for (i = 0; i < 500; i++) {
+    RECREATE(player_table, struct player_index_element, i + 1);
+    top_of_p_table = i;
+    CREATE(player_table[i].name, char, 16);
+    snprintf(player_table[i].name, 16, "name%d", i);
+    player_table[i].id = i * 3 + 1;
+    ptable_hash_add(i);
+  }
+  for (i = 0; i < 500; i++) {
+    snprintf(label, sizeof(label), "NAME%d", i);
+    failures += expect_int(label, linear_name(label), ptable_hash_name(label));
+    failures += expect_int("id", linear_id(i * 3 + 1), ptable_hash_id(i * 3 + 1));
+    failures += expect_int("missing id", -1, ptable_hash_id(i * 3 + 2));
+  }
+  failures += expect_int("missing name", -1, ptable_hash_name("name500"));
+
+  /* A rename and a new id leave stale slots behind that must not match. */
+  free(player_table[10].name);
+  player_table[10].name = strdup("renamed");
+  ptable_hash_add(10);
+  player_table[20].id = 5000;
+  ptable_hash_add(20);
+  failures += expect_int("new name", 10, ptable_hash_name("Renamed"));
+  failures += expect_int("old name", -1, ptable_hash_name("name10"));
+  failures += expect_int("new id", 20, ptable_hash_id(5000));
+  failures += expect_int("old id", -1, ptable_hash_id(20 * 3 + 1));
+
+  /* Removal shifts everything down and rebuilds. */
+  free(player_table[0].name);
+  memmove(player_table, player_table + 1, top_of_p_table * sizeof(*player_table));
+  top_of_p_table--;
+  ptable_hash_rebuild();
+  failures += expect_int("removed", -1, ptable_hash_name("name0"));
+  failures += expect_int("shifted name", 98, ptable_hash_name("name99"));
+  failures += expect_int("shifted id", 98, ptable_hash_id(99 * 3 + 1));
+
+  ptable_hash_free();
+  free_players();
+
+  if (argc > 1)
+    bench(atoi(argv[1]), argc > 2 ? atoi(argv[2]) : 2000);
+
+  return failures;
+}
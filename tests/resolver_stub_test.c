@@ -0,0 +1,143 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+
+/* Stubs and globals required by resolver.c */
+void basic_mud_log(const char *format, ...) { (void)format; }
+size_t strlcpy(char *dest, const char *source, size_t totalsize)
+{
+  snprintf(dest, totalsize, "%s", source);
+  return strlen(source);
+}
+
+#include "resolver.c"
+
+/* A local stub resolver: no nameserver, no network.  It runs on the worker
+ * threads, so its count is kept under a lock the test can wait on. */
+static pthread_mutex_t stub_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stub_cond = PTHREAD_COND_INITIALIZER;
+static int stub_calls = 0;
+
+static int stub_lookup(const struct in_addr *addr, char *host, size_t len)
+{
+  pthread_mutex_lock(&stub_lock);
+  stub_calls++;
+  pthread_cond_signal(&stub_cond);
+  pthread_mutex_unlock(&stub_lock);
+
+  if (addr->s_addr != htonl(INADDR_LOOPBACK))
+    return 0;
+  snprintf(host, len, "stub.localhost");
+  return 1;
+}
+
+static int resolved_count = 0;
+
+static void stub_done(struct descriptor_data *d, const char *host)
+{
+  strlcpy(d->host, host, sizeof(d->host));
+  resolved_count++;
+}
+
+/* Waits for the workers to make 'want' lookups, then stops them.  Joining
+ * means every result they produced is queued before resolver_process(). */
+static int finish_lookups(int want)
+{
+  struct timespec deadline;
+  int i, ok = 1;
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += 5;
+
+  pthread_mutex_lock(&stub_lock);
+  while (stub_calls < want && ok)
+    ok = (pthread_cond_timedwait(&stub_cond, &stub_lock, &deadline) == 0);
+  pthread_mutex_unlock(&stub_lock);
+
+  pthread_mutex_lock(&request_lock);
+  stopping = TRUE;
+  pthread_cond_broadcast(&request_cond);
+  pthread_mutex_unlock(&request_lock);
+  for (i = 0; i < num_workers; i++)
+    pthread_join(workers[i], NULL);
+  free(workers);
+  workers = NULL;
+  num_workers = 0;
+
+  resolver_process();
+  if (!ok)
+    fprintf(stderr, "timed out waiting for %d lookup(s)\n", want);
+  return ok ? 0 : 1;
+}
+
+static int expect_int(const char *label, int expected, int actual)
+{
+  if (expected != actual) {
+    fprintf(stderr, "%s: expected %d but got %d\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+static int expect_string_equals(const char *label, const char *actual, const char *expected)
+{
+  if (strcmp(actual, expected) != 0) {
+    fprintf(stderr, "%s: expected '%s' but got '%s'\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+int main(void)
+{
+  struct descriptor_data d1, d2, d3;
+  struct in_addr loopback, other;
+  char host[HOST_LENGTH + 1];
+  int failures = 0;
+
+  memset(&d1, 0, sizeof(d1));
+  memset(&d2, 0, sizeof(d2));
+  memset(&d3, 0, sizeof(d3));
+  loopback.s_addr = htonl(INADDR_LOOPBACK);
+  other.s_addr = htonl(0x0A000001);
+
+  resolver_set_lookup(stub_lookup);
+  resolver_init(2, stub_done);
+
+  strcpy(d1.host, "127.0.0.1");
+  failures += expect_int("cold cache", 0, resolver_cache_lookup(loopback, host, sizeof(host)));
+  resolver_request(&d1, loopback);
+  failures += finish_lookups(1);
+  failures += expect_string_equals("name delivered", d1.host, "stub.localhost");
+  failures += expect_int("request cleared", 1, d1.dns_request == NULL);
+
+  failures += expect_int("warm cache", 1, resolver_cache_lookup(loopback, host, sizeof(host)));
+  failures += expect_string_equals("cached name", host, "stub.localhost");
+
+  /* A cancelled request must not touch its descriptor. */
+  strcpy(d2.host, "127.0.0.1");
+  resolved_count = stub_calls = 0;
+  resolver_init(2, stub_done);
+  resolver_request(&d2, loopback);
+  resolver_cancel(&d2);
+  failures += finish_lookups(1);
+  failures += expect_string_equals("cancelled stays numeric", d2.host, "127.0.0.1");
+  failures += expect_int("cancelled not delivered", 0, resolved_count);
+
+  /* Failures keep the numeric address and are cached negatively. */
+  strcpy(d3.host, "10.0.0.1");
+  resolved_count = stub_calls = 0;
+  resolver_init(2, stub_done);
+  resolver_request(&d3, other);
+  failures += finish_lookups(1);
+  failures += expect_string_equals("failed stays numeric", d3.host, "10.0.0.1");
+  /* With the workers stopped a lookup would run here and be counted. */
+  resolver_request(&d3, other);
+  failures += expect_int("negative cache skips lookup", 1, stub_calls);
+  failures += expect_int("no pending request", 1, d3.dns_request == NULL);
+
+  resolver_shutdown();
+
+  return failures;
+}
@@ -0,0 +1,128 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+
+/* Stubs and globals required by savequeue.c */
+static int logged_errors = 0;
+
+void basic_mud_log(const char *format, ...) { (void)format; }
+void mudlog(int type, int level, int file, const char *str, ...)
+{
+  (void)type; (void)level; (void)file; (void)str;
+  logged_errors++;
+}
+int MAX(int a, int b) { return a > b ? a : b; }
+size_t strlcpy(char *dest, const char *source, size_t totalsize)
+{
+  snprintf(dest, totalsize, "%s", source);
+  return strlen(source);
+}
+
+#include "savequeue.c"
+
+static int expect_int(const char *label, long expected, long actual)
+{
+  if (expected != actual) {
+    fprintf(stderr, "%s: expected %ld but got %ld\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+static int expect_file(const char *label, const char *path, const char *expected)
+{
+  char buf[256] = "";
+  FILE *fl;
+  size_t n;
+
+  if (!(fl = fopen(path, "r"))) {
+    if (!expected)
+      return 0;
+    fprintf(stderr, "%s: %s is missing\n", label, path);
+    return 1;
+  }
+  n = fread(buf, 1, sizeof(buf) - 1, fl);
+  buf[n] = '\0';
+  fclose(fl);
+
+  if (!expected || strcmp(buf, expected)) {
+    fprintf(stderr, "%s: %s holds '%s'\n", label, path, buf);
+    return 1;
+  }
+  return 0;
+}
+
+static int save_text(const char *path, const char *text)
+{
+  struct save_file sf;
+  FILE *fl;
+
+  if (!(fl = save_file_open(&sf, path)))
+    return FALSE;
+  fputs(text, fl);
+  return save_file_close(&sf);
+}
+
+int main(void)
+{
+  char dir[] = "/tmp/savequeueXXXXXX", a[128], b[128], tmp[140], bad[160];
+  struct save_queue_stats ss;
+  struct save_file sf;
+  int failures = 0;
+
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  snprintf(a, sizeof(a), "%s/a.plr", dir);
+  snprintf(b, sizeof(b), "%s/b.plr", dir);
+  snprintf(tmp, sizeof(tmp), "%s.tmp", a);
+  snprintf(bad, sizeof(bad), "%s/missing/c.plr", dir);
+
+  /* Before the writer starts, files are written on the spot. */
+  failures += expect_int("sync save", TRUE, save_text(a, "first\n"));
+  failures += expect_file("sync file", a, "first\n");
+  failures += expect_file("no temp file", tmp, NULL);
+  failures += expect_int("sync failure", FALSE, save_text(bad, "x"));
+  failures += expect_int("failure logged", 1, logged_errors);
+
+  /* Queue without a running writer so nothing is written yet. */
+  writer_running = TRUE;
+  save_text(a, "second\n");
+  save_text(b, "other\n");
+  save_text(a, "third\n");
+  save_queue_stats(&ss);
+  failures += expect_int("pending", 2, ss.pending);
+  failures += expect_int("coalesced", 1, ss.coalesced);
+  failures += expect_file("not yet written", a, "first\n");
+
+  save_queue_discard(b);
+  save_queue_stats(&ss);
+  failures += expect_int("discarded", 1, ss.pending);
+
+  /* An aborted snapshot leaves the queue alone. */
+  save_file_open(&sf, a);
+  fputs("aborted\n", sf.fl);
+  save_file_abort(&sf);
+
+  /* The writer picks up what was queued before it started. */
+  writer_running = FALSE;
+  save_queue_init();
+  save_queue_wait(a);
+  failures += expect_file("queued write", a, "third\n");
+  failures += expect_file("discarded file", b, NULL);
+
+  save_text(bad, "x");
+  save_queue_shutdown();
+  save_queue_stats(&ss);
+  failures += expect_int("writes", 2, ss.writes);
+  failures += expect_int("failures", 2, ss.failures);
+  failures += expect_int("threaded failure logged", 2, logged_errors);
+  failures += expect_int("drained", 0, ss.pending);
+
+  unlink(a);
+  rmdir(dir);
+
+  return failures;
+}
@@ -0,0 +1,403 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+#include "comm.h"
+#include "interpreter.h"
+#include "handler.h"
+#include "act.h"
+
+/* Stubs and globals required by shop.c */
+struct descriptor_data *descriptor_list = NULL;
+struct command_info *complete_cmd_info = NULL;
+struct player_special_data dummy_mob;
+struct time_info_data time_info;
+struct room_data *world = NULL;
+room_rnum top_of_world = NOWHERE;
+struct index_data *mob_index = NULL;
+struct char_data *mob_proto = NULL;
+mob_rnum top_of_mobt = NOBODY;
+struct index_data *obj_index = NULL;
+struct obj_data *obj_proto = NULL;
+obj_rnum top_of_objt = NOTHING;
+struct shop_data *shop_index = NULL;
+int top_shop = -1;
+
+/* Logged complaints, which should come once per expression. */
+static int logged = 0;
+
+void basic_mud_log(const char *format, ...) { (void)format; logged++; }
+int MAX(int a, int b) { return a > b ? a : b; }
+int MIN(int a, int b) { return a < b ? a : b; }
+char *CAP(char *txt) { return (txt); }
+char *act(const char *str, int hide_invisible, struct char_data *ch, struct obj_data *obj,
+          void *vict_obj, int type)
+{ (void)str; (void)hide_invisible; (void)ch; (void)obj; (void)vict_obj; (void)type; return (NULL); }
+size_t send_to_char(struct char_data *ch, const char *messg, ...) { (void)ch; (void)messg; return (0); }
+void page_string(struct descriptor_data *d, char *str, int keep_internal)
+{ (void)d; (void)str; (void)keep_internal; }
+ACMD(do_action) { (void)ch; (void)argument; (void)cmd; (void)subcmd; }
+ACMD(do_echo) { (void)ch; (void)argument; (void)cmd; (void)subcmd; }
+ACMD(do_say) { (void)ch; (void)argument; (void)cmd; (void)subcmd; }
+ACMD(do_tell) { (void)ch; (void)argument; (void)cmd; (void)subcmd; }
+int find_command(const char *command) { (void)command; return (-1); }
+int count_color_chars(char *string) { (void)string; return (0); }
+int room_is_dark(room_rnum room) { (void)room; return (0); }
+char *fname(const char *namelist) { return ((char *)namelist); }
+void format_gold_as_currency(char *out, size_t outsz, long long total_gold)
+{ snprintf(out, outsz, "%lld", total_gold); }
+char *fread_string(FILE *fl, const char *error) { (void)fl; (void)error; return (strdup("$")); }
+int get_line(FILE *fl, char *buf) { (void)fl; *buf = '\0'; return (0); }
+struct char_data *get_char_num(mob_rnum nr) { (void)nr; return (NULL); }
+struct obj_data *get_obj_in_list_num(int num, struct obj_data *list) { (void)num; (void)list; return (NULL); }
+struct obj_data *get_obj_in_list_vis(struct char_data *ch, char *name, int *number, struct obj_data *list)
+{ (void)ch; (void)name; (void)number; (void)list; return (NULL); }
+int get_number(char **name) { (void)name; return (1); }
+int is_number(const char *str) { (void)str; return (0); }
+char *one_argument(char *argument, char *first_arg) { *first_arg = '\0'; return (argument); }
+void obj_to_char(struct obj_data *object, struct char_data *ch) { (void)object; (void)ch; }
+void obj_from_char(struct obj_data *object) { (void)object; }
+void extract_obj(struct obj_data *obj) { (void)obj; }
+struct obj_data *read_object(obj_vnum nr, int type) { (void)nr; (void)type; return (NULL); }
+mob_rnum real_mobile(mob_vnum vnum) { (void)vnum; return (NOBODY); }
+obj_rnum real_object(obj_vnum vnum) { (void)vnum; return (NOTHING); }
+room_rnum real_room(room_vnum vnum) { (void)vnum; return (NOWHERE); }
+shop_rnum real_shop(shop_vnum vnum) { (void)vnum; return (NOWHERE); }
+long shop_calculate_buy_price(long base_cost, float buyprofit, int keeper_cha, const struct char_data *buyer)
+{ (void)buyprofit; (void)keeper_cha; (void)buyer; return (base_cost); }
+float shop_charisma_discount(const struct char_data *buyer, int keeper_cha) { (void)buyer; (void)keeper_cha; return (1); }
+long shop_scale_base_cost(long base_cost) { return (base_cost); }
+const char *skill_name(int num) { (void)num; return ("skill"); }
+size_t sprintbit(bitvector_t vektor, const char *names[], char *result, size_t reslen)
+{ (void)vektor; (void)names; *result = '\0'; (void)reslen; return (0); }
+size_t sprinttype(int type, const char *names[], char *result, size_t reslen)
+{ (void)type; (void)names; *result = '\0'; (void)reslen; return (0); }
+void sprintbitarray(int bitvector[], const char *names[], int maxar, char *result)
+{ (void)bitvector; (void)names; (void)maxar; *result = '\0'; }
+size_t strlcpy(char *dest, const char *source, size_t totalsize)
+{
+  snprintf(dest, totalsize, "%s", source);
+  return strlen(source);
+}
+
+/* The real ones, since the result depends on them. */
+int is_abbrev(const char *arg1, const char *arg2)
+{
+  if (!*arg1)
+    return (0);
+
+  for (; *arg1 && *arg2; arg1++, arg2++)
+    if (LOWER(*arg1) != LOWER(*arg2))
+      return (0);
+
+  if (!*arg1)
+    return (1);
+  else
+    return (0);
+}
+
+int isname(const char *str, const char *namelist)
+{
+  char *newlist;
+  char *curtok;
+
+  if (!str || !*str || !namelist || !*namelist)
+    return 0;
+
+  if (!strcmp(str, namelist)) /* the easy way */
+    return 1;
+
+  newlist = strdup(namelist); /* make a copy since strtok 'modifies' strings */
+  for(curtok = strtok(newlist, " \t\r\n"); curtok; curtok = strtok(NULL, " \t\r\n"))
+    if(curtok && is_abbrev(str, curtok)) {
+      /* Don't allow abbreviated numbers. - Sryth */
+      if (isdigit(*str) && (atoi(str) != atoi(curtok)))
+        return 0;
+      free(newlist);
+      return 1;
+    }
+  free(newlist);
+  return 0;
+}
+
+#include "constants.c"
+#include "shop.c"
+
+/* How trade_with() used to evaluate keywords, parsing them every time. */
+static void old_evaluate_operation(struct stack_data *ops, struct stack_data *vals)
+{
+  int oper;
+
+  if ((oper = pop(ops)) == OPER_NOT)
+    push(vals, !pop(vals));
+  else {
+    int val1 = pop(vals),
+	val2 = pop(vals);
+
+    if (oper == OPER_AND)
+      push(vals, val1 && val2);
+    else if (oper == OPER_OR)
+      push(vals, val1 || val2);
+  }
+}
+
+static int old_evaluate_expression(struct obj_data *obj, char *expr)
+{
+  struct stack_data ops, vals;
+  char *ptr, *end, name[MAX_STRING_LENGTH];
+  int temp, eindex;
+
+  if (!expr || !*expr)
+    return (TRUE);
+
+  ops.len = vals.len = 0;
+  ptr = expr;
+  while (*ptr) {
+    if (isspace(*ptr))
+      ptr++;
+    else {
+      if ((temp = find_oper_num(*ptr)) == NOTHING) {
+	end = ptr;
+	while (*ptr && !isspace(*ptr) && find_oper_num(*ptr) == NOTHING)
+	  ptr++;
+	strncpy(name, end, ptr - end);
+	name[ptr - end] = '\0';
+	for (eindex = 0; *extra_bits[eindex] != '\n'; eindex++)
+	  if (!str_cmp(name, extra_bits[eindex])) {
+	    push(&vals, OBJ_FLAGGED(obj, eindex));
+	    break;
+	  }
+	if (*extra_bits[eindex] == '\n')
+	  push(&vals, isname(name, obj->name));
+      } else {
+	if (temp != OPER_OPEN_PAREN)
+	  while (top(&ops) > temp)
+	    old_evaluate_operation(&ops, &vals);
+
+	if (temp == OPER_CLOSE_PAREN) {
+	  if ((temp = pop(&ops)) != OPER_OPEN_PAREN)
+	    return (FALSE);
+	} else
+	  push(&ops, temp);
+	ptr++;
+      }
+    }
+  }
+  while (top(&ops) != -1)
+    old_evaluate_operation(&ops, &vals);
+  temp = pop(&vals);
+  if (top(&vals) != -1)
+    return (FALSE);
+  return (temp);
+}
+
+static const char *tokens[] = {
+  "sword", "dagger", "sw", "staff", "GLOW", "magic", "NODROP", "!", "^", "&",
+  "*", "|", "+", "(", ")", "[", "]", "{", "}", " ", "blade", "ANTI_GOOD"
+};
+#define NUM_TOKENS (int)(sizeof(tokens) / sizeof(tokens[0]))
+
+static const char *names[] = {
+  "sword long", "dagger", "staff oak", "blade sword", "gem", "", "swordfish"
+};
+#define NUM_NAMES (int)(sizeof(names) / sizeof(names[0]))
+
+static void random_expression(char *buf, size_t len)
+{
+  int i, n = 1 + rand() % 12;
+
+  *buf = '\0';
+  for (i = 0; i < n; i++) {
+    strncat(buf, tokens[rand() % NUM_TOKENS], len - strlen(buf) - 1);
+    if (rand() % 2)
+      strncat(buf, " ", len - strlen(buf) - 1);
+  }
+}
+
+static void set_object(struct obj_data *obj, int n)
+{
+  int bit;
+
+  memset(obj, 0, sizeof(*obj));
+  obj->name = (char *)names[n % NUM_NAMES];
+  for (bit = 0; *extra_bits[bit] != '\n'; bit++)
+    if ((n >> (bit % 8)) & 1 && bit % 3 == n % 3)
+      SET_BIT_AR(GET_OBJ_EXTRA(obj), bit);
+}
+
+static int expect_int(const char *label, long expected, long actual)
+{
+  if (expected != actual) {
+    fprintf(stderr, "%s: expected %ld but got %ld\n", label, expected, actual);
+    return 1;
+  }
+  return 0;
+}
+
+/* Every fuzzed expression must give each object what it used to. */
+static int compare_with_old(int rounds)
+{
+  struct shop_buy_data entry;
+  struct obj_data obj;
+  char expr[256];
+  int i, n, failures = 0;
+
+  for (i = 0; i < rounds && failures < 10; i++) {
+    random_expression(expr, sizeof(expr));
+    entry.type = ITEM_WEAPON;
+    entry.keywords = expr;
+    entry.expr = NULL;
+    compile_buy_word(&entry);
+    for (n = 0; n < 64; n++) {
+      set_object(&obj, n);
+      if (!old_evaluate_expression(&obj, expr) != !evaluate_expression(&obj, entry.expr)) {
+        fprintf(stderr, "'%s' on '%s' flags %d: was %d\n", expr, obj.name, n,
+                !!old_evaluate_expression(&obj, expr));
+        failures++;
+        break;
+      }
+    }
+    entry.keywords = NULL;
+    free_buy_word(&entry);
+  }
+  return (failures);
+}
+
+/* A shop buying weapons named sword or dagger that do not glow. */
+static void make_world(int protos)
+{
+  int i;
+
+  top_of_objt = protos - 1;
+  CREATE(obj_proto, struct obj_data, protos);
+  for (i = 0; i < protos; i++) {
+    set_object(&obj_proto[i], i);
+    obj_proto[i].item_number = i;
+    GET_OBJ_TYPE(&obj_proto[i]) = ITEM_WEAPON;
+    GET_OBJ_COST(&obj_proto[i]) = 10;
+    REMOVE_BIT_AR(GET_OBJ_EXTRA(&obj_proto[i]), ITEM_NOSELL);
+  }
+
+  top_shop = 0;
+  CREATE(shop_index, struct shop_data, 1);
+  CREATE(shop_index[0].type, struct shop_buy_data, 2);
+  BUY_TYPE(shop_index[0].type[0]) = ITEM_WEAPON;
+  BUY_WORD(shop_index[0].type[0]) = strdup("(sword | dagger) & ^GLOW");
+  compile_buy_word(&shop_index[0].type[0]);
+  BUY_TYPE(shop_index[0].type[1]) = NOTHING;
+}
+
+static int check_cache(void)
+{
+  struct obj_data item;
+  char restrung[] = "dagger";
+  int failures = 0, verdict;
+
+  make_world(8);
+  item = obj_proto[0];	/* "sword long", no glow */
+  verdict = trade_with(&item, 0);
+  failures += expect_int("accepted", OBJECT_OK, verdict);
+  failures += expect_int("cached", SHOP_TRADE_YES, shop_index[0].trade_cache[0]);
+
+  /* A restrung or enchanted copy is judged on its own. */
+  item.name = (char *)"gem";
+  failures += expect_int("restrung", OBJECT_NOTOK, trade_with(&item, 0));
+  failures += expect_int("cache kept", SHOP_TRADE_YES, shop_index[0].trade_cache[0]);
+  item = obj_proto[4];	/* "gem" */
+  failures += expect_int("refused", OBJECT_NOTOK, trade_with(&item, 0));
+  item.name = restrung;
+  failures += expect_int("restrung accepted", OBJECT_OK, trade_with(&item, 0));
+  item = obj_proto[0];
+  SET_BIT_AR(GET_OBJ_EXTRA(&item), ITEM_GLOW);
+  failures += expect_int("enchanted", OBJECT_NOTOK, trade_with(&item, 0));
+
+  /* So is a spent wand, whatever its prototype is. */
+  item = obj_proto[0];
+  GET_OBJ_TYPE(&item) = ITEM_WAND;
+  failures += expect_int("other type", OBJECT_NOTOK, trade_with(&item, 0));
+
+  shop_forget_trades();
+  failures += expect_int("forgotten", 0, shop_index[0].trade_cache_size);
+  return (failures);
+}
+
+static double seconds(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return (tv.tv_sec + tv.tv_usec / 1000000.0);
+}
+
+/* shop_expr_test <rounds>: times listing a large inventory. */
+static void benchmark(int rounds)
+{
+  struct obj_data *inv;
+  double start, old_time, compiled_time, new_time;
+  int i, r, accepted = 0, old_accepted;
+
+  make_world(500);
+  CREATE(inv, struct obj_data, 500);
+  for (i = 0; i < 500; i++)
+    inv[i] = obj_proto[i];
+
+  start = seconds();
+  for (r = 0; r < rounds; r++)
+    for (i = 0; i < 500; i++)
+      accepted += !!old_evaluate_expression(&inv[i], SHOP_BUYWORD(0, 0));
+  old_time = seconds() - start;
+  old_accepted = accepted;
+
+  start = seconds();
+  for (r = 0; r < rounds; r++)
+    for (i = 0; i < 500; i++)
+      accepted -= !!evaluate_expression(&inv[i], shop_index[0].type[0].expr);
+  compiled_time = seconds() - start;
+
+  start = seconds();
+  for (r = 0; r < rounds; r++)
+    for (i = 0; i < 500; i++)
+      accepted += (trade_with(&inv[i], 0) == OBJECT_OK);
+  new_time = seconds() - start;
+
+  printf("%d items x %d rounds: parsed %.3fs, compiled %.3fs, cached %.3fs (%s)\n",
+         500, rounds, old_time, compiled_time, new_time,
+         accepted != old_accepted ? "MISMATCH" : "same verdicts");
+}
+
+int main(int argc, char **argv)
+{
+  int failures = 0;
+
+  if (argc > 1) {
+    benchmark(atoi(argv[1]));
+    return 0;
+  }
+
+  srand(17);
+  failures += compare_with_old(20000);
+
+  /* Malformed keywords are complained about when compiled, not every time. */
+  {
+    struct shop_buy_data entry = { ITEM_WEAPON, NULL, NULL };
+    struct obj_data obj;
+
+    entry.keywords = strdup("sword)(");
+    compile_buy_word(&entry);
+    set_object(&obj, 0);
+    logged = 0;
+    failures += expect_int("bad paren", FALSE, evaluate_expression(&obj, entry.expr));
+    failures += expect_int("quiet", 0, logged);
+    free_buy_word(&entry);
+
+    entry.keywords = strdup("");
+    compile_buy_word(&entry);
+    failures += expect_int("empty", TRUE, evaluate_expression(&obj, entry.expr));
+    free_buy_word(&entry);
+  }
+
+  failures += check_cache();
+  return (failures);
+}
@@ -0,0 +1,369 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+#include "dg_scripts.h"
+
+/* Stubs and globals required by snapshot.c */
+struct config_data config_info;
+struct player_special_data dummy_mob;
+int mini_mud = 0;
+
+struct zone_data *zone_table = NULL;
+zone_rnum top_of_zone_table = 0;
+struct index_data **trig_index = NULL;
+int top_of_trigt = 0;
+struct room_data *world = NULL;
+room_rnum top_of_world = 0;
+struct index_data *mob_index = NULL;
+struct char_data *mob_proto = NULL;
+mob_rnum top_of_mobt = 0;
+struct index_data *obj_index = NULL;
+struct obj_data *obj_proto = NULL;
+obj_rnum top_of_objt = 0;
+
+static int compiled = 0, attached = 0;
+
+void basic_mud_log(const char *format, ...) { (void)format; }
+void dg_compile_cmdlist(struct cmdlist_element *cmdlist, trig_vnum vnum)
+{
+  (void)vnum;
+  for (; cmdlist; cmdlist = cmdlist->next)
+    compiled++;
+}
+void assign_triggers(void *i, int type) { (void)i; (void)type; attached++; }
+int MAX(int a, int b) { return (a > b ? a : b); }
+
+#include "snapshot.c"
+
+#define NUM_ROOMS 300
+
+static int failures = 0;
+
+static void expect(const char *label, int ok)
+{
+  if (!ok) {
+    fprintf(stderr, "%s: failed\n", label);
+    failures++;
+  }
+}
+
+static void write_file(const char *path, const char *text)
+{
+  FILE *fl = fopen(path, "w");
+
+  fputs(text, fl);
+  fclose(fl);
+}
+
+static struct extra_descr_data *make_extra(const char *keyword, struct extra_descr_data *next)
+{
+  struct extra_descr_data *ex;
+
+  CREATE(ex, struct extra_descr_data, 1);
+  ex->keyword = strdup(keyword);
+  ex->description = strdup("You see nothing special.\r\n");
+  ex->next = next;
+  return (ex);
+}
+
+static struct trig_proto_list *make_protos(int vnum, int count)
+{
+  struct trig_proto_list *head = NULL, *tp;
+
+  while (count--) {
+    CREATE(tp, struct trig_proto_list, 1);
+    tp->vnum = vnum + count;
+    tp->next = head;
+    head = tp;
+  }
+  return (head);
+}
+
+static struct trig_data *make_trigger(int nr, const char **lines)
+{
+  struct cmdlist_element **tail;
+  struct trig_data *trig;
+
+  CREATE(trig, struct trig_data, 1);
+  trig->nr = nr;
+  trig->attach_type = WLD_TRIGGER;
+  trig->name = strdup("a test trigger");
+  trig->trigger_type = 1 << nr;
+  trig->narg = 100;
+  trig->arglist = nr ? strdup("hello") : NULL;
+  for (tail = &trig->cmdlist; *lines; lines++, tail = &(*tail)->next) {
+    CREATE(*tail, struct cmdlist_element, 1);
+    (*tail)->cmd = strdup(*lines);
+  }
+  return (trig);
+}
+
+/* A small world in the shape boot_world() leaves it. */
+static void make_world(void)
+{
+  static const char *lines0[] = { "if %actor.is_pc%", "  say hi", "end", NULL };
+  static const char *lines1[] = { "wait 1", NULL };
+  char buf[64];
+  int i;
+
+  top_of_zone_table = 1;
+  CREATE(zone_table, struct zone_data, 2);
+  for (i = 0; i < 2; i++) {
+    zone_table[i].name = strdup(i ? "The Second Zone" : "The First Zone");
+    zone_table[i].builders = i ? strdup("None.") : NULL;
+    zone_table[i].number = i;
+    zone_table[i].bot = i * 100;
+    zone_table[i].top = i * 100 + 99;
+    zone_table[i].lifespan = 30;
+    zone_table[i].reset_mode = 2;
+  }
+  CREATE(zone_table[0].cmd, struct reset_com, 3);
+  zone_table[0].cmd[0].command = 'M';
+  zone_table[0].cmd[0].arg1 = 1;
+  zone_table[0].cmd[0].arg3 = 2;
+  zone_table[0].cmd[1].command = 'V';
+  zone_table[0].cmd[1].sarg1 = strdup("quest");
+  zone_table[0].cmd[1].sarg2 = strdup("started");
+  zone_table[0].cmd[2].command = 'S';
+  CREATE(zone_table[1].cmd, struct reset_com, 1);
+  zone_table[1].cmd[0].command = 'S';
+
+  top_of_trigt = 2;
+  CREATE(trig_index, struct index_data *, 2);
+  for (i = 0; i < 2; i++) {
+    CREATE(trig_index[i], struct index_data, 1);
+    trig_index[i]->vnum = 10 + i;
+    trig_index[i]->number = 5;
+    trig_index[i]->proto = make_trigger(i, i ? lines1 : lines0);
+  }
+
+  top_of_world = NUM_ROOMS - 1;
+  CREATE(world, struct room_data, NUM_ROOMS);
+  for (i = 0; i < NUM_ROOMS; i++) {
+    world[i].number = i;
+    world[i].zone = i >= 100;
+    world[i].sector_type = i % 7;
+    world[i].room_flags[0] = i * 3;
+    snprintf(buf, sizeof(buf), "Room %d", i);
+    world[i].name = strdup(buf);
+    world[i].description = i % 5 ? strdup("A plain room.\r\n") : NULL;
+    if (i % 4 == 0)
+      world[i].ex_description = make_extra("wall", make_extra("floor", NULL));
+    if (i + 1 < NUM_ROOMS) {
+      CREATE(world[i].dir_option[i % NUM_OF_DIRS], struct room_direction_data, 1);
+      world[i].dir_option[i % NUM_OF_DIRS]->keyword = i % 2 ? strdup("door") : NULL;
+      world[i].dir_option[i % NUM_OF_DIRS]->exit_info = EX_ISDOOR;
+      world[i].dir_option[i % NUM_OF_DIRS]->key = NOTHING;
+      world[i].dir_option[i % NUM_OF_DIRS]->to_room = i + 1;
+    }
+    if (i % 10 == 0) {
+      world[i].proto_script = make_protos(10, 2);
+      CREATE(world[i].script, struct script_data, 1);
+    }
+  }
+
+  top_of_mobt = 1;
+  CREATE(mob_index, struct index_data, 2);
+  CREATE(mob_proto, struct char_data, 2);
+  for (i = 0; i < 2; i++) {
+    mob_index[i].vnum = i + 1;
+    mob_proto[i].nr = i;
+    mob_proto[i].in_room = NOWHERE;
+    mob_proto[i].player.name = strdup("guard cityguard");
+    mob_proto[i].player.short_descr = strdup("the cityguard");
+    mob_proto[i].player.long_descr = strdup("A cityguard stands here.\r\n");
+    mob_proto[i].player_specials = &dummy_mob;
+    mob_proto[i].points.max_hit = 100 + i;
+    mob_proto[i].points.money = 1234567890123LL;
+    mob_proto[i].proto_script = i ? make_protos(11, 1) : NULL;
+  }
+
+  top_of_objt = 1;
+  CREATE(obj_index, struct index_data, 2);
+  CREATE(obj_proto, struct obj_data, 2);
+  for (i = 0; i < 2; i++) {
+    obj_index[i].vnum = i + 1;
+    obj_proto[i].item_number = i;
+    obj_proto[i].in_room = NOWHERE;
+    obj_proto[i].name = strdup("sword long");
+    obj_proto[i].short_description = strdup("a long sword");
+    obj_proto[i].description = strdup("A long sword lies here.");
+    obj_proto[i].obj_flags.value[1] = 4 + i;
+    obj_proto[i].affected[0].location = APPLY_STR;
+    obj_proto[i].affected[0].modifier = 2;
+    obj_proto[i].ex_description = make_extra("blade", NULL);
+  }
+}
+
+static int same_string(const char *a, const char *b)
+{
+  if (!a || !b)
+    return (a == b);
+  return (a != b && !strcmp(a, b));
+}
+
+/* Compares what snapshot_load() built against the originals. */
+static void check_loaded(struct snap_world *was)
+{
+  struct extra_descr_data *ea, *eb;
+  struct cmdlist_element *ca, *cb;
+  int i, d;
+
+  expect("zone count", top_of_zone_table == 1);
+  expect("zone name", same_string(zone_table[0].name, was->zones[0].name));
+  expect("zone builders", same_string(zone_table[0].builders, was->zones[0].builders) &&
+         same_string(zone_table[1].builders, was->zones[1].builders));
+  expect("zone cmd", zone_table[0].cmd[0].command == 'M' && zone_table[0].cmd[0].arg3 == 2);
+  expect("zone sargs", same_string(zone_table[0].cmd[1].sarg2, was->zones[0].cmd[1].sarg2));
+  expect("zone end", zone_table[0].cmd[2].command == 'S' && zone_table[1].cmd[0].command == 'S');
+
+  expect("trigger count", top_of_trigt == 2);
+  expect("trigger number", trig_index[0]->number == 0);
+  expect("trigger arglist", same_string(trig_index[1]->proto->arglist, "hello") &&
+         !trig_index[0]->proto->arglist);
+  for (i = 0; i < 2; i++)
+    for (ca = trig_index[i]->proto->cmdlist, cb = was->trigs[i]->proto->cmdlist;
+         ca || cb; ca = ca->next, cb = cb->next)
+      if (!ca || !cb || !same_string(ca->cmd, cb->cmd)) {
+        expect("trigger lines", FALSE);
+        break;
+      }
+  expect("trigger compiled", compiled == 4);
+
+  expect("room count", top_of_world == NUM_ROOMS - 1);
+  for (i = 0; i < NUM_ROOMS; i++) {
+    if (!same_string(world[i].name, was->rooms[i].name) ||
+        !same_string(world[i].description, was->rooms[i].description) ||
+        world[i].room_flags[0] != i * 3 || world[i].zone != was->rooms[i].zone ||
+        world[i].script) {
+      expect("room", FALSE);
+      break;
+    }
+    for (ea = world[i].ex_description, eb = was->rooms[i].ex_description;
+         ea || eb; ea = ea->next, eb = eb->next)
+      if (!ea || !eb || !same_string(ea->keyword, eb->keyword)) {
+        expect("room extras", FALSE);
+        break;
+      }
+    for (d = 0; d < NUM_OF_DIRS; d++)
+      if (!world[i].dir_option[d] != !was->rooms[i].dir_option[d] ||
+          (world[i].dir_option[d] &&
+           (world[i].dir_option[d]->to_room != was->rooms[i].dir_option[d]->to_room ||
+            !same_string(world[i].dir_option[d]->keyword, was->rooms[i].dir_option[d]->keyword))))
+        expect("room exit", FALSE);
+  }
+  expect("room trigger list", world[10].proto_script && world[10].proto_script->vnum == 10 &&
+         world[10].proto_script->next && world[10].proto_script->next->vnum == 11 &&
+         !world[10].proto_script->next->next && !world[11].proto_script);
+  expect("room triggers attached", attached == NUM_ROOMS / 10);
+
+  expect("mob count", top_of_mobt == 1);
+  expect("mob strings", same_string(mob_proto[1].player.long_descr, was->mobs[1].player.long_descr) &&
+         !mob_proto[1].player.description);
+  expect("mob numbers", mob_proto[1].points.max_hit == 101 &&
+         mob_proto[1].points.money == 1234567890123LL && mob_index[1].vnum == 2);
+  expect("mob specials", mob_proto[0].player_specials == &dummy_mob);
+  expect("mob triggers", !mob_proto[0].proto_script && mob_proto[1].proto_script &&
+         mob_proto[1].proto_script->vnum == 11);
+
+  expect("obj count", top_of_objt == 1);
+  expect("obj strings", same_string(obj_proto[1].description, was->objs[1].description) &&
+         !obj_proto[1].action_description);
+  expect("obj numbers", obj_proto[1].obj_flags.value[1] == 5 &&
+         obj_proto[1].affected[0].modifier == 2 && obj_index[1].vnum == 2);
+  expect("obj extras", obj_proto[0].ex_description &&
+         same_string(obj_proto[0].ex_description->keyword, "blade") &&
+         !obj_proto[0].ex_description->next);
+}
+
+static void install(struct snap_world *w)
+{
+  zone_table = w->zones;
+  top_of_zone_table = w->num_zones - 1;
+  trig_index = w->trigs;
+  top_of_trigt = w->num_trigs;
+  world = w->rooms;
+  top_of_world = w->num_rooms - 1;
+  mob_index = w->mob_index;
+  mob_proto = w->mobs;
+  top_of_mobt = w->num_mobs - 1;
+  obj_index = w->obj_index;
+  obj_proto = w->objs;
+  top_of_objt = w->num_objs - 1;
+}
+
+int main(void)
+{
+  char dir[] = "/tmp/snaptestXXXXXX", *name;
+  struct snap_world text;
+  FILE *fl;
+
+  if (!mkdtemp(dir) || chdir(dir)) {
+    perror(dir);
+    return 1;
+  }
+  mkdir("world", 0755);
+  mkdir("world/zon", 0755);
+  mkdir("world/trg", 0755);
+  mkdir("world/wld", 0755);
+  mkdir("world/mob", 0755);
+  mkdir("world/obj", 0755);
+  write_file("world/zon/index", "0.zon\n1.zon\n$\n");
+  write_file("world/zon/0.zon", "#0\n");
+  write_file("world/zon/1.zon", "#1\n");
+  write_file("world/trg/index", "0.trg\n$\n");
+  write_file("world/trg/0.trg", "#10\n");
+  write_file("world/wld/index", "0.wld\n$\n");
+  write_file("world/wld/0.wld", "#0\n");
+  write_file("world/mob/index", "0.mob\n$\n");
+  write_file("world/mob/0.mob", "#1\n");
+  write_file("world/obj/index", "0.obj\n$\n");
+  write_file("world/obj/0.obj", "#1\n");
+
+  expect("nothing to load", !snapshot_load());
+
+  make_world();
+  current_world(&text);
+  snapshot_save();
+  expect("verify", snapshot_verify() == 0);
+
+  /* Loading replaces every table with a fresh copy. */
+  compiled = attached = 0;
+  expect("load", snapshot_load());
+  check_loaded(&text);
+  expect("verify loaded", snapshot_verify() == 0);
+
+  /* A table that no longer matches is reported. */
+  install(&text);
+  name = world[123].name;
+  world[123].name = strdup("Room 124");
+  expect("verify changed", snapshot_verify() == 1);
+  world[123].name = name;
+  world[7].dir_option[7 % NUM_OF_DIRS]->to_room = 3;
+  expect("verify changed exit", snapshot_verify() == 1);
+  world[7].dir_option[7 % NUM_OF_DIRS]->to_room = 8;
+  expect("verify restored", snapshot_verify() == 0);
+
+  /* So is a snapshot that does not fit the files or the settings. */
+  config_info.play.diagonal_dirs = !config_info.play.diagonal_dirs;
+  expect("other settings", !snapshot_load());
+  config_info.play.diagonal_dirs = !config_info.play.diagonal_dirs;
+
+  write_file("world/mob/0.mob", "#2\n");
+  expect("stale verify", snapshot_verify() == 1);
+  expect("stale", !snapshot_load());
+  write_file("world/mob/0.mob", "#1\n");
+
+  expect("unchanged again", snapshot_load());
+  install(&text);
+  fl = fopen(SNAPSHOT_FILE, "r+b");
+  fseek(fl, -10, SEEK_END);
+  fputc('!', fl);
+  fclose(fl);
+  expect("damaged", !snapshot_load());
+
+  return failures;
+}
@@ -0,0 +1,180 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+
+/* Stubs and globals required by trace.c */
+struct descriptor_data *descriptor_list = NULL;
+unsigned long pulse = 0;
+
+void basic_mud_log(const char *format, ...) { (void)format; }
+
+#include "trace.c"
+
+static struct descriptor_data descs[3];
+static char got[2048];
+
+static void note(const char *fmt, ...)
+{
+  va_list args;
+  size_t len = strlen(got);
+
+  va_start(args, fmt);
+  vsnprintf(got + len, sizeof(got) - len, fmt, args);
+  va_end(args);
+}
+
+struct descriptor_data *replay_descriptor(int desc_num, const char *host)
+{
+  struct descriptor_data *d = &descs[desc_num % 3];
+
+  note("%lu connect %d %s\n", pulse, desc_num, host);
+  d->descriptor = INVALID_SOCKET;
+  d->desc_num = desc_num;
+  d->next = descriptor_list;
+  descriptor_list = d;
+  return (d);
+}
+
+void write_to_q(const char *txt, struct txt_q *queue, int aliased)
+{
+  (void)queue; (void)aliased;
+  note("%lu input %s\n", pulse, txt);
+}
+
+void close_socket(struct descriptor_data *d)
+{
+  struct descriptor_data *temp;
+
+  note("%lu drop %d\n", pulse, d->desc_num);
+  REMOVE_FROM_LIST(d, descriptor_list, next);
+}
+
+/* Replays fname from the start, ten passes at most. */
+static void replay(const char *fname)
+{
+  unsigned long seed;
+
+  got[0] = '\0';
+  descriptor_list = NULL;
+  if (!trace_replay_start(fname, FALSE, &seed))
+    return;
+  for (pulse = 0; !trace_replay_done() && pulse < 10; pulse++)
+    trace_replay_input();
+  trace_stop();
+}
+
+static const char *expected =
+  "3 connect 7 10.0.0.1\n"
+  "3 connect 998 example.org\n"
+  "5 input NEW\n"
+  "5 input say hello\n"
+  "9 heartbeats 4\n"
+  "300 input look\n"
+  "300 drop 998\n"
+  "301 drop 7\n";
+
+int main(void)
+{
+  struct descriptor_data a, b;
+  char line[MAX_INPUT_LENGTH];
+  const char *fname = "trace_test.trace";
+  unsigned long seed = 0;
+  int n, failures = 0;
+
+  memset(&a, 0, sizeof(a));
+  memset(&b, 0, sizeof(b));
+  a.desc_num = 7;
+  strcpy(a.host, "10.0.0.1");
+  b.desc_num = 998;
+  strcpy(b.host, "example.org");
+
+  if (!trace_record_start(fname, 123456789UL)) {
+    fprintf(stderr, "could not start recording\n");
+    return 1;
+  }
+  pulse = 3;
+  trace_connect(&a);
+  trace_connect(&b);
+  trace_heartbeats(1);
+  pulse = 5;
+  trace_input(&a, "NEW");
+  trace_input(&b, "say hello");
+  pulse = 9;
+  trace_heartbeats(4);
+  pulse = 300;
+  trace_input(&a, "look");
+  trace_drop(&b, TRACE_DROP_INPUT);
+  pulse = 301;
+  trace_drop(&a, TRACE_DROP_OUTPUT);
+  pulse = 320;
+  trace_stop();
+
+  /* The replay side asks for each phase of every pass in turn. */
+  if (!trace_replay_start(fname, TRUE, &seed)) {
+    fprintf(stderr, "could not start replaying\n");
+    return 1;
+  }
+  if (seed != 123456789UL) {
+    fprintf(stderr, "seed came back as %lu\n", seed);
+    failures++;
+  }
+  if (!trace_replay_fast()) {
+    fprintf(stderr, "replay should be fast\n");
+    failures++;
+  }
+
+  for (pulse = 0; !trace_replay_done(); ) {
+    trace_replay_input();
+    trace_replay_output();
+    if ((n = trace_replay_heartbeats()) != 1)
+      note("%lu heartbeats %d\n", pulse, n);
+    pulse += n;
+    if (pulse > 1000)
+      break;
+  }
+  trace_stop();
+
+  if (strcmp(got, expected)) {
+    fprintf(stderr, "replayed:\n%sexpected:\n%s", got, expected);
+    failures++;
+  }
+  if (pulse != 320) {
+    fprintf(stderr, "replay ended at pulse %lu instead of 320\n", pulse);
+    failures++;
+  }
+
+  /* The longest line the game takes survives the trip. */
+  memset(line, 'x', sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\0';
+  pulse = 0;
+  trace_record_start(fname, 1);
+  trace_connect(&a);
+  trace_input(&a, line);
+  trace_stop();
+  replay(fname);
+  if (strncmp(got, "0 connect 7 10.0.0.1\n0 input ", 29) ||
+      strncmp(got + 29, line, strlen(line)) || strcmp(got + 29 + strlen(line), "\n")) {
+    fprintf(stderr, "long line replayed as:\n%s", got);
+    failures++;
+  }
+
+  /* A trace cut off part way stops where the damage starts. */
+  if (truncate(fname, 30) < 0)
+    perror(fname);
+  replay(fname);
+  if (strcmp(got, "0 connect 7 10.0.0.1\n")) {
+    fprintf(stderr, "damaged trace replayed as:\n%s", got);
+    failures++;
+  }
+
+  unlink(fname);
+  if (failures) {
+    fprintf(stderr, "%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("trace tests passed\n");
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+
+#define NUM_CHARS 5
+
+static int failures = 0;
+
+/* Walks the list both ways and compares it with the expected order. */
+static void expect_order(const char *label, struct char_data *head,
+                         struct char_data *chars, const char *expected)
+{
+  struct char_data *ch, *last = NULL;
+  char got[NUM_CHARS + 1];
+  int n = 0;
+
+  for (ch = head; ch && n < NUM_CHARS; last = ch, ch = ch->next_in_room) {
+    if (ch->prev_in_room != last) {
+      fprintf(stderr, "%s: bad back link at %c\n", label, 'a' + (int) (ch - chars));
+      failures++;
+    }
+    got[n++] = 'a' + (int) (ch - chars);
+  }
+  got[n] = '\0';
+
+  if (strcmp(got, expected)) {
+    fprintf(stderr, "%s: expected '%s' but got '%s'\n", label, expected, got);
+    failures++;
+  }
+}
+
+int main(void)
+{
+  struct char_data chars[NUM_CHARS], *people = NULL;
+  int i;
+
+  memset(chars, 0, sizeof(chars));
+
+  for (i = 0; i < NUM_CHARS; i++)
+    LINK_HEAD(&chars[i], people, next_in_room, prev_in_room);
+  expect_order("linked", people, chars, "edcba");
+
+  /* The middle, the head and the tail. */
+  UNLINK_HEAD(&chars[2], people, next_in_room, prev_in_room);
+  expect_order("middle", people, chars, "edba");
+  UNLINK_HEAD(&chars[4], people, next_in_room, prev_in_room);
+  expect_order("head", people, chars, "dba");
+  UNLINK_HEAD(&chars[0], people, next_in_room, prev_in_room);
+  expect_order("tail", people, chars, "db");
+
+  /* A loop standing on a removed item can still step forward. */
+  if (chars[4].next_in_room != &chars[3]) {
+    fprintf(stderr, "removed item lost its next link\n");
+    failures++;
+  }
+
+  /* Removing something that is not on the list changes nothing. */
+  UNLINK_HEAD(&chars[2], people, next_in_room, prev_in_room);
+  expect_order("not listed", people, chars, "db");
+
+  UNLINK_HEAD(&chars[3], people, next_in_room, prev_in_room);
+  UNLINK_HEAD(&chars[1], people, next_in_room, prev_in_room);
+  expect_order("emptied", people, chars, "");
+
+  LINK_HEAD(&chars[2], people, next_in_room, prev_in_room);
+  expect_order("relinked", people, chars, "c");
+
+  return failures;
+}
@@ -0,0 +1,236 @@
+#include "conf.h"
+#include "sysdep.h"
+
+#include "structs.h"
+#include "utils.h"
+#include "spells.h"
+#include "comm.h"
+#include "db.h"
+#include "handler.h"
+#include "class.h"
+#include "fight.h"
+#include "mud_event.h"
+#include "dg_scripts.h"
+
+/* Stubs and globals required by limits.c and magic.c */
+struct char_data *character_list = NULL;
+struct obj_data *object_list = NULL;
+struct room_data *world = NULL;
+struct index_data *obj_index = NULL;
+obj_rnum top_of_objt = 0;
+struct config_data config_info;
+struct player_special_data dummy_mob;
+struct happyhour happy_data;
+struct spell_info_type spell_info[TOP_SPELL_DEFINE + 1];
+
+static int dormant = FALSE;
+
+int MAX(int a, int b) { return a > b ? a : b; }
+int MIN(int a, int b) { return a < b ? a : b; }
+
+void basic_mud_log(const char *format, ...) { (void)format; }
+void mudlog(int type, int level, int file, const char *str, ...) { (void)type; (void)level; (void)file; (void)str; }
+void game_info(const char *messg, ...) { (void)messg; }
+size_t send_to_char(struct char_data *ch, const char *messg, ...) { (void)ch; (void)messg; return 0; }
+char *act(const char *str, int hide_invisible, struct char_data *ch, struct obj_data *obj, void *vict_obj, int type) { (void)str; (void)hide_invisible; (void)ch; (void)obj; (void)vict_obj; (void)type; return NULL; }
+void core_dump_real(const char *who, int line) { (void)who; (void)line; }
+
+void Crash_crashsave(struct char_data *ch) { (void)ch; }
+void Crash_idlesave(struct char_data *ch) { (void)ch; }
+void Crash_rentsave(struct char_data *ch, int cost) { (void)ch; (void)cost; }
+void add_llog_entry(struct char_data *ch, int type) { (void)ch; (void)type; }
+void advance_level(struct char_data *ch) { (void)ch; }
+void save_char(struct char_data *ch) { (void)ch; }
+void update_char_objects(struct char_data *ch) { (void)ch; }
+void reboot_wizlists(void) { }
+void stop_fighting(struct char_data *ch) { (void)ch; }
+int damage(struct char_data *ch, struct char_data *victim, int dam, int attacktype) { (void)ch; (void)victim; (void)dam; (void)attacktype; return 0; }
+int level_exp(int chclass, int level) { (void)chclass; return level * 1000; }
+const char *title_male(int chclass, int level) { (void)chclass; (void)level; return ""; }
+const char *title_female(int chclass, int level) { (void)chclass; (void)level; return ""; }
+byte saving_throws(int class_num, int type, int level) { (void)class_num; (void)type; (void)level; return 0; }
+int rand_number(int from, int to) { (void)to; return from; }
+int dice(int number, int size) { (void)size; return number; }
+int crit_check_heal(struct char_data *ch, int *mult) { (void)ch; (void)mult; return FALSE; }
+int crit_check_spell(struct char_data *ch, int *mult) { (void)ch; (void)mult; return FALSE; }
+void crit_show_banner(struct char_data *ch, struct char_data *victim, int mult) { (void)ch; (void)victim; (void)mult; }
+
+struct time_info_data *age(struct char_data *ch)
+{
+  static struct time_info_data years;
+
+  (void)ch;
+  years.year = 20;
+  return (&years);
+}
+
+void add_follower(struct char_data *ch, struct char_data *leader) { (void)ch; (void)leader; }
+void join_group(struct char_data *ch, struct group_data *group) { (void)ch; (void)group; }
+void char_from_room(struct char_data *ch) { (void)ch; }
+void char_to_room(struct char_data *ch, room_rnum room) { (void)ch; (void)room; }
+void extract_char(struct char_data *ch) { (void)ch; }
+void extract_obj(struct obj_data *obj) { (void)obj; }
+void obj_from_obj(struct obj_data *obj) { (void)obj; }
+void obj_to_char(struct obj_data *object, struct char_data *ch) { (void)object; (void)ch; }
+void obj_to_obj(struct obj_data *obj, struct obj_data *obj_to) { (void)obj; (void)obj_to; }
+void obj_to_room(struct obj_data *object, room_rnum room) { (void)object; (void)room; }
+struct char_data *read_mobile(mob_vnum nr, int type) { (void)nr; (void)type; return NULL; }
+struct obj_data *read_object(obj_vnum nr, int type) { (void)nr; (void)type; return NULL; }
+void load_mtrigger(char_data *ch) { (void)ch; }
+void load_otrigger(obj_data *obj) { (void)obj; }
+void timer_otrigger(obj_data *obj) { (void)obj; }
+void new_affect(struct affected_type *af) { memset(af, 0, sizeof(*af)); }
+struct mud_event_data *new_mud_event(event_id iId, void *pStruct, char *sVariables) { (void)iId; (void)pStruct; (void)sVariables; return NULL; }
+void attach_mud_event(struct mud_event_data *pMudEvent, long time) { (void)pMudEvent; (void)time; }
+void *simple_list(struct list_data *pList) { (void)pList; return NULL; }
+void update_zone_player(struct char_data *ch) { (void)ch; }
+ASPELL(spell_recall) { (void)level; (void)ch; (void)victim; (void)obj; }
+
+void affect_from_char(struct char_data *ch, int type) { (void)ch; (void)type; }
+void affect_join(struct char_data *ch, struct affected_type *af,
+  bool add_dur, bool avg_dur, bool add_mod, bool avg_mod)
+{
+  (void)ch; (void)af; (void)add_dur; (void)avg_dur; (void)add_mod; (void)avg_mod;
+}
+bool affected_by_spell(struct char_data *ch, int type) { (void)ch; (void)type; return FALSE; }
+
+/* Only mana modifiers matter here: they move the cap regeneration runs into. */
+void affect_remove(struct char_data *ch, struct affected_type *af)
+{
+  struct affected_type *temp;
+
+  if (af->location == APPLY_MANA)
+    GET_MAX_MANA(ch) -= af->modifier;
+  REMOVE_FROM_LIST(af, ch->affected, next);
+  free(af);
+}
+
+int effective_max_mana(const struct char_data *ch) { return GET_MAX_MANA(ch); }
+int effective_max_move(const struct char_data *ch) { return GET_MAX_MOVE(ch); }
+int mobile_dormant(struct char_data *ch) { (void)ch; return dormant; }
+
+void update_pos(struct char_data *victim)
+{
+  if ((GET_HIT(victim) > 0) && (GET_POS(victim) > POS_STUNNED))
+    return;
+  else if (GET_HIT(victim) > 0)
+    GET_POS(victim) = POS_STANDING;
+  else
+    GET_POS(victim) = POS_STUNNED;
+}
+
+#include "limits.c"
+#include "magic.c"
+
+static int failures = 0;
+
+static void add_affect(struct char_data *ch, int spell, int duration, int location, int modifier)
+{
+  struct affected_type *af;
+
+  CREATE(af, struct affected_type, 1);
+  af->spell = spell;
+  af->duration = duration;
+  af->location = location;
+  af->modifier = modifier;
+  af->next = ch->affected;
+  ch->affected = af;
+}
+
+/* A level 10 mobile that regains 10 of each point a tick.  The bless it
+ * carries ends on tick 'ends' and took 50 off its mana cap with it. */
+static void make_mobile(struct char_data *ch, int pos, int hit, int ends)
+{
+  memset(ch, 0, sizeof(*ch));
+  ch->player_specials = &dummy_mob;
+  SET_BIT_AR(MOB_FLAGS(ch), MOB_ISNPC);
+  GET_LEVEL(ch) = 10;
+  GET_POS(ch) = pos;
+  GET_HIT(ch) = hit;
+  GET_MAX_HIT(ch) = 100;
+  GET_MANA(ch) = 120;
+  GET_MAX_MANA(ch) = 150;
+  GET_MOVE(ch) = 10;
+  GET_MAX_MOVE(ch) = 100;
+  add_affect(ch, SPELL_BLESS, ends - 1, APPLY_MANA, 50);
+  add_affect(ch, SPELL_ARMOR, ends, APPLY_NONE, 0);
+  add_affect(ch, SPELL_STRENGTH, ends + 5, APPLY_NONE, 0);
+  add_affect(ch, SPELL_INFRAVISION, -1, APPLY_NONE, 0);
+}
+
+static void describe(struct char_data *ch, char *buf, size_t len)
+{
+  struct affected_type *af;
+  size_t n;
+
+  n = snprintf(buf, len, "pos %d hit %d mana %d/%d move %d, affects",
+    GET_POS(ch), GET_HIT(ch), GET_MANA(ch), GET_MAX_MANA(ch), GET_MOVE(ch));
+  for (af = ch->affected; af && n < len; af = af->next)
+    n += snprintf(buf + n, len - n, " %d:%d", af->spell, af->duration);
+}
+
+static void free_affects(struct char_data *ch)
+{
+  while (ch->affected)
+    affect_remove(ch, ch->affected);
+}
+
+/* Runs 'ticks' ticks on one mobile awake and on another asleep, wakes the
+ * second and expects the two to match. */
+static void compare(const char *label, int pos, int hit, int ticks, int ends)
+{
+  struct char_data live, slept;
+  char want[256], got[256];
+  int i;
+
+  make_mobile(&live, pos, hit, ends);
+  make_mobile(&slept, pos, hit, ends);
+
+  dormant = FALSE;
+  character_list = &live;
+  for (i = 0; i < ticks; i++) {
+    affect_update();
+    point_update();
+  }
+
+  dormant = TRUE;
+  character_list = &slept;
+  for (i = 0; i < ticks; i++) {
+    affect_update();
+    point_update();
+  }
+  if (slept.char_specials.dormant_ticks != ticks) {
+    fprintf(stderr, "%s: slept through %d ticks, not %d\n", label,
+      slept.char_specials.dormant_ticks, ticks);
+    failures++;
+  }
+  wake_mobile(&slept);
+
+  describe(&live, want, sizeof(want));
+  describe(&slept, got, sizeof(got));
+  if (strcmp(want, got)) {
+    fprintf(stderr, "%s:\n  awake: %s\n  slept: %s\n", label, want, got);
+    failures++;
+  }
+
+  character_list = NULL;
+  free_affects(&live);
+  free_affects(&slept);
+}
+
+int main(void)
+{
+  compare("one tick", POS_STANDING, 20, 1, 3);
+  compare("bless ends on the last tick", POS_STANDING, 20, 3, 3);
+  compare("bless ended a tick earlier", POS_STANDING, 20, 4, 3);
+  compare("hit points reach the cap", POS_STANDING, 20, 12, 3);
+  compare("still blessed", POS_STANDING, 20, 2, 3);
+  compare("stunned", POS_STUNNED, 0, 3, 3);
+
+  if (failures) {
+    fprintf(stderr, "%d failure(s)\n", failures);
+    return 1;
+  }
+  printf("zone dormancy tests passed\n");
+  return 0;
+}